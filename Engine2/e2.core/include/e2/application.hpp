@@ -25,6 +25,10 @@ namespace e2
 		virtual ~Application();
 
 		virtual void initialize() =0;
+
+		/** Called once the main loop has stopped, while async tasks still run. Finish anything in flight that must not be lost */
+		virtual void preShutdown();
+
 		virtual void shutdown() = 0;
 		virtual void update(double seconds) = 0;
 
@@ -38,6 +38,12 @@ namespace e2
 		//
 		AudioStream,
 
+		// Submeshes store whether their streams are quantized, and their index format
+		QuantizedMeshes,
+
+		// Meshes store simplified levels of detail, and the screen sizes to switch at
+		MeshLods,
+
 		// New versions above this line 
 		End,
 		Latest = End - 1
@@ -330,10 +330,37 @@ namespace e2
 			return finder->second;
 		}
 
+		/** Size of the skin palette this mesh indexes, one past the highest bone index */
+		inline uint32_t numBones() const
+		{
+			return m_numBones;
+		}
+
+		/** Levels of detail including the full detail one, simplified levels are index ranges in the submeshes (see e2::SubmeshSpecification::lod) */
+		inline uint8_t lodCount() const
+		{
+			return uint8_t(m_lodScreenSizes.size() + 1);
+		}
+
+		/** Screen size (fraction of the screen height covered by radius()) below which the given simplified level is used */
+		inline float lodScreenSize(uint8_t level) const
+		{
+			return m_lodScreenSizes[level - 1];
+		}
+
+		/** Distance from the mesh origin to its farthest vertex, only known for meshes with simplified levels */
+		inline float radius() const
+		{
+			return m_radius;
+		}
+
 	protected:
 		e2::StackVector<e2::SubmeshSpecification, e2::maxNumSubmeshes> m_specifications;
 		e2::StackVector<e2::MaterialPtr, e2::maxNumSubmeshes> m_materials;
 		std::unordered_map<e2::Name, uint32_t> m_boneIndex;
+		uint32_t m_numBones{};
+		e2::StackVector<float, e2::maxNumLods - 1> m_lodScreenSizes;
+		float m_radius{};
 		bool m_done{};
 	};
 
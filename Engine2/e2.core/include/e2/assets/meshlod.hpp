@@ -0,0 +1,92 @@
+
+#pragma once
+
+#include <e2/buildcfg.hpp>
+#include <e2/export.hpp>
+#include <e2/utils.hpp>
+#include <e2/renderer/meshspecification.hpp>
+
+#include <vector>
+
+namespace e2
+{
+	/** How far past a switch point the screen size has to go before a proxy changes level, as a fraction of it. Keeps proxies at the boundary from flickering */
+	constexpr float lodHysteresis = 0.1f;
+
+	/** Two vertices are skinned alike if their bone weights differ by at most this much in total. Vertices next to one that isn't stay put */
+	constexpr float lodSkinTolerance = 0.5f;
+
+	/** How the importers build simplified levels of detail for a mesh */
+	struct E2_API MeshLodSettings
+	{
+		/** Simplified levels to build after the full detail one, at most maxNumLods - 1 */
+		uint32_t numLods{ 3 };
+
+		/** Each level aims for this fraction of the triangles in the level before it */
+		float triangleRatio{ 0.5f };
+
+		/** Error any level may have, relative to the mesh radius. Levels stop short of their triangle target rather than go past it */
+		float maxError{ 0.05f };
+
+		/** Error a level may show, as a fraction of the screen height. Decides the screen sizes levels switch at */
+		float maxScreenError{ 1.0f / 1080.0f };
+	};
+
+	/** One submesh the way the importers have it, weights and bones are null if it isn't skinned */
+	struct E2_API LodSource
+	{
+		uint32_t const* indices{};
+		uint32_t numIndices{};
+		glm::vec4 const* positions{};
+		uint32_t numVertices{};
+		glm::vec4 const* weights{};
+		glm::uvec4 const* bones{};
+	};
+
+	/** Levels of a submesh, all of them in one index list starting with the full detail indices */
+	struct E2_API LodSubmesh
+	{
+		std::vector<uint32_t> indices;
+		std::vector<e2::SubmeshLod> levels;
+	};
+
+	/** Levels of detail for a whole mesh, what mesh assets store */
+	struct E2_API MeshLods
+	{
+		float radius{};
+
+		/** Screen size below which each simplified level is used, never growing from one level to the next */
+		std::vector<float> screenSizes;
+
+		std::vector<e2::LodSubmesh> submeshes;
+	};
+
+	/**
+	 * Simplifies a triangle list by collapsing edges in order of quadric error, until it has at most targetIndexCount indices or the next collapse would go past maxError.
+	 * Vertices are only ever collapsed onto a neighbour, so the result indexes the same vertices with their attributes and skinning intact. Vertices on seams (sharing a position
+	 * with another vertex) or next to a differently skinned vertex stay put, and border vertices only move along the border. Weights and bones may be null.
+	 * Returns the error, as a distance in the units of the positions
+	 */
+	E2_API float simplifyIndices(uint32_t const* indices, uint32_t numIndices, glm::vec4 const* positions, uint32_t numVertices, glm::vec4 const* weights, glm::uvec4 const* bones, uint32_t targetIndexCount, float maxError, std::vector<uint32_t>& outIndices);
+
+	/** Distance from the origin to the farthest vertex, screen sizes are measured from this */
+	E2_API float meshRadius(glm::vec4 const* positions, uint32_t numVertices);
+
+	/** Builds settings.numLods levels for every submesh, each aiming for a fraction of the triangles of the one before. A level that can't get below the one before reuses its indices */
+	E2_API void generateMeshLods(e2::MeshLodSettings const& settings, e2::LodSource const* submeshes, uint32_t numSubmeshes, e2::MeshLods& outLods);
+
+	/** Screen size below which a level with the given error (relative to the mesh radius) shows at most maxScreenError of it */
+	E2_API float lodScreenSize(float relativeError, float maxScreenError);
+
+	/** Projected size of a sphere, as a fraction of the screen height */
+	E2_API float projectedScreenSize(float radius, float distance, float tanHalfFov);
+
+	/**
+	 * Level of detail to use at the given screen size. maxScreenSizes[i] is the size below which level i is used (maxScreenSizes[0] isn't read).
+	 * Only moves away from currentLevel once the size is past the switch point by the hysteresis fraction
+	 */
+	E2_API uint8_t selectLod(float const* maxScreenSizes, uint8_t numLevels, uint8_t currentLevel, float screenSize, float hysteresis);
+
+	/** Simplifies reference meshes and checks triangle targets, error, borders, seams and skinning, then LOD selection and its hysteresis */
+	E2_API bool testMeshLods();
+}
@@ -0,0 +1,69 @@
+
+#pragma once
+
+#include <e2/buildcfg.hpp>
+#include <e2/export.hpp>
+#include <e2/utils.hpp>
+#include <e2/assets/mesh.hpp>
+
+#include <vector>
+
+namespace e2
+{
+	/** Worst error a quantized stream may have per component. A submesh where any stream would go past its bound keeps full precision streams */
+	constexpr float positionQuantizationTolerance = 1.0f / 1024.0f; // about a millimeter
+	constexpr float directionQuantizationTolerance = 1.0f / 127.0f;
+	constexpr float texCoordQuantizationTolerance = 1.0f / 2048.0f; // half a texel at 1024
+	constexpr float colorQuantizationTolerance = 1.0f / 255.0f;
+	constexpr float weightQuantizationTolerance = 1.0f / 255.0f;
+
+	/** Submesh data the way it is stored on disk and uploaded, streams in VertexAttributeFlags order */
+	struct E2_API EncodedSubmesh
+	{
+		e2::VertexAttributeFlags attributes{ e2::VertexAttributeFlags::None };
+		bool quantized{};
+		e2::IndexFormat indexFormat{ e2::IndexFormat::Uint32 };
+		uint32_t numVertices{};
+		uint32_t numIndices{};
+		std::vector<uint8_t> indexData;
+		std::vector<std::vector<uint8_t>> streams;
+	};
+
+	/** Encodes a float stream to vertexStreamFormat(stream, quantized). Weights are rounded so each vertex keeps its sum */
+	E2_API void encodeVertexStream(e2::VertexStream stream, bool quantized, glm::vec4 const* values, uint32_t numVertices, std::vector<uint8_t>& outData);
+
+	/** Decodes a stream back to floats, the same values the vertex stage sees */
+	E2_API void decodeVertexStream(e2::VertexStream stream, bool quantized, uint8_t const* data, uint32_t numVertices, glm::vec4* outValues);
+
+	E2_API void encodeBoneStream(bool quantized, glm::uvec4 const* bones, uint32_t numVertices, std::vector<uint8_t>& outData);
+	E2_API void decodeBoneStream(bool quantized, uint8_t const* data, uint32_t numVertices, glm::uvec4* outValues);
+
+	/** Largest per component error the stream would get if quantized */
+	E2_API float vertexStreamQuantizationError(e2::VertexStream stream, glm::vec4 const* values, uint32_t numVertices);
+
+	/** Largest error allowed for a quantized stream */
+	E2_API float vertexStreamQuantizationTolerance(e2::VertexStream stream);
+
+	/** 
+	 * Encodes a submesh for upload. Indices are 16 bit whenever they fit. If allowQuantize, the vertex streams are quantized 
+	 * when every stream stays within its tolerance and bone ids fit in a byte, otherwise they are kept as floats
+	 */
+	E2_API void encodeSubmesh(e2::ProceduralSubmesh const& source, bool allowQuantize, e2::EncodedSubmesh& outEncoded);
+
+	/** Same as encodeSubmesh, from full precision streams (vec4, uvec4 for bone ids) in VertexAttributeFlags order, the way importers build them */
+	E2_API void encodeSubmeshStreams(e2::VertexAttributeFlags attributes, uint32_t numVertices, uint32_t numIndices, uint32_t const* indices, uint8_t const* const* streams, bool allowQuantize, e2::EncodedSubmesh& outEncoded);
+
+	/** Indices as 16 bit if they all fit, 32 bit otherwise */
+	E2_API e2::IndexFormat encodeIndices(uint32_t const* indices, uint32_t numIndices, std::vector<uint8_t>& outData);
+
+	/** Reads indices back from the GPU as 32 bit, whatever format they are stored in */
+	E2_API void downloadIndices(e2::SubmeshSpecification const& spec, uint32_t* outIndices);
+
+	/** Reads a vertex stream back from the GPU and decodes it. attributeIndex is the index in spec.vertexAttributes */
+	E2_API void downloadVertexStream(e2::SubmeshSpecification const& spec, uint32_t attributeIndex, e2::VertexStream stream, glm::vec4* outValues);
+
+	E2_API void downloadBoneStream(e2::SubmeshSpecification const& spec, uint32_t attributeIndex, glm::uvec4* outValues);
+
+	/** Round trips synthetic submeshes and checks the error bounds, the fallbacks to full precision and the index formats */
+	E2_API bool testMeshQuantization();
+}
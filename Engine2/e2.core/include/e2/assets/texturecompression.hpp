@@ -0,0 +1,49 @@
+
+#pragma once
+
+#include <e2/buildcfg.hpp>
+#include <e2/export.hpp>
+#include <e2/utils.hpp>
+#include <e2/rhi/texture.hpp>
+
+#include <vector>
+
+namespace e2
+{
+	/** What a texture holds, decides how its mips are filtered and which block format it gets */
+	enum class TextureUsage : uint8_t
+	{
+		/** sRGB color, filtered in linear light */
+		Color = 0,
+
+		/** Linear data like masks, roughness and metalness */
+		Linear,
+
+		/** Tangent space normals, renormalized per mip. Compressed to two channels, shaders rebuild z */
+		Normal,
+	};
+
+	/** 
+	 * Block format for a texture. Opaque color gets BC1 and color with alpha BC3, or BC7 for either if highQuality.
+	 * Grayscale linear data gets BC4 (sampled as RRR1) and normals BC5
+	 */
+	E2_API e2::TextureFormat chooseBlockFormat(e2::TextureUsage usage, bool hasAlpha, bool grayscale, bool highQuality);
+
+	/** Bytes of one mip in a block compressed format, partial blocks at the edges count as whole ones */
+	E2_API uint64_t blockDataSize(e2::TextureFormat format, glm::uvec2 const& resolution);
+
+	/** Full mip chain down to 1x1 from RGBA8 texels. Mip 0 is a copy of the source, every other mip is filtered from the full precision one above it */
+	E2_API void generateMipChain(uint8_t const* rgba8, glm::uvec2 const& resolution, e2::TextureUsage usage, std::vector<std::vector<uint8_t>>& outMips);
+
+	/** Encodes RGBA8 texels to BC1, BC3, BC4, BC5 or BC7. BC7 only uses mode 6, a single RGBA subset with 4 bit indices */
+	E2_API bool encodeBlocks(e2::TextureFormat format, uint8_t const* rgba8, glm::uvec2 const& resolution, std::vector<uint8_t>& outBlocks);
+
+	/** Decodes to RGBA8 as the GPU samples it, BC4 as RRR1 and BC5 as RG01. BC7 decodes mode 6 only, the one encodeBlocks writes */
+	E2_API bool decodeBlocks(e2::TextureFormat format, uint8_t const* blocks, glm::uvec2 const& resolution, std::vector<uint8_t>& outRgba8);
+
+	/** Peak signal to noise ratio in dB between two RGBA8 images, over the channels format stores */
+	E2_API double blockPSNR(e2::TextureFormat format, uint8_t const* original, uint8_t const* decoded, glm::uvec2 const& resolution);
+
+	/** Encodes and decodes synthetic color, alpha, mask and normal images in every block format and checks the quality, and checks generated mip chains */
+	E2_API bool testBlockCompression();
+}
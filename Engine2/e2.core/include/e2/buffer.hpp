@@ -249,6 +249,11 @@ namespace e2
 		virtual uint8_t const* read(uint64_t numBytes) override;
 		virtual bool write(uint8_t const* data, uint64_t size) override;
 
+		inline uint8_t const* data() const
+		{
+			return m_data.data();
+		}
+
 	protected:
 		mutable std::vector<uint8_t> m_data;
 	};
@@ -44,6 +44,23 @@ namespace e2
 
 	/// --- End Physics 
 
+	/// --- Begin Logging
+
+	/** Lowest severity the log macros are compiled in for at all (0 notices, 1 warnings, 2 errors), anything below it costs nothing. e2::Log::setMinSeverity filters further at runtime */
+#if defined(E2_GAME_BUILD)
+	constexpr uint8_t minLogSeverity = 1;
+#else 
+	constexpr uint8_t minLogSeverity = 0;
+#endif
+
+	/** Entries each thread can have waiting for the log writer before it has to block or drop (see e2::LogOverflow), must be a power of two */
+	constexpr uint32_t logQueueSize = 1024;
+
+	/** Entries kept in memory for log consoles, older ones are only in e2.log */
+	constexpr uint32_t maxNumLogHistory = 8192;
+
+	/// --- End Logging
+
 	/// --- Begin Graphs 
 
 	/** Maximum number of nodes in a graph */
@@ -126,6 +143,9 @@ namespace e2
 	 /** The maximum number of submeshes per mesh (see e2::Mesh) */
 	constexpr uint32_t maxNumSubmeshes = 8;
 
+	/** The maximum number of levels of detail per mesh proxy, and per mesh including its full detail level (see e2::MeshProxy, e2::MeshLodSettings) */
+	constexpr uint32_t maxNumLods = 4;
+
 	/** The maximum number of active mesh proxies per session. This limits how many meshes can be rendered at once, excluding mesh instancing and submeshes. (see e2::MeshProxy, e2::Session) */
 	constexpr uint32_t maxNumMeshProxies = 4096;
 	constexpr uint32_t maxNumSkinProxies = 1024;
@@ -135,6 +155,9 @@ namespace e2
 	constexpr uint64_t maxNumRootBones = 16;
 	constexpr uint64_t maxNumSkeletonBones = 128;
 
+	/** Total number of bones the skin palette buffers fit, shared by every skin proxy in a session (see e2::SkinPaletteAllocator) */
+	constexpr uint32_t maxNumSkinPaletteBones = 32768;
+
 
 	/** The size of the render dispatch queue. Every renderer will use at least 1. Extra uses from other things such as quadrenderer etc. */
 	constexpr uint32_t maxNumQueuedBuffers = 32;
@@ -167,11 +190,11 @@ namespace e2
 	/** Maximum number of shader defines per shader */
 	constexpr uint8_t maxShaderDefines = 16;
 
-	/** The maximum number of vertex bindings in a vertex layout */
-	constexpr uint32_t maxNumVertexBindings = 8;
+	/** The maximum number of vertex bindings in a vertex layout (a mesh uses up to 8, instanced layouts add one) */
+	constexpr uint32_t maxNumVertexBindings = 10;
 
-	/** The maximum number of vertex attributes in a vertex layout */
-	constexpr uint32_t maxNumVertexAttributes = 8;
+	/** The maximum number of vertex attributes in a vertex layout (a mesh uses up to 8, instanced layouts add two) */
+	constexpr uint32_t maxNumVertexAttributes = 10;
 
 	/// ------ Begin Vulkan
 
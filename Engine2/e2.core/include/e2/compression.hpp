@@ -0,0 +1,26 @@
+
+#pragma once
+
+#include <e2/export.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace e2
+{
+	/**
+	 * LZ77 style byte compression (literal runs and back references within 64KB), for bulk data we write at runtime like save games.
+	 * Favours speed over ratio, it's meant to run in the background in a couple of milliseconds per megabyte.
+	 * The uncompressed size isn't stored, keep it alongside.
+	 */
+	E2_API void compressLZ(uint8_t const* data, uint64_t size, std::vector<uint8_t>& outCompressed);
+
+	/** No stream decompresses to more than this many bytes per compressed byte (a match costs at least one length byte per 255 bytes). Check stored sizes against it before allocating */
+	constexpr uint64_t maxExpansionLZ = 255;
+
+	/** Decompresses exactly outSize bytes into outData. Returns false if compressed is corrupt or doesn't decompress to outSize */
+	E2_API bool decompressLZ(uint8_t const* compressed, uint64_t compressedSize, uint8_t* outData, uint64_t outSize);
+
+	/** Round trips tiny, incompressible, run heavy and record like data, and checks wrong sizes, truncated streams and corrupt bytes are refused without writing out of bounds */
+	E2_API bool testCompressionLZ();
+}
@@ -6,33 +6,12 @@
 #include <e2/config.hpp>
 #include <e2/timer.hpp>
 #include <e2/utils.hpp>
+#include <e2/profiler.hpp>
 
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 
-#if defined(E2_PROFILER)
-#define E2_BEGIN_SCOPE(g) profiler()->beginScope(__FUNCDNAME__, __FUNCTION__, e2::ProfileGroupId::##g);
-#define E2_END_SCOPE() profiler()->endScope();
-
-#define E2_BEGIN_SCOPE_CTX(g, x) x->profiler()->beginScope(__FUNCDNAME__, __FUNCTION__, e2::ProfileGroupId::##g);
-#define E2_END_SCOPE_CTX(x) x->profiler()->endScope();
-
-#define E2_TIME_SCOPE(x) TimeBlock __timeBlock__##__LINE__(x);
-
-#define E2_PROFILE_SCOPE(g) ProfileBlock __profileBlock__##__LINE__(profiler(), __FUNCDNAME__, __FUNCTION__, e2::ProfileGroupId::##g)
-#define E2_PROFILE_SCOPE_CTX(g, c) ProfileBlock __profileBlock__##__LINE__(c->profiler(), __FUNCDNAME__, __FUNCTION__, e2::ProfileGroupId::##g)
-#else 
-#define E2_BEGIN_SCOPE(g) void()
-#define E2_END_SCOPE() void()
-#define E2_BEGIN_SCOPE_CTX(g, x) void()
-#define E2_END_SCOPE_CTX(x) void()
-#define E2_PROFILE_SCOPE(g) void()
-#define E2_PROFILE_SCOPE_CTX(g, x) void()
-#endif
-
-
-
 namespace e2
 {
 	class Application;
@@ -72,156 +51,48 @@ namespace e2
 	};
 
 
-	constexpr uint64_t profileStackSize = 1024;
-
-#if defined(E2_PROFILER)
-
-	enum class ProfileGroupId : uint8_t
+	/** Which managers an engine brings up, and how it paces itself */
+	struct E2_API EngineCreateInfo
 	{
-		Default = 0,
-		Animation,
-		Rendering,
-		Scripting,
-		WorldGeneration,
-		Count
+		/** No window, renderer, UI or audio. Ticks at tickRate, sleeping in between, instead of pacing itself to the display */
+		bool headless{};
 
-	};
+		/** Individually omit managers. Ignored (all off) when headless, and UI requires rendering */
+		bool withRendering{ true };
+		bool withUI{ true };
+		bool withAudio{ true };
 
-	struct E2_API ProfileGroup
-	{
-		std::string displayName;
-		double timeInFrame{}; // time in seconds this function has been executing, in this frame
-		double avgTimeInFrame{}; // average time this function spent executing, per frame
-		double highTimeInFrame{}; // highest time this function spent executing, per frame
+		/** Ticks per second when headless */
+		double tickRate{ 60.0 };
 	};
 
-	struct E2_API ProfileFunction
-	{
-		/** decorated function name, used as unique identifier */
-		std::string functionId;
-
-		std::string displayName;
-
-		double timeInFrame{}; // time in seconds this function has been executing, in this frame
-		double avgTimeInFrame{}; // average time this function spent executing, per frame
-		double highTimeInFrame{}; // highest time this function spent executing, per frame
-
-		// variables below are never reset, and are updated every frame
-		uint64_t timesInScope{}; // num times this function has had a scope, since profiling started
-		double timeInScope{}; // time in seconds this function has been in scope, since profiling started
-
-		double avgTimeInScope{}; // average time this function spent in scope, per invocation
-		double highTimeInScope{}; // highest time this function spent in scope, per invocation
-
-	};
-
-	struct E2_API ProfileScope
-	{
-		e2::ProfileGroupId groupId = e2::ProfileGroupId::Default;
-		/** The function in which this scope was opened (and is closed) */
-		ProfileFunction* function{};
-
-		void openScope()
-		{
-			openTime = e2::timeNow();
-		}
-
-		void closeScope()
-		{
-			secondsInScope += openTime.durationSince().seconds();
-		}
-
-		/** moment in time this scope was opened */
-		double secondsInScope{};
-		e2::Moment openTime;
-	};
-
-
-	struct ProfileReport
-	{
-		std::vector<e2::ProfileFunction> functions;
-
-		e2::StackVector<e2::ProfileGroup, size_t(e2::ProfileGroupId::Count)> groups;
-	};
-
-	class E2_API Profiler
-	{
-	public:
-
-		Profiler();
-
-		void start();
-		void stop();
+	/** Headless ticks are timed over this many ticks, and percentiles logged */
+	constexpr uint32_t tickMetricsWindow = 1024;
 
-		void newFrame();
-
-		void beginScope(std::string const& funcId, std::string const& funcDisplayName, e2::ProfileGroupId groupId = ProfileGroupId::Default);
-
-		void endScope();
-
-		ProfileReport report();
-
-		uint64_t frameCount()
-		{
-			return m_numFrames;
-		}
-
-	protected:
-		bool m_enabled{};
-		uint64_t m_numFrames{};
-		e2::StackVector<e2::ProfileScope, profileStackSize> m_stack;
-		std::unordered_map<std::string, e2::ProfileFunction> m_functions;
-		e2::StackVector<e2::ProfileGroup, size_t(e2::ProfileGroupId::Count)> m_groups;
-
-	};
-
-	struct TimeBlock
+	/** Tick duration percentiles over the last tickMetricsWindow ticks of a headless engine, in milliseconds */
+	struct E2_API TickMetrics
 	{
+		float tickTimeMsP50{};
+		float tickTimeMsP90{};
+		float tickTimeMsP99{};
+		float tickTimeMsHigh{};
 
-		TimeBlock(std::string const& name)
-			: m_name(name)
-		{
-			m_timer.reset();
-		}
-
-		~TimeBlock()
-		{
-			double ms = m_timer.seconds() * 1000.0;
-			LogNotice("TimeBlock {}: {}ms", m_name, ms);
-		}
-
-	protected:
-		e2::Timer m_timer;
-		std::string m_name;
+		/** Ticks that finished after their deadline */
+		uint32_t numLateTicks{};
 	};
 
-	struct ProfileBlock
-	{
-		Profiler* profiler{};
-
-		ProfileBlock(Profiler* inProfiler, std::string const& funcId, std::string const& funcDisplayName, e2::ProfileGroupId groupId)
-			: profiler(inProfiler)
-		{
-			profiler->beginScope(funcId, funcDisplayName, groupId);
-		}
-
-		~ProfileBlock()
-		{
-			profiler->endScope();
-		}
-	};
-#endif
 
 	class E2_API Engine : public Context
 	{
 	public:
-		Engine();
+		Engine(e2::EngineCreateInfo const& createInfo = {});
 		virtual ~Engine();
 
 		virtual Engine* engine() override;
 
 		void run(e2::Application* app);
 
+		/** Stops running after the current tick. Safe to call from any thread, or a signal handler */
 		void shutdown();
 
 
@@ -230,13 +101,38 @@ namespace e2
 			return m_application;
 		}
 
+		/** True if this engine runs without a window, renderer, UI and audio. Their managers are nullptr */
+		inline bool headless() const
+		{
+			return m_headless;
+		}
+
+		inline e2::TickMetrics const& tickMetrics() const
+		{
+			return m_tickMetrics;
+		}
+
 #if defined(E2_PROFILER)
 		e2::EngineMetrics& metrics();
 #endif
 	protected:
 		friend Context;
 
-		bool m_running{ false };
+		/** Updates every manager and the application once */
+		void tick(double deltaTime);
+
+		/** Runs until shutdown, pacing ticks to the display (well, as fast as targetMsPerFrame allows) */
+		void runWindowed();
+
+		/** Runs until shutdown, ticking at m_tickRate and sleeping until the next deadline in between */
+		void runHeadless();
+
+		// atomic so shutdown() can be called from a signal handler
+		std::atomic<bool> m_running{ false };
+
+		bool m_headless{};
+		double m_tickRate{};
+		e2::TickMetrics m_tickMetrics;
 
 #if defined(E2_PROFILER)
 		e2::EngineMetrics m_metrics;
@@ -1,6 +1,8 @@
 
 #pragma once 
 
+#if defined(_MSC_VER)
+
 #if defined(E2_BUILD)
 
 #define E2_API __declspec(dllexport)
@@ -9,4 +11,11 @@
 
 #define E2_API __declspec(dllimport)
 
+#endif
+
+#else
+
+// gcc and clang export by visibility, build with -fvisibility=hidden so only E2_API symbols leave the shared library
+#define E2_API __attribute__((visibility("default")))
+
 #endif
\ No newline at end of file
@@ -56,6 +56,45 @@ struct std::hash<e2::MeshProxyLODEntry>
 };
 namespace e2
 {
+	/** Bones are stored as the first three rows of their matrix, the last is always (0, 0, 0, 1) */
+	constexpr uint32_t skinPaletteBoneSize = sizeof(glm::vec4) * 3;
+
+	/**
+	 * Places skin palettes in the skin buffers, each at its actual bone count.
+	 * First fit from a sorted list of free ranges, neighbouring ranges are merged when freed.
+	 */
+	class E2_API SkinPaletteAllocator
+	{
+	public:
+		SkinPaletteAllocator(uint32_t capacity, uint32_t alignment);
+
+		/** Returns offset in bytes, or UINT32_MAX if there's no room */
+		uint32_t allocate(uint32_t size);
+		void free(uint32_t offset, uint32_t size);
+
+		inline uint32_t capacity() const
+		{
+			return m_capacity;
+		}
+
+		inline uint32_t used() const
+		{
+			return m_used;
+		}
+
+	protected:
+		struct Range
+		{
+			uint32_t offset{};
+			uint32_t size{};
+		};
+
+		uint32_t m_capacity{};
+		uint32_t m_alignment{};
+		uint32_t m_used{};
+		std::vector<Range> m_freeRanges;
+	};
+
 	class E2_API Session : public e2::Context
 	{
 	public:
@@ -80,6 +119,8 @@ namespace e2
 		std::map<e2::RenderLayer, std::unordered_set<MeshProxyLODEntry>> const& submeshIndex() const;
 		std::unordered_set<MeshProxyLODEntry> const& shadowSubmeshes() const;
 
+		std::unordered_set<e2::MeshProxy*> const& meshProxies() const;
+
 		e2::IDescriptorSet* getModelSet(uint8_t frameIndex);
 
 		e2::IDescriptorSetLayout* getModelSetLayout();
@@ -103,9 +144,11 @@ namespace e2
 		/** Buffers for model matrices (one per frame index) */
 		e2::Pair<e2::IDataBuffer*> m_modelBuffers{nullptr};
 
-		/** Buffers for skin matrices (one per frame index) */
+		/** Buffers for skin palettes (one per frame index), packed by m_skinPalettes */
 		e2::Pair<e2::IDataBuffer*> m_skinBuffers{ nullptr };
 
+		e2::SkinPaletteAllocator m_skinPalettes;
+
 		friend MeshProxy;
 
 		/** All the registered mesh proxies */
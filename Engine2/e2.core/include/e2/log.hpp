@@ -1,21 +1,17 @@
 
 #pragma once
 
+#include <e2/buildcfg.hpp>
 #include <e2/export.hpp>
 
 #include <string>
 #include <format>
 #include <mutex>
 
-//#if defined(E2_DEVELOPMENT)
-#define LogNotice(x, ...) e2::Log::write( e2::Severity::Notice, __func__, __FILE__, __LINE__, std::format(x, __VA_ARGS__))
-#define LogWarning(x, ...) e2::Log::write( e2::Severity::Warning, __func__, __FILE__, __LINE__, std::format(x, __VA_ARGS__))
-#define LogError(x, ...) e2::Log::write( e2::Severity::Error, __func__, __FILE__, __LINE__, std::format(x, __VA_ARGS__))
-//#else 
-//#define LogNotice(...)
-//#define LogWarning(...)
-//#define LogError(...)
-//#endif
+// Severities below e2::minLogSeverity compile away entirely, and ones below the runtime severity never format their message or evaluate its arguments
+#define LogNotice(x, ...) do { if constexpr (e2::minLogSeverity <= 0) { if (e2::Log::enabled(e2::Severity::Notice)) e2::Log::write( e2::Severity::Notice, __func__, __FILE__, __LINE__, std::format(x, __VA_ARGS__)); } } while (false)
+#define LogWarning(x, ...) do { if constexpr (e2::minLogSeverity <= 1) { if (e2::Log::enabled(e2::Severity::Warning)) e2::Log::write( e2::Severity::Warning, __func__, __FILE__, __LINE__, std::format(x, __VA_ARGS__)); } } while (false)
+#define LogError(x, ...) do { if constexpr (e2::minLogSeverity <= 2) { if (e2::Log::enabled(e2::Severity::Error)) e2::Log::write( e2::Severity::Error, __func__, __FILE__, __LINE__, std::format(x, __VA_ARGS__)); } } while (false)
 
 namespace e2
 {
@@ -27,33 +23,71 @@ namespace e2
 		Error
 	};
 
+	/** What a thread does when its log queue is full */
+	enum class LogOverflow : uint8_t
+	{
+		/** Wait for the log writer to make room, nothing is lost */
+		Block = 0,
+
+		/** Drop notices and warnings (counted in e2::Log::numDropped), errors still wait */
+		Drop
+	};
+
 	struct E2_API LogEntry
 	{
 		e2::Severity severity{ e2::Severity::Notice };
-		std::string function;
-		std::string file;
+
+		/** String literals from the call site */
+		char const* function{};
+		char const* file{};
 		uint32_t line{};
 
+		/** Order the entry was written in, across all threads */
+		uint64_t sequence{};
+
 		std::string message;
 	};
 
 
+	/**
+	 * Every thread that logs gets its own lock-free queue, which a dedicated writer thread drains in batches to stdout, e2.log and the in-memory history.
+	 * Writing an entry is a sequence number and a move into the queue; the only locks are taken when a thread logs for the first time, and by the writer.
+	 */
 	class E2_API Log
 	{
 	public:
 		static std::string formatFilepath(std::string const& filePath);
 
-		static void write(e2::Severity severity, std::string const& function, std::string const& file, uint32_t line, std::string const& message);
-	
+		static void write(e2::Severity severity, char const* function, char const* file, uint32_t line, std::string message);
+
+		/** Whether entries of the given severity are written at all, see setMinSeverity */
+		static bool enabled(e2::Severity severity);
+
+		static void setMinSeverity(e2::Severity severity);
+		static e2::Severity minSeverity();
+
+		static void setOverflow(e2::LogOverflow overflow);
+		static uint64_t numDropped();
+
+		/** Blocks until everything this thread has written so far is out */
+		static void flush();
+
+		/** Flushes and stops the writer thread, anything written after this is written directly */
+		static void shutdown();
+
+		/** The history only keeps the last e2::maxNumLogHistory entries, lock getMutex while reading it */
 		static uint32_t numEntries();
 		static e2::LogEntry const& getEntry(uint32_t id);
 
+		/** Entries ever added to the history, keeps growing when the history is full */
+		static uint64_t numWritten();
+
 		static void clear();
 
 		static std::recursive_mutex& getMutex();
 
 	};
 
+	/** Logs from many threads at once, and checks per thread ordering, that nothing is lost when blocking, that drops are counted, and runtime filtering. Reports throughput */
+	E2_API bool testLog();
 }
-
-
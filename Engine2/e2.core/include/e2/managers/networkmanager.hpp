@@ -6,10 +6,21 @@
 
 #include <e2/utils.hpp>
 #include <unordered_set>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <bit>
 
 #if defined(_WIN64)
 #include <winsock2.h>
+#include <ws2tcpip.h>
 #pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #endif
 #include <e2/timer.hpp>
 
@@ -18,12 +29,51 @@ namespace e2
 	class Engine;
 	class Session;
 
+#if defined(_WIN64)
+	using NetSocket = SOCKET;
+	constexpr NetSocket invalidNetSocket = INVALID_SOCKET;
+#else
+	using NetSocket = int;
+	constexpr NetSocket invalidNetSocket = -1;
+#endif
+
 	constexpr uint64_t maxBufferedPackets = 1024;
 	constexpr uint64_t netFrameSize = 508;
-	constexpr uint64_t netFragmentHeaderSize = 10;
+	constexpr uint64_t netFragmentHeaderSize = 19;
+	constexpr uint64_t netAckFrameSize = 8;
 	constexpr uint64_t maxFragmentPayloadSize = netFrameSize - netFragmentHeaderSize;
-	constexpr uint64_t maxNumFragments = 65536;
-	// 32.768 megabyte max packet sizes (500*65536
+
+	/** Largest packet we send or reassemble. numFragments on the wire is 16 bit, but we never accept anywhere near that */
+	constexpr uint64_t maxNetPacketSize = 1024 * 1024;
+	constexpr uint64_t maxNumFragments = (maxNetPacketSize + maxFragmentPayloadSize - 1) / maxFragmentPayloadSize;
+
+	/** Outgoing fragments are paced to this rate, anything above it waits in a queue on the game thread */
+	constexpr uint64_t netSendBytesPerSecond = 8 * 1024 * 1024;
+	constexpr uint64_t netSendBurstBytes = 64 * 1024;
+
+	/** Incomplete packets are dropped after this many seconds */
+	constexpr double netReassemblyTimeout = 5.0;
+
+	/** Packets being reassembled from one peer at once, beyond this the oldest is dropped */
+	constexpr uint32_t maxReassemblingPacketsPerPeer = 16;
+
+	/** Reassembly memory one peer, and all peers together, may hold. A new packet that would go over either is dropped */
+	constexpr uint64_t maxReassemblyBytesPerPeer = 4 * 1024 * 1024;
+	constexpr uint64_t maxReassemblyBytes = 32 * 1024 * 1024;
+
+	/** If we owe a peer acks and haven't sent it anything for this long, we send a bare ack frame */
+	constexpr double netAckDelay = 1.0 / 30.0;
+
+	/** Reliable resend timeout is estimated from RTT, and clamped to this. Every resend of the same packet doubles it, up to the max */
+	constexpr double netMinResendTimeout = 0.05;
+	constexpr double netMaxResendTimeout = 2.0;
+	constexpr double netInitialResendTimeout = 0.25;
+
+	/** Sent packets we remember per peer for acks, RTT and loss */
+	constexpr uint32_t netSentHistorySize = 256;
+
+	/** Out of order reliable packets we hold on to per peer, anything further ahead is dropped and resent later */
+	constexpr uint16_t maxBufferedReliablePackets = 1024;
 
 
 	enum class NetFrameType : uint8_t
@@ -36,17 +86,39 @@ namespace e2
 
 		DataFragment = 30, // bi
 
+		Ack = 40, // bi, acks only, for when we have nothing else to send
 	};
 
 	EnumFlagsDeclaration(NetFrameType);
 
 	enum class NetFrameFlags : uint8_t
 	{
-		Default = 0
+		Default = 0,
+		HasAck = 1 << 0, // ack and ackBits are valid
 	};
 
 	EnumFlagsDeclaration(NetFrameFlags);
 
+	enum class NetChannel : uint8_t
+	{
+		/** Fire and forget, may arrive out of order or not at all */
+		Unreliable = 0,
+
+		/** May not arrive, but anything older than what we already got is dropped. For state that is resent all the time anyway */
+		UnreliableSequenced = 1,
+
+		/** Resent until acked, and delivered in the order it was sent */
+		ReliableOrdered = 2,
+
+		Count
+	};
+
+	/** True if sequence a is newer than b, handling wraparound */
+	inline bool netSequenceGreater(uint16_t a, uint16_t b)
+	{
+		return int16_t(uint16_t(a - b)) > 0;
+	}
+
 	struct NetFragment
 	{
 		NetFrameType frameType;
@@ -56,6 +128,14 @@ namespace e2
 		uint16_t fragmentIndex; // fragment index (in packet, 0-n)
 		uint16_t numFragments;
 		uint16_t fragmentSize;
+
+		e2::NetChannel channel;
+		uint16_t sequence; // sequence in channel, kept across resends
+
+		// piggybacked acks: newest packet id we got from the receiver, and one bit for each of the 32 before it
+		uint16_t ack;
+		uint32_t ackBits;
+
 		uint8_t fragmentPayload[e2::maxFragmentPayloadSize];
 	};
 
@@ -97,22 +177,174 @@ namespace e2
 		NetPacket(e2::NetPeerAddress const& address, uint8_t const* packetData, uint64_t packetSize);
 		e2::NetPeerAddress peerAddress;
 		e2::HeapStream data;
+
+		e2::NetChannel channel{ e2::NetChannel::Unreliable };
+
+		// set on received packets
+		uint16_t packetId{};
+		uint16_t sequence{};
+		bool hasAck{};
+		uint16_t ack{};
+		uint32_t ackBits{};
+
+		// a bare ack frame, no data
+		bool ackOnly{};
 	};
 
 	struct NetReceiveState
 	{
 		uint16_t numFragments{};
-		bool* fragmentsReceived{};
+		uint16_t numReceived{};
 		uint32_t packetSize{};
+
+		// from NetReassemblyPool, payloads followed by one received-bit per fragment
 		uint8_t* packetData{};
+		uint8_t* fragmentsReceived{};
+		uint8_t sizeClass{};
+
+		e2::Moment firstReceived;
+	};
+
+	/**
+	 * Buffers for packet reassembly, recycled per power of two fragment count so big transfers don't allocate for every packet.
+	 * Network thread only (and the game thread while it isn't running)
+	 */
+	class E2_API NetReassemblyPool
+	{
+	public:
+		~NetReassemblyPool();
+
+		/** Returns a buffer fitting numFragments payloads, with all received-bits cleared. Bits start at bitsOffset(outSizeClass) */
+		uint8_t* acquire(uint16_t numFragments, uint8_t& outSizeClass);
+		void release(uint8_t* buffer, uint8_t sizeClass);
+
+		/** Frees every pooled buffer, buffers in use are unaffected */
+		void clear();
+
+		static uint64_t bitsOffset(uint8_t sizeClass);
+
+		/** Size class acquire() picks for numFragments, and the full size of a buffer in it */
+		static uint8_t sizeClass(uint16_t numFragments);
+		static uint64_t bufferSize(uint8_t sizeClass);
+
+		/** Buffers handed out and not yet released, readable from any thread */
+		uint32_t numInUse() const
+		{
+			return m_numInUse;
+		}
+
+		/** Sum of bufferSize() over the buffers in use, readable from any thread */
+		uint64_t bytesInUse() const
+		{
+			return m_bytesInUse;
+		}
+
+	protected:
+		static constexpr uint32_t numSizeClasses = std::bit_width(uint32_t(e2::maxNumFragments - 1)) + 1;
+		static constexpr uint32_t maxPooledPerClass = 4;
+
+		std::vector<uint8_t*> m_free[numSizeClasses];
+		std::atomic<uint32_t> m_numInUse{};
+		std::atomic<uint64_t> m_bytesInUse{};
+	};
+
+	struct NetSentRecord
+	{
+		bool valid{};
+		bool acked{};
+		bool countedLost{};
+		uint16_t packetId{};
+		e2::Moment sentAt;
+
+		// ReliableOrdered packets, so acking any transmission of it clears it from NetPeerState::unacked
+		bool reliable{};
+		uint16_t sequence{};
+	};
+
+	struct NetUnackedPacket
+	{
+		uint16_t sequence{};
+		uint32_t numSends{};
+		e2::Moment lastSent;
+		std::vector<uint8_t> data;
+	};
+
+	struct NetPeerStats
+	{
+		/** Smoothed round trip time and its mean deviation, in seconds */
+		double roundTripTime{};
+		double jitter{};
+
+		/** Fraction (0-1) of our packets that went unacked over the last second */
+		double packetLoss{};
+
+		double sentBytesPerSecond{};
+		double receivedBytesPerSecond{};
+
+		uint32_t numResent{};
+		uint32_t numUnacked{};
 	};
 
 	struct NetPeerState
 	{
-		uint16_t outgoingPacketIndex{};
 		NetPeerAddress peerAddress;
+
+		// network thread only
 		std::unordered_map<uint16_t, NetReceiveState> receivingPackets;
 
+		// game thread only, under NetworkManager::m_peerMutex
+		uint16_t outgoingPacketIndex{};
+		uint16_t outgoingSequences[size_t(e2::NetChannel::Count)]{};
+		e2::Moment lastSent;
+
+		// what we got from them, so we can ack it
+		bool hasRemote{};
+		bool ackPending{};
+		uint16_t remoteSequence{};
+		uint32_t remoteAckBits{};
+
+		// what we sent them
+		NetSentRecord sentHistory[e2::netSentHistorySize];
+		std::vector<NetUnackedPacket> unacked;
+		bool hasRoundTripSample{};
+
+		// receive side of the sequenced channels
+		bool hasSequenced{};
+		uint16_t lastSequenced{};
+		uint16_t nextReliableSequence{};
+		std::unordered_map<uint16_t, e2::NetPacket> bufferedReliable;
+
+		// stats, windows are folded into stats once a second
+		NetPeerStats stats;
+		e2::Moment statsWindowStart;
+		uint64_t windowSentBytes{};
+		uint64_t windowReceivedBytes{};
+		uint32_t windowAcked{};
+		uint32_t windowLost{};
+	};
+
+	/** A frame held back by the latency shim */
+	struct NetDelayedFrame
+	{
+		e2::Moment releaseAt;
+		NetPeerAddress address;
+		uint16_t size{};
+		uint8_t data[e2::netFrameSize];
+	};
+
+	/** Connection changes seen by the network thread, raised as NetCallbacks from update() */
+	enum class NetEventType : uint8_t
+	{
+		Connected,
+		Disconnected,
+		PeerConnected,
+		PeerDisconnected
+	};
+
+	struct NetEvent
+	{
+		e2::NetEventType type{};
+		NetPeerAddress address;
 	};
 
 	enum class NetworkState
@@ -128,6 +360,7 @@ namespace e2
 
 
 
+	/** All of these are called from NetworkManager::update() on the game thread, so they may send packets and touch game state */
 	class E2_API NetCallbacks
 	{
 	public:
@@ -162,8 +395,10 @@ namespace e2
 		void startServer(uint16_t port);
 		void tryConnect(e2::NetPeerAddress const& address);
 		
+		/** Network thread. Queues a Disconnected event for update() */
 		void notifyServerDisconnected();
 
+		/** Network thread. Queues a Connected event for update(), once per connection attempt */
 		void flagConnected();
 
 		virtual void initialize() override;
@@ -177,18 +412,109 @@ namespace e2
 		}
 
 		NetPeerState *getOrCreatePeerState(NetPeerAddress const& peerAddress);
+
+		/** Network thread. Drops the peer's state and queues a PeerDisconnected event for update() */
 		void notifyClientDisconnected(NetPeerAddress const& address);
+
+		/** Network thread. Queues a PeerConnected event for update() */
 		void notifyClientConnected(NetPeerAddress const& address);
 
-		void fetchOutgoing(e2::StackVector<e2::NetSendFragment, e2::maxBufferedPackets>& outSwap);
+		/** Network thread only. Pops the next fragment queued by the game thread, returns false when there are none */
+		bool popOutgoing(e2::NetSendFragment& outFragment);
+
+		/** Network thread only. Blocks until the socket has data, outgoing fragments were queued, the thread is stopping or timeoutMs passed */
+		void waitForWork(uint32_t timeoutMs);
+
+		/** Network thread only */
+		inline e2::NetReassemblyPool& reassemblyPool()
+		{
+			return m_reassemblyPool;
+		}
+
+		/** Network thread only. Frees an in-progress packet back to the pool */
+		void releaseReceiveState(e2::NetReceiveState& state);
+
+		/** Network thread only. Drops packets that have been incomplete for longer than netReassemblyTimeout */
+		void expireReassembly();
+
+		/** Network thread only. Counts a fragment that would have started a packet over the reassembly budget, expireReassembly() reports them */
+		inline void countOverBudget()
+		{
+			m_numOverBudget++;
+		}
+
+		/** Game thread. Moves as many queued fragments to the network thread as the send rate allows */
+		void flushOutgoing();
+
+		/** Game thread. Resends unacked reliable packets, sends bare acks where they're due and updates peer stats */
+		void updateReliability();
+
+		/**
+		 * Game thread. Processes acks in packet and runs it through its channel.
+		 * Whatever is ready for the handlers (packet itself, and any reliable packets it unblocked) is appended to outPackets
+		 */
+		void deliverIncoming(e2::NetPacket& packet, std::vector<e2::NetPacket>& outPackets);
+
+		/** Stats for the given peer, returns false if we don't know it */
+		bool peerStats(e2::NetPeerAddress const& address, e2::NetPeerStats& outStats);
+
+		/** Debug shim, drops this fraction (0-1) of outgoing frames at random */
+		void setSimulatedPacketLoss(float loss)
+		{
+			m_simulatedPacketLoss = loss;
+		}
+
+		float simulatedPacketLoss() const
+		{
+			return m_simulatedPacketLoss;
+		}
+
+		/** Debug shim, holds every outgoing frame back for latency seconds, plus up to jitter seconds at random (so they may arrive out of order) */
+		void setSimulatedLatency(double latency, double jitter)
+		{
+			m_simulatedLatency = latency;
+			m_simulatedJitter = jitter;
+		}
+
+		double simulatedLatency() const
+		{
+			return m_simulatedLatency;
+		}
+
+		double simulatedJitter() const
+		{
+			return m_simulatedJitter;
+		}
+
+		/** Network thread only. Holds a frame back for the latency shim */
+		void delayFrame(e2::NetDelayedFrame const& frame);
+
+		/** Network thread only. Sends held back frames that are due, returns milliseconds until the next one is (UINT32_MAX if none) */
+		uint32_t sendDelayedFrames();
+
+		/** Hosts on port, blasts numPackets small packets at ourselves over loopback and logs packets per second. Returns false if any went missing or it isn't offline */
+		bool benchmarkLoopback(uint16_t port, uint32_t numPackets);
+
+		/**
+		 * Hosts on port and sends numPackets packets of packetSize bytes to ourselves over loopback, dropping packetLoss of all frames.
+		 * Verifies the content of every packet that arrives, that all of them arrive without loss, that at least half the expected share arrives with loss,
+		 * and that the incomplete ones time out. Logs and returns the result, false if it isn't offline
+		 */
+		bool testLoopbackFragments(uint16_t port, uint32_t packetSize, uint32_t numPackets, float packetLoss);
+
+		/**
+		 * Hosts on port and sends numMessages messages to ourselves over loopback, alternating reliable-ordered and unreliable-sequenced,
+		 * with packetLoss of all frames dropped and latency (+-jitter) added. Verifies every reliable message arrives exactly once and in order,
+		 * and that sequenced messages never go backwards. Logs the result and peer stats, returns the result, false if it isn't offline
+		 */
+		bool testLoopbackReliability(uint16_t port, uint32_t numMessages, float packetLoss, double latency, double jitter);
 
 		inline NetPeerAddress serverAddress() const
 		{
 			return m_serverAddress;
 		}
 
-#if defined(_WIN64)
-		inline SOCKET& platformSocket()
+		inline NetSocket& platformSocket()
 		{
 			return m_socket;
 		}
@@ -197,7 +523,6 @@ namespace e2
 		{
 			return m_recvAddr;
 		}
-#endif
 
 		void receivePacket(e2::NetPacket& newPacket);
 
@@ -208,8 +533,9 @@ namespace e2
 			return m_state;
 		}
 
+		/** Sends outPacket on outPacket.channel */
 		void sendPacket(e2::NetPacket& outPacket);
-		void broadcastPacket(e2::HeapStream& packet);
+		void broadcastPacket(e2::HeapStream& packet, e2::NetChannel channel = e2::NetChannel::Unreliable);
 
 		void registerHandler(uint8_t handlerId, PacketHandlerCallback handler);
 
@@ -232,28 +558,86 @@ namespace e2
 		void unregisterNetCallbacks(e2::NetCallbacks* cb);
 
 	protected:
+		void startThread();
+		void wakeThread();
+
+		/** Same as getOrCreatePeerState, but m_peerMutex must already be held */
+		NetPeerState* findOrCreatePeerState(NetPeerAddress const& peerAddress);
+
+		/** Fragments one transmission of a packet to peer into m_pendingFragments, returns its packet id. m_peerMutex must be held */
+		uint16_t queuePacket(e2::NetPeerState* peer, e2::NetChannel channel, uint16_t sequence, uint8_t const* packetData, uint64_t packetSize);
+
+		/** Applies acks from peer, m_peerMutex must be held */
+		void processAcks(e2::NetPeerState* peer, uint16_t ack, uint32_t ackBits);
+
+		/** Network thread. Queues an event for raiseEvents() */
+		void queueEvent(e2::NetEventType type, NetPeerAddress const& address);
+
+		/** Game thread. Raises the queued events as NetCallbacks, in the order the network thread saw them */
+		void raiseEvents();
+
 		uint16_t m_hostPort{ 1337};
 		NetPeerAddress m_serverAddress; // only valid for client
-		NetworkState m_state{e2::NetworkState::Offline};
-		bool m_disconnectFlag{};
+		// written by the game thread, read by both
+		std::atomic<NetworkState> m_state{e2::NetworkState::Offline};
 		std::thread m_thread;
-		bool m_killFlag{};
-		e2::StackVector<e2::NetPacket, e2::maxBufferedPackets> m_incomingBuffer;
-		e2::StackVector<e2::NetSendFragment, e2::maxBufferedPackets> m_outgoingBuffer;
-		std::recursive_mutex m_syncMutex;
+		std::atomic_bool m_killFlag{};
+
+		// network thread -> game thread
+		e2::SpscRing<e2::NetPacket, e2::maxBufferedPackets> m_incomingBuffer;
+
+		// game thread -> network thread
+		e2::SpscRing<e2::NetSendFragment, e2::maxBufferedPackets> m_outgoingBuffer;
+
+		// network thread -> game thread. Connection changes are rare and must not be dropped, so a locked queue rather than a ring
+		std::mutex m_eventMutex;
+		std::vector<e2::NetEvent> m_events;
+		std::vector<e2::NetEvent> m_eventScratch; // game thread only
+
+		// set when the network thread queued Connected, so frames arriving before update() raises it don't queue it again
+		std::atomic_bool m_connectedFlag{};
+
+		// fragments waiting for send budget or room in m_outgoingBuffer, game thread only
+		std::deque<e2::NetSendFragment> m_pendingFragments;
+		double m_sendBudget{};
+		e2::Moment m_lastFlush;
+
+		e2::NetReassemblyPool m_reassemblyPool;
+		std::atomic<float> m_simulatedPacketLoss{};
+		std::atomic<double> m_simulatedLatency{};
+		std::atomic<double> m_simulatedJitter{};
+
+		// fragments dropped since expireReassembly() last reported them, network thread only
+		uint32_t m_numOverBudget{};
+
+		// min-heap on releaseAt, network thread only
+		std::vector<e2::NetDelayedFrame> m_delayedFrames;
+
+		// scratch for update(), game thread only
+		std::vector<e2::NetPacket> m_deliverScratch;
+
 		e2::Moment m_timeSinceTryConnect;
 		uint32_t m_timesTriedConnect{0};
+
+		// peers are created by both threads, guard the map. Each field of a peer state is only touched by one of them
+		std::mutex m_peerMutex;
 		std::unordered_map<NetPeerAddress, NetPeerState*, NetPeerAddressHash> m_peerStates;
 
 
 		std::array<PacketHandlerCallback, 256> m_handlers;
 
+		NetSocket m_socket{ e2::invalidNetSocket };
+		sockaddr_in m_recvAddr{}; // only for server
+
 #if defined(_WIN64)
 		WSADATA m_wsaHandle;
 
-		SOCKET m_socket{};
-		sockaddr_in m_recvAddr; // only for server
-
+		// signaled when the socket is readable, and when the game thread queues outgoing fragments (or wants the thread to stop)
+		WSAEVENT m_socketEvent{ WSA_INVALID_EVENT };
+		WSAEVENT m_wakeEvent{ WSA_INVALID_EVENT };
+#else
+		// the game thread writes a byte to [1] when it queues outgoing fragments (or wants the thread to stop), the network thread polls [0] next to the socket
+		int m_wakePipe[2]{ -1, -1 };
 #endif
 
 		std::unordered_set<NetCallbacks*> m_netCallbacks;
@@ -96,7 +96,8 @@ namespace e2
 			return m_rendererSetLayout;
 		}
 
-		e2::IVertexLayout* getOrCreateVertexLayout(e2::VertexAttributeFlags flags);
+		/** Vertex layout for meshes with the given attributes, instanced layouts have e2::InstanceData in a per-instance binding after them. Quantized layouts read the compact formats from vertexStreamFormat */
+		e2::IVertexLayout* getOrCreateVertexLayout(e2::VertexAttributeFlags flags, bool instanced = false, bool quantized = false);
 		/*e2::IVertexLayout* nullVertexLayout()
 		{
 			return m_nullVertexLayout;
@@ -181,7 +182,8 @@ namespace e2
 		e2::StackVector<e2::RenderSubmitInfo, e2::maxNumQueuedBuffers> m_queue;
 		e2::StackVector<e2::RenderCallbacks*, e2::maxNumRenderCallbacks> m_callbacks;
 
-		e2::StackVector<e2::IVertexLayout*, e2::maxNumAttributePermutations> m_vertexLayoutCache;
+		/** Regular layouts, followed by instanced ones, then the same again for quantized streams */
+		e2::StackVector<e2::IVertexLayout*, e2::maxNumAttributePermutations * 4> m_vertexLayoutCache;
 
 	};
 
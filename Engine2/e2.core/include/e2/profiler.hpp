@@ -0,0 +1,228 @@
+
+#pragma once 
+
+#include <e2/export.hpp>
+#include <e2/timer.hpp>
+#include <e2/utils.hpp>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#define E2_PROFILE_CONCAT_INNER(a, b) a##b
+#define E2_PROFILE_CONCAT(a, b) E2_PROFILE_CONCAT_INNER(a, b)
+
+#if defined(E2_PROFILER)
+#define E2_TIME_SCOPE(x) TimeBlock E2_PROFILE_CONCAT(__timeBlock__, __LINE__)(x);
+
+// Markers are static, so a scope only copies a pointer and a group id, never allocates or hashes a string
+#define E2_PROFILE_BLOCK(g, n, p) static e2::ProfileMarker const E2_PROFILE_CONCAT(__profileMarker__, __LINE__){ n, e2::ProfileGroupId::g }; e2::ProfileBlock E2_PROFILE_CONCAT(__profileBlock__, __LINE__)(p, E2_PROFILE_CONCAT(__profileMarker__, __LINE__))
+#define E2_PROFILE_NAMED(g, n) E2_PROFILE_BLOCK(g, n, profiler())
+#define E2_PROFILE_SCOPE(g) E2_PROFILE_BLOCK(g, __FUNCTION__, profiler())
+#define E2_PROFILE_SCOPE_CTX(g, c) E2_PROFILE_BLOCK(g, __FUNCTION__, c->profiler())
+
+#define E2_PROFILE_COUNTER(n, v) do { static e2::ProfileMarker const __profileCounter__{ n, e2::ProfileGroupId::Default }; profiler()->counter(__profileCounter__, double(v)); } while (false)
+#else 
+#define E2_TIME_SCOPE(x) void()
+#define E2_PROFILE_NAMED(g, n) void()
+#define E2_PROFILE_SCOPE(g) void()
+#define E2_PROFILE_SCOPE_CTX(g, x) void()
+#define E2_PROFILE_COUNTER(n, v) void()
+#endif
+
+namespace e2
+{
+	/** Deepest a thread can nest profile scopes */
+	constexpr uint64_t profileStackSize = 1024;
+
+	/** Events each thread keeps for trace export, older ones are overwritten. Frames only need to fit in it to be rolled up into reports */
+	constexpr uint64_t profileEventBufferSize = 65536;
+
+#if defined(E2_PROFILER)
+
+	enum class ProfileGroupId : uint8_t
+	{
+		Default = 0,
+		Animation,
+		Rendering,
+		Scripting,
+		WorldGeneration,
+		Async,
+		Count
+
+	};
+
+	/** What a profile scope or counter is called, name has to outlive the profiler (string literals, __FUNCTION__, e2::Name::cstring) and identifies it */
+	struct E2_API ProfileMarker
+	{
+		char const* name{};
+		e2::ProfileGroupId group{ e2::ProfileGroupId::Default };
+	};
+
+	enum class ProfileEventType : uint8_t
+	{
+		Scope = 0,
+		Counter,
+		Frame
+	};
+
+	struct E2_API ProfileEvent
+	{
+		e2::ProfileMarker marker;
+		e2::ProfileEventType type{ e2::ProfileEventType::Scope };
+
+		/** How many scopes were open around it on its thread */
+		uint8_t depth{};
+
+		/** Nanoseconds on the steady clock */
+		uint64_t start{};
+		uint64_t duration{};
+
+		/** Duration not spent in nested scopes */
+		uint64_t selfDuration{};
+
+		/** Value of counters, index of frames */
+		double value{};
+	};
+
+	struct E2_API ProfileGroup
+	{
+		std::string displayName;
+		double timeInFrame{}; // time in seconds this function has been executing, in this frame
+		double avgTimeInFrame{}; // average time this function spent executing, per frame
+		double highTimeInFrame{}; // highest time this function spent executing, per frame
+	};
+
+	struct E2_API ProfileFunction
+	{
+		std::string displayName;
+
+		double timeInFrame{}; // time in seconds this function has been executing, in this frame, summed over threads
+		double avgTimeInFrame{}; // average time this function spent executing, per frame
+		double highTimeInFrame{}; // highest time this function spent executing, per frame
+
+		// variables below are never reset, and are updated every frame
+		uint64_t timesInScope{}; // num times this function has had a scope, since profiling started
+		double timeInScope{}; // time in seconds this function has been in scope, since profiling started
+
+		double avgTimeInScope{}; // average time this function spent in scope, per invocation
+		double highTimeInScope{}; // highest time this function spent in scope, per invocation
+
+	};
+
+	struct ProfileReport
+	{
+		std::vector<e2::ProfileFunction> functions;
+
+		e2::StackVector<e2::ProfileGroup, size_t(e2::ProfileGroupId::Count)> groups;
+	};
+
+	struct ProfileThread;
+
+	/**
+	 * Every thread that profiles gets its own event buffer and scope stack, so scopes can open and close on any thread.
+	 * Closing a scope takes the buffer's own lock, which only newFrame and trace export ever contend for.
+	 * Times are exclusive, a scope doesn't count the time spent in scopes nested in it.
+	 */
+	class E2_API Profiler
+	{
+	public:
+
+		Profiler();
+		~Profiler();
+
+		void start();
+		void stop();
+
+		/** Rolls up what every thread profiled since the last frame into the report, and marks the frame in the trace. Call from the main thread */
+		void newFrame();
+
+		/** Opens a scope on the calling thread, returns false (and opens nothing) if not profiling */
+		bool beginScope(e2::ProfileMarker const& marker);
+
+		/** Closes the innermost scope open on the calling thread */
+		void endScope();
+
+		void counter(e2::ProfileMarker const& marker, double value);
+
+		/** Names the calling thread in traces */
+		void setThreadName(std::string const& name);
+
+		ProfileReport report();
+
+		uint64_t frameCount()
+		{
+			return m_numFrames;
+		}
+
+		uint32_t numThreads();
+
+		/** Events a thread has in its buffer, oldest first */
+		std::vector<e2::ProfileEvent> events(uint32_t threadIndex);
+
+		/** Every event still buffered, in the Chrome trace event format (chrome://tracing, Perfetto) */
+		std::string traceJson();
+		bool writeTrace(std::string const& path);
+
+	protected:
+		e2::ProfileThread* thread();
+
+		uint64_t m_serial{};
+		std::atomic<bool> m_enabled{};
+		uint64_t m_numFrames{};
+		uint64_t m_startTime{};
+		uint64_t m_frameStart{};
+
+		std::mutex m_threadsMutex;
+		std::vector<std::shared_ptr<e2::ProfileThread>> m_threads;
+
+		std::unordered_map<char const*, e2::ProfileFunction> m_functions;
+		e2::StackVector<e2::ProfileGroup, size_t(e2::ProfileGroupId::Count)> m_groups;
+
+	};
+
+	struct TimeBlock
+	{
+
+		TimeBlock(std::string const& name)
+			: m_name(name)
+		{
+			m_timer.reset();
+		}
+
+		~TimeBlock()
+		{
+			double ms = m_timer.seconds() * 1000.0;
+			LogNotice("TimeBlock {}: {}ms", m_name, ms);
+		}
+
+	protected:
+		e2::Timer m_timer;
+		std::string m_name;
+	};
+
+	struct ProfileBlock
+	{
+		Profiler* profiler{};
+		bool open{};
+
+		ProfileBlock(Profiler* inProfiler, e2::ProfileMarker const& marker)
+			: profiler(inProfiler)
+			, open(inProfiler->beginScope(marker))
+		{
+		}
+
+		~ProfileBlock()
+		{
+			if (open)
+				profiler->endScope();
+		}
+	};
+
+	/** Profiles nested scopes on several threads, checks nesting, exclusive times and per thread attribution, the rollup and trace export, and reports the cost per scope */
+	E2_API bool testProfiler();
+#endif
+}
@@ -22,6 +22,8 @@ namespace e2
 	class IDescriptorSet;
 	class IPipeline;
 	class IPipelineLayout;
+	class IDataBuffer;
+	class IVertexLayout;
 
 	/** 
 	 * Base-class for GPU proxies of a material asset.
@@ -78,9 +80,15 @@ namespace e2
 
 		e2::Session* session{};
 
-		/** The unique identifier we got from session when registering. Used for things like modelmatrix buffer offsets etc. */
+		/** The unique identifier we got from session when registering. */
 		uint32_t id{ UINT32_MAX };
 
+		/** Number of bones in the mesh, only these are uploaded */
+		uint32_t numBones{};
+
+		/** Where our palette lives in the session skin buffers, in bytes. Bound as the dynamic offset for the skin data */
+		uint32_t paletteOffset{ UINT32_MAX };
+
 		e2::SkeletonPtr skeletonAsset{};
 		e2::MeshPtr meshAsset{};
 
@@ -90,8 +98,6 @@ namespace e2
 		e2::Pair<bool> skinDirty{ true };
 	};
 
-	constexpr uint32_t maxNumLods = 3;
-
 	struct E2_API MeshLodConfiguration
 	{
 		float maxDistance{ 0.0f };
@@ -101,7 +107,21 @@ namespace e2
 
 	struct E2_API MeshProxyConfiguration
 	{
+		/** A single lod whose mesh has simplified levels gets one lod per level, picked by screen size instead of maxDistance */
 		e2::StackVector<MeshLodConfiguration, e2::maxNumLods> lods;
+
+		/** If nonzero, the proxy is instanced and draws its meshes once per instance, with room for this many instances */
+		uint32_t maxInstances{};
+	};
+
+	/**
+	 * One instance of an instanced mesh proxy, fed to the vertex stage as two vec4 attributes after the mesh attributes.
+	 * transform is the position (xyz) and rotation around the up axis (w), what parameters means is up to the shader
+	 */
+	struct E2_API InstanceData
+	{
+		glm::vec4 transform;
+		glm::vec4 parameters;
 	};
 
 
@@ -113,6 +133,12 @@ namespace e2
 
 		e2::MeshPtr asset{};
 
+		/** Level of detail in asset to draw, simplified levels share their asset with level 0 */
+		uint8_t level{};
+
+		/** Screen size below which this simplified level is used, zero for lods picked by maxDistance */
+		float maxScreenSize{ 0.0f };
+
 		/** Material proxies for this mesh lod, they default to the materials default proxies unless overridden. */
 		e2::StackVector<e2::MaterialProxy*, e2::maxNumSubmeshes> materialProxies;
 
@@ -123,6 +149,9 @@ namespace e2
 		/** Cache for the pipeline layouts to be used for the given submeshes in this lod. Cached from session. */
 		e2::StackVector<e2::IPipelineLayout*, e2::maxNumSubmeshes> pipelineLayouts;
 		e2::StackVector<e2::IPipelineLayout*, e2::maxNumSubmeshes> shadowPipelineLayouts;
+
+		/** Vertex layouts with the instance attributes added, only for instanced proxies */
+		e2::StackVector<e2::IVertexLayout*, e2::maxNumSubmeshes> instancedVertexLayouts;
 	};
 
 	/**
@@ -155,6 +184,14 @@ namespace e2
 		void setPosition(glm::vec3 const& position);
 		void setRotation(float rotation);
 
+		inline bool instanced() const
+		{
+			return maxInstances > 0;
+		}
+
+		/** Replaces the instances of an instanced proxy, they're uploaded by the session at most once per frame index */
+		void setInstances(e2::InstanceData const* data, uint32_t count);
+
 		e2::Session* session{};
 
 		/** The unique identifier we got from session when registering. Used for things like modelmatrix buffer offsets etc. */
@@ -166,9 +203,24 @@ namespace e2
 		e2::Pair<bool> modelMatrixDirty{ true };
 		e2::StackVector<MeshProxyLOD, e2::maxNumLods> lods;
 
-		bool lodTest(uint8_t lod, float distance);
+		uint32_t maxInstances{};
+		std::vector<e2::InstanceData> instances;
+		e2::Pair<bool> instancesDirty{ false };
+
+		/** Instance buffers, and how many instances were last uploaded to them (one per frame index) */
+		e2::Pair<e2::IDataBuffer*> instanceBuffers{ nullptr };
+		e2::Pair<uint32_t> numInstances{ 0 };
+
+		/** Picks the lod to draw from the main view, once per frame. Simplified levels go by screen size with some hysteresis, other lods by maxDistance */
+		void updateLod(glm::vec3 const& viewOrigin, float tanHalfFov);
+
+		/** True if lod is the one updateLod picked */
+		bool lodTest(uint8_t lod);
 
 		MeshProxyLOD* lodByDistance(float distance);
+
+		/** The lod updateLod picked, UINT8_MAX if the proxy is past every maxDistance */
+		uint8_t currentLod{};
 	};
 }  
   
@@ -36,10 +36,42 @@ namespace e2
         All = Normal | TexCoords01 | TexCoords23 | Color | Bones
     };
 
+    /** One vertex buffer of a submesh, in the order they are bound */
+    enum class VertexStream : uint8_t
+    {
+        Position = 0,
+        Normal,
+        Tangent,
+        TexCoords01,
+        TexCoords23,
+        Color,
+        Weights,
+        Bones
+    };
+
+    /**
+     * Format a stream is stored in, vec4 (or uvec4 for bone ids) unless quantized. Quantized streams are converted by the vertex fetch so shaders read the same types:
+     * positions and texcoords are halfs, normals and tangents snorm8, colors and weights unorm8 and bone ids uint8
+     */
+    E2_API e2::VertexFormat vertexStreamFormat(e2::VertexStream stream, bool quantized);
+
+    /** Bytes per vertex in a stream */
+    E2_API uint32_t vertexStreamStride(e2::VertexStream stream, bool quantized);
+
     E2_API void applyVertexAttributeDefines(e2::VertexAttributeFlags flags, e2::ShaderCreateInfo& outInfo);
 
     class IVertexLayout;
 
+    /** Range in the index buffer of a simplified level of detail, it indexes the same vertices as the full detail submesh */
+    struct E2_API SubmeshLod
+    {
+        uint32_t firstIndex{};
+        uint32_t indexCount{};
+
+        // how far the simplified surface is from the full detail one, in mesh units
+        float error{};
+    };
+
     /** Specification for mesh data for a single submesh */
     struct E2_API SubmeshSpecification
     {
@@ -57,7 +89,22 @@ namespace e2
         uint32_t indexCount{};
         uint32_t vertexCount{};
 
+        // vertex streams are in their compact formats, see vertexStreamFormat
+        bool quantized{};
+
+        e2::IndexFormat indexFormat{ e2::IndexFormat::Uint32 };
+
+        // simplified levels after the full detail one, their indices follow the full detail indices in indexBuffer
+        e2::StackVector<e2::SubmeshLod, e2::maxNumLods - 1> lods;
+
+        /** Index range to draw for a level of detail, level 0 and levels this submesh doesn't have draw the full detail indices */
+        e2::SubmeshLod lod(uint8_t level) const
+        {
+            if (level == 0 || level > lods.size())
+                return { 0, indexCount, 0.0f };
 
+            return lods[level - 1];
+        }
     };
 
 
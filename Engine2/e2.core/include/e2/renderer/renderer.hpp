@@ -30,6 +30,9 @@ namespace e2
 		/** Mesh is skinned */
 		Skin = 1 << 1,
 
+		/** Mesh is drawn once per record in its proxy's instance buffer */
+		Instanced = 1 << 2,
+
 
 	};
 
@@ -217,6 +220,12 @@ layout(set = RendererSetIndex, binding = 0) uniform RendererData
 
 		e2::Session* session() const;
 
+		/** Seconds this renderer has been running, as the shaders see it in renderer.time.x */
+		inline float time() const
+		{
+			return m_rendererData.time.x;
+		}
+
 		void setView(e2::RenderView const& renderView);
 
 		inline e2::ITexture* colorTarget() const
@@ -50,6 +50,9 @@ namespace e2
 
 		virtual bool supportsShadows();
 
+		/** Whether pipelines can be created with RendererFlags::Instanced, for instanced mesh proxies */
+		virtual bool supportsInstancing();
+
 		void active(bool newValue);
 		bool active();
 
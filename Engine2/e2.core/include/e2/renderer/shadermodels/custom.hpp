@@ -7,6 +7,7 @@
 #include <e2/renderer/shadermodel.hpp>
 
 #include <map>
+#include <unordered_map>
 #include <cstdint>
 
 namespace e2
@@ -104,6 +105,7 @@ namespace e2
 		virtual e2::IPipeline* getOrCreatePipeline(e2::MeshProxy* proxy, uint8_t lodIndex, uint8_t submeshIndex, e2::RendererFlags rendererFlags) override;
 
 		virtual bool supportsShadows() override;
+		virtual bool supportsInstancing() override;
 		virtual void invalidatePipelines() override;
 
 		e2::IdArena<uint32_t, e2::maxNumCustomProxies> proxyIds;
@@ -147,6 +149,9 @@ namespace e2
 
 		e2::StackVector<e2::CustomCacheEntry, uint16_t(e2::CustomFlags::Count)> m_pipelineCache;
 
+		/** Pipelines for instanced proxies, there are few enough of them that they don't get a slot per permutation */
+		std::unordered_map<uint16_t, e2::CustomCacheEntry> m_instancedPipelineCache;
+
 		//std::unordered_map<e2::CustomFlags, CustomCacheEntry> m_pipelineCache;
 
 		e2::Name m_name;
@@ -95,6 +95,16 @@ namespace e2
 		D32S8,
 		S8,
 
+		// block compressed, stored in texture assets so only ever append
+		BC1,
+		BC1SRGB,
+		BC3,
+		BC3SRGB,
+		BC4,
+		BC5,
+		BC7,
+		BC7SRGB,
+
 		Count
 	};
 
@@ -131,7 +141,15 @@ namespace e2
 		Uint,
 		Vec2u,
 		Vec3u,
-		Vec4u
+		Vec4u,
+
+		// halfs and normalized bytes, read as vec4
+		Vec4Half,
+		Vec4Snorm8,
+		Vec4Unorm8,
+
+		// read as uvec4
+		Vec4u8
 	};
 
 	enum class VertexRate : uint8_t
@@ -140,6 +158,12 @@ namespace e2
 		PerInstance
 	};
 
+	enum class IndexFormat : uint8_t
+	{
+		Uint32 = 0,
+		Uint16
+	};
+
 	enum class LoadOperation : uint8_t
 	{
 		Ignore = 0,
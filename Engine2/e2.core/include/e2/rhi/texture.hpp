@@ -55,6 +55,9 @@ namespace e2
 		virtual void generateMips() = 0;
 		virtual void generateMipsCmd(e2::ICommandBuffer* buff) = 0;
 	};
+
+	/** True for the BC formats. These can't be render targets or blitted, so their mips have to be uploaded rather than generated */
+	E2_API bool isBlockCompressed(e2::TextureFormat format);
 }
 
 #include "texture.generated.hpp"
\ No newline at end of file
@@ -104,11 +104,11 @@ namespace e2
 		virtual void nullVertexLayout() =0;
 		virtual void bindVertexLayout(e2::IVertexLayout* vertexLayout) = 0;
 		virtual void bindVertexBuffer(uint32_t binding, e2::IDataBuffer* dataBuffer) = 0;
-		virtual void bindIndexBuffer(e2::IDataBuffer* dataBuffer) = 0;
+		virtual void bindIndexBuffer(e2::IDataBuffer* dataBuffer, e2::IndexFormat format = e2::IndexFormat::Uint32) = 0;
 
 		virtual void pushConstants(e2::IPipelineLayout* layout, uint32_t offset, uint32_t size, uint8_t const* data) = 0;
 
-		virtual void draw(uint32_t indexCount, uint32_t instanceCount) = 0;
+		virtual void draw(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex = 0) = 0;
 		virtual void drawNonIndexed(uint32_t vertexCount, uint32_t instanceCount) = 0;
 
 		virtual void useAsDescriptor(e2::ITexture* texture) = 0;
@@ -53,11 +53,11 @@ namespace e2
 		virtual void nullVertexLayout() override;
 		virtual void bindVertexLayout(e2::IVertexLayout* vertexLayout) override;
 		virtual void bindVertexBuffer(uint32_t binding, e2::IDataBuffer* dataBuffer) override;
-		virtual void bindIndexBuffer(e2::IDataBuffer* dataBuffer) override;
+		virtual void bindIndexBuffer(e2::IDataBuffer* dataBuffer, e2::IndexFormat format = e2::IndexFormat::Uint32) override;
 
 		virtual void pushConstants(e2::IPipelineLayout* layout, uint32_t offset, uint32_t size, uint8_t const* data) override;
 
-		virtual void draw(uint32_t indexCount, uint32_t instanceCount) override;
+		virtual void draw(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex = 0) override;
 		virtual void drawNonIndexed(uint32_t vertexCount, uint32_t instanceCount) override;
 
 		virtual void useAsDescriptor(e2::ITexture* texture) override;
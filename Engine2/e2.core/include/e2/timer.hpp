@@ -59,5 +59,48 @@ namespace e2
 		e2::Moment m_start;
 	};
 
+	/**
+	 * Fixed rate scheduler. Feed it frame time, and it tells you how many fixed steps to run.
+	 * At most maxSteps per advance, time beyond that is dropped so a long frame can't snowball into longer ones.
+	 */
+	class E2_API FixedTimestep
+	{
+	public:
+		FixedTimestep(double stepsPerSecond, uint32_t maxSteps);
+
+		/** Adds seconds of frame time, and returns how many steps to run now */
+		uint32_t advance(double seconds);
+
+		double stepSeconds() const
+		{
+			return m_stepSeconds;
+		}
+
+		/** How far we are from the last step towards the next, in [0, 1). Render by interpolating between the last two steps with this */
+		double alpha() const
+		{
+			return m_accumulator / m_stepSeconds;
+		}
+
+		/** Steps handed out since creation */
+		uint64_t numSteps() const
+		{
+			return m_numSteps;
+		}
+
+		/** Steps we skipped since creation, because frames were too long */
+		uint64_t numDroppedSteps() const
+		{
+			return m_numDroppedSteps;
+		}
+
+	protected:
+		double m_stepSeconds{};
+		uint32_t m_maxSteps{};
+		double m_accumulator{};
+		uint64_t m_numSteps{};
+		uint64_t m_numDroppedSteps{};
+	};
+
 
 }
\ No newline at end of file
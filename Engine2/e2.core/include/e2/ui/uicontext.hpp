@@ -15,24 +15,11 @@
 
 #include <e2/timer.hpp>
 #include <e2/ui/uitypes.hpp>
+#include <e2/ui/uiwidgettable.hpp>
+#include <e2/ui/uitextlayout.hpp>
 
 namespace e2
 {
-	constexpr uint32_t maxNumUIWidgetData = 4096;
-	constexpr uint32_t uiRetainFrameCount = 4;
-
-	struct E2_API UIWidgetState
-	{
-		size_t id;
-		uint32_t framesSinceActive{0};
-		glm::vec2 position;
-		glm::vec2 size;
-		bool hovered{};
-		bool active{};
-
-		float dragOrigin{};
-	};
-
 	constexpr uint32_t uiIdStackSize = 32;
 
 
@@ -298,7 +285,6 @@ namespace e2
 
 		float calculateSDFTextWidth(e2::FontFace fontFace, float fontSize, std::string const& markdownUtf8);
 
-		/** @todo build renderstate here for drawRasterText to cut CPU time for rendering text in almost half  */
 		float calculateTextWidth(e2::FontFace fontFace, uint8_t fontSize, std::string const& markdownUtf8);
 
 		// --- End Rendering --- //
@@ -340,9 +326,10 @@ namespace e2
 
 		e2::StackVector<e2::Name, uiIdStackSize> m_idStack;
 
-		std::unordered_map<size_t, e2::UIWidgetState*> m_dataMap;
-		e2::Arena<UIWidgetState> m_dataArena;
-		std::vector<size_t> m_clearList;
+		e2::UIWidgetTable m_widgets;
+
+		e2::UIDefaultFontMetrics m_fontMetrics{ this };
+		e2::UITextLayoutCache m_textLayouts{ &m_fontMetrics };
 
 		size_t m_activeId;
 
@@ -0,0 +1,133 @@
+
+#pragma once
+
+#include <e2/buildcfg.hpp>
+#include <e2/export.hpp>
+#include <e2/utils.hpp>
+
+#include <e2/assets/font.hpp>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace e2
+{
+	class Context;
+
+	/** Text layouts not drawn or measured for this many frames are dropped */
+	constexpr uint32_t uiTextLayoutRetainFrameCount = 120;
+
+	/** Glyph color that means the color passed to the draw call, as opposed to an index into the accent table */
+	constexpr uint8_t uiTextDefaultColor = 0xFF;
+
+	struct E2_API UITextGlyph
+	{
+		/** Relative to the position the text is drawn at */
+		glm::vec2 offset;
+		glm::vec2 size;
+
+		glm::vec2 uvOffset;
+		glm::vec2 uvSize;
+
+		e2::ITexture* texture{};
+
+		/** uiTextDefaultColor, or 0-9 as set by ^0-^9 (see UIContext::drawRasterText) */
+		uint8_t color{ e2::uiTextDefaultColor };
+	};
+
+	/** Parsed and shaped markdown text, ready to be drawn as is */
+	struct E2_API UITextLayout
+	{
+		// what this was built from, used to tell hash collisions apart
+		std::string text;
+		float fontSize{};
+		e2::FontFace fontFace{};
+		bool sdf{};
+		bool enableColorChange{};
+		bool built{};
+
+		std::vector<e2::UITextGlyph> glyphs;
+
+		/** Sum of all advances, this is what calculateTextWidth returns */
+		float width{};
+
+		/** Lower right corner of all glyph quads, relative to the position the text is drawn at */
+		glm::vec2 extents{};
+
+		uint64_t lastUsedFrame{};
+	};
+
+	/**
+	 * What text layout asks of the fonts, per face. Same units as e2::Font: sdf glyphs are in 32 pixel em units, raster glyphs in pixels at uint8_t(fontSize).
+	 * Lets layout run without a renderer, against any fonts or none at all
+	 */
+	class E2_API IUITextMetrics
+	{
+	public:
+		virtual ~IUITextMetrics();
+
+		virtual float midlineOffset(e2::FontFace face, float fontSize, bool sdf) = 0;
+		virtual float spaceAdvance(e2::FontFace face, e2::FontStyle style, float fontSize, bool sdf) = 0;
+		virtual float kerning(e2::FontFace face, uint32_t left, uint32_t right, e2::FontStyle style, float fontSize, bool sdf) = 0;
+		virtual e2::FontGlyph glyph(e2::FontFace face, uint32_t codepoint, e2::FontStyle style, float fontSize, bool sdf) = 0;
+		virtual e2::ITexture* glyphTexture(e2::FontFace face, uint32_t textureIndex) = 0;
+	};
+
+	/** Metrics of the render manager's default fonts, this is what UIContext lays out with */
+	class E2_API UIDefaultFontMetrics : public e2::IUITextMetrics
+	{
+	public:
+		UIDefaultFontMetrics(e2::Context* context);
+
+		virtual float midlineOffset(e2::FontFace face, float fontSize, bool sdf) override;
+		virtual float spaceAdvance(e2::FontFace face, e2::FontStyle style, float fontSize, bool sdf) override;
+		virtual float kerning(e2::FontFace face, uint32_t left, uint32_t right, e2::FontStyle style, float fontSize, bool sdf) override;
+		virtual e2::FontGlyph glyph(e2::FontFace face, uint32_t codepoint, e2::FontStyle style, float fontSize, bool sdf) override;
+		virtual e2::ITexture* glyphTexture(e2::FontFace face, uint32_t textureIndex) override;
+
+	protected:
+		e2::Context* m_context{};
+	};
+
+	/** Parses and shapes markdown text from scratch, see UIContext::drawRasterText for the markup */
+	E2_API void buildTextLayout(e2::IUITextMetrics* metrics, e2::FontFace fontFace, float fontSize, std::string const& markdownUtf8, bool sdf, bool enableColorChange, e2::UITextLayout& outLayout);
+
+	/**
+	 * Text layouts by text and font parameters. Built the first time they're asked for, and dropped once unused for uiTextLayoutRetainFrameCount frames,
+	 * so text that is drawn and measured every frame is only parsed once
+	 */
+	class E2_API UITextLayoutCache
+	{
+	public:
+		UITextLayoutCache(e2::IUITextMetrics* metrics);
+
+		/**
+		 * Layout of the given text, built now unless it's cached.
+		 * The reference is only good until the next call to layout() or newFrame(): a miss may grow the table, and a hash collision rebuilds the same slot. Copy what you need to keep
+		 */
+		e2::UITextLayout const& layout(e2::FontFace fontFace, float fontSize, std::string const& markdownUtf8, bool sdf, bool enableColorChange);
+
+		/** Ages every layout by a frame, and now and then drops the stale ones. Call once per ui frame */
+		void newFrame();
+
+		/** Drops every layout not used within the last uiTextLayoutRetainFrameCount frames */
+		void evict();
+
+		uint64_t numLayouts() const
+		{
+			return m_layouts.size();
+		}
+
+	protected:
+		e2::IUITextMetrics* m_metrics{};
+		std::unordered_map<size_t, e2::UITextLayout> m_layouts;
+		uint64_t m_frame{};
+	};
+
+	/**
+	 * Lays out numStrings random markdown strings against made up metrics, cached and uncached, and verifies they are identical,
+	 * that hits return the same layout, and that stale layouts are evicted. Needs no renderer or fonts
+	 */
+	E2_API bool testTextLayoutCache(uint32_t numStrings);
+}
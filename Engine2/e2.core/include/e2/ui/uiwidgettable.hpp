@@ -0,0 +1,95 @@
+
+#pragma once
+
+#include <e2/buildcfg.hpp>
+#include <e2/export.hpp>
+#include <e2/utils.hpp>
+
+#include <vector>
+
+namespace e2
+{
+	constexpr uint32_t maxNumUIWidgetData = 4096;
+	constexpr uint32_t uiRetainFrameCount = 4;
+
+	/** Slots in the widget table, twice the widget count so probe chains stay short */
+	constexpr uint32_t uiWidgetTableSize = e2::maxNumUIWidgetData * 2;
+
+	struct E2_API UIWidgetState
+	{
+		size_t id;
+
+		/** The widget frame this was last reserved in, anything older than uiRetainFrameCount frames is stale */
+		uint64_t lastFrame{};
+
+		glm::vec2 position;
+		glm::vec2 size;
+		bool hovered{};
+		bool active{};
+
+		float dragOrigin{};
+	};
+
+	/**
+	 * Widget states by combined id. States live in an arena, looked up through a flat open-addressed table.
+	 * Nothing is swept per frame: a stale state is recycled in place when a probe for a new id passes over it,
+	 * and only if the arena runs dry are all stale states dropped at once
+	 */
+	class E2_API UIWidgetTable
+	{
+	public:
+		UIWidgetTable();
+
+		/** 
+		 * State for id, kept as is if it was reserved within the last uiRetainFrameCount frames, otherwise reset.
+		 * Returns nullptr if more than maxNumUIWidgetData widgets are in use
+		 */
+		e2::UIWidgetState* reserve(size_t id);
+
+		/** Ages every state by a frame, call once per ui frame */
+		void newFrame();
+
+		/** States taken from the arena, live or stale */
+		uint32_t numStates() const
+		{
+			return m_numStates;
+		}
+
+		/** How many times stale states were dropped because the arena ran dry */
+		uint32_t numCompactions() const
+		{
+			return m_numCompactions;
+		}
+
+	protected:
+		struct Slot
+		{
+			size_t id{};
+
+			/** nullptr for empty slots */
+			e2::UIWidgetState* state{};
+		};
+
+		bool stale(e2::UIWidgetState const* state) const
+		{
+			return m_frame - state->lastFrame >= e2::uiRetainFrameCount;
+		}
+
+		uint32_t homeSlot(size_t id) const;
+
+		void reset(e2::UIWidgetState* state, size_t id);
+
+		/** Returns the states of all stale slots to the arena and reinserts the live ones */
+		void compact();
+
+		std::vector<Slot> m_slots;
+		std::vector<Slot> m_liveSlots;
+		e2::Arena<e2::UIWidgetState> m_arena;
+		uint32_t m_numStates{};
+		uint32_t m_numCompactions{};
+		uint64_t m_frame{};
+	};
+
+	/** Drives numFrames of synthetic widget ids through a widget table, and verifies states persist, reset and stay within the arena like they should */
+	E2_API bool testUIWidgetTable(uint32_t numFrames);
+}
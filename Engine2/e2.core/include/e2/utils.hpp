@@ -234,6 +234,9 @@ namespace e2
 	E2_API bool readFile(std::string const& path, std::string& outData);
 	E2_API bool writeFile(std::string const& path, std::string const& data);
 
+	/** Flushes a closed file's contents to disk, so renaming it over another file can't leave that one empty after a crash */
+	E2_API bool syncFile(std::string const& path);
+
 	/**
 	 * Reads a string file, but allows c++/glsl-style includes to be made.
 	 * All paths are relative to the current working directory
@@ -677,6 +680,74 @@ namespace e2
 	};
 
 
+	/**
+	 * Lock-free ring for passing data from exactly one producer thread to exactly one consumer thread
+	 * --
+	 * Storage is static like StackVector, and indices only ever grow, so full and empty are never ambiguous.
+	 * push() may only be called from the producer, pop() only from the consumer.
+	 * clear() is only safe while neither side is running.
+	 */
+	template<typename DataType, uint64_t Capacity>
+		requires (!Empty<Capacity>)
+	class SpscRing
+	{
+	public:
+
+		/** Returns false if the ring is full */
+		bool push(DataType const& value)
+		{
+			uint64_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) >= Capacity)
+				return false;
+
+			m_data[tail % Capacity] = value;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/** Returns false if the ring is empty */
+		bool pop(DataType& outValue)
+		{
+			uint64_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+
+			outValue = std::move(m_data[head % Capacity]);
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/** Only exact when called from either side, otherwise a snapshot */
+		uint64_t size() const
+		{
+			return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		constexpr uint64_t capacity() const
+		{
+			return Capacity;
+		}
+
+		void clear()
+		{
+			m_head.store(0, std::memory_order_relaxed);
+			m_tail.store(0, std::memory_order_relaxed);
+		}
+
+	protected:
+		// keep the indices on separate cache lines, so the two threads don't fight over them
+		alignas(64) std::atomic<uint64_t> m_head{};
+		alignas(64) std::atomic<uint64_t> m_tail{};
+
+		DataType m_data[Capacity];
+	};
+
+
 	/** 
 	 * Cached string, use for commonly used shorter strings. Cached and reused. Overhead is 32bit unsigned integer.
 	 * Serialized as a c-string, as the index is not guaranteed to be the same on every execution
@@ -14,6 +14,11 @@ e2::Application::~Application()
 
 }
 
+void e2::Application::preShutdown()
+{
+
+}
+
 
 e2::Engine* e2::Application::engine()
 {
@@ -1,6 +1,7 @@
 
 #include "e2/assets/mesh.hpp"
 #include "e2/assets/material.hpp"
+#include "e2/assets/meshquantization.hpp"
 
 #include "e2/managers/assetmanager.hpp"
 #include "e2/managers/rendermanager.hpp"
@@ -57,6 +58,22 @@ bool e2::Mesh::read(e2::IStream& source)
 			source >> mappingBoneIndex;
 
 			m_boneIndex[mappingName] = mappingBoneIndex;
+			m_numBones = glm::max(m_numBones, mappingBoneIndex + 1);
+		}
+	}
+
+	if (version >= AssetVersion::MeshLods)
+	{
+		source >> m_radius;
+
+		uint8_t numLods{};
+		source >> numLods;
+		for (uint8_t i = 0; i < numLods; i++)
+		{
+			float screenSize{};
+			source >> screenSize;
+			if (i + 1 < e2::maxNumLods)
+				m_lodScreenSizes.push(screenSize);
 		}
 	}
 
@@ -78,7 +95,33 @@ bool e2::Mesh::read(e2::IStream& source)
 		source >> attributeFlags;
 		newSpecification.attributeFlags = (e2::VertexAttributeFlags)attributeFlags;
 
-		newSpecification.vertexLayout = renderManager()->getOrCreateVertexLayout(newSpecification.attributeFlags);
+		if (version >= AssetVersion::QuantizedMeshes)
+		{
+			uint8_t quantized{};
+			source >> quantized;
+			newSpecification.quantized = quantized != 0;
+
+			uint8_t indexFormat{};
+			source >> indexFormat;
+			newSpecification.indexFormat = (e2::IndexFormat)indexFormat;
+		}
+
+		if (version >= AssetVersion::MeshLods)
+		{
+			uint8_t numLods{};
+			source >> numLods;
+			for (uint8_t j = 0; j < numLods; j++)
+			{
+				e2::SubmeshLod newLod;
+				source >> newLod.firstIndex;
+				source >> newLod.indexCount;
+				source >> newLod.error;
+				if (j + 1 < e2::maxNumLods)
+					newSpecification.lods.push(newLod);
+			}
+		}
+
+		newSpecification.vertexLayout = renderManager()->getOrCreateVertexLayout(newSpecification.attributeFlags, false, newSpecification.quantized);
 
 		auto readIndexBuffer = [this, &source, &newSpecification]() -> void {
 			uint32_t bufferSize{};
@@ -198,11 +241,14 @@ void e2::Mesh::addProceduralSubmesh(e2::ProceduralSubmesh const& sourceData)
 	e2::DataBufferCreateInfo bufferCreateInfo{};
 	bufferCreateInfo.dynamic = false;
 
-	// Indices
+	// Indices, 16 bit when they fit. Vertex streams stay full precision, procedural meshes are often read back and edited
+	std::vector<uint8_t> indexData;
+	newSpecification.indexFormat = e2::encodeIndices(sourceData.sourceIndices, sourceData.numIndices, indexData);
+
 	bufferCreateInfo.type = BufferType::IndexBuffer;
-	bufferCreateInfo.size = sizeof(uint32_t) * sourceData.numIndices;
+	bufferCreateInfo.size = indexData.size();
 	newBuffer = renderContext()->createDataBuffer(bufferCreateInfo);
-	newBuffer->upload(reinterpret_cast<uint8_t const*>(sourceData.sourceIndices), bufferCreateInfo.size, 0, 0);
+	newBuffer->upload(indexData.data(), bufferCreateInfo.size, 0, 0);
 	newSpecification.indexBuffer = newBuffer;
 
 	// Positions
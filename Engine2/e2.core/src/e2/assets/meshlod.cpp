@@ -0,0 +1,860 @@
+
+#include "e2/assets/meshlod.hpp"
+
+#include "e2/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+	// plane quadric (symmetric 4x4, upper triangle) and the area it was weighted by, evaluates to weighted squared distance from the planes
+	struct Quadric
+	{
+		double a2{}, ab{}, ac{}, ad{}, b2{}, bc{}, bd{}, c2{}, cd{}, d2{};
+		double weight{};
+
+		void addPlane(glm::dvec3 const& n, double d, double w)
+		{
+			a2 += n.x * n.x * w; ab += n.x * n.y * w; ac += n.x * n.z * w; ad += n.x * d * w;
+			b2 += n.y * n.y * w; bc += n.y * n.z * w; bd += n.y * d * w;
+			c2 += n.z * n.z * w; cd += n.z * d * w;
+			d2 += d * d * w;
+			weight += w;
+		}
+
+		void add(Quadric const& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+
+		double evaluate(glm::dvec3 const& p) const
+		{
+			double value = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+				+ b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+				+ c2 * p.z * p.z + 2.0 * cd * p.z
+				+ d2;
+			return std::max(value, 0.0);
+		}
+	};
+
+	struct PositionKey
+	{
+		uint32_t bits[3];
+
+		bool operator==(PositionKey const& other) const
+		{
+			return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+		}
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()(PositionKey const& key) const
+		{
+			uint64_t h = key.bits[0];
+			h = h * 0x9E3779B97F4A7C15ull ^ key.bits[1];
+			h = h * 0x9E3779B97F4A7C15ull ^ key.bits[2];
+			return size_t(h ^ (h >> 29));
+		}
+	};
+
+	PositionKey positionKey(glm::vec4 const& position)
+	{
+		// +0 so -0 and 0 weld
+		float values[3] = { position.x + 0.0f, position.y + 0.0f, position.z + 0.0f };
+		PositionKey key;
+		std::memcpy(key.bits, values, sizeof(key.bits));
+		return key;
+	}
+
+	uint64_t edgeKey(uint32_t from, uint32_t to)
+	{
+		return (uint64_t(from) << 32) | to;
+	}
+
+	// total difference in bone weights, 0 when skinned the same and 2 when they share no bones. Unused slots often repeat a bone id with no weight, so influences are summed per bone
+	float skinDistance(glm::vec4 const* weights, glm::uvec4 const* bones, uint32_t a, uint32_t b)
+	{
+		uint32_t ids[8];
+		float difference[8];
+		uint32_t numIds = 0;
+
+		auto accumulate = [&](uint32_t vertex, float sign) {
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				uint32_t slot = 0;
+				while (slot < numIds && ids[slot] != bones[vertex][i])
+					slot++;
+
+				if (slot == numIds)
+				{
+					ids[numIds] = bones[vertex][i];
+					difference[numIds++] = 0.0f;
+				}
+
+				difference[slot] += weights[vertex][i] * sign;
+			}
+		};
+
+		accumulate(a, 1.0f);
+		accumulate(b, -1.0f);
+
+		float distance = 0.0f;
+		for (uint32_t i = 0; i < numIds; i++)
+			distance += std::abs(difference[i]);
+
+		return distance;
+	}
+
+	glm::dvec3 triangleNormal(glm::dvec3 const& a, glm::dvec3 const& b, glm::dvec3 const& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+
+	struct Collapse
+	{
+		uint32_t from{};
+		uint32_t to{};
+		double cost{};
+	};
+}
+
+float e2::simplifyIndices(uint32_t const* indices, uint32_t numIndices, glm::vec4 const* positions, uint32_t numVertices, glm::vec4 const* weights, glm::uvec4 const* bones, uint32_t targetIndexCount, float maxError, std::vector<uint32_t>& outIndices)
+{
+	outIndices.assign(indices, indices + numIndices);
+	if (numIndices <= targetIndexCount || numVertices == 0)
+		return 0.0f;
+
+	bool skinned = weights && bones;
+
+	std::vector<glm::dvec3> points(numVertices);
+	for (uint32_t i = 0; i < numVertices; i++)
+		points[i] = glm::dvec3(positions[i]);
+
+	// vertices that share a position with another one sit on a uv or normal seam, moving them would tear it open
+	std::vector<uint8_t> seam(numVertices, 0);
+	{
+		std::unordered_map<::PositionKey, uint32_t, ::PositionKeyHash> firstVertex;
+		firstVertex.reserve(numVertices);
+		for (uint32_t i = 0; i < numVertices; i++)
+		{
+			auto inserted = firstVertex.insert({ ::positionKey(positions[i]), i });
+			if (!inserted.second)
+			{
+				seam[i] = 1;
+				seam[inserted.first->second] = 1;
+			}
+		}
+	}
+
+	// quadrics of the planes around each vertex, weighted by triangle area, and the surface normal at it
+	std::vector<::Quadric> quadrics(numVertices);
+	std::vector<glm::dvec3> normals(numVertices, glm::dvec3(0.0));
+	for (uint32_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		uint32_t const* tri = &indices[i];
+		glm::dvec3 normal = ::triangleNormal(points[tri[0]], points[tri[1]], points[tri[2]]);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+
+		for (uint32_t j = 0; j < 3; j++)
+			normals[tri[j]] += normal;
+
+		normal /= length;
+		double d = -glm::dot(normal, points[tri[0]]);
+		for (uint32_t j = 0; j < 3; j++)
+			quadrics[tri[j]].addPlane(normal, d, length * 0.5);
+	}
+
+	for (glm::dvec3& normal : normals)
+	{
+		double length = glm::length(normal);
+		if (length > 0.0)
+			normal /= length;
+	}
+
+	// border edges also get a plane along the edge, upright from the triangle, so borders keep their outline
+	{
+		std::unordered_map<uint64_t, uint32_t> edges;
+		edges.reserve(numIndices);
+		for (uint32_t i = 0; i + 2 < numIndices; i += 3)
+		{
+			for (uint32_t j = 0; j < 3; j++)
+				edges[::edgeKey(indices[i + j], indices[i + (j + 1) % 3])]++;
+		}
+
+		for (uint32_t i = 0; i + 2 < numIndices; i += 3)
+		{
+			uint32_t const* tri = &indices[i];
+			glm::dvec3 normal = ::triangleNormal(points[tri[0]], points[tri[1]], points[tri[2]]);
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				uint32_t a = tri[j], b = tri[(j + 1) % 3];
+				if (edges.contains(::edgeKey(b, a)))
+					continue;
+
+				glm::dvec3 edge = points[b] - points[a];
+				glm::dvec3 borderNormal = glm::cross(edge, normal);
+				double length = glm::length(borderNormal);
+				if (length <= 0.0)
+					continue;
+
+				borderNormal /= length;
+				double d = -glm::dot(borderNormal, points[a]);
+				double w = glm::dot(edge, edge);
+				quadrics[a].addPlane(borderNormal, d, w);
+				quadrics[b].addPlane(borderNormal, d, w);
+			}
+		}
+	}
+
+	double maxCost = double(maxError) * double(maxError);
+	double worstCost = 0.0;
+
+	std::vector<uint32_t> triangleOffsets(numVertices + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<uint8_t> border(numVertices);
+	std::vector<uint8_t> locked(numVertices);
+	std::vector<uint8_t> touched(numVertices);
+	std::vector<uint32_t> remap(numVertices);
+	std::vector<::Collapse> collapses;
+	std::unordered_map<uint64_t, uint32_t> edges;
+
+	while (outIndices.size() > targetIndexCount)
+	{
+		uint32_t numTriangles = uint32_t(outIndices.size() / 3);
+
+		// triangles around each vertex
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : outIndices)
+			triangleOffsets[index + 1]++;
+		for (uint32_t i = 0; i < numVertices; i++)
+			triangleOffsets[i + 1] += triangleOffsets[i];
+
+		vertexTriangles.resize(outIndices.size());
+		{
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (uint32_t i = 0; i < outIndices.size(); i++)
+				vertexTriangles[cursor[outIndices[i]]++] = i / 3;
+		}
+
+		// directed edges, an edge without a twin is a border, an edge seen twice is non manifold and left alone
+		edges.clear();
+		for (uint32_t i = 0; i < outIndices.size(); i += 3)
+		{
+			for (uint32_t j = 0; j < 3; j++)
+				edges[::edgeKey(outIndices[i + j], outIndices[i + (j + 1) % 3])]++;
+		}
+
+		std::fill(border.begin(), border.end(), 0);
+		for (uint32_t i = 0; i < numVertices; i++)
+			locked[i] = seam[i];
+
+		for (auto const& [key, count] : edges)
+		{
+			uint32_t a = uint32_t(key >> 32), b = uint32_t(key);
+			auto twin = edges.find(::edgeKey(b, a));
+			if (count > 1 || (twin != edges.end() && twin->second > 1))
+			{
+				locked[a] = locked[b] = 1;
+			}
+			else if (twin == edges.end())
+			{
+				border[a] = border[b] = 1;
+			}
+
+			if (skinned && ::skinDistance(weights, bones, a, b) > e2::lodSkinTolerance)
+				locked[a] = locked[b] = 1;
+		}
+
+		auto isBorderEdge = [&edges](uint32_t a, uint32_t b) -> bool {
+			return !edges.contains(::edgeKey(a, b)) || !edges.contains(::edgeKey(b, a));
+		};
+
+		auto canCollapse = [&](uint32_t from, uint32_t to) -> bool {
+			if (locked[from])
+				return false;
+
+			if (border[from] && !isBorderEdge(from, to))
+				return false;
+
+			return true;
+		};
+
+		auto collapseCost = [&](uint32_t from, uint32_t to) -> double {
+			::Quadric combined = quadrics[from];
+			combined.add(quadrics[to]);
+			return combined.weight > 0.0 ? combined.evaluate(points[to]) / combined.weight : 0.0;
+		};
+
+		// cheapest direction of every edge
+		collapses.clear();
+		for (auto const& [key, count] : edges)
+		{
+			uint32_t a = uint32_t(key >> 32), b = uint32_t(key);
+			if (a > b && edges.contains(::edgeKey(b, a)))
+				continue;
+
+			::Collapse best{ 0, 0, std::numeric_limits<double>::max() };
+			if (canCollapse(a, b))
+				best = { a, b, collapseCost(a, b) };
+
+			if (canCollapse(b, a))
+			{
+				double cost = collapseCost(b, a);
+				if (cost < best.cost)
+					best = { b, a, cost };
+			}
+
+			if (best.cost <= maxCost)
+				collapses.push_back(best);
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](::Collapse const& lhs, ::Collapse const& rhs) {
+			return lhs.cost < rhs.cost || (lhs.cost == rhs.cost && (lhs.from < rhs.from || (lhs.from == rhs.from && lhs.to < rhs.to)));
+		});
+
+		// collapse the cheapest, at most one per neighbourhood per pass so the checks see current triangles
+		for (uint32_t i = 0; i < numVertices; i++)
+			remap[i] = i;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		uint32_t trianglesToRemove = (uint32_t(outIndices.size()) - targetIndexCount + 2) / 3;
+		uint32_t removed = 0;
+		uint32_t numCollapsed = 0;
+
+		for (::Collapse const& collapse : collapses)
+		{
+			if (removed >= trianglesToRemove)
+				break;
+
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// the triangles that stay must not flip or go flat, or turn away from the surface they started on (a few small turns add up)
+			bool valid = true;
+			uint32_t collapsedTriangles = 0;
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && valid; t++)
+			{
+				uint32_t const* tri = &outIndices[vertexTriangles[t] * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+				{
+					collapsedTriangles++;
+					continue;
+				}
+
+				glm::dvec3 corners[3] = { points[tri[0]], points[tri[1]], points[tri[2]] };
+				glm::dvec3 before = ::triangleNormal(corners[0], corners[1], corners[2]);
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					if (tri[j] == collapse.from)
+						corners[j] = points[collapse.to];
+				}
+				glm::dvec3 after = ::triangleNormal(corners[0], corners[1], corners[2]);
+
+				double beforeLength = glm::length(before), afterLength = glm::length(after);
+				if (afterLength <= beforeLength * 1e-6 || glm::dot(before, after) < 0.25 * beforeLength * afterLength)
+					valid = false;
+
+				for (uint32_t j = 0; j < 3 && valid; j++)
+				{
+					uint32_t corner = tri[j] == collapse.from ? collapse.to : tri[j];
+					if (glm::dot(after, normals[corner]) < 0.25 * afterLength)
+						valid = false;
+				}
+			}
+
+			if (!valid || collapsedTriangles == 0)
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			worstCost = std::max(worstCost, collapse.cost);
+
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+			{
+				uint32_t const* tri = &outIndices[vertexTriangles[t] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+
+			removed += collapsedTriangles;
+			numCollapsed++;
+		}
+
+		if (numCollapsed == 0)
+			break;
+
+		uint32_t write = 0;
+		for (uint32_t i = 0; i < numTriangles; i++)
+		{
+			uint32_t a = remap[outIndices[i * 3]], b = remap[outIndices[i * 3 + 1]], c = remap[outIndices[i * 3 + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			outIndices[write++] = a;
+			outIndices[write++] = b;
+			outIndices[write++] = c;
+		}
+		outIndices.resize(write);
+	}
+
+	return float(std::sqrt(worstCost));
+}
+
+float e2::meshRadius(glm::vec4 const* positions, uint32_t numVertices)
+{
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < numVertices; i++)
+		radius = std::max(radius, glm::length(glm::vec3(positions[i])));
+
+	return radius;
+}
+
+void e2::generateMeshLods(e2::MeshLodSettings const& settings, e2::LodSource const* submeshes, uint32_t numSubmeshes, e2::MeshLods& outLods)
+{
+	uint32_t numLevels = std::min(settings.numLods, e2::maxNumLods - 1);
+
+	outLods.radius = 0.0f;
+	for (uint32_t i = 0; i < numSubmeshes; i++)
+		outLods.radius = std::max(outLods.radius, e2::meshRadius(submeshes[i].positions, submeshes[i].numVertices));
+
+	float errorBudget = settings.maxError * outLods.radius;
+
+	// worst error of each level over all submeshes, relative to the radius
+	std::vector<float> levelErrors(numLevels, 0.0f);
+
+	outLods.submeshes.clear();
+	outLods.submeshes.resize(numSubmeshes);
+	std::vector<uint32_t> simplified;
+	for (uint32_t i = 0; i < numSubmeshes; i++)
+	{
+		e2::LodSource const& source = submeshes[i];
+		e2::LodSubmesh& submesh = outLods.submeshes[i];
+		submesh.indices.assign(source.indices, source.indices + source.numIndices);
+		submesh.levels.clear();
+
+		// every level is simplified from full detail, so its error is measured against the real surface and doesn't pile up along the chain
+		e2::SubmeshLod previousLevel{ 0, source.numIndices, 0.0f };
+		for (uint32_t level = 0; level < numLevels; level++)
+		{
+			uint32_t target = uint32_t(float(previousLevel.indexCount / 3) * settings.triangleRatio) * 3;
+			float levelError = e2::simplifyIndices(source.indices, source.numIndices, source.positions, source.numVertices, source.weights, source.bones, target, errorBudget, simplified);
+
+			e2::SubmeshLod newLevel = previousLevel;
+			if (simplified.size() < previousLevel.indexCount)
+			{
+				newLevel.firstIndex = uint32_t(submesh.indices.size());
+				newLevel.indexCount = uint32_t(simplified.size());
+				newLevel.error = std::max(levelError, previousLevel.error);
+				submesh.indices.insert(submesh.indices.end(), simplified.begin(), simplified.end());
+			}
+
+			submesh.levels.push_back(newLevel);
+			if (outLods.radius > 0.0f)
+				levelErrors[level] = std::max(levelErrors[level], newLevel.error / outLods.radius);
+
+			previousLevel = newLevel;
+		}
+	}
+
+	outLods.screenSizes.resize(numLevels);
+	for (uint32_t level = 0; level < numLevels; level++)
+	{
+		outLods.screenSizes[level] = e2::lodScreenSize(levelErrors[level], settings.maxScreenError);
+		if (level > 0)
+			outLods.screenSizes[level] = std::min(outLods.screenSizes[level], outLods.screenSizes[level - 1]);
+	}
+}
+
+float e2::lodScreenSize(float relativeError, float maxScreenError)
+{
+	// a sphere of radius r covers r / (d * tan) of the screen height, and an error of e * r covers half of that times e
+	if (relativeError <= 0.0f)
+		return std::numeric_limits<float>::max();
+
+	return 2.0f * maxScreenError / relativeError;
+}
+
+float e2::projectedScreenSize(float radius, float distance, float tanHalfFov)
+{
+	float denominator = std::max(distance, radius) * tanHalfFov;
+	if (denominator <= 0.0f)
+		return std::numeric_limits<float>::max();
+
+	return radius / denominator;
+}
+
+uint8_t e2::selectLod(float const* maxScreenSizes, uint8_t numLevels, uint8_t currentLevel, float screenSize, float hysteresis)
+{
+	uint8_t level = currentLevel < numLevels ? currentLevel : 0;
+
+	while (level + 1 < numLevels && screenSize < maxScreenSizes[level + 1] * (1.0f - hysteresis))
+		level++;
+
+	while (level > 0 && screenSize > maxScreenSizes[level] * (1.0f + hysteresis))
+		level--;
+
+	return level;
+}
+
+namespace
+{
+	struct ReferenceMesh
+	{
+		std::vector<uint32_t> indices;
+		std::vector<glm::vec4> positions;
+		std::vector<glm::vec4> weights;
+		std::vector<glm::uvec4> bones;
+	};
+
+	// flat square in xz from 0 to size, left half skinned to bone 0 and right half to bone 1
+	ReferenceMesh makeGrid(uint32_t size)
+	{
+		ReferenceMesh mesh;
+		for (uint32_t z = 0; z <= size; z++)
+		{
+			for (uint32_t x = 0; x <= size; x++)
+			{
+				mesh.positions.push_back({ float(x), 0.0f, float(z), 1.0f });
+				mesh.weights.push_back({ 1.0f, 0.0f, 0.0f, 0.0f });
+				mesh.bones.push_back({ x <= size / 2 ? 0u : 1u, 0, 0, 0 });
+			}
+		}
+
+		for (uint32_t z = 0; z < size; z++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				uint32_t i = z * (size + 1) + x;
+				mesh.indices.insert(mesh.indices.end(), { i, i + size + 1, i + 1, i + 1, i + size + 1, i + size + 2 });
+			}
+		}
+
+		return mesh;
+	}
+
+	// unit sphere with a uv seam, the vertices at u = 0 and u = 1 (and at the poles) are separate vertices at the same positions
+	ReferenceMesh makeSphere(uint32_t segments, uint32_t rings)
+	{
+		ReferenceMesh mesh;
+		for (uint32_t r = 0; r <= rings; r++)
+		{
+			float theta = glm::pi<float>() * float(r) / float(rings);
+			for (uint32_t s = 0; s <= segments; s++)
+			{
+				float phi = glm::two_pi<float>() * float(s % segments) / float(segments);
+				float y = r == 0 ? 1.0f : r == rings ? -1.0f : std::cos(theta);
+				float ringRadius = r == 0 || r == rings ? 0.0f : std::sin(theta);
+				mesh.positions.push_back({ ringRadius * std::cos(phi), y, ringRadius * std::sin(phi), 1.0f });
+			}
+		}
+
+		for (uint32_t r = 0; r < rings; r++)
+		{
+			for (uint32_t s = 0; s < segments; s++)
+			{
+				uint32_t i = r * (segments + 1) + s;
+				if (r > 0)
+					mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + segments + 1 });
+				if (r + 1 < rings)
+					mesh.indices.insert(mesh.indices.end(), { i + 1, i + segments + 2, i + segments + 1 });
+			}
+		}
+
+		return mesh;
+	}
+
+	double surfaceArea(std::vector<uint32_t> const& indices, std::vector<glm::vec4> const& positions)
+	{
+		double area = 0.0;
+		for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+			area += glm::length(::triangleNormal(glm::dvec3(positions[indices[i]]), glm::dvec3(positions[indices[i + 1]]), glm::dvec3(positions[indices[i + 2]]))) * 0.5;
+
+		return area;
+	}
+
+	// every index in range and no triangle collapsed to a line or flipped away from the original surface normal (given by normalAt)
+	template<typename NormalFunc>
+	bool validTriangles(std::vector<uint32_t> const& indices, std::vector<glm::vec4> const& positions, NormalFunc normalAt)
+	{
+		for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			if (indices[i] >= positions.size() || indices[i + 1] >= positions.size() || indices[i + 2] >= positions.size())
+				return false;
+
+			glm::vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			if (glm::length(normal) <= 0.0f || glm::dot(normal, normalAt((a + b + c) / 3.0f)) <= 0.0f)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+bool e2::testMeshLods()
+{
+	// a flat grid simplifies without error down to its corners, keeping its outline and its skinning split
+	{
+		::ReferenceMesh grid = ::makeGrid(16);
+		uint32_t numVertices = uint32_t(grid.positions.size());
+		uint32_t target = uint32_t(grid.indices.size() / 4) / 3 * 3;
+
+		std::vector<uint32_t> simplified;
+		float error = e2::simplifyIndices(grid.indices.data(), uint32_t(grid.indices.size()), grid.positions.data(), numVertices, grid.weights.data(), grid.bones.data(), target, 0.001f, simplified);
+
+		if (simplified.size() > target || simplified.size() < 6 || error > 0.001f)
+		{
+			LogError("mesh lods: grid simplified to {} of target {} indices, error {}", simplified.size(), target, error);
+			return false;
+		}
+
+		auto up = [](glm::vec3 const&) { return glm::vec3(0.0f, 1.0f, 0.0f); };
+		if (!::validTriangles(simplified, grid.positions, up))
+		{
+			LogError("mesh lods: grid simplified to degenerate, flipped or out of range triangles");
+			return false;
+		}
+
+		if (std::abs(::surfaceArea(simplified, grid.positions) - 256.0) > 0.001)
+		{
+			LogError("mesh lods: grid lost its outline, area went from 256 to {}", ::surfaceArea(simplified, grid.positions));
+			return false;
+		}
+
+		// triangles across the skinning split only ever span the two columns next to it
+		for (uint32_t i = 0; i < simplified.size(); i += 3)
+		{
+			bool bone0 = false, bone1 = false;
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				bone0 = bone0 || grid.bones[simplified[i + j]].x == 0;
+				bone1 = bone1 || grid.bones[simplified[i + j]].x == 1;
+			}
+
+			if (!bone0 || !bone1)
+				continue;
+
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				float x = grid.positions[simplified[i + j]].x;
+				if (x != 8.0f && x != 9.0f)
+				{
+					LogError("mesh lods: triangle across the skinning split reaches column {}", x);
+					return false;
+				}
+			}
+		}
+
+		// without skinning the grid goes further, the split doesn't hold it back
+		std::vector<uint32_t> unskinned;
+		e2::simplifyIndices(grid.indices.data(), uint32_t(grid.indices.size()), grid.positions.data(), numVertices, nullptr, nullptr, 6, 0.001f, unskinned);
+		if (unskinned.size() >= simplified.size() || std::abs(::surfaceArea(unskinned, grid.positions) - 256.0) > 0.001)
+		{
+			LogError("mesh lods: unskinned grid simplified to {} indices, expected fewer than {}", unskinned.size(), simplified.size());
+			return false;
+		}
+
+		// bent into a bowl and with room for error, corners get cut, but the outline is still made of vertices that were on it
+		::ReferenceMesh bowl = grid;
+		for (glm::vec4& p : bowl.positions)
+			p.y = ((p.x - 8.0f) * (p.x - 8.0f) + (p.z - 8.0f) * (p.z - 8.0f)) / 16.0f;
+
+		std::vector<uint32_t> loose;
+		e2::simplifyIndices(bowl.indices.data(), uint32_t(bowl.indices.size()), bowl.positions.data(), numVertices, nullptr, nullptr, 6, 4.0f, loose);
+		std::unordered_map<uint64_t, uint32_t> looseEdges;
+		for (uint32_t i = 0; i < loose.size(); i += 3)
+		{
+			for (uint32_t j = 0; j < 3; j++)
+				looseEdges[::edgeKey(loose[i + j], loose[i + (j + 1) % 3])]++;
+		}
+
+		for (auto const& [key, count] : looseEdges)
+		{
+			if (looseEdges.contains(::edgeKey(uint32_t(key), uint32_t(key >> 32))))
+				continue;
+
+			for (uint32_t vertex : { uint32_t(key >> 32), uint32_t(key) })
+			{
+				glm::vec4 const& p = grid.positions[vertex];
+				if (p.x != 0.0f && p.x != 16.0f && p.z != 0.0f && p.z != 16.0f)
+				{
+					LogError("mesh lods: vertex at {} {} moved onto the outline", p.x, p.z);
+					return false;
+				}
+			}
+		}
+	}
+
+	// a sphere hits its triangle targets with bounded error, and leaves its seam where it was
+	{
+		::ReferenceMesh sphere = ::makeSphere(32, 16);
+		uint32_t numVertices = uint32_t(sphere.positions.size());
+		uint32_t numIndices = uint32_t(sphere.indices.size());
+		uint32_t target = numIndices / 4 / 3 * 3;
+
+		std::vector<uint32_t> simplified;
+		float error = e2::simplifyIndices(sphere.indices.data(), numIndices, sphere.positions.data(), numVertices, nullptr, nullptr, target, 0.2f, simplified);
+		if (simplified.size() > target || error <= 0.0f || error > 0.2f)
+		{
+			LogError("mesh lods: sphere simplified to {} of target {} indices, error {}", simplified.size(), target, error);
+			return false;
+		}
+
+		auto outwards = [](glm::vec3 const& p) { return p; };
+		if (!::validTriangles(simplified, sphere.positions, outwards))
+		{
+			LogError("mesh lods: sphere simplified to degenerate, flipped or out of range triangles");
+			return false;
+		}
+
+		// nothing strays far from the surface
+		for (uint32_t i = 0; i < simplified.size(); i += 3)
+		{
+			glm::vec3 centroid = (glm::vec3(sphere.positions[simplified[i]]) + glm::vec3(sphere.positions[simplified[i + 1]]) + glm::vec3(sphere.positions[simplified[i + 2]])) / 3.0f;
+			if (1.0f - glm::length(centroid) > 0.5f)
+			{
+				LogError("mesh lods: simplified sphere caves in, a triangle is {} from the center", glm::length(centroid));
+				return false;
+			}
+		}
+
+		// both sides of the seam are still used, by triangles on their own side
+		for (uint32_t r = 1; r < 16; r++)
+		{
+			uint32_t start = r * 33, end = r * 33 + 32;
+			bool startUsed = std::find(simplified.begin(), simplified.end(), start) != simplified.end();
+			bool endUsed = std::find(simplified.begin(), simplified.end(), end) != simplified.end();
+			if (!startUsed || !endUsed)
+			{
+				LogError("mesh lods: seam vertex on ring {} was collapsed", r);
+				return false;
+			}
+		}
+
+		// a tight error bound stops it early
+		std::vector<uint32_t> tight;
+		float tightError = e2::simplifyIndices(sphere.indices.data(), numIndices, sphere.positions.data(), numVertices, nullptr, nullptr, target, 0.0001f, tight);
+		if (tight.size() != numIndices || tightError > 0.0001f)
+		{
+			LogError("mesh lods: sphere simplified to {} indices with error {} past a 0.0001 bound", tight.size(), tightError);
+			return false;
+		}
+
+		// a chain of levels, each about half the one before, with growing error and shrinking screen sizes
+		e2::MeshLodSettings settings;
+		settings.maxError = 0.5f;
+		e2::LodSource source{ sphere.indices.data(), numIndices, sphere.positions.data(), numVertices, nullptr, nullptr };
+		e2::MeshLods lods;
+		e2::generateMeshLods(settings, &source, 1, lods);
+
+		if (std::abs(lods.radius - 1.0f) > 0.0001f || lods.screenSizes.size() != settings.numLods || lods.submeshes.size() != 1 || lods.submeshes[0].levels.size() != settings.numLods)
+		{
+			LogError("mesh lods: generated {} levels, radius {}, expected {} and 1", lods.screenSizes.size(), lods.radius, settings.numLods);
+			return false;
+		}
+
+		e2::LodSubmesh const& submesh = lods.submeshes[0];
+		if (!std::equal(sphere.indices.begin(), sphere.indices.end(), submesh.indices.begin()))
+		{
+			LogError("mesh lods: level 0 isn't the full detail submesh");
+			return false;
+		}
+
+		e2::SubmeshLod previous{ 0, numIndices, 0.0f };
+		for (uint32_t i = 0; i < settings.numLods; i++)
+		{
+			e2::SubmeshLod const& level = submesh.levels[i];
+			uint32_t levelTarget = uint32_t(float(previous.indexCount / 3) * settings.triangleRatio) * 3;
+			// the last level runs into the error budget before its target
+			bool reachedTarget = level.indexCount <= levelTarget || (i + 1 == settings.numLods && level.indexCount < previous.indexCount);
+			if (!reachedTarget || level.firstIndex + level.indexCount > submesh.indices.size() || level.error < previous.error || level.error > settings.maxError * lods.radius
+				|| (i > 0 && lods.screenSizes[i] > lods.screenSizes[i - 1]))
+			{
+				LogError("mesh lods: level {} has {} indices (target {}), error {}, screen size {}", i + 1, level.indexCount, levelTarget, level.error, lods.screenSizes[i]);
+				return false;
+			}
+
+			std::vector<uint32_t> levelIndices(submesh.indices.begin() + level.firstIndex, submesh.indices.begin() + level.firstIndex + level.indexCount);
+			if (!::validTriangles(levelIndices, sphere.positions, outwards))
+			{
+				LogError("mesh lods: level {} has degenerate, flipped or out of range triangles", i + 1);
+				return false;
+			}
+
+			previous = level;
+		}
+
+		LogNotice("mesh lods: sphere {} triangles, levels {} {} {}, errors {} {} {}, screen sizes {} {} {}", numIndices / 3,
+			submesh.levels[0].indexCount / 3, submesh.levels[1].indexCount / 3, submesh.levels[2].indexCount / 3,
+			submesh.levels[0].error, submesh.levels[1].error, submesh.levels[2].error,
+			lods.screenSizes[0], lods.screenSizes[1], lods.screenSizes[2]);
+	}
+
+	// a level that can't be simplified reuses the one before
+	{
+		::ReferenceMesh grid = ::makeGrid(1);
+		e2::LodSource source{ grid.indices.data(), uint32_t(grid.indices.size()), grid.positions.data(), uint32_t(grid.positions.size()), nullptr, nullptr };
+		e2::MeshLods lods;
+		e2::generateMeshLods(e2::MeshLodSettings(), &source, 1, lods);
+		if (lods.submeshes[0].indices.size() != 6 || lods.submeshes[0].levels[0].firstIndex != 0 || lods.submeshes[0].levels[0].indexCount != 6)
+		{
+			LogError("mesh lods: a quad that can't be simplified got {} indices", lods.submeshes[0].indices.size());
+			return false;
+		}
+	}
+
+	// selection walks levels as the screen size shrinks, but needs to get past a switch point by the hysteresis before changing
+	{
+		float sizes[4] = { 0.0f, 0.5f, 0.25f, 0.125f };
+		struct Step
+		{
+			uint8_t from;
+			float size;
+			uint8_t expected;
+		};
+
+		Step const steps[] = {
+			{ 0, 1.0f, 0 }, { 0, 0.49f, 0 }, { 0, 0.44f, 1 }, { 1, 0.52f, 1 }, { 1, 0.56f, 0 },
+			{ 1, 0.2f, 2 }, { 2, 0.26f, 2 }, { 2, 0.3f, 1 }, { 0, 0.05f, 3 }, { 3, 1.0f, 0 }, { 3, 0.13f, 3 }, { 3, 0.14f, 2 },
+			{ 7, 1.0f, 0 },
+		};
+
+		for (Step const& step : steps)
+		{
+			uint8_t level = e2::selectLod(sizes, 4, step.from, step.size, 0.1f);
+			if (level != step.expected)
+			{
+				LogError("mesh lods: selecting from level {} at screen size {} gave level {}, expected {}", step.from, step.size, level, step.expected);
+				return false;
+			}
+		}
+
+		if (e2::selectLod(sizes, 1, 0, 0.0f, 0.1f) != 0)
+		{
+			LogError("mesh lods: a mesh with one level selected another");
+			return false;
+		}
+
+		// a unit sphere 10 away at 60 degrees fov covers about 17% of the screen height, and the level with error e switches where it shows maxScreenError
+		float size = e2::projectedScreenSize(1.0f, 10.0f, std::tan(glm::radians(30.0f)));
+		float switchSize = e2::lodScreenSize(0.01f, 1.0f / 1080.0f);
+		if (std::abs(size - 0.1732f) > 0.001f || std::abs(0.01f * switchSize * 0.5f - 1.0f / 1080.0f) > 0.000001f)
+		{
+			LogError("mesh lods: screen size {} and switch size {} are off", size, switchSize);
+			return false;
+		}
+	}
+
+	LogNotice("mesh lods verified");
+	return true;
+}
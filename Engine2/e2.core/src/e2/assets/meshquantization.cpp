@@ -0,0 +1,598 @@
+
+#include "e2/assets/meshquantization.hpp"
+
+#include "e2/log.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	int8_t toSnorm8(float value)
+	{
+		return int8_t(std::round(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	float fromSnorm8(int8_t value)
+	{
+		return std::max(float(value) / 127.0f, -1.0f);
+	}
+
+	uint8_t toUnorm8(float value)
+	{
+		return uint8_t(std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+	}
+
+	float fromUnorm8(uint8_t value)
+	{
+		return float(value) / 255.0f;
+	}
+
+	// rounds weights to bytes so they still add up to what they did (largest remainder), a skinned vertex that loses weight gets pulled towards the origin
+	void quantizeWeights(glm::vec4 const& weights, uint8_t* outWeights)
+	{
+		float scaled[4];
+		float total = 0.0f;
+		uint32_t sum = 0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			scaled[i] = std::clamp(weights[i], 0.0f, 1.0f) * 255.0f;
+			outWeights[i] = uint8_t(std::floor(scaled[i]));
+			total += scaled[i];
+			sum += outWeights[i];
+		}
+
+		uint32_t target = uint32_t(std::round(total));
+		while (sum < target)
+		{
+			// the weight that lost the most to flooring takes the next unit
+			uint32_t best = 0;
+			float bestRemainder = 0.0f;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				float remainder = scaled[i] - float(outWeights[i]);
+				if (outWeights[i] < 255 && remainder > bestRemainder)
+				{
+					best = i;
+					bestRemainder = remainder;
+				}
+			}
+
+			if (bestRemainder <= 0.0f)
+				break;
+
+			outWeights[best]++;
+			sum++;
+		}
+	}
+
+	// a skinned, textured and colored blob about a meter and a half across, the kind of mesh that should always quantize
+	struct TestSubmesh
+	{
+		std::vector<uint32_t> indices;
+		std::vector<glm::vec4> positions;
+		std::vector<glm::vec4> normals;
+		std::vector<glm::vec4> tangents;
+		std::vector<glm::vec4> uv01;
+		std::vector<glm::vec4> colors;
+		std::vector<glm::vec4> weights;
+		std::vector<glm::uvec4> bones;
+
+		TestSubmesh(uint32_t numVertices)
+		{
+			for (uint32_t i = 0; i < numVertices; i++)
+			{
+				glm::vec3 normal = e2::randomOnUnitSphere();
+				glm::vec3 tangent = glm::normalize(glm::cross(normal, e2::randomOnUnitSphere()));
+				positions.push_back(glm::vec4(normal * e2::randomFloat(0.5f, 1.5f), 1.0f));
+				normals.push_back(glm::vec4(normal, 0.0f));
+				tangents.push_back(glm::vec4(tangent, e2::randomBool() ? 1.0f : -1.0f));
+				uv01.push_back(glm::vec4(e2::randomFloat(0.0f, 1.0f), e2::randomFloat(0.0f, 1.0f), e2::randomFloat(0.0f, 1.0f), e2::randomFloat(0.0f, 1.0f)));
+				colors.push_back(glm::vec4(e2::randomFloat(0.0f, 1.0f), e2::randomFloat(0.0f, 1.0f), e2::randomFloat(0.0f, 1.0f), 1.0f));
+
+				// up to four influences, some vertices with fewer
+				glm::vec4 weight(e2::randomFloat(0.0f, 1.0f), e2::randomFloat(0.0f, 1.0f), e2::randomBool() ? e2::randomFloat(0.0f, 1.0f) : 0.0f, e2::randomBool() ? e2::randomFloat(0.0f, 1.0f) : 0.0f);
+				weights.push_back(weight / (weight.x + weight.y + weight.z + weight.w + 0.0001f));
+				bones.push_back(glm::uvec4(e2::randomInt(0, 63), e2::randomInt(0, 63), e2::randomInt(0, 63), e2::randomInt(0, 63)));
+			}
+
+			for (uint32_t i = 0; i < numVertices * 3; i++)
+				indices.push_back(uint32_t(e2::randomInt(0, numVertices - 1)));
+		}
+
+		e2::ProceduralSubmesh submesh()
+		{
+			e2::ProceduralSubmesh submesh;
+			submesh.attributes = e2::VertexAttributeFlags::Normal | e2::VertexAttributeFlags::TexCoords01 | e2::VertexAttributeFlags::Color | e2::VertexAttributeFlags::Bones;
+			submesh.numIndices = uint32_t(indices.size());
+			submesh.numVertices = uint32_t(positions.size());
+			submesh.sourceIndices = indices.data();
+			submesh.sourcePositions = positions.data();
+			submesh.sourceNormals = normals.data();
+			submesh.sourceTangents = tangents.data();
+			submesh.sourceUv01 = uv01.data();
+			submesh.sourceColors = colors.data();
+			submesh.sourceWeights = weights.data();
+			submesh.sourceBones = bones.data();
+			return submesh;
+		}
+	};
+
+	bool decodedIndicesMatch(e2::EncodedSubmesh const& encoded, std::vector<uint32_t> const& indices)
+	{
+		for (uint32_t i = 0; i < encoded.numIndices; i++)
+		{
+			uint32_t index{};
+			if (encoded.indexFormat == e2::IndexFormat::Uint16)
+			{
+				uint16_t shortIndex{};
+				std::memcpy(&shortIndex, encoded.indexData.data() + i * sizeof(uint16_t), sizeof(uint16_t));
+				index = shortIndex;
+			}
+			else
+			{
+				std::memcpy(&index, encoded.indexData.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+			}
+
+			if (index != indices[i])
+				return false;
+		}
+
+		return true;
+	}
+}
+
+void e2::encodeVertexStream(e2::VertexStream stream, bool quantized, glm::vec4 const* values, uint32_t numVertices, std::vector<uint8_t>& outData)
+{
+	e2::VertexFormat format = e2::vertexStreamFormat(stream, quantized);
+	uint32_t stride = e2::vertexStreamStride(stream, quantized);
+	outData.resize(uint64_t(stride) * numVertices);
+
+	uint8_t* cursor = outData.data();
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		glm::vec4 const& value = values[i];
+		switch (format)
+		{
+		case e2::VertexFormat::Vec4:
+			std::memcpy(cursor, &value, sizeof(glm::vec4));
+			break;
+		case e2::VertexFormat::Vec4Half:
+		{
+			uint16_t halves[4];
+			for (uint32_t c = 0; c < 4; c++)
+				halves[c] = glm::packHalf1x16(value[c]);
+			std::memcpy(cursor, halves, sizeof(halves));
+			break;
+		}
+		case e2::VertexFormat::Vec4Snorm8:
+			for (uint32_t c = 0; c < 4; c++)
+				cursor[c] = uint8_t(::toSnorm8(value[c]));
+			break;
+		case e2::VertexFormat::Vec4Unorm8:
+			if (stream == e2::VertexStream::Weights)
+			{
+				::quantizeWeights(value, cursor);
+			}
+			else
+			{
+				for (uint32_t c = 0; c < 4; c++)
+					cursor[c] = ::toUnorm8(value[c]);
+			}
+			break;
+		default:
+			LogError("stream {} is not a float stream, use encodeBoneStream", uint32_t(stream));
+			std::memset(outData.data(), 0, outData.size());
+			return;
+		}
+
+		cursor += stride;
+	}
+}
+
+void e2::decodeVertexStream(e2::VertexStream stream, bool quantized, uint8_t const* data, uint32_t numVertices, glm::vec4* outValues)
+{
+	e2::VertexFormat format = e2::vertexStreamFormat(stream, quantized);
+	uint32_t stride = e2::vertexStreamStride(stream, quantized);
+
+	uint8_t const* cursor = data;
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		glm::vec4& value = outValues[i];
+		switch (format)
+		{
+		case e2::VertexFormat::Vec4:
+			std::memcpy(&value, cursor, sizeof(glm::vec4));
+			break;
+		case e2::VertexFormat::Vec4Half:
+		{
+			uint16_t halves[4];
+			std::memcpy(halves, cursor, sizeof(halves));
+			for (uint32_t c = 0; c < 4; c++)
+				value[c] = glm::unpackHalf1x16(halves[c]);
+			break;
+		}
+		case e2::VertexFormat::Vec4Snorm8:
+			for (uint32_t c = 0; c < 4; c++)
+				value[c] = ::fromSnorm8(int8_t(cursor[c]));
+			break;
+		case e2::VertexFormat::Vec4Unorm8:
+			for (uint32_t c = 0; c < 4; c++)
+				value[c] = ::fromUnorm8(cursor[c]);
+			break;
+		default:
+			LogError("stream {} is not a float stream, use decodeBoneStream", uint32_t(stream));
+			return;
+		}
+
+		cursor += stride;
+	}
+}
+
+void e2::encodeBoneStream(bool quantized, glm::uvec4 const* bones, uint32_t numVertices, std::vector<uint8_t>& outData)
+{
+	outData.resize(uint64_t(e2::vertexStreamStride(e2::VertexStream::Bones, quantized)) * numVertices);
+	if (!quantized)
+	{
+		std::memcpy(outData.data(), bones, outData.size());
+		return;
+	}
+
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+			outData[uint64_t(i) * 4 + c] = uint8_t(std::min(bones[i][c], 255u));
+	}
+}
+
+void e2::decodeBoneStream(bool quantized, uint8_t const* data, uint32_t numVertices, glm::uvec4* outValues)
+{
+	if (!quantized)
+	{
+		std::memcpy(outValues, data, sizeof(glm::uvec4) * numVertices);
+		return;
+	}
+
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+			outValues[i][c] = data[uint64_t(i) * 4 + c];
+	}
+}
+
+float e2::vertexStreamQuantizationError(e2::VertexStream stream, glm::vec4 const* values, uint32_t numVertices)
+{
+	std::vector<uint8_t> encoded;
+	e2::encodeVertexStream(stream, true, values, numVertices, encoded);
+
+	std::vector<glm::vec4> decoded(numVertices);
+	e2::decodeVertexStream(stream, true, encoded.data(), numVertices, decoded.data());
+
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			float error = std::abs(decoded[i][c] - values[i][c]);
+
+			// anything that doesn't survive (out of half range, nan) is as wrong as it gets
+			if (!(error <= maxError))
+				maxError = std::isnan(error) ? INFINITY : error;
+		}
+	}
+
+	return maxError;
+}
+
+float e2::vertexStreamQuantizationTolerance(e2::VertexStream stream)
+{
+	switch (stream)
+	{
+	case e2::VertexStream::Position:
+		return e2::positionQuantizationTolerance;
+	case e2::VertexStream::Normal:
+	case e2::VertexStream::Tangent:
+		return e2::directionQuantizationTolerance;
+	case e2::VertexStream::TexCoords01:
+	case e2::VertexStream::TexCoords23:
+		return e2::texCoordQuantizationTolerance;
+	case e2::VertexStream::Color:
+		return e2::colorQuantizationTolerance;
+	case e2::VertexStream::Weights:
+		return e2::weightQuantizationTolerance;
+	default:
+		return 0.0f;
+	}
+}
+
+void e2::encodeSubmesh(e2::ProceduralSubmesh const& source, bool allowQuantize, e2::EncodedSubmesh& outEncoded)
+{
+	uint8_t const* streams[e2::maxNumSpecificationAttributes]{};
+	uint32_t numStreams = 0;
+	auto addStream = [&streams, &numStreams](void const* values) {
+		streams[numStreams++] = reinterpret_cast<uint8_t const*>(values);
+	};
+
+	addStream(source.sourcePositions);
+
+	if ((source.attributes & e2::VertexAttributeFlags::Normal) == e2::VertexAttributeFlags::Normal)
+	{
+		addStream(source.sourceNormals);
+		addStream(source.sourceTangents);
+	}
+
+	if ((source.attributes & e2::VertexAttributeFlags::TexCoords01) == e2::VertexAttributeFlags::TexCoords01)
+		addStream(source.sourceUv01);
+
+	if ((source.attributes & e2::VertexAttributeFlags::TexCoords23) == e2::VertexAttributeFlags::TexCoords23)
+		addStream(source.sourceUv23);
+
+	if ((source.attributes & e2::VertexAttributeFlags::Color) == e2::VertexAttributeFlags::Color)
+		addStream(source.sourceColors);
+
+	if ((source.attributes & e2::VertexAttributeFlags::Bones) == e2::VertexAttributeFlags::Bones)
+	{
+		addStream(source.sourceWeights);
+		addStream(source.sourceBones);
+	}
+
+	e2::encodeSubmeshStreams(source.attributes, source.numVertices, source.numIndices, source.sourceIndices, streams, allowQuantize, outEncoded);
+}
+
+void e2::encodeSubmeshStreams(e2::VertexAttributeFlags attributes, uint32_t numVertices, uint32_t numIndices, uint32_t const* indices, uint8_t const* const* streams, bool allowQuantize, e2::EncodedSubmesh& outEncoded)
+{
+	outEncoded.attributes = attributes;
+	outEncoded.numVertices = numVertices;
+	outEncoded.numIndices = numIndices;
+
+	// what each of the given streams is, in the order they are laid out
+	e2::VertexStream kinds[e2::maxNumSpecificationAttributes];
+	uint32_t numStreams = 0;
+	kinds[numStreams++] = e2::VertexStream::Position;
+
+	if ((attributes & e2::VertexAttributeFlags::Normal) == e2::VertexAttributeFlags::Normal)
+	{
+		kinds[numStreams++] = e2::VertexStream::Normal;
+		kinds[numStreams++] = e2::VertexStream::Tangent;
+	}
+
+	if ((attributes & e2::VertexAttributeFlags::TexCoords01) == e2::VertexAttributeFlags::TexCoords01)
+		kinds[numStreams++] = e2::VertexStream::TexCoords01;
+
+	if ((attributes & e2::VertexAttributeFlags::TexCoords23) == e2::VertexAttributeFlags::TexCoords23)
+		kinds[numStreams++] = e2::VertexStream::TexCoords23;
+
+	if ((attributes & e2::VertexAttributeFlags::Color) == e2::VertexAttributeFlags::Color)
+		kinds[numStreams++] = e2::VertexStream::Color;
+
+	if ((attributes & e2::VertexAttributeFlags::Bones) == e2::VertexAttributeFlags::Bones)
+	{
+		kinds[numStreams++] = e2::VertexStream::Weights;
+		kinds[numStreams++] = e2::VertexStream::Bones;
+	}
+
+	bool quantize = allowQuantize;
+	for (uint32_t i = 0; i < numStreams && quantize; i++)
+	{
+		if (kinds[i] == e2::VertexStream::Bones)
+		{
+			glm::uvec4 const* bones = reinterpret_cast<glm::uvec4 const*>(streams[i]);
+			for (uint32_t v = 0; v < numVertices && quantize; v++)
+				quantize = bones[v].x < 256 && bones[v].y < 256 && bones[v].z < 256 && bones[v].w < 256;
+		}
+		else
+		{
+			glm::vec4 const* values = reinterpret_cast<glm::vec4 const*>(streams[i]);
+			quantize = e2::vertexStreamQuantizationError(kinds[i], values, numVertices) <= e2::vertexStreamQuantizationTolerance(kinds[i]);
+		}
+	}
+
+	outEncoded.quantized = quantize;
+	outEncoded.streams.resize(numStreams);
+	for (uint32_t i = 0; i < numStreams; i++)
+	{
+		if (kinds[i] == e2::VertexStream::Bones)
+			e2::encodeBoneStream(quantize, reinterpret_cast<glm::uvec4 const*>(streams[i]), numVertices, outEncoded.streams[i]);
+		else
+			e2::encodeVertexStream(kinds[i], quantize, reinterpret_cast<glm::vec4 const*>(streams[i]), numVertices, outEncoded.streams[i]);
+	}
+
+	outEncoded.indexFormat = e2::encodeIndices(indices, numIndices, outEncoded.indexData);
+}
+
+e2::IndexFormat e2::encodeIndices(uint32_t const* indices, uint32_t numIndices, std::vector<uint8_t>& outData)
+{
+	uint32_t maxIndex = 0;
+	for (uint32_t i = 0; i < numIndices; i++)
+		maxIndex = std::max(maxIndex, indices[i]);
+
+	if (maxIndex > UINT16_MAX)
+	{
+		outData.resize(sizeof(uint32_t) * numIndices);
+		std::memcpy(outData.data(), indices, outData.size());
+		return e2::IndexFormat::Uint32;
+	}
+
+	outData.resize(sizeof(uint16_t) * numIndices);
+	uint16_t* shortIndices = reinterpret_cast<uint16_t*>(outData.data());
+	for (uint32_t i = 0; i < numIndices; i++)
+		shortIndices[i] = uint16_t(indices[i]);
+
+	return e2::IndexFormat::Uint16;
+}
+
+void e2::downloadIndices(e2::SubmeshSpecification const& spec, uint32_t* outIndices)
+{
+	if (spec.indexFormat == e2::IndexFormat::Uint32)
+	{
+		uint64_t size = sizeof(uint32_t) * spec.indexCount;
+		spec.indexBuffer->download(reinterpret_cast<uint8_t*>(outIndices), size, size, 0);
+		return;
+	}
+
+	std::vector<uint16_t> indices(spec.indexCount);
+	uint64_t size = sizeof(uint16_t) * spec.indexCount;
+	spec.indexBuffer->download(reinterpret_cast<uint8_t*>(indices.data()), size, size, 0);
+	for (uint32_t i = 0; i < spec.indexCount; i++)
+		outIndices[i] = indices[i];
+}
+
+void e2::downloadVertexStream(e2::SubmeshSpecification const& spec, uint32_t attributeIndex, e2::VertexStream stream, glm::vec4* outValues)
+{
+	if (!spec.quantized)
+	{
+		uint64_t size = sizeof(glm::vec4) * spec.vertexCount;
+		spec.vertexAttributes[attributeIndex]->download(reinterpret_cast<uint8_t*>(outValues), size, size, 0);
+		return;
+	}
+
+	std::vector<uint8_t> data(uint64_t(e2::vertexStreamStride(stream, true)) * spec.vertexCount);
+	spec.vertexAttributes[attributeIndex]->download(data.data(), data.size(), data.size(), 0);
+	e2::decodeVertexStream(stream, true, data.data(), spec.vertexCount, outValues);
+}
+
+void e2::downloadBoneStream(e2::SubmeshSpecification const& spec, uint32_t attributeIndex, glm::uvec4* outValues)
+{
+	if (!spec.quantized)
+	{
+		uint64_t size = sizeof(glm::uvec4) * spec.vertexCount;
+		spec.vertexAttributes[attributeIndex]->download(reinterpret_cast<uint8_t*>(outValues), size, size, 0);
+		return;
+	}
+
+	std::vector<uint8_t> data(uint64_t(e2::vertexStreamStride(e2::VertexStream::Bones, true)) * spec.vertexCount);
+	spec.vertexAttributes[attributeIndex]->download(data.data(), data.size(), data.size(), 0);
+	e2::decodeBoneStream(true, data.data(), spec.vertexCount, outValues);
+}
+
+bool e2::testMeshQuantization()
+{
+	constexpr uint32_t numVertices = 3000;
+	::TestSubmesh test(numVertices);
+	e2::ProceduralSubmesh source = test.submesh();
+
+	e2::EncodedSubmesh encoded;
+	e2::encodeSubmesh(source, true, encoded);
+	if (!encoded.quantized || encoded.indexFormat != e2::IndexFormat::Uint16 || encoded.streams.size() != 7)
+	{
+		LogError("mesh quantization: test submesh wasn't quantized with 16 bit indices");
+		return false;
+	}
+
+	e2::VertexStream const streams[6] = { e2::VertexStream::Position, e2::VertexStream::Normal, e2::VertexStream::Tangent, e2::VertexStream::TexCoords01, e2::VertexStream::Color, e2::VertexStream::Weights };
+	std::vector<glm::vec4> const* values[6] = { &test.positions, &test.normals, &test.tangents, &test.uv01, &test.colors, &test.weights };
+	std::vector<glm::vec4> decoded[6];
+	uint64_t quantizedSize = encoded.indexData.size();
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		if (encoded.streams[i].size() != uint64_t(e2::vertexStreamStride(streams[i], true)) * numVertices)
+		{
+			LogError("mesh quantization: stream {} encoded to the wrong size", uint32_t(streams[i]));
+			return false;
+		}
+
+		quantizedSize += encoded.streams[i].size();
+		decoded[i].resize(numVertices);
+		e2::decodeVertexStream(streams[i], true, encoded.streams[i].data(), numVertices, decoded[i].data());
+
+		float maxError = 0.0f;
+		for (uint32_t v = 0; v < numVertices; v++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+				maxError = std::max(maxError, std::abs(decoded[i][v][c] - (*values[i])[v][c]));
+		}
+
+		if (maxError > e2::vertexStreamQuantizationTolerance(streams[i]))
+		{
+			LogError("mesh quantization: stream {} is off by {}, allowed {}", uint32_t(streams[i]), maxError, e2::vertexStreamQuantizationTolerance(streams[i]));
+			return false;
+		}
+	}
+
+	// handedness survives exactly, and weights still add up to one
+	for (uint32_t v = 0; v < numVertices; v++)
+	{
+		uint8_t const* weights = encoded.streams[5].data() + v * 4;
+		if (decoded[2][v].w != test.tangents[v].w || uint32_t(weights[0]) + weights[1] + weights[2] + weights[3] != 255)
+		{
+			LogError("mesh quantization: vertex {} lost its tangent sign or weight sum", v);
+			return false;
+		}
+	}
+
+	std::vector<glm::uvec4> bones(numVertices);
+	e2::decodeBoneStream(true, encoded.streams[6].data(), numVertices, bones.data());
+	quantizedSize += encoded.streams[6].size();
+	if (std::memcmp(bones.data(), test.bones.data(), sizeof(glm::uvec4) * numVertices) != 0 || !::decodedIndicesMatch(encoded, test.indices))
+	{
+		LogError("mesh quantization: bone ids or indices didn't round trip");
+		return false;
+	}
+
+	uint64_t fullSize = sizeof(uint32_t) * test.indices.size() + (sizeof(glm::vec4) * 6 + sizeof(glm::uvec4)) * numVertices;
+	LogNotice("mesh quantization: {} bytes instead of {} ({:.1f}x smaller)", quantizedSize, fullSize, double(fullSize) / double(quantizedSize));
+
+	// not asking for it keeps everything exact
+	e2::encodeSubmesh(source, false, encoded);
+	if (encoded.quantized || encoded.streams[0].size() != sizeof(glm::vec4) * numVertices || std::memcmp(encoded.streams[0].data(), test.positions.data(), encoded.streams[0].size()) != 0)
+	{
+		LogError("mesh quantization: submesh was quantized without being allowed to");
+		return false;
+	}
+
+	// any stream going past its bound keeps the whole submesh at full precision
+	struct Fallback
+	{
+		char const* name;
+		glm::vec4* value;
+		glm::vec4 broken;
+	};
+
+	Fallback const fallbacks[] = {
+		{ "large position", &test.positions[17], glm::vec4(96.3f, 0.0f, 12.1f, 1.0f) },
+		{ "tiled uv", &test.uv01[29], glm::vec4(37.3f, 0.5f, 0.0f, 0.0f) },
+		{ "unnormalized normal", &test.normals[31], glm::vec4(1.4f, 0.0f, 0.0f, 0.0f) },
+		{ "hdr color", &test.colors[5], glm::vec4(4.0f, 1.0f, 1.0f, 1.0f) },
+	};
+
+	for (Fallback const& fallback : fallbacks)
+	{
+		glm::vec4 original = *fallback.value;
+		*fallback.value = fallback.broken;
+		e2::encodeSubmesh(source, true, encoded);
+		*fallback.value = original;
+
+		if (encoded.quantized)
+		{
+			LogError("mesh quantization: submesh with a {} was quantized", fallback.name);
+			return false;
+		}
+	}
+
+	uint32_t originalBone = test.bones[7].y;
+	test.bones[7].y = 300;
+	e2::encodeSubmesh(source, true, encoded);
+	test.bones[7].y = originalBone;
+	if (encoded.quantized)
+	{
+		LogError("mesh quantization: submesh with bone ids past 255 was quantized");
+		return false;
+	}
+
+	// indices past 16 bits stay 32 bit
+	::TestSubmesh large(70000);
+	large.indices[1234] = 69999;
+	e2::ProceduralSubmesh largeSource = large.submesh();
+	e2::encodeSubmesh(largeSource, true, encoded);
+	if (encoded.indexFormat != e2::IndexFormat::Uint32 || !::decodedIndicesMatch(encoded, large.indices))
+	{
+		LogError("mesh quantization: large submesh got the wrong index format");
+		return false;
+	}
+
+	LogNotice("mesh quantization verified");
+	return true;
+}
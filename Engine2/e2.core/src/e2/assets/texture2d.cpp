@@ -66,7 +66,7 @@ bool e2::Texture2D::read(e2::IStream& source)
 			source >> dataSize;
 			m_texture->upload(i, glm::uvec3(0, 0, 0), glm::uvec3(res, 1), source.read(dataSize), dataSize);
 
-			res /= 2;
+			res = glm::max(res / 2u, glm::uvec2(1, 1));
 		}
 	}
 	else
@@ -76,7 +76,8 @@ bool e2::Texture2D::read(e2::IStream& source)
 		m_texture->upload(0, glm::uvec3(0, 0, 0), glm::uvec3(m_resolution, 1), source.read(dataSize), dataSize);
 	}
 
-	if (generateMips)
+	// block compressed mips can't be blitted, the importer always writes them
+	if (generateMips && !e2::isBlockCompressed(m_format))
 		m_texture->generateMips();
 
 	return true;
@@ -0,0 +1,1141 @@
+
+#include "e2/assets/texturecompression.hpp"
+
+#include "e2/log.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	constexpr uint32_t bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float srgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t toUnorm8(float c)
+	{
+		return uint8_t(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+	}
+
+	// the source texels a destination texel covers along one axis, weighted by overlap (an area filter, which is a 2x2 box for even sizes)
+	struct FilterTaps
+	{
+		uint32_t first{};
+		uint32_t count{};
+		float weights[4]{};
+	};
+
+	void calculateTaps(uint32_t sourceSize, uint32_t targetSize, std::vector<FilterTaps>& outTaps)
+	{
+		outTaps.resize(targetSize);
+		float scale = float(sourceSize) / float(targetSize);
+		for (uint32_t i = 0; i < targetSize; i++)
+		{
+			float begin = float(i) * scale;
+			float end = begin + scale;
+
+			FilterTaps& taps = outTaps[i];
+			taps.first = uint32_t(begin);
+			taps.count = 0;
+			for (uint32_t s = taps.first; s < sourceSize && float(s) < end && taps.count < 4; s++)
+			{
+				float overlap = std::min(end, float(s + 1)) - std::max(begin, float(s));
+				taps.weights[taps.count++] = overlap / scale;
+			}
+		}
+	}
+
+	// texels of one 4x4 block, edge texels repeated where the block hangs over the image
+	void gatherBlock(uint8_t const* rgba8, glm::uvec2 const& resolution, uint32_t blockX, uint32_t blockY, uint8_t outTexels[16][4])
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32_t sourceY = std::min(blockY * 4 + y, resolution.y - 1);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				uint32_t sourceX = std::min(blockX * 4 + x, resolution.x - 1);
+				std::memcpy(outTexels[y * 4 + x], rgba8 + (uint64_t(sourceY) * resolution.x + sourceX) * 4, 4);
+			}
+		}
+	}
+
+	// principal axis of the covariance of numChannels wide texels, by power iteration. Returns false if all texels are equal
+	bool principalAxis(float const texels[16][4], uint32_t numChannels, float outMean[4], float outAxis[4])
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			outMean[c] = 0.0f;
+			outAxis[c] = 0.0f;
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+			for (uint32_t c = 0; c < numChannels; c++)
+				outMean[c] += texels[i][c] / 16.0f;
+
+		float covariance[4][4]{};
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			for (uint32_t a = 0; a < numChannels; a++)
+				for (uint32_t b = 0; b < numChannels; b++)
+					covariance[a][b] += (texels[i][a] - outMean[a]) * (texels[i][b] - outMean[b]);
+		}
+
+		// start from the channel that varies the most, a fixed start vector can be orthogonal to the axis we're after
+		uint32_t widest = 0;
+		for (uint32_t c = 1; c < numChannels; c++)
+		{
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		}
+
+		if (covariance[widest][widest] < 1e-6f)
+			return false;
+
+		float axis[4]{};
+		for (uint32_t c = 0; c < numChannels; c++)
+			axis[c] = covariance[widest][c] / covariance[widest][widest];
+
+		float length = 0.0f;
+		for (uint32_t iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4]{};
+			for (uint32_t a = 0; a < numChannels; a++)
+				for (uint32_t b = 0; b < numChannels; b++)
+					next[a] += covariance[a][b] * axis[b];
+
+			length = 0.0f;
+			for (uint32_t c = 0; c < numChannels; c++)
+				length += next[c] * next[c];
+			length = std::sqrt(length);
+
+			if (length < 1e-6f)
+				return false;
+
+			for (uint32_t c = 0; c < numChannels; c++)
+				axis[c] = next[c] / length;
+		}
+
+		for (uint32_t c = 0; c < numChannels; c++)
+			outAxis[c] = axis[c];
+
+		return true;
+	}
+
+	// endpoints along the principal axis, at the extremes of the texels projected onto it
+	void axisEndpoints(float const texels[16][4], uint32_t numChannels, float outLow[4], float outHigh[4])
+	{
+		float mean[4];
+		float axis[4];
+		if (!principalAxis(texels, numChannels, mean, axis))
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				outLow[c] = mean[c];
+				outHigh[c] = mean[c];
+			}
+			return;
+		}
+
+		float minProjection = FLT_MAX;
+		float maxProjection = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			float projection = 0.0f;
+			for (uint32_t c = 0; c < numChannels; c++)
+				projection += (texels[i][c] - mean[c]) * axis[c];
+
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			outLow[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+			outHigh[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+		}
+	}
+
+	// least squares endpoints for given interpolation weights (weight of high, 0-1). Returns false if the system is singular
+	bool fitEndpoints(float const texels[16][4], uint32_t numChannels, float const weights[16], float outLow[4], float outHigh[4])
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4]{};
+		float bx[4]{};
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			float b = weights[i];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (uint32_t c = 0; c < numChannels; c++)
+			{
+				ax[c] += a * texels[i][c];
+				bx[c] += b * texels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+
+		for (uint32_t c = 0; c < numChannels; c++)
+		{
+			outLow[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+			outHigh[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+		}
+
+		return true;
+	}
+
+	// --- BC1 (also the color half of BC3) --- //
+
+	uint16_t packColor565(float const color[4])
+	{
+		uint32_t r = uint32_t(std::clamp(color[0] * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f));
+		uint32_t g = uint32_t(std::clamp(color[1] * 63.0f / 255.0f + 0.5f, 0.0f, 63.0f));
+		uint32_t b = uint32_t(std::clamp(color[2] * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f));
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void unpackColor565(uint16_t packed, int32_t outColor[3])
+	{
+		int32_t r = (packed >> 11) & 31;
+		int32_t g = (packed >> 5) & 63;
+		int32_t b = packed & 31;
+		outColor[0] = (r << 3) | (r >> 2);
+		outColor[1] = (g << 2) | (g >> 4);
+		outColor[2] = (b << 3) | (b >> 2);
+	}
+
+	// palette in index order: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1. Three color mode puts the midpoint at 2 and black at 3
+	void colorPalette(uint16_t c0, uint16_t c1, bool fourColor, int32_t outPalette[4][4])
+	{
+		int32_t e0[3];
+		int32_t e1[3];
+		unpackColor565(c0, e0);
+		unpackColor565(c1, e1);
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			outPalette[0][c] = e0[c];
+			outPalette[1][c] = e1[c];
+			if (fourColor)
+			{
+				outPalette[2][c] = (2 * e0[c] + e1[c]) / 3;
+				outPalette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+			}
+			else
+			{
+				outPalette[2][c] = (e0[c] + e1[c]) / 2;
+				outPalette[3][c] = 0;
+			}
+		}
+
+		for (uint32_t i = 0; i < 4; i++)
+			outPalette[i][3] = 255;
+
+		if (!fourColor)
+			outPalette[3][3] = 0;
+	}
+
+	// picks the nearest palette color for every texel, returns the total squared error
+	uint32_t colorIndices(float const texels[16][4], uint16_t c0, uint16_t c1, uint32_t& outIndices)
+	{
+		int32_t palette[4][4];
+		colorPalette(c0, c1, true, palette);
+
+		uint32_t totalError = 0;
+		outIndices = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t bestError = UINT32_MAX;
+			uint32_t bestIndex = 0;
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				uint32_t error = 0;
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					int32_t d = int32_t(texels[i][c]) - palette[p][c];
+					error += uint32_t(d * d);
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			outIndices |= bestIndex << (i * 2);
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	void encodeColorBlock(uint8_t const texels8[16][4], uint8_t* outBlock)
+	{
+		float texels[16][4];
+		for (uint32_t i = 0; i < 16; i++)
+			for (uint32_t c = 0; c < 4; c++)
+				texels[i][c] = float(texels8[i][c]);
+
+		float low[4];
+		float high[4];
+		axisEndpoints(texels, 3, low, high);
+
+		uint16_t c0 = packColor565(high);
+		uint16_t c1 = packColor565(low);
+		uint32_t indices = 0;
+		uint32_t error = colorIndices(texels, c0, c1, indices);
+
+		// refit the endpoints to the indices we got, a couple of times
+		constexpr float highWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		for (uint32_t iteration = 0; iteration < 2 && error > 0; iteration++)
+		{
+			float weights[16];
+			for (uint32_t i = 0; i < 16; i++)
+				weights[i] = highWeights[(indices >> (i * 2)) & 3];
+
+			if (!fitEndpoints(texels, 3, weights, low, high))
+				break;
+
+			uint16_t newC0 = packColor565(high);
+			uint16_t newC1 = packColor565(low);
+			uint32_t newIndices = 0;
+			uint32_t newError = colorIndices(texels, newC0, newC1, newIndices);
+			if (newError >= error)
+				break;
+
+			c0 = newC0;
+			c1 = newC1;
+			indices = newIndices;
+			error = newError;
+		}
+
+		// keep four color mode, which needs c0 > c1
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			indices ^= 0x55555555;
+		}
+		else if (c0 == c1)
+		{
+			indices = 0;
+		}
+
+		outBlock[0] = uint8_t(c0);
+		outBlock[1] = uint8_t(c0 >> 8);
+		outBlock[2] = uint8_t(c1);
+		outBlock[3] = uint8_t(c1 >> 8);
+		for (uint32_t b = 0; b < 4; b++)
+			outBlock[4 + b] = uint8_t(indices >> (b * 8));
+	}
+
+	void decodeColorBlock(uint8_t const* block, bool forceFourColor, uint8_t outTexels[16][4])
+	{
+		uint16_t c0 = uint16_t(block[0] | (block[1] << 8));
+		uint16_t c1 = uint16_t(block[2] | (block[3] << 8));
+		uint32_t indices = uint32_t(block[4]) | (uint32_t(block[5]) << 8) | (uint32_t(block[6]) << 16) | (uint32_t(block[7]) << 24);
+
+		int32_t palette[4][4];
+		colorPalette(c0, c1, forceFourColor || c0 > c1, palette);
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t index = (indices >> (i * 2)) & 3;
+			for (uint32_t c = 0; c < 4; c++)
+				outTexels[i][c] = uint8_t(palette[index][c]);
+		}
+	}
+
+	// --- BC4 (also the alpha half of BC3, and both halves of BC5) --- //
+
+	void singlePalette(uint8_t e0, uint8_t e1, int32_t outPalette[8])
+	{
+		outPalette[0] = e0;
+		outPalette[1] = e1;
+		if (e0 > e1)
+		{
+			for (int32_t k = 2; k < 8; k++)
+				outPalette[k] = ((8 - k) * e0 + (k - 1) * e1 + 3) / 7;
+		}
+		else
+		{
+			for (int32_t k = 2; k < 6; k++)
+				outPalette[k] = ((6 - k) * e0 + (k - 1) * e1 + 2) / 5;
+			outPalette[6] = 0;
+			outPalette[7] = 255;
+		}
+	}
+
+	void encodeSingleBlock(uint8_t const texels8[16][4], uint32_t channel, uint8_t* outBlock)
+	{
+		uint8_t minValue = 255;
+		uint8_t maxValue = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			minValue = std::min(minValue, texels8[i][channel]);
+			maxValue = std::max(maxValue, texels8[i][channel]);
+		}
+
+		// eight value mode when there is a range, a flat block is just e0 everywhere
+		outBlock[0] = maxValue;
+		outBlock[1] = minValue;
+
+		int32_t palette[8];
+		singlePalette(maxValue, minValue, palette);
+
+		uint64_t indices = 0;
+		if (maxValue != minValue)
+		{
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				int32_t bestError = INT32_MAX;
+				uint64_t bestIndex = 0;
+				for (uint32_t p = 0; p < 8; p++)
+				{
+					int32_t error = std::abs(int32_t(texels8[i][channel]) - palette[p]);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= bestIndex << (i * 3);
+			}
+		}
+
+		for (uint32_t b = 0; b < 6; b++)
+			outBlock[2 + b] = uint8_t(indices >> (b * 8));
+	}
+
+	void decodeSingleBlock(uint8_t const* block, uint32_t channel, uint8_t outTexels[16][4])
+	{
+		int32_t palette[8];
+		singlePalette(block[0], block[1], palette);
+
+		uint64_t indices = 0;
+		for (uint32_t b = 0; b < 6; b++)
+			indices |= uint64_t(block[2 + b]) << (b * 8);
+
+		for (uint32_t i = 0; i < 16; i++)
+			outTexels[i][channel] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+	}
+
+	// --- BC7 mode 6 --- //
+
+	struct Bc7Endpoints
+	{
+		// 7 bit per channel, plus a shared p bit for the lsb
+		uint8_t color[2][4]{};
+		uint8_t pbit[2]{};
+
+		uint8_t value(uint32_t endpoint, uint32_t channel) const
+		{
+			return uint8_t((color[endpoint][channel] << 1) | pbit[endpoint]);
+		}
+	};
+
+	void quantizeBc7(float const low[4], float const high[4], uint32_t p0, uint32_t p1, Bc7Endpoints& outEndpoints)
+	{
+		outEndpoints.pbit[0] = uint8_t(p0);
+		outEndpoints.pbit[1] = uint8_t(p1);
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			outEndpoints.color[0][c] = uint8_t(std::clamp((low[c] - float(p0)) / 2.0f + 0.5f, 0.0f, 127.0f));
+			outEndpoints.color[1][c] = uint8_t(std::clamp((high[c] - float(p1)) / 2.0f + 0.5f, 0.0f, 127.0f));
+		}
+	}
+
+	void bc7Palette(Bc7Endpoints const& endpoints, int32_t outPalette[16][4])
+	{
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				int32_t e0 = endpoints.value(0, c);
+				int32_t e1 = endpoints.value(1, c);
+				outPalette[i][c] = ((64 - int32_t(bc7Weights4[i])) * e0 + int32_t(bc7Weights4[i]) * e1 + 32) >> 6;
+			}
+		}
+	}
+
+	uint32_t bc7Indices(float const texels[16][4], Bc7Endpoints const& endpoints, uint8_t outIndices[16])
+	{
+		int32_t palette[16][4];
+		bc7Palette(endpoints, palette);
+
+		uint32_t totalError = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t bestError = UINT32_MAX;
+			for (uint8_t p = 0; p < 16; p++)
+			{
+				uint32_t error = 0;
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					int32_t d = int32_t(texels[i][c]) - palette[p][c];
+					error += uint32_t(d * d);
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					outIndices[i] = p;
+				}
+			}
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	// tries every p bit combination for the given endpoints, keeps the best in outEndpoints/outIndices if it beats bestError
+	void tryBc7Endpoints(float const texels[16][4], float const low[4], float const high[4], Bc7Endpoints& outEndpoints, uint8_t outIndices[16], uint32_t& bestError)
+	{
+		for (uint32_t p = 0; p < 4; p++)
+		{
+			Bc7Endpoints endpoints;
+			quantizeBc7(low, high, p & 1, p >> 1, endpoints);
+
+			uint8_t indices[16];
+			uint32_t error = bc7Indices(texels, endpoints, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				outEndpoints = endpoints;
+				std::memcpy(outIndices, indices, 16);
+			}
+		}
+	}
+
+	struct BitWriter128
+	{
+		uint8_t* block{};
+		uint32_t cursor{};
+
+		void write(uint32_t value, uint32_t numBits)
+		{
+			for (uint32_t b = 0; b < numBits; b++, cursor++)
+			{
+				if (value & (1u << b))
+					block[cursor / 8] |= uint8_t(1u << (cursor % 8));
+			}
+		}
+	};
+
+	struct BitReader128
+	{
+		uint8_t const* block{};
+		uint32_t cursor{};
+
+		uint32_t read(uint32_t numBits)
+		{
+			uint32_t value = 0;
+			for (uint32_t b = 0; b < numBits; b++, cursor++)
+				value |= uint32_t((block[cursor / 8] >> (cursor % 8)) & 1) << b;
+			return value;
+		}
+	};
+
+	void encodeBc7Block(uint8_t const texels8[16][4], uint8_t* outBlock)
+	{
+		float texels[16][4];
+		for (uint32_t i = 0; i < 16; i++)
+			for (uint32_t c = 0; c < 4; c++)
+				texels[i][c] = float(texels8[i][c]);
+
+		float low[4];
+		float high[4];
+		axisEndpoints(texels, 4, low, high);
+
+		Bc7Endpoints endpoints;
+		uint8_t indices[16]{};
+		uint32_t error = UINT32_MAX;
+		tryBc7Endpoints(texels, low, high, endpoints, indices, error);
+
+		for (uint32_t iteration = 0; iteration < 2 && error > 0; iteration++)
+		{
+			float weights[16];
+			for (uint32_t i = 0; i < 16; i++)
+				weights[i] = float(bc7Weights4[indices[i]]) / 64.0f;
+
+			if (!fitEndpoints(texels, 4, weights, low, high))
+				break;
+
+			uint32_t previousError = error;
+			tryBc7Endpoints(texels, low, high, endpoints, indices, error);
+			if (error >= previousError)
+				break;
+		}
+
+		// the msb of the first index is implied 0, flip the block around if it isn't
+		if (indices[0] & 8)
+		{
+			std::swap(endpoints.color[0], endpoints.color[1]);
+			std::swap(endpoints.pbit[0], endpoints.pbit[1]);
+			for (uint32_t i = 0; i < 16; i++)
+				indices[i] = uint8_t(15 - indices[i]);
+		}
+
+		std::memset(outBlock, 0, 16);
+		BitWriter128 writer{ outBlock };
+		writer.write(1 << 6, 7);
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			writer.write(endpoints.color[0][c], 7);
+			writer.write(endpoints.color[1][c], 7);
+		}
+		writer.write(endpoints.pbit[0], 1);
+		writer.write(endpoints.pbit[1], 1);
+		writer.write(indices[0], 3);
+		for (uint32_t i = 1; i < 16; i++)
+			writer.write(indices[i], 4);
+	}
+
+	bool decodeBc7Block(uint8_t const* block, uint8_t outTexels[16][4])
+	{
+		BitReader128 reader{ block };
+		if (reader.read(7) != (1 << 6))
+			return false;
+
+		Bc7Endpoints endpoints;
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			endpoints.color[0][c] = uint8_t(reader.read(7));
+			endpoints.color[1][c] = uint8_t(reader.read(7));
+		}
+		endpoints.pbit[0] = uint8_t(reader.read(1));
+		endpoints.pbit[1] = uint8_t(reader.read(1));
+
+		int32_t palette[16][4];
+		bc7Palette(endpoints, palette);
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t index = reader.read(i == 0 ? 3 : 4);
+			for (uint32_t c = 0; c < 4; c++)
+				outTexels[i][c] = uint8_t(palette[index][c]);
+		}
+
+		return true;
+	}
+
+	uint32_t blockBytes(e2::TextureFormat format)
+	{
+		switch (format)
+		{
+		case e2::TextureFormat::BC1:
+		case e2::TextureFormat::BC1SRGB:
+		case e2::TextureFormat::BC4:
+			return 8;
+		case e2::TextureFormat::BC3:
+		case e2::TextureFormat::BC3SRGB:
+		case e2::TextureFormat::BC5:
+		case e2::TextureFormat::BC7:
+		case e2::TextureFormat::BC7SRGB:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+}
+
+e2::TextureFormat e2::chooseBlockFormat(e2::TextureUsage usage, bool hasAlpha, bool grayscale, bool highQuality)
+{
+	if (usage == e2::TextureUsage::Normal)
+		return e2::TextureFormat::BC5;
+
+	bool srgb = usage == e2::TextureUsage::Color;
+	if (!srgb && grayscale && !hasAlpha)
+		return e2::TextureFormat::BC4;
+
+	if (highQuality)
+		return srgb ? e2::TextureFormat::BC7SRGB : e2::TextureFormat::BC7;
+
+	if (hasAlpha)
+		return srgb ? e2::TextureFormat::BC3SRGB : e2::TextureFormat::BC3;
+
+	return srgb ? e2::TextureFormat::BC1SRGB : e2::TextureFormat::BC1;
+}
+
+uint64_t e2::blockDataSize(e2::TextureFormat format, glm::uvec2 const& resolution)
+{
+	uint64_t blocksX = (resolution.x + 3) / 4;
+	uint64_t blocksY = (resolution.y + 3) / 4;
+	return blocksX * blocksY * ::blockBytes(format);
+}
+
+void e2::generateMipChain(uint8_t const* rgba8, glm::uvec2 const& resolution, e2::TextureUsage usage, std::vector<std::vector<uint8_t>>& outMips)
+{
+	uint32_t numMips = e2::calculateMipLevels(resolution);
+	outMips.resize(numMips);
+
+	uint64_t numTexels = uint64_t(resolution.x) * resolution.y;
+	outMips[0].assign(rgba8, rgba8 + numTexels * 4);
+
+	// filter in full precision from the mip above, in linear light for color and as vectors for normals
+	std::vector<float> current(numTexels * 4);
+	for (uint64_t i = 0; i < numTexels * 4; i++)
+	{
+		float value = float(rgba8[i]) / 255.0f;
+		bool alpha = (i % 4) == 3;
+		if (usage == e2::TextureUsage::Color && !alpha)
+			value = ::srgbToLinear(value);
+		else if (usage == e2::TextureUsage::Normal && !alpha)
+			value = value * 2.0f - 1.0f;
+
+		current[i] = value;
+	}
+
+	std::vector<float> horizontal;
+	std::vector<float> next;
+	std::vector<::FilterTaps> tapsX;
+	std::vector<::FilterTaps> tapsY;
+
+	glm::uvec2 currentResolution = resolution;
+	for (uint32_t mip = 1; mip < numMips; mip++)
+	{
+		glm::uvec2 nextResolution(std::max(currentResolution.x / 2, 1u), std::max(currentResolution.y / 2, 1u));
+		::calculateTaps(currentResolution.x, nextResolution.x, tapsX);
+		::calculateTaps(currentResolution.y, nextResolution.y, tapsY);
+
+		horizontal.assign(uint64_t(nextResolution.x) * currentResolution.y * 4, 0.0f);
+		for (uint32_t y = 0; y < currentResolution.y; y++)
+		{
+			for (uint32_t x = 0; x < nextResolution.x; x++)
+			{
+				::FilterTaps const& taps = tapsX[x];
+				float* target = &horizontal[(uint64_t(y) * nextResolution.x + x) * 4];
+				for (uint32_t t = 0; t < taps.count; t++)
+				{
+					float const* source = &current[(uint64_t(y) * currentResolution.x + taps.first + t) * 4];
+					for (uint32_t c = 0; c < 4; c++)
+						target[c] += source[c] * taps.weights[t];
+				}
+			}
+		}
+
+		next.assign(uint64_t(nextResolution.x) * nextResolution.y * 4, 0.0f);
+		for (uint32_t y = 0; y < nextResolution.y; y++)
+		{
+			::FilterTaps const& taps = tapsY[y];
+			for (uint32_t x = 0; x < nextResolution.x; x++)
+			{
+				float* target = &next[(uint64_t(y) * nextResolution.x + x) * 4];
+				for (uint32_t t = 0; t < taps.count; t++)
+				{
+					float const* source = &horizontal[(uint64_t(taps.first + t) * nextResolution.x + x) * 4];
+					for (uint32_t c = 0; c < 4; c++)
+						target[c] += source[c] * taps.weights[t];
+				}
+			}
+		}
+
+		uint64_t numNextTexels = uint64_t(nextResolution.x) * nextResolution.y;
+		std::vector<uint8_t>& mipData = outMips[mip];
+		mipData.resize(numNextTexels * 4);
+		for (uint64_t i = 0; i < numNextTexels; i++)
+		{
+			float* texel = &next[i * 4];
+			if (usage == e2::TextureUsage::Normal)
+			{
+				// averaged normals get shorter, and lighting expects unit length
+				float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+				if (length > 1e-6f)
+				{
+					for (uint32_t c = 0; c < 3; c++)
+						texel[c] /= length;
+				}
+				else
+				{
+					texel[0] = 0.0f;
+					texel[1] = 0.0f;
+					texel[2] = 1.0f;
+				}
+			}
+
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				float value = texel[c];
+				if (c < 3 && usage == e2::TextureUsage::Color)
+					value = ::linearToSrgb(value);
+				else if (c < 3 && usage == e2::TextureUsage::Normal)
+					value = value * 0.5f + 0.5f;
+
+				mipData[i * 4 + c] = ::toUnorm8(value);
+			}
+		}
+
+		current.swap(next);
+		currentResolution = nextResolution;
+	}
+}
+
+bool e2::encodeBlocks(e2::TextureFormat format, uint8_t const* rgba8, glm::uvec2 const& resolution, std::vector<uint8_t>& outBlocks)
+{
+	uint32_t bytesPerBlock = ::blockBytes(format);
+	if (bytesPerBlock == 0)
+	{
+		LogError("format {} is not block compressed", uint32_t(format));
+		return false;
+	}
+
+	uint32_t blocksX = (resolution.x + 3) / 4;
+	uint32_t blocksY = (resolution.y + 3) / 4;
+	outBlocks.resize(e2::blockDataSize(format, resolution));
+
+	uint8_t texels[16][4];
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			::gatherBlock(rgba8, resolution, blockX, blockY, texels);
+			uint8_t* block = &outBlocks[(uint64_t(blockY) * blocksX + blockX) * bytesPerBlock];
+
+			switch (format)
+			{
+			case e2::TextureFormat::BC1:
+			case e2::TextureFormat::BC1SRGB:
+				::encodeColorBlock(texels, block);
+				break;
+			case e2::TextureFormat::BC3:
+			case e2::TextureFormat::BC3SRGB:
+				::encodeSingleBlock(texels, 3, block);
+				::encodeColorBlock(texels, block + 8);
+				break;
+			case e2::TextureFormat::BC4:
+				::encodeSingleBlock(texels, 0, block);
+				break;
+			case e2::TextureFormat::BC5:
+				::encodeSingleBlock(texels, 0, block);
+				::encodeSingleBlock(texels, 1, block + 8);
+				break;
+			default:
+				::encodeBc7Block(texels, block);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool e2::decodeBlocks(e2::TextureFormat format, uint8_t const* blocks, glm::uvec2 const& resolution, std::vector<uint8_t>& outRgba8)
+{
+	uint32_t bytesPerBlock = ::blockBytes(format);
+	if (bytesPerBlock == 0)
+	{
+		LogError("format {} is not block compressed", uint32_t(format));
+		return false;
+	}
+
+	uint32_t blocksX = (resolution.x + 3) / 4;
+	uint32_t blocksY = (resolution.y + 3) / 4;
+	outRgba8.resize(uint64_t(resolution.x) * resolution.y * 4);
+
+	uint8_t texels[16][4];
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			uint8_t const* block = &blocks[(uint64_t(blockY) * blocksX + blockX) * bytesPerBlock];
+
+			switch (format)
+			{
+			case e2::TextureFormat::BC1:
+			case e2::TextureFormat::BC1SRGB:
+				::decodeColorBlock(block, false, texels);
+				break;
+			case e2::TextureFormat::BC3:
+			case e2::TextureFormat::BC3SRGB:
+				::decodeColorBlock(block + 8, true, texels);
+				::decodeSingleBlock(block, 3, texels);
+				break;
+			case e2::TextureFormat::BC4:
+				::decodeSingleBlock(block, 0, texels);
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					texels[i][1] = texels[i][0];
+					texels[i][2] = texels[i][0];
+					texels[i][3] = 255;
+				}
+				break;
+			case e2::TextureFormat::BC5:
+				::decodeSingleBlock(block, 0, texels);
+				::decodeSingleBlock(block + 8, 1, texels);
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+				break;
+			default:
+				if (!::decodeBc7Block(block, texels))
+				{
+					LogError("bc7 block {},{} is not mode 6", blockX, blockY);
+					return false;
+				}
+				break;
+			}
+
+			for (uint32_t y = 0; y < 4 && blockY * 4 + y < resolution.y; y++)
+			{
+				for (uint32_t x = 0; x < 4 && blockX * 4 + x < resolution.x; x++)
+				{
+					uint64_t target = (uint64_t(blockY * 4 + y) * resolution.x + blockX * 4 + x) * 4;
+					std::memcpy(&outRgba8[target], texels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+double e2::blockPSNR(e2::TextureFormat format, uint8_t const* original, uint8_t const* decoded, glm::uvec2 const& resolution)
+{
+	uint32_t numChannels = 4;
+	if (format == e2::TextureFormat::BC4)
+		numChannels = 1;
+	else if (format == e2::TextureFormat::BC5)
+		numChannels = 2;
+	else if (format == e2::TextureFormat::BC1 || format == e2::TextureFormat::BC1SRGB)
+		numChannels = 3;
+
+	uint64_t numTexels = uint64_t(resolution.x) * resolution.y;
+	double squaredError = 0.0;
+	for (uint64_t i = 0; i < numTexels; i++)
+	{
+		for (uint32_t c = 0; c < numChannels; c++)
+		{
+			double d = double(original[i * 4 + c]) - double(decoded[i * 4 + c]);
+			squaredError += d * d;
+		}
+	}
+
+	double meanSquaredError = squaredError / double(numTexels * numChannels);
+	if (meanSquaredError <= 0.0)
+		return 99.0;
+
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+bool e2::testBlockCompression()
+{
+	// odd sizes, so edge blocks hang over and mips round down
+	glm::uvec2 resolution(61, 47);
+	uint64_t numTexels = uint64_t(resolution.x) * resolution.y;
+
+	std::vector<uint8_t> color(numTexels * 4);
+	std::vector<uint8_t> mask(numTexels * 4);
+	std::vector<uint8_t> normals(numTexels * 4);
+
+	// fixed seed, so the PSNR floors always see the same grain and a failure replays exactly
+	std::minstd_rand random(0xBC45);
+	for (uint32_t y = 0; y < resolution.y; y++)
+	{
+		for (uint32_t x = 0; x < resolution.x; x++)
+		{
+			uint8_t* c = &color[(uint64_t(y) * resolution.x + x) * 4];
+			float u = float(x) / float(resolution.x);
+			float v = float(y) / float(resolution.y);
+
+			// gradients with a bit of grain, like a painted albedo
+			float grain = float(int32_t(random() % 13) - 6);
+			c[0] = ::toUnorm8(u * 0.8f + 0.1f + grain / 255.0f);
+			c[1] = ::toUnorm8(v * 0.6f + 0.2f * std::sin(u * 9.0f) + 0.2f + grain / 255.0f);
+			c[2] = ::toUnorm8(0.3f + 0.2f * std::cos(v * 7.0f) + grain / 255.0f);
+			c[3] = ::toUnorm8(std::clamp(1.2f - u * 1.4f, 0.0f, 1.0f));
+
+			uint8_t* m = &mask[(uint64_t(y) * resolution.x + x) * 4];
+			float radius = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+			m[0] = m[1] = m[2] = ::toUnorm8(std::clamp(1.0f - radius * 1.8f, 0.0f, 1.0f));
+			m[3] = 255;
+
+			// bumps, unit length vectors biased into 0-1
+			float nx = 0.5f * std::sin(u * 20.0f);
+			float ny = 0.5f * std::cos(v * 16.0f);
+			float nz = std::sqrt(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+			uint8_t* n = &normals[(uint64_t(y) * resolution.x + x) * 4];
+			n[0] = ::toUnorm8(nx * 0.5f + 0.5f);
+			n[1] = ::toUnorm8(ny * 0.5f + 0.5f);
+			n[2] = ::toUnorm8(nz * 0.5f + 0.5f);
+			n[3] = 255;
+		}
+	}
+
+	struct Case
+	{
+		char const* name;
+		e2::TextureFormat format;
+		std::vector<uint8_t> const* image;
+		double minPSNR;
+	};
+
+	Case const cases[] = {
+		{ "bc1 color", e2::TextureFormat::BC1SRGB, &color, 32.0 },
+		{ "bc3 color", e2::TextureFormat::BC3SRGB, &color, 32.0 },
+		{ "bc7 color", e2::TextureFormat::BC7SRGB, &color, 36.0 },
+		{ "bc4 mask", e2::TextureFormat::BC4, &mask, 44.0 },
+		{ "bc5 normals", e2::TextureFormat::BC5, &normals, 40.0 },
+	};
+
+	std::vector<uint8_t> blocks;
+	std::vector<uint8_t> decoded;
+	std::vector<uint8_t> reencoded;
+	for (Case const& test : cases)
+	{
+		if (!e2::encodeBlocks(test.format, test.image->data(), resolution, blocks) || blocks.size() != e2::blockDataSize(test.format, resolution))
+		{
+			LogError("block compression: {} encoded to the wrong size", test.name);
+			return false;
+		}
+
+		if (!e2::decodeBlocks(test.format, blocks.data(), resolution, decoded))
+		{
+			LogError("block compression: {} failed to decode", test.name);
+			return false;
+		}
+
+		double psnr = e2::blockPSNR(test.format, test.image->data(), decoded.data(), resolution);
+		if (psnr < test.minPSNR)
+		{
+			LogError("block compression: {} psnr is {:.2f} dB, expected at least {:.2f}", test.name, psnr, test.minPSNR);
+			return false;
+		}
+
+		// what decodes from our blocks must survive another round trip unchanged for single channel formats, as every value is on a palette already
+		if (test.format == e2::TextureFormat::BC4 || test.format == e2::TextureFormat::BC5)
+		{
+			std::vector<uint8_t> reblocks;
+			e2::encodeBlocks(test.format, decoded.data(), resolution, reblocks);
+			e2::decodeBlocks(test.format, reblocks.data(), resolution, reencoded);
+			if (e2::blockPSNR(test.format, decoded.data(), reencoded.data(), resolution) < 99.0)
+			{
+				LogError("block compression: {} changed on a second round trip", test.name);
+				return false;
+			}
+		}
+
+		uint64_t rawSize = numTexels * 4;
+		LogNotice("block compression: {} at {:.2f} dB, {} bytes ({:.1f}x smaller than rgba8)", test.name, psnr, blocks.size(), double(rawSize) / double(blocks.size()));
+	}
+
+	// blocks of two colors the formats can store exactly must come back exactly, whichever way round the endpoints end up.
+	// BC1 and BC3 get 565 representable colors, BC7 one odd and one even color so each endpoint can take its own p bit
+	uint8_t const exactColors[2][4][2][4] = {
+		{
+			{ { 255, 0, 0, 255 }, { 0, 0, 255, 40 } },
+			{ { 0, 0, 0, 255 }, { 255, 255, 255, 40 } },
+			{ { 255, 255, 255, 255 }, { 0, 0, 0, 40 } },
+			{ { 132, 65, 8, 255 }, { 8, 190, 255, 40 } },
+		},
+		{
+			{ { 255, 1, 33, 255 }, { 0, 200, 100, 0 } },
+			{ { 17, 99, 201, 127 }, { 240, 12, 64, 200 } },
+			{ { 1, 1, 1, 1 }, { 254, 254, 254, 254 } },
+			{ { 85, 3, 77, 255 }, { 20, 220, 0, 254 } },
+		},
+	};
+
+	e2::TextureFormat const exactFormats[3] = { e2::TextureFormat::BC1, e2::TextureFormat::BC3, e2::TextureFormat::BC7 };
+	glm::uvec2 exactResolution(16, 4);
+	std::vector<uint8_t> exact(16 * 4 * 4);
+	for (e2::TextureFormat format : exactFormats)
+	{
+		uint32_t set = format == e2::TextureFormat::BC7 ? 1 : 0;
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			for (uint32_t x = 0; x < 16; x++)
+				std::memcpy(&exact[(y * 16 + x) * 4], exactColors[set][x / 4][(x + y) % 2], 4);
+		}
+
+		e2::encodeBlocks(format, exact.data(), exactResolution, blocks);
+		e2::decodeBlocks(format, blocks.data(), exactResolution, decoded);
+		if (e2::blockPSNR(format, exact.data(), decoded.data(), exactResolution) < 99.0)
+		{
+			LogError("block compression: two color blocks don't round trip exactly in format {}", uint32_t(format));
+			return false;
+		}
+	}
+
+	// gamma correct filtering: black and white texels average to half the light, which is 188 in srgb rather than 128
+	glm::uvec2 checkerResolution(8, 8);
+	std::vector<uint8_t> checker(64 * 4);
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		uint8_t value = ((i % 8) + (i / 8)) % 2 ? 255 : 0;
+		checker[i * 4 + 0] = checker[i * 4 + 1] = checker[i * 4 + 2] = value;
+		checker[i * 4 + 3] = 255;
+	}
+
+	std::vector<std::vector<uint8_t>> mips;
+	e2::generateMipChain(checker.data(), checkerResolution, e2::TextureUsage::Color, mips);
+	if (mips.size() != 4 || mips[1].size() != 16 * 4 || std::abs(int32_t(mips[1][0]) - 188) > 1 || std::abs(int32_t(mips[3][0]) - 188) > 1)
+	{
+		LogError("block compression: srgb checker mips are wrong, {} mips, mip 1 is {}", mips.size(), mips.size() > 1 ? uint32_t(mips[1][0]) : 0);
+		return false;
+	}
+
+	e2::generateMipChain(checker.data(), checkerResolution, e2::TextureUsage::Linear, mips);
+	if (std::abs(int32_t(mips[1][0]) - 128) > 1)
+	{
+		LogError("block compression: linear checker mip 1 is {}, expected 128", uint32_t(mips[1][0]));
+		return false;
+	}
+
+	// odd sizes round down to 1x1, and normals stay unit length all the way
+	e2::generateMipChain(normals.data(), resolution, e2::TextureUsage::Normal, mips);
+	glm::uvec2 mipResolution = resolution;
+	for (uint32_t mip = 0; mip < mips.size(); mip++)
+	{
+		uint64_t mipTexels = uint64_t(mipResolution.x) * mipResolution.y;
+		if (mips[mip].size() != mipTexels * 4)
+		{
+			LogError("block compression: normal mip {} has {} bytes, expected {}", mip, mips[mip].size(), mipTexels * 4);
+			return false;
+		}
+
+		for (uint64_t i = 0; i < mipTexels; i++)
+		{
+			float length = 0.0f;
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				float value = float(mips[mip][i * 4 + c]) / 255.0f * 2.0f - 1.0f;
+				length += value * value;
+			}
+
+			if (std::abs(std::sqrt(length) - 1.0f) > 0.02f)
+			{
+				LogError("block compression: normal mip {} texel {} has length {}", mip, i, std::sqrt(length));
+				return false;
+			}
+		}
+
+		mipResolution = glm::uvec2(std::max(mipResolution.x / 2, 1u), std::max(mipResolution.y / 2, 1u));
+	}
+
+	if (mipResolution.x != 1 || mipResolution.y != 1 || mips.back().size() != 4)
+	{
+		LogError("block compression: mip chain of {}x{} doesn't end at 1x1", resolution.x, resolution.y);
+		return false;
+	}
+
+	LogNotice("block compression verified");
+	return true;
+}
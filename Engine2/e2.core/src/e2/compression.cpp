@@ -0,0 +1,289 @@
+
+#include "e2/compression.hpp"
+
+#include "e2/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// sequences are a token (literal count << 4 | match length - minMatch), literals, a 16 bit offset and the match.
+	// counts of 15 continue in extra bytes, 255 meaning more follow. The last sequence has literals only
+	constexpr uint32_t minMatch = 4;
+	constexpr uint32_t maxOffset = 65535;
+	constexpr uint32_t hashBits = 16;
+
+	// the last bytes are always literals, so matching never reads past the end
+	constexpr uint64_t endLiterals = 8;
+
+	uint32_t read32(uint8_t const* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t hash(uint32_t v)
+	{
+		return (v * 2654435761u) >> (32 - hashBits);
+	}
+
+	void writeLength(std::vector<uint8_t>& out, uint64_t length)
+	{
+		while (length >= 255)
+		{
+			out.push_back(255);
+			length -= 255;
+		}
+		out.push_back(uint8_t(length));
+	}
+
+	void writeSequence(std::vector<uint8_t>& out, uint8_t const* literals, uint64_t numLiterals, uint32_t offset, uint64_t matchLength)
+	{
+		uint64_t matchCode = matchLength >= minMatch ? matchLength - minMatch : 0;
+		out.push_back(uint8_t((numLiterals >= 15 ? 15 : numLiterals) << 4 | (matchCode >= 15 ? 15 : matchCode)));
+		if (numLiterals >= 15)
+			writeLength(out, numLiterals - 15);
+
+		out.insert(out.end(), literals, literals + numLiterals);
+
+		if (matchLength == 0)
+			return;
+
+		out.push_back(uint8_t(offset));
+		out.push_back(uint8_t(offset >> 8));
+		if (matchCode >= 15)
+			writeLength(out, matchCode - 15);
+	}
+
+	bool readLength(uint8_t const*& in, uint8_t const* end, uint64_t& length)
+	{
+		uint8_t b;
+		do
+		{
+			if (in >= end)
+				return false;
+			b = *in++;
+			length += b;
+		} while (b == 255);
+		return true;
+	}
+}
+
+void e2::compressLZ(uint8_t const* data, uint64_t size, std::vector<uint8_t>& outCompressed)
+{
+	outCompressed.clear();
+	outCompressed.reserve(size / 2 + 16);
+
+	std::vector<uint32_t> table(uint64_t(1) << hashBits, 0);
+
+	uint64_t anchor = 0;
+	uint64_t cursor = 0;
+	uint64_t matchLimit = size > endLiterals ? size - endLiterals : 0;
+
+	while (cursor + minMatch <= matchLimit)
+	{
+		uint32_t sequence = read32(data + cursor);
+		uint32_t& slot = table[hash(sequence)];
+		uint64_t candidate = slot;
+		slot = uint32_t(cursor);
+
+		if (candidate >= cursor || cursor - candidate > maxOffset || read32(data + candidate) != sequence)
+		{
+			cursor++;
+			continue;
+		}
+
+		uint64_t matchLength = minMatch;
+		while (cursor + matchLength < matchLimit && data[candidate + matchLength] == data[cursor + matchLength])
+			matchLength++;
+
+		writeSequence(outCompressed, data + anchor, cursor - anchor, uint32_t(cursor - candidate), matchLength);
+
+		// index a position inside the match too, so runs keep matching cheaply
+		if (cursor + matchLength - 2 + minMatch <= matchLimit)
+			table[hash(read32(data + cursor + matchLength - 2))] = uint32_t(cursor + matchLength - 2);
+
+		cursor += matchLength;
+		anchor = cursor;
+	}
+
+	writeSequence(outCompressed, data + anchor, size - anchor, 0, 0);
+}
+
+bool e2::decompressLZ(uint8_t const* compressed, uint64_t compressedSize, uint8_t* outData, uint64_t outSize)
+{
+	uint8_t const* in = compressed;
+	uint8_t const* inEnd = compressed + compressedSize;
+	uint64_t out = 0;
+
+	while (in < inEnd)
+	{
+		uint8_t token = *in++;
+
+		uint64_t numLiterals = token >> 4;
+		if (numLiterals == 15 && !readLength(in, inEnd, numLiterals))
+			return false;
+
+		if (numLiterals > uint64_t(inEnd - in) || numLiterals > outSize - out)
+			return false;
+
+		if (numLiterals > 0)
+			std::memcpy(outData + out, in, numLiterals);
+		in += numLiterals;
+		out += numLiterals;
+
+		// literals only, this was the last sequence
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return false;
+
+		uint64_t offset = uint64_t(in[0]) | uint64_t(in[1]) << 8;
+		in += 2;
+
+		uint64_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+			return false;
+		matchLength += minMatch;
+
+		if (offset == 0 || offset > out || matchLength > outSize - out)
+			return false;
+
+		// may overlap itself (runs), then it has to be copied forward byte by byte
+		uint8_t* dst = outData + out;
+		uint8_t const* src = dst - offset;
+		if (offset >= matchLength)
+		{
+			std::memcpy(dst, src, matchLength);
+		}
+		else
+		{
+			for (uint64_t i = 0; i < matchLength; i++)
+				dst[i] = src[i];
+		}
+
+		out += matchLength;
+	}
+
+	return out == outSize;
+}
+
+namespace
+{
+	bool checkRoundTrip(char const* name, std::vector<uint8_t> const& data, std::minstd_rand& random)
+	{
+		std::vector<uint8_t> compressed;
+		e2::compressLZ(data.data(), data.size(), compressed);
+
+		if (compressed.size() * e2::maxExpansionLZ < data.size())
+		{
+			LogError("lz {}: {} bytes compressed to {}, beyond maxExpansionLZ", name, data.size(), compressed.size());
+			return false;
+		}
+
+		// one spare byte after the output, so an overrun shows even without a sanitizer
+		constexpr uint8_t guard = 0xA5;
+		std::vector<uint8_t> decompressed(data.size() + 1, guard);
+		if (!e2::decompressLZ(compressed.data(), compressed.size(), decompressed.data(), data.size()) || decompressed.back() != guard)
+		{
+			LogError("lz {}: failed to decompress {} bytes", name, data.size());
+			return false;
+		}
+
+		if (!std::equal(data.begin(), data.end(), decompressed.begin()))
+		{
+			LogError("lz {}: {} bytes don't round trip", name, data.size());
+			return false;
+		}
+
+		// the size is stored outside the stream, any other size must be refused
+		if (e2::decompressLZ(compressed.data(), compressed.size(), decompressed.data(), data.size() + 1)
+			|| (data.size() > 0 && e2::decompressLZ(compressed.data(), compressed.size(), decompressed.data(), data.size() - 1)))
+		{
+			LogError("lz {}: decompressed {} bytes to a size it wasn't compressed from", name, data.size());
+			return false;
+		}
+
+		// a save cut short anywhere must be refused. Every cut for small streams, a few hundred for big ones
+		uint64_t cutStep = std::max<uint64_t>(1, compressed.size() / 256);
+		uint64_t firstCut = data.empty() ? 1 : 0;
+		for (uint64_t cut = firstCut; cut < compressed.size(); cut += cutStep)
+		{
+			if (e2::decompressLZ(compressed.data(), cut, decompressed.data(), data.size()) || decompressed.back() != guard)
+			{
+				LogError("lz {}: stream cut to {} of {} bytes was accepted", name, cut, compressed.size());
+				return false;
+			}
+		}
+
+		// corrupt bytes may still decode to something, but never outside the buffers. Run under a sanitizer to see reads
+		std::vector<uint8_t> corrupt;
+		for (uint32_t i = 0; i < 256 && !compressed.empty(); i++)
+		{
+			corrupt = compressed;
+			uint32_t numFlips = 1 + random() % 4;
+			for (uint32_t f = 0; f < numFlips; f++)
+				corrupt[random() % corrupt.size()] ^= uint8_t(1 + random() % 255);
+
+			e2::decompressLZ(corrupt.data(), corrupt.size(), decompressed.data(), data.size());
+			if (decompressed.back() != guard)
+			{
+				LogError("lz {}: corrupt stream wrote past the output", name);
+				return false;
+			}
+		}
+
+		LogNotice("lz {}: {} bytes to {}", name, data.size(), compressed.size());
+		return true;
+	}
+}
+
+bool e2::testCompressionLZ()
+{
+	// fixed seed, so a failure replays exactly
+	std::minstd_rand random(0x1277);
+	bool success = true;
+
+	// nothing, and less than the literal tail
+	for (uint64_t size : { 0, 1, 7, 8, 9, 12, 13 })
+	{
+		std::vector<uint8_t> tiny(size);
+		for (uint8_t& b : tiny)
+			b = uint8_t(random());
+		success = ::checkRoundTrip("tiny", tiny, random) && success;
+	}
+
+	// incompressible
+	std::vector<uint8_t> noise(100003);
+	for (uint8_t& b : noise)
+		b = uint8_t(random());
+	success = ::checkRoundTrip("noise", noise, random) && success;
+
+	// one long run, matches overlap themselves and go past 15 + 255 in length
+	std::vector<uint8_t> run(300007, 0x2A);
+	success = ::checkRoundTrip("run", run, random) && success;
+
+	// repeats further back than a match may reach, next to repeats close by
+	std::vector<uint8_t> far(200011);
+	for (uint64_t i = 0; i < far.size(); i++)
+		far[i] = i < 70000 ? uint8_t(random()) : far[i - (i < 140000 ? 70000 : 3)];
+	success = ::checkRoundTrip("far", far, random) && success;
+
+	// save game like, structs with a few fields changing and some floats
+	std::vector<uint8_t> records;
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		uint32_t fields[4] = { i, 7, uint32_t(random() % 5), 0x3F800000 + uint32_t(random() % 64) };
+		records.insert(records.end(), reinterpret_cast<uint8_t*>(fields), reinterpret_cast<uint8_t*>(fields) + sizeof(fields));
+	}
+	success = ::checkRoundTrip("records", records, random) && success;
+
+	if (success)
+		LogNotice("lz compression verified");
+
+	return success;
+}
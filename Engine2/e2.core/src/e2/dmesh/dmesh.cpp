@@ -1,5 +1,6 @@
 ﻿
 #include "e2/dmesh/dmesh.hpp"
+#include "e2/assets/meshquantization.hpp"
 
 #include "mikktspace.h"
 
@@ -24,21 +25,21 @@ e2::DynamicMesh::DynamicMesh(e2::MeshPtr mesh, uint8_t submeshIndex, e2::VertexA
 	uint32_t triCount = indexCount / 3;
 
 	uint32_t* sourceIndices = new uint32_t[indexCount];
-	spec.indexBuffer->download(reinterpret_cast<uint8_t*>(sourceIndices), sizeof(uint32_t) * indexCount, sizeof(uint32_t) * indexCount, 0);
+	e2::downloadIndices(spec, sourceIndices);
 
 	uint32_t attributeCounter = 0;
 	glm::vec4* sourcePositions = new glm::vec4[vertCount];
-	spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourcePositions), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+	e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::Position, sourcePositions);
 
 	glm::vec4* sourceNormals{};
 	glm::vec4* sourceTangents{};
 	if ((relevantFlags & e2::VertexAttributeFlags::Normal) == e2::VertexAttributeFlags::Normal)
 	{
 		sourceNormals = new glm::vec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceNormals), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+		e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::Normal, sourceNormals);
 
 		sourceTangents = new glm::vec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceTangents), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+		e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::Tangent, sourceTangents);
 	}
 	else if ((existingFlags & e2::VertexAttributeFlags::Normal) == e2::VertexAttributeFlags::Normal)
 	{
@@ -51,7 +52,7 @@ e2::DynamicMesh::DynamicMesh(e2::MeshPtr mesh, uint8_t submeshIndex, e2::VertexA
 	if ((relevantFlags & e2::VertexAttributeFlags::TexCoords01) == e2::VertexAttributeFlags::TexCoords01)
 	{
 		sourceUv01 = new glm::vec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceUv01), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+		e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::TexCoords01, sourceUv01);
 	}
 	else if ((existingFlags & e2::VertexAttributeFlags::TexCoords01) == e2::VertexAttributeFlags::TexCoords01)
 	{
@@ -63,7 +64,7 @@ e2::DynamicMesh::DynamicMesh(e2::MeshPtr mesh, uint8_t submeshIndex, e2::VertexA
 	if ((relevantFlags & e2::VertexAttributeFlags::TexCoords23) == e2::VertexAttributeFlags::TexCoords23)
 	{
 		sourceUv23 = new glm::vec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceUv23), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+		e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::TexCoords23, sourceUv23);
 	}
 	else if ((existingFlags & e2::VertexAttributeFlags::TexCoords23) == e2::VertexAttributeFlags::TexCoords23)
 	{
@@ -75,7 +76,7 @@ e2::DynamicMesh::DynamicMesh(e2::MeshPtr mesh, uint8_t submeshIndex, e2::VertexA
 	if ((relevantFlags & e2::VertexAttributeFlags::Color) == e2::VertexAttributeFlags::Color)
 	{
 		sourceColors = new glm::vec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceColors), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+		e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::Color, sourceColors);
 	}
 	else if ((existingFlags & e2::VertexAttributeFlags::Color) == e2::VertexAttributeFlags::Color)
 	{
@@ -88,10 +89,10 @@ e2::DynamicMesh::DynamicMesh(e2::MeshPtr mesh, uint8_t submeshIndex, e2::VertexA
 	if ((relevantFlags & e2::VertexAttributeFlags::Bones) == e2::VertexAttributeFlags::Bones)
 	{
 		sourceWeights = new glm::vec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceWeights), sizeof(glm::vec4) * vertCount, sizeof(glm::vec4) * vertCount, 0);
+		e2::downloadVertexStream(spec, attributeCounter++, e2::VertexStream::Weights, sourceWeights);
 
 		sourceBones = new glm::uvec4[vertCount];
-		spec.vertexAttributes[attributeCounter++]->download(reinterpret_cast<uint8_t*>(sourceBones), sizeof(glm::uvec4) * vertCount, sizeof(glm::uvec4) * vertCount, 0);
+		e2::downloadBoneStream(spec, attributeCounter++, sourceBones);
 	}
 	else if ((existingFlags & e2::VertexAttributeFlags::Bones) == e2::VertexAttributeFlags::Bones)
 	{
@@ -805,8 +806,8 @@ void e2::DynamicMesh::mergeDuplicateVertices()
 	 positions = (glm::vec4*)malloc(sizeof(glm::vec4) * vertexCapacity);
 
 	 e2::SubmeshSpecification const& spec = mesh->specification(submesh);
-	 spec.indexBuffer->download(reinterpret_cast<uint8_t*>(indices), sizeof(uint32_t) * indexCapacity, sizeof(uint32_t) * indexCapacity, 0);
-	 spec.vertexAttributes[0]->download(reinterpret_cast<uint8_t*>(positions), sizeof(glm::vec4) * vertexCapacity, sizeof(glm::vec4) * vertexCapacity, 0);
+	 e2::downloadIndices(spec, indices);
+	 e2::downloadVertexStream(spec, 0, e2::VertexStream::Position, positions);
 
 	 numVertices = vertexCapacity;
 	 numIndices = indexCapacity;
@@ -1020,8 +1021,8 @@ void e2::DynamicMesh::mergeDuplicateVertices()
 
 
 	 e2::SubmeshSpecification const& spec = mesh->specification(submesh);
-	 spec.indexBuffer->download(reinterpret_cast<uint8_t*>(indices), sizeof(uint32_t) * indexCapacity, sizeof(uint32_t) * indexCapacity, 0);
-	 spec.vertexAttributes[0]->download(reinterpret_cast<uint8_t*>(positions), sizeof(glm::vec4) * vertexCapacity, sizeof(glm::vec4) * vertexCapacity, 0);
+	 e2::downloadIndices(spec, indices);
+	 e2::downloadVertexStream(spec, 0, e2::VertexStream::Position, positions);
 
 	 numVertices = vertexCapacity;
 	 numIndices = indexCapacity;
@@ -18,19 +18,32 @@
 
 #include "e2/rhi/window.hpp"
 
-e2::Engine::Engine()
+#include <thread>
+#include <algorithm>
+
+e2::Engine::Engine(e2::EngineCreateInfo const& createInfo)
+	: m_headless(createInfo.headless)
+	, m_tickRate(createInfo.tickRate)
 {
+	bool withRendering = !m_headless && createInfo.withRendering;
+	bool withUI = withRendering && createInfo.withUI;
+	bool withAudio = !m_headless && createInfo.withAudio;
+
 #if defined(E2_PROFILER)
 	m_profiler = e2::create<Profiler>();
+	m_profiler->setThreadName("Main");
 #endif
 	m_config = e2::create<Config>();
 	m_typeManager = e2::create<e2::TypeManager>(this);
 	m_asyncManager = e2::create<e2::AsyncManager>(this);
 	m_networkManager = e2::create<e2::NetworkManager>(this);
 	m_assetManager = e2::create<e2::AssetManager>(this);
-	m_audioManager = e2::create<e2::AudioManager>(this);
-	m_renderManager = e2::create<e2::RenderManager>(this);
-	m_uiManager = e2::create<e2::UIManager>(this);
+	if(withAudio)
+		m_audioManager = e2::create<e2::AudioManager>(this);
+	if(withRendering)
+		m_renderManager = e2::create<e2::RenderManager>(this);
+	if(withUI)
+		m_uiManager = e2::create<e2::UIManager>(this);
 	m_gameManager = e2::create<e2::GameManager>(this);
 
 	m_config->load("e2.cfg");
@@ -39,10 +52,13 @@ e2::Engine::Engine()
 e2::Engine::~Engine()
 {
 	e2::destroy(m_gameManager);
-	e2::destroy(m_uiManager);
+	if(m_uiManager)
+		e2::destroy(m_uiManager);
 
-	e2::destroy(m_renderManager);
-	e2::destroy(m_audioManager);
+	if(m_renderManager)
+		e2::destroy(m_renderManager);
+	if(m_audioManager)
+		e2::destroy(m_audioManager);
 	e2::destroy(m_assetManager);
 	e2::destroy(m_networkManager);
 	e2::destroy(m_asyncManager);
@@ -56,6 +72,8 @@ e2::Engine::~Engine()
 #if defined(E2_DEVELOPMENT)
 	e2::printLingeringObjects();
 #endif 
+
+	e2::Log::shutdown();
 }
 
 e2::Engine* e2::Engine::engine()
@@ -71,21 +89,162 @@ void e2::Engine::run(e2::Application* app)
 	m_asyncManager->initialize();
 	m_networkManager->initialize();
 	m_assetManager->initialize();
-	m_audioManager->initialize();
-	m_renderManager->initialize();
-	m_uiManager->initialize();
+	if (m_audioManager)
+		m_audioManager->initialize();
+	if (m_renderManager)
+		m_renderManager->initialize();
+	if (m_uiManager)
+		m_uiManager->initialize();
 	m_gameManager->initialize();
 
+	m_running = true;
+
+	m_application->initialize();
+
+	if (m_headless)
+		runHeadless();
+	else
+		runWindowed();
+
+	// waits for all render commands to have completed 
+	if (m_renderManager)
+		m_renderManager->renderContext()->waitIdle();
+
+	// last chance to finish async work, like a save game being written
+	m_application->preShutdown();
+
+	// stops running all async threads, and joins them 
+	m_asyncManager->shutdown();
+	
+	// shutdown application
+	m_application->shutdown();
+
+	// prune all disposed and lingering objects
+	e2::ManagedObject::keepAroundPrune();
+
+	m_gameManager->shutdown();
+
+	m_networkManager->shutdown();
+
+	if (m_audioManager)
+		m_audioManager->shutdown();
+
+	m_assetManager->shutdown();
+
+	e2::ManagedObject::keepAroundPrune();
+
+	if (m_uiManager)
+		m_uiManager->shutdown();
+	if (m_renderManager)
+		m_renderManager->shutdown();
+
+	e2::ManagedObject::keepAroundPrune();
+
+	m_typeManager->shutdown();
+
+}
+
+void e2::Engine::tick(double deltaTime)
+{
+	E2_PROFILE_SCOPE(Default);
+
+	m_networkManager->update(deltaTime);
+	m_asyncManager->update(deltaTime);
+	m_assetManager->update(deltaTime);
+	if (m_audioManager)
+		m_audioManager->update(deltaTime);
+	if (m_renderManager)
+		m_renderManager->update(deltaTime);
+	if (m_uiManager)
+		m_uiManager->update(deltaTime);
+	
+	m_gameManager->preUpdate(deltaTime);
+
+	m_application->update(deltaTime);
+
+	m_gameManager->update(deltaTime);
+
+	// Only dispatch render stuff if we are actually still running
+	if (m_running && m_renderManager)
+		m_renderManager->dispatch();
+}
+
+void e2::Engine::runHeadless()
+{
+	using clock = std::chrono::steady_clock;
+
+	// sleeps are only as precise as the OS scheduler, so we wake up this much early and yield the rest of the way
+	constexpr std::chrono::microseconds sleepSlack{ 2000 };
+
+	clock::duration tickDuration = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / m_tickRate));
+	clock::time_point deadline = clock::now();
+
+	std::vector<float> tickTimes;
+	tickTimes.reserve(e2::tickMetricsWindow);
+	uint32_t numLateTicks{};
+
+	LogNotice("Running headless at {} ticks per second", m_tickRate);
+
+	e2::Moment lastTickStart;
+	while (m_running)
+	{
+		deadline += tickDuration;
+
+		e2::Moment tickStart = e2::timeNow();
+		double deltaTime = (tickStart - lastTickStart).seconds();
+		lastTickStart = tickStart;
+
+		tick(deltaTime);
+
+		tickTimes.push_back((float)tickStart.durationSince().milliseconds());
+
+		clock::time_point now = clock::now();
+		if (now > deadline)
+		{
+			numLateTicks++;
+
+			// if we fell more than a tick behind, don't try to catch up with a burst of ticks, just start over from here
+			if (now - deadline > tickDuration)
+				deadline = now;
+		}
+		else
+		{
+			if (deadline - now > sleepSlack)
+				std::this_thread::sleep_until(deadline - sleepSlack);
+
+			while (clock::now() < deadline)
+				std::this_thread::yield();
+		}
+
+		if (tickTimes.size() >= e2::tickMetricsWindow)
+		{
+			std::sort(tickTimes.begin(), tickTimes.end());
+			m_tickMetrics.tickTimeMsP50 = tickTimes[tickTimes.size() / 2];
+			m_tickMetrics.tickTimeMsP90 = tickTimes[tickTimes.size() * 90 / 100];
+			m_tickMetrics.tickTimeMsP99 = tickTimes[tickTimes.size() * 99 / 100];
+			m_tickMetrics.tickTimeMsHigh = tickTimes.back();
+			m_tickMetrics.numLateTicks = numLateTicks;
+
+			LogNotice("Tick time p50 {:.3f}ms, p90 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms, {} of {} ticks late (budget {:.3f}ms)", 
+				m_tickMetrics.tickTimeMsP50, m_tickMetrics.tickTimeMsP90, m_tickMetrics.tickTimeMsP99, m_tickMetrics.tickTimeMsHigh, 
+				numLateTicks, tickTimes.size(), 1000.0 / m_tickRate);
+
+			tickTimes.clear();
+			numLateTicks = 0;
+		}
+
+		e2::ManagedObject::keepAroundTick();
+	}
+}
+
+void e2::Engine::runWindowed()
+{
 	e2::Moment lastFrameStart;
 	double deltaTime{};
-	m_running = true;
 
 	constexpr double targetMsPerFrame = 6.944444444444444; // 144 fps
 	//constexpr double targetMsPerFrame = 3.33333333333; // 300 fps
 
-
-	m_application->initialize();
-
 	e2::Moment lastMetricsProbe;
 
 	while (m_running)
@@ -100,25 +259,7 @@ void e2::Engine::run(e2::Application* app)
 			m_profiler->newFrame();
 #endif
 
-			E2_BEGIN_SCOPE(Default);
-			m_networkManager->update(deltaTime);
-			m_asyncManager->update(deltaTime);
-			m_assetManager->update(deltaTime);
-			m_audioManager->update(deltaTime);
-			m_renderManager->update(deltaTime);
-			m_uiManager->update(deltaTime);
-			
-			m_gameManager->preUpdate(deltaTime);
-
-			m_application->update(deltaTime);
-
-			m_gameManager->update(deltaTime);
-
-			// Only dispatch render stuff if we are actually still running
-			if (m_running)
-				m_renderManager->dispatch();
-
-			E2_END_SCOPE();
+			tick(deltaTime);
 
 #if defined(E2_PROFILER)
 			m_metrics.frameTimeMs[m_metrics.cursor] = (float)lastFrameStart.durationSince().milliseconds();
@@ -165,36 +306,6 @@ void e2::Engine::run(e2::Application* app)
 			e2::ManagedObject::keepAroundTick();
 		}
 	}
-
-	// waits for all render commands to have completed 
-	m_renderManager->renderContext()->waitIdle();
-
-	// stops running all async threads, and joins them 
-	m_asyncManager->shutdown();
-	
-	// shutdown application
-	m_application->shutdown();
-
-	// prune all disposed and lingering objects
-	e2::ManagedObject::keepAroundPrune();
-
-	m_gameManager->shutdown();
-
-	m_networkManager->shutdown();
-
-	m_audioManager->shutdown();
-
-	m_assetManager->shutdown();
-
-	e2::ManagedObject::keepAroundPrune();
-
-	m_uiManager->shutdown();
-	m_renderManager->shutdown();
-
-	e2::ManagedObject::keepAroundPrune();
-
-	m_typeManager->shutdown();
-
 }
 
 void e2::Engine::shutdown()
@@ -208,159 +319,4 @@ e2::EngineMetrics& e2::Engine::metrics()
 	return m_metrics;
 
 }
-
-e2::Profiler::Profiler()
-{
-	m_groups.resize(size_t(e2::ProfileGroupId::Count));
-
-	m_groups[size_t(e2::ProfileGroupId::Default)].displayName = "Default";
-	m_groups[size_t(e2::ProfileGroupId::Animation)].displayName = "Animation";
-	m_groups[size_t(e2::ProfileGroupId::Rendering)].displayName = "Rendering";
-	m_groups[size_t(e2::ProfileGroupId::Scripting)].displayName = "Scripting";
-}
-
-void e2::Profiler::start()
-{
-	if (m_enabled)
-		return;
-
-
-	for (uint8_t i = 0; i < uint8_t(e2::ProfileGroupId::Count); i++)
-	{
-		e2::ProfileGroup* grp = &m_groups[i];
-		grp->highTimeInFrame = 0.0;
-
-		grp->avgTimeInFrame = 0.0;
-		grp->timeInFrame = 0.0;
-	}
-
-	m_functions.clear();
-	m_stack.clear();
-	m_enabled = true;
-	m_numFrames = 0;
-}
-
-void e2::Profiler::stop()
-{
-	m_enabled = false;
-}
-
-void e2::Profiler::newFrame()
-{
-	if (!m_enabled)
-		return;
-
-	if (!m_stack.empty())
-	{
-		LogError("Mismatching profiler scope brackets; new frame but we got stuff on stack.");
-		m_stack.clear();
-	}
-
-	for (auto& [id, function] : m_functions)
-	{
-		e2::ProfileFunction* func = &function;
-		
-		if (func->timeInFrame > func->highTimeInFrame)
-			func->highTimeInFrame = func->timeInFrame;
-
-		func->avgTimeInFrame = (double(m_numFrames) * func->avgTimeInFrame + func->timeInFrame) / (double(m_numFrames) + 1.0);
-
-		func->timeInFrame = 0.0;
-	}
-
-	for (uint8_t i = 0; i < uint8_t(e2::ProfileGroupId::Count); i++)
-	{
-		e2::ProfileGroup* grp = &m_groups[i];
-		if (grp->timeInFrame > grp->highTimeInFrame)
-			grp->highTimeInFrame = grp->timeInFrame;
-
-		grp->avgTimeInFrame = (double(m_numFrames) * grp->avgTimeInFrame + grp->timeInFrame) / (double(m_numFrames) + 1.0);
-		grp->timeInFrame = 0.0;
-	}
-
-	m_numFrames++;
-}
-
-void e2::Profiler::beginScope(std::string const& funcId, std::string const& funcDisplayName, e2::ProfileGroupId groupId)
-{
-	if (!m_enabled)
-		return;
-
-
-	if (!m_stack.empty())
-	{
-		e2::ProfileScope& top = m_stack.back();
-		top.closeScope();
-	}
-
-	e2::ProfileFunction* func{};
-	auto finder = m_functions.find(funcId);
-	if (finder == m_functions.end())
-	{
-		e2::ProfileFunction newFunc;
-		newFunc.displayName = funcDisplayName;
-		newFunc.functionId = funcId;
-
-		m_functions[funcId] = newFunc;
-		func = &m_functions.at(funcId);
-	}
-	else
-	{
-		func = &finder->second;
-	}
-
-	e2::ProfileScope newScope;
-	newScope.groupId = groupId;
-	newScope.function = func;
-	newScope.openScope();
-	m_stack.push(newScope);
-}
-
-void e2::Profiler::endScope()
-{
-	if (!m_enabled)
-		return;
-
-	if (m_stack.empty())
-	{
-		LogError("Mismatching profiler scope brackets; ended scope but we ain't got none.");
-		return;
-	}
-
-	e2::ProfileScope& top = m_stack.back();
-	top.closeScope();
-	double secondsInScope = top.secondsInScope;
-	m_stack.pop();
-
-	e2::ProfileGroup* grp = &m_groups[size_t(top.groupId)];
-	grp->timeInFrame += secondsInScope;
-
-	top.function->timeInFrame += secondsInScope;
-	top.function->timeInScope += secondsInScope;
-	if (secondsInScope > top.function->highTimeInScope)
-		top.function->highTimeInScope = secondsInScope;
-	top.function->avgTimeInScope = (double(top.function->timesInScope) * top.function->avgTimeInScope + secondsInScope) / (double(top.function->timesInScope) + 1.0);
-
-	top.function->timesInScope++;
-
-	if (!m_stack.empty())
-	{
-		e2::ProfileScope& top = m_stack.back();
-		top.openScope();
-	}
-}
-
-e2::ProfileReport e2::Profiler::report()
-{
-	e2::ProfileReport returner;
-	for (auto& [id, func] : m_functions)
-	{
-		returner.functions.push_back(func);
-	}
-	std::sort(returner.functions.begin(), returner.functions.end(), [](e2::ProfileFunction const& lhs, e2::ProfileFunction const& rhs) -> bool { return lhs.avgTimeInFrame > rhs.avgTimeInFrame;  });
-
-	returner.groups = m_groups;
-	
-	return returner;
-}
 #endif
\ No newline at end of file
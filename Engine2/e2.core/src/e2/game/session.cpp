@@ -13,8 +13,71 @@
 
 #include "e2/renderer/meshproxy.hpp"
 
+#include <algorithm>
+
+e2::SkinPaletteAllocator::SkinPaletteAllocator(uint32_t capacity, uint32_t alignment)
+	: m_alignment(glm::max(alignment, 1U))
+{
+	m_capacity = (capacity / m_alignment) * m_alignment;
+	m_freeRanges.push_back({ 0, m_capacity });
+}
+
+uint32_t e2::SkinPaletteAllocator::allocate(uint32_t size)
+{
+	// every offset is a multiple of alignment, so rounding sizes up keeps it that way
+	size = ((size + m_alignment - 1) / m_alignment) * m_alignment;
+
+	for (uint32_t i = 0; i < m_freeRanges.size(); i++)
+	{
+		Range& range = m_freeRanges[i];
+		if (range.size < size)
+			continue;
+
+		uint32_t offset = range.offset;
+		range.offset += size;
+		range.size -= size;
+		if (range.size == 0)
+			m_freeRanges.erase(m_freeRanges.begin() + i);
+
+		m_used += size;
+		return offset;
+	}
+
+	return UINT32_MAX;
+}
+
+void e2::SkinPaletteAllocator::free(uint32_t offset, uint32_t size)
+{
+	size = ((size + m_alignment - 1) / m_alignment) * m_alignment;
+	m_used -= size;
+
+	auto it = std::lower_bound(m_freeRanges.begin(), m_freeRanges.end(), offset, [](Range const& range, uint32_t value) {
+		return range.offset < value;
+	});
+	it = m_freeRanges.insert(it, { offset, size });
+
+	// merge with next, then with previous
+	auto next = it + 1;
+	if (next != m_freeRanges.end() && it->offset + it->size == next->offset)
+	{
+		it->size += next->size;
+		it = m_freeRanges.erase(next) - 1;
+	}
+
+	if (it != m_freeRanges.begin())
+	{
+		auto prev = it - 1;
+		if (prev->offset + prev->size == it->offset)
+		{
+			prev->size += it->size;
+			m_freeRanges.erase(it);
+		}
+	}
+}
+
 e2::Session::Session(e2::Context* ctx)
 	: m_engine(ctx->engine())
+	, m_skinPalettes(e2::maxNumSkinPaletteBones * e2::skinPaletteBoneSize, renderManager()->paddedBufferSize(1))
 {
 	m_meshProxies.reserve(1024);
 	//m_submeshIndex.reserve(2048);
@@ -26,9 +89,10 @@ e2::Session::Session(e2::Context* ctx)
 	m_modelBuffers[0] = renderContext()->createDataBuffer(bufferCreateInfo);
 	m_modelBuffers[1] = renderContext()->createDataBuffer(bufferCreateInfo);
 
-	uint64_t skinDataSize = sizeof(glm::mat4) * e2::maxNumSkeletonBones;
+	// the shader sees a full maxNumSkeletonBones palette from any offset, so leave room for that after the last one
+	uint64_t skinDataSize = e2::skinPaletteBoneSize * e2::maxNumSkeletonBones;
 
-	bufferCreateInfo.size = renderManager()->paddedBufferSize((uint32_t)skinDataSize * e2::maxNumSkinProxies);
+	bufferCreateInfo.size = renderManager()->paddedBufferSize(m_skinPalettes.capacity() + (uint32_t)skinDataSize);
 	m_skinBuffers[0] = renderContext()->createDataBuffer(bufferCreateInfo);
 	m_skinBuffers[1] = renderContext()->createDataBuffer(bufferCreateInfo);
 
@@ -95,18 +159,36 @@ void e2::Session::tick(double seconds)
 			uint32_t proxyOffset = renderManager()->paddedBufferSize(sizeof(glm::mat4)) * proxy->id;
 			m_modelBuffers[frameIndex]->upload(reinterpret_cast<uint8_t const*>(&proxy->modelMatrix), sizeof(glm::mat4), 0, proxyOffset);
 		}
+
+		if (proxy->instancesDirty[frameIndex])
+		{
+			proxy->instancesDirty[frameIndex] = false;
+
+			uint32_t numInstances = (uint32_t)proxy->instances.size();
+			if (numInstances > 0)
+				proxy->instanceBuffers[frameIndex]->upload(reinterpret_cast<uint8_t const*>(proxy->instances.data()), sizeof(e2::InstanceData) * numInstances, 0, 0);
+
+			proxy->numInstances[frameIndex] = numInstances;
+		}
 	}
 
+	glm::vec4 palette[e2::maxNumSkeletonBones * 3];
 	for (e2::SkinProxy* proxy : m_skinProxies)
 	{
 		if (proxy->skinDirty[frameIndex])
 		{
 			proxy->skinDirty[frameIndex] = false;
 
-			// @todo if we ever change model buffers from being dynamic, we need to optimize these uploads
-			// right now it's fine as theyre just mapped memcpys
-			uint32_t proxyOffset = renderManager()->paddedBufferSize(sizeof(glm::mat4) * e2::maxNumSkeletonBones) * proxy->id;
-			m_skinBuffers[frameIndex]->upload(reinterpret_cast<uint8_t const*>(&proxy->skin[0]), sizeof(glm::mat4) * e2::maxNumSkeletonBones, 0, proxyOffset);
+			// only the bones the mesh uses, and only the rows that aren't constant
+			for (uint32_t i = 0; i < proxy->numBones; i++)
+			{
+				glm::mat4 const& bone = proxy->skin[i];
+				palette[i * 3 + 0] = glm::vec4(bone[0][0], bone[1][0], bone[2][0], bone[3][0]);
+				palette[i * 3 + 1] = glm::vec4(bone[0][1], bone[1][1], bone[2][1], bone[3][1]);
+				palette[i * 3 + 2] = glm::vec4(bone[0][2], bone[1][2], bone[2][2], bone[3][2]);
+			}
+
+			m_skinBuffers[frameIndex]->upload(reinterpret_cast<uint8_t const*>(&palette[0]), e2::skinPaletteBoneSize * proxy->numBones, 0, proxy->paletteOffset);
 		}
 	}
 
@@ -179,6 +261,13 @@ uint32_t e2::Session::registerSkinProxy(e2::SkinProxy* proxy)
 		return UINT32_MAX;
 	}
 
+	proxy->paletteOffset = m_skinPalettes.allocate(e2::skinPaletteBoneSize * proxy->numBones);
+	if (proxy->paletteOffset == UINT32_MAX)
+	{
+		LogError("skin palettes full, {} of {} bytes used", m_skinPalettes.used(), m_skinPalettes.capacity());
+		return UINT32_MAX;
+	}
+
 	m_skinProxies.insert(proxy);
 
 	return m_skinIds.create();
@@ -187,6 +276,7 @@ uint32_t e2::Session::registerSkinProxy(e2::SkinProxy* proxy)
 void e2::Session::unregisterSkinProxy(e2::SkinProxy* proxy)
 {
 	m_skinIds.destroy(proxy->id);
+	m_skinPalettes.free(proxy->paletteOffset, e2::skinPaletteBoneSize * proxy->numBones);
 
 	m_skinProxies.erase(proxy);
 }
@@ -202,6 +292,11 @@ std::unordered_set<e2::MeshProxyLODEntry> const& e2::Session::shadowSubmeshes()
 	return m_shadowSubmeshes;
 }
 
+std::unordered_set<e2::MeshProxy*> const& e2::Session::meshProxies() const
+{
+	return m_meshProxies;
+}
+
 e2::IDescriptorSet* e2::Session::getModelSet(uint8_t frameIndex)
 {
 	return m_modelSets[frameIndex];
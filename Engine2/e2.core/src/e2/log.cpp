@@ -2,6 +2,15 @@
 #include "e2/log.hpp"
 
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 
 #include <iostream>
 #include <fstream>
@@ -9,8 +18,227 @@
 
 namespace
 {
-	std::recursive_mutex logMutex;
-	std::ofstream outHandle;
+	static_assert((e2::logQueueSize & (e2::logQueueSize - 1)) == 0, "logQueueSize has to be a power of two");
+
+	/** Single producer (the thread it belongs to), single consumer (the writer) ring of entries */
+	struct LogQueue
+	{
+		e2::LogEntry entries[e2::logQueueSize];
+
+		alignas(64) std::atomic<uint64_t> head{};
+		alignas(64) std::atomic<uint64_t> tail{};
+	};
+
+	struct LogState
+	{
+		std::atomic<uint8_t> minSeverity{ 0 };
+		std::atomic<e2::LogOverflow> overflow{ e2::LogOverflow::Block };
+		std::atomic<uint64_t> nextSequence{};
+		std::atomic<uint64_t> dropped{};
+
+		std::once_flag startFlag;
+		std::atomic<bool> running{};
+		std::atomic<bool> pending{};
+
+		// wakes the writer, and the threads waiting for it to flush
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable flushed;
+		uint64_t flushRequested{};
+		uint64_t flushCompleted{};
+		bool stopped{};
+
+		// queues of every thread that has logged, dropped by the writer once their thread is gone and they are empty
+		std::mutex queuesMutex;
+		std::vector<std::shared_ptr<LogQueue>> queues;
+
+		// only touched by the writer, or by whoever writes directly once it is shut down
+		std::mutex outputMutex;
+		std::vector<std::shared_ptr<LogQueue>> drainQueues;
+		std::vector<e2::LogEntry> batch;
+		std::string text;
+		std::ofstream outHandle;
+
+		// set by testLog, takes the entries whose message starts with captureTag instead of writing them
+		std::vector<e2::LogEntry>* capture{};
+
+		std::recursive_mutex historyMutex;
+		std::deque<e2::LogEntry> history;
+		std::atomic<uint64_t> numWritten{};
+	};
+
+	/** Prefix of the messages testLog logs from its threads, nothing else is captured */
+	constexpr std::string_view captureTag = "[logtest] ";
+
+	// Never destroyed, threads may still log while statics are torn down
+	LogState& state()
+	{
+		static LogState* instance = new LogState();
+		return *instance;
+	}
+
+	thread_local std::shared_ptr<LogQueue> localQueue;
+
+	LogQueue& threadQueue(LogState& s)
+	{
+		if (!localQueue)
+		{
+			localQueue = std::make_shared<LogQueue>();
+			std::scoped_lock lock(s.queuesMutex);
+			s.queues.push_back(localQueue);
+		}
+
+		return *localQueue;
+	}
+
+	std::string_view severityName(e2::Severity severity)
+	{
+		if (severity == e2::Severity::Warning)
+			return "Warning";
+		else if (severity == e2::Severity::Error)
+			return "Error";
+		return "Notice";
+	}
+
+	std::string_view filename(char const* file)
+	{
+		std::string_view path(file);
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string_view::npos ? path : path.substr(separator + 1);
+	}
+
+	/** Writes out s.batch, in the order it's in. Caller holds s.outputMutex */
+	void writeBatch(LogState& s)
+	{
+		if (s.capture)
+		{
+			auto captured = std::stable_partition(s.batch.begin(), s.batch.end(), [](e2::LogEntry const& entry) {
+				return !entry.message.starts_with(captureTag);
+			});
+			std::move(captured, s.batch.end(), std::back_inserter(*s.capture));
+			s.batch.erase(captured, s.batch.end());
+		}
+
+		if (s.batch.empty())
+			return;
+
+		s.text.clear();
+		for (e2::LogEntry const& entry : s.batch)
+			std::format_to(std::back_inserter(s.text), "{} in {} ({}:{}): {}\n", severityName(entry.severity), entry.function, filename(entry.file), entry.line, entry.message);
+
+		// one write and one flush per batch, rather than per line
+		std::cout.write(s.text.data(), s.text.size());
+		std::cout.flush();
+
+		if (!s.outHandle.is_open())
+		{
+			s.outHandle.open("e2.log");
+		}
+
+		s.outHandle.write(s.text.data(), s.text.size());
+		s.outHandle.flush();
+
+		std::scoped_lock lock(s.historyMutex);
+		for (e2::LogEntry& entry : s.batch)
+		{
+			if (s.history.size() >= e2::maxNumLogHistory)
+				s.history.pop_front();
+
+			s.history.push_back(std::move(entry));
+			s.numWritten.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/** Moves everything queued so far into one batch and writes it out, returns false if there was nothing. Caller holds s.outputMutex */
+	bool drain(LogState& s)
+	{
+		{
+			std::scoped_lock lock(s.queuesMutex);
+			std::erase_if(s.queues, [](std::shared_ptr<LogQueue> const& queue) {
+				return queue.use_count() == 1 && queue->head.load(std::memory_order_acquire) == queue->tail.load(std::memory_order_relaxed);
+			});
+			s.drainQueues = s.queues;
+		}
+
+		s.batch.clear();
+		for (std::shared_ptr<LogQueue> const& queue : s.drainQueues)
+		{
+			uint64_t head = queue->head.load(std::memory_order_acquire);
+			uint64_t tail = queue->tail.load(std::memory_order_relaxed);
+			for (; tail < head; tail++)
+				s.batch.push_back(std::move(queue->entries[tail & (e2::logQueueSize - 1)]));
+
+			queue->tail.store(tail, std::memory_order_release);
+		}
+		s.drainQueues.clear();
+
+		if (s.batch.empty())
+			return false;
+
+		// each queue is in order already, this interleaves the threads the way they wrote
+		std::sort(s.batch.begin(), s.batch.end(), [](e2::LogEntry const& a, e2::LogEntry const& b) {
+			return a.sequence < b.sequence;
+		});
+
+		writeBatch(s);
+		return true;
+	}
+
+	void wakeWriter(LogState& s)
+	{
+		if (!s.pending.exchange(true, std::memory_order_acq_rel))
+			s.wake.notify_one();
+	}
+
+	void writerThread(LogState* s)
+	{
+		while (true)
+		{
+			uint64_t flushRequest{};
+			bool stopping{};
+			{
+				std::unique_lock lock(s->mutex);
+
+				// idle writers still check in every few milliseconds, producers only wake it when they fill up or log errors
+				s->wake.wait_for(lock, std::chrono::milliseconds(5), [s]() {
+					return !s->running.load() || s->pending.load() || s->flushRequested > s->flushCompleted;
+				});
+
+				s->pending.store(false);
+				flushRequest = s->flushRequested;
+				stopping = !s->running.load();
+			}
+
+			{
+				std::scoped_lock lock(s->outputMutex);
+				while (drain(*s));
+			}
+
+			std::unique_lock lock(s->mutex);
+			if (flushRequest > s->flushCompleted)
+			{
+				s->flushCompleted = flushRequest;
+				s->flushed.notify_all();
+			}
+
+			if (stopping)
+			{
+				s->stopped = true;
+				s->flushed.notify_all();
+				return;
+			}
+		}
+	}
+
+	void writeDirect(LogState& s, e2::LogEntry&& entry)
+	{
+		std::scoped_lock lock(s.outputMutex);
+		while (drain(s));
+
+		s.batch.clear();
+		s.batch.push_back(std::move(entry));
+		writeBatch(s);
+	}
 }
 
 std::string e2::Log::formatFilepath(std::string const& filePath)
@@ -18,60 +246,289 @@ std::string e2::Log::formatFilepath(std::string const& filePath)
 	return std::filesystem::path(filePath).filename().string();
 }
 
-namespace
+void e2::Log::write(e2::Severity severity, char const* function, char const* file, uint32_t line, std::string message)
 {
-	std::vector<e2::LogEntry> logEntries;
-}
+	LogState& s = ::state();
 
-void e2::Log::write(e2::Severity severity, std::string const& function, std::string const& file, uint32_t line, std::string const& message)
-{
-	std::scoped_lock lock(::logMutex);
+	std::call_once(s.startFlag, [&s]() {
+		s.running.store(true);
+		std::thread(::writerThread, &s).detach();
+	});
 
 	e2::LogEntry newEntry;
 	newEntry.severity = severity;
 	newEntry.function = function;
 	newEntry.file = file;
 	newEntry.line = line;
-	newEntry.message = message;
+	newEntry.sequence = s.nextSequence.fetch_add(1, std::memory_order_relaxed);
+	newEntry.message = std::move(message);
+
+	if (!s.running.load(std::memory_order_acquire))
+	{
+		::writeDirect(s, std::move(newEntry));
+		return;
+	}
+
+	LogQueue& queue = ::threadQueue(s);
+	uint64_t head = queue.head.load(std::memory_order_relaxed);
+	while (head - queue.tail.load(std::memory_order_acquire) >= e2::logQueueSize)
+	{
+		::wakeWriter(s);
+
+		if (severity != e2::Severity::Error && s.overflow.load(std::memory_order_relaxed) == e2::LogOverflow::Drop)
+		{
+			s.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		if (!s.running.load(std::memory_order_acquire))
+		{
+			::writeDirect(s, std::move(newEntry));
+			return;
+		}
+
+		std::this_thread::yield();
+	}
+
+	queue.entries[head & (e2::logQueueSize - 1)] = std::move(newEntry);
+	queue.head.store(head + 1, std::memory_order_release);
+
+	if (severity == e2::Severity::Error || head - queue.tail.load(std::memory_order_relaxed) >= e2::logQueueSize / 2)
+		::wakeWriter(s);
+}
+
+bool e2::Log::enabled(e2::Severity severity)
+{
+	return uint8_t(severity) >= ::state().minSeverity.load(std::memory_order_relaxed);
+}
+
+void e2::Log::setMinSeverity(e2::Severity severity)
+{
+	::state().minSeverity.store(uint8_t(severity));
+}
 
-	logEntries.push_back(newEntry);
+e2::Severity e2::Log::minSeverity()
+{
+	return e2::Severity(::state().minSeverity.load());
+}
 
-	std::string severityStr;
-	if (severity == Severity::Notice)
-		severityStr = "Notice";
-	else if (severity == Severity::Warning)
-		severityStr = "Warning";
-	else if (severity == Severity::Error)
-		severityStr = "Error";
+void e2::Log::setOverflow(e2::LogOverflow overflow)
+{
+	::state().overflow.store(overflow);
+}
 
-	std::string output = std::format("{} in {} ({}:{}): {}", severityStr, function, e2::Log::formatFilepath(file), line, message);
+uint64_t e2::Log::numDropped()
+{
+	return ::state().dropped.load();
+}
 
-	std::cout << output << std::endl;
+void e2::Log::flush()
+{
+	LogState& s = ::state();
+	if (!s.running.load())
+		return;
+
+	std::unique_lock lock(s.mutex);
+	uint64_t request = ++s.flushRequested;
+	s.wake.notify_one();
+	s.flushed.wait(lock, [&s, request]() {
+		return s.flushCompleted >= request || s.stopped;
+	});
+}
+
+void e2::Log::shutdown()
+{
+	LogState& s = ::state();
+	if (!s.running.exchange(false))
+		return;
 
-	if (!outHandle.is_open())
 	{
-		outHandle.open("e2.log");
+		std::unique_lock lock(s.mutex);
+		s.wake.notify_one();
+		s.flushed.wait(lock, [&s]() {
+			return s.stopped;
+		});
 	}
 
-	outHandle << output << std::endl;
+	// anything that made it into a queue while the writer was on its way out
+	std::scoped_lock lock(s.outputMutex);
+	while (::drain(s));
 }
 
 uint32_t e2::Log::numEntries()
 {
-	return (uint32_t)::logEntries.size();
+	LogState& s = ::state();
+	std::scoped_lock lock(s.historyMutex);
+	return (uint32_t)s.history.size();
 }
 
 e2::LogEntry const& e2::Log::getEntry(uint32_t id)
 {
-	return ::logEntries[id];
+	return ::state().history[id];
+}
+
+uint64_t e2::Log::numWritten()
+{
+	return ::state().numWritten.load(std::memory_order_relaxed);
 }
 
 void e2::Log::clear()
 {
-	::logEntries.clear();
+	LogState& s = ::state();
+	std::scoped_lock lock(s.historyMutex);
+	s.history.clear();
 }
 
 std::recursive_mutex& e2::Log::getMutex()
 {
-	return ::logMutex;
+	return ::state().historyMutex;
+}
+
+namespace
+{
+	/** Logs numThreads * numMessages notices, messages are captureTag followed by "<thread> <index>". Returns the seconds it took to write them all (not to get them out) */
+	double logFromThreads(uint32_t numThreads, uint32_t numMessages)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([t, numMessages]() {
+				for (uint32_t i = 0; i < numMessages; i++)
+					LogNotice("{}{} {}", captureTag, t, i);
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/** Checks the captured entries of each thread are in the order it wrote them, and counts them. Threads only interleave in order within a batch */
+	bool checkCaptured(std::vector<e2::LogEntry> const& captured, uint32_t numThreads, uint32_t numMessages, uint64_t& outCount)
+	{
+		std::vector<int64_t> lastIndex(numThreads, -1);
+		std::vector<uint64_t> lastSequence(numThreads, 0);
+		outCount = 0;
+
+		for (e2::LogEntry const& entry : captured)
+		{
+			uint32_t thread{}, index{};
+			char const* begin = entry.message.data() + captureTag.size();
+			char const* end = begin + entry.message.size();
+			std::from_chars_result parsed = std::from_chars(begin, end, thread);
+			if (parsed.ec == std::errc())
+				parsed = std::from_chars(parsed.ptr + 1, end, index);
+
+			if (parsed.ec != std::errc() || thread >= numThreads || index >= numMessages)
+			{
+				LogError("unexpected log entry \"{}\"", entry.message);
+				return false;
+			}
+
+			if (int64_t(index) <= lastIndex[thread])
+			{
+				LogError("thread {} wrote {} after {}", thread, index, lastIndex[thread]);
+				return false;
+			}
+
+			if (lastIndex[thread] >= 0 && entry.sequence <= lastSequence[thread])
+			{
+				LogError("thread {} entry {} written after {}", thread, entry.sequence, lastSequence[thread]);
+				return false;
+			}
+
+			lastIndex[thread] = index;
+			lastSequence[thread] = entry.sequence;
+			outCount++;
+		}
+
+		return true;
+	}
+}
+
+bool e2::testLog()
+{
+	LogState& s = ::state();
+	bool success = true;
+
+	// disabled severities don't evaluate their arguments
+	e2::Severity oldSeverity = e2::Log::minSeverity();
+	e2::Log::setMinSeverity(e2::Severity::Warning);
+	uint32_t evaluated{};
+	LogNotice("{}", ++evaluated);
+	e2::Log::setMinSeverity(oldSeverity);
+
+	if (evaluated != 0)
+	{
+		LogError("filtered notice still formatted its message");
+		success = false;
+	}
+
+	constexpr uint32_t numThreads = 8;
+	constexpr uint32_t numMessages = 20000;
+	constexpr uint64_t numTotal = uint64_t(numThreads) * numMessages;
+
+	// the writer fills these under s.outputMutex, so they are only ours again once capture has been switched away from them under it too
+	std::vector<e2::LogEntry> blockedEntries;
+	std::vector<e2::LogEntry> droppedEntries;
+	blockedEntries.reserve(numTotal);
+	droppedEntries.reserve(numTotal);
+
+	e2::Log::flush();
+	{
+		std::scoped_lock lock(s.outputMutex);
+		s.capture = &blockedEntries;
+	}
+
+	// blocking, nothing may be lost
+	double blockSeconds = ::logFromThreads(numThreads, numMessages);
+	e2::Log::flush();
+	{
+		std::scoped_lock lock(s.outputMutex);
+		s.capture = &droppedEntries;
+	}
+
+	// dropping, whatever is missing has to be counted
+	uint64_t droppedBefore = e2::Log::numDropped();
+	e2::Log::setOverflow(e2::LogOverflow::Drop);
+	double dropSeconds = ::logFromThreads(numThreads, numMessages);
+	e2::Log::flush();
+	e2::Log::setOverflow(e2::LogOverflow::Block);
+	uint64_t numDropped = e2::Log::numDropped() - droppedBefore;
+
+	{
+		std::scoped_lock lock(s.outputMutex);
+		s.capture = nullptr;
+	}
+	e2::Log::flush();
+
+	// only report once nothing is captured anymore, or the errors would vanish with the rest
+	uint64_t numBlocked{};
+	if (!::checkCaptured(blockedEntries, numThreads, numMessages, numBlocked))
+		success = false;
+	else if (numBlocked != numTotal)
+	{
+		LogError("lost {} of {} entries while blocking", numTotal - numBlocked, numTotal);
+		success = false;
+	}
+
+	uint64_t numKept{};
+	if (!::checkCaptured(droppedEntries, numThreads, numMessages, numKept))
+		success = false;
+	else if (numKept + numDropped != numTotal)
+	{
+		LogError("{} kept and {} dropped of {} entries", numKept, numDropped, numTotal);
+		success = false;
+	}
+
+	LogNotice("{} threads logged {} entries in {:.1f} ms blocking ({:.2f}M/s), {:.1f} ms dropping ({:.2f}M/s, {} dropped)", numThreads, numTotal,
+		blockSeconds * 1000.0, double(numTotal) / blockSeconds / 1e6, dropSeconds * 1000.0, double(numTotal) / dropSeconds / 1e6, numDropped);
+
+	if (success)
+		LogNotice("log tests passed");
+
+	return success;
 }
@@ -1,6 +1,7 @@
 
 #include "e2/managers/asyncmanager.hpp"
 #include "e2/timer.hpp"
+#include "e2/profiler.hpp"
 #include <glm/glm.hpp>
 
 
@@ -81,6 +82,8 @@ void e2::AsyncManager::update(double deltaTime)
 		m_queue.swap(m_queueSwap);
 	}
 
+	E2_PROFILE_COUNTER("Async tasks queued", m_queueSwap.size());
+
 	for (e2::AsyncTaskPtr task : m_queueSwap)
 	{
 		task->prepare();
@@ -175,6 +178,10 @@ void e2::AsyncThread::run()
 {
 	m_thread = std::thread([this]() {
 		m_running = true;
+
+#if defined(E2_PROFILER)
+		profiler()->setThreadName(std::format("Async {}", m_name.cstring()));
+#endif
 		uint64_t framesSinceActivity{};
 
 		std::vector<e2::AsyncTaskPtr> incomingSwap;
@@ -198,7 +205,13 @@ void e2::AsyncThread::run()
 			{
 				task->setThreadName(m_name);
 				asyncTimer.reset();
-				task->execute();
+				{
+#if defined(E2_PROFILER)
+					// named after the task type, type names live as long as the profiler
+					e2::ProfileBlock taskBlock(profiler(), e2::ProfileMarker{ task->type()->fqn.cstring(), e2::ProfileGroupId::Async });
+#endif
+					task->execute();
+				}
 				task->setAsyncTime(asyncTimer.seconds() * 1000.0);
 
 				{
@@ -1,5 +1,19 @@
 #include <e2/managers/networkmanager.hpp>
 
+#include <thread>
+#include <chrono>
+#include <random>
+#include <bit>
+#include <algorithm>
+#include <cmath>
+
+#if !defined(_WIN64)
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#endif
+
 
 
 
@@ -9,233 +23,485 @@
 
 namespace
 {
-	static void s_networkThread(e2::NetworkManager* manager)
+	/** Error code of the last failed socket call, for logging */
+	static int32_t s_socketError()
+	{
+#if defined(_WIN64)
+		return WSAGetLastError();
+#else
+		return errno;
+#endif
+	}
+
+	static bool s_socketWouldBlock(int32_t error)
 	{
-		e2::StackVector<uint8_t, 1024> recvBuff;
+#if defined(_WIN64)
+		return error == WSAEWOULDBLOCK;
+#else
+		return error == EWOULDBLOCK || error == EAGAIN;
+#endif
+	}
 
+	/** Makes socket non-blocking, and gives it a receive buffer that holds a full burst of frames while the network thread wakes up */
+	static void s_configureSocket(e2::NetSocket socket)
+	{
+#if defined(_WIN64)
+		u_long mode = 1; // 1 = non-blocking, 0 = blocking
+		ioctlsocket(socket, FIONBIO, &mode);
+#else
+		fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
 
-		while (manager->threadRunning())
-		{
+		// linux defaults to ~200KB, which a few hundred frames in flight overflow. The OS caps this (net.core.rmem_max on linux), and that is fine
+		int32_t receiveBufferSize = 4 * 1024 * 1024;
+		setsockopt(socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<char const*>(&receiveBufferSize), sizeof(receiveBufferSize));
+	}
+
+	static void s_closeSocket(e2::NetSocket socket)
+	{
 #if defined(_WIN64)
+		closesocket(socket);
+#else
+		close(socket);
+#endif
+	}
+
+	/** Writes fragment as a frame to buffer (netFrameSize bytes), returns its size */
+	static uint64_t s_writeFrame(e2::NetFragment const& fragment, uint8_t* buffer)
+	{
+		uint64_t fullSize = 2;
+		if (fragment.frameType == e2::NetFrameType::DataFragment)
+			fullSize = e2::netFragmentHeaderSize + fragment.fragmentSize;
+		else if (fragment.frameType == e2::NetFrameType::Ack)
+			fullSize = e2::netAckFrameSize;
+
+		e2::RawMemoryStream rawStream(buffer, fullSize, true);
+		rawStream << uint8_t(fragment.frameType);
+		rawStream << uint8_t(fragment.frameFlags);
+
+		if (fragment.frameType == e2::NetFrameType::DataFragment)
+		{
+			rawStream << fragment.packetId;
+			rawStream << fragment.fragmentIndex;
+			rawStream << fragment.numFragments;
+			rawStream << fragment.fragmentSize;
+			rawStream << uint8_t(fragment.channel);
+			rawStream << fragment.sequence;
+			rawStream << fragment.ack;
+			rawStream << fragment.ackBits;
+			rawStream.write(fragment.fragmentPayload, fragment.fragmentSize);
+		}
+		else if (fragment.frameType == e2::NetFrameType::Ack)
+		{
+			rawStream << fragment.ack;
+			rawStream << fragment.ackBits;
+		}
+
+		return fullSize;
+	}
+
+	/** Datagrams moved per batch. On linux a batch is one recvmmsg/sendmmsg call */
+	constexpr uint32_t netDatagramBatch = 32;
 
-			/*
-				uint16_t packetId; // sequential packet id (sender)
-				uint16_t fragmentIndex; // fragment index (in packet, 0-n)
-				uint16_t numFragments;
-				uint16_t fragmentSize;
-			*/
+	/** Slots are bigger than a frame, so an oversized datagram arrives whole and fails the frame size checks instead of being cut to fit */
+	constexpr uint32_t netDatagramSlotSize = 1024;
 
-			// receive a packet
-			//sockaddr_in platformAddr = manager->platformAddress();
-			sockaddr_in recvAddr;
-			int32_t recvAddrSize = sizeof(recvAddr);
-			int32_t bytesRead = recvfrom(manager->platformSocket(), reinterpret_cast<char*>(recvBuff.data()), recvBuff.capacity(), 0, (SOCKADDR*)&recvAddr, &recvAddrSize);
+	struct NetDatagramBatch
+	{
+		uint32_t count{};
+		sockaddr_in addresses[netDatagramBatch];
+		uint32_t sizes[netDatagramBatch];
+		uint8_t data[netDatagramBatch][netDatagramSlotSize];
+	};
+
+	/** Reads up to netDatagramBatch datagrams that are waiting on socket into batch */
+	static void s_receiveBatch(e2::NetSocket socket, NetDatagramBatch& batch)
+	{
+		batch.count = 0;
+
+#if defined(__linux__)
+		mmsghdr headers[netDatagramBatch]{};
+		iovec vectors[netDatagramBatch];
+		for (uint32_t i = 0; i < netDatagramBatch; i++)
+		{
+			vectors[i].iov_base = batch.data[i];
+			vectors[i].iov_len = netDatagramSlotSize;
+			headers[i].msg_hdr.msg_name = &batch.addresses[i];
+			headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			headers[i].msg_hdr.msg_iov = &vectors[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int32_t numRead = recvmmsg(socket, headers, netDatagramBatch, 0, nullptr);
+		if (numRead < 0)
+		{
+			int32_t error = s_socketError();
+			if (!s_socketWouldBlock(error))
+			{
+				LogError("recvmmsg failed: {}", error);
+			}
+			return;
+		}
 
-			if (bytesRead == SOCKET_ERROR)
+		for (int32_t i = 0; i < numRead; i++)
+			batch.sizes[i] = headers[i].msg_len;
+
+		batch.count = uint32_t(numRead);
+#else
+		while (batch.count < netDatagramBatch)
+		{
+			socklen_t recvAddrSize = sizeof(sockaddr_in);
+			int32_t bytesRead = recvfrom(socket, reinterpret_cast<char*>(batch.data[batch.count]), netDatagramSlotSize, 0, (sockaddr*)&batch.addresses[batch.count], &recvAddrSize);
+			if (bytesRead < 0)
 			{
-				int32_t wsaError = WSAGetLastError();
-				if (wsaError != WSAEWOULDBLOCK)
+				int32_t error = s_socketError();
+				if (!s_socketWouldBlock(error))
 				{
-					LogError("recvfrom failed: {}", WSAGetLastError());
+					LogError("recvfrom failed: {}", error);
 				}
+				return;
 			}
-			else
+
+			batch.sizes[batch.count++] = uint32_t(bytesRead);
+		}
+#endif
+	}
+
+	/** Sends every datagram in batch and empties it. Like any UDP send, a datagram the OS refuses is lost */
+	static void s_sendBatch(e2::NetSocket socket, NetDatagramBatch& batch)
+	{
+#if defined(__linux__)
+		mmsghdr headers[netDatagramBatch]{};
+		iovec vectors[netDatagramBatch];
+		for (uint32_t i = 0; i < batch.count; i++)
+		{
+			vectors[i].iov_base = batch.data[i];
+			vectors[i].iov_len = batch.sizes[i];
+			headers[i].msg_hdr.msg_name = &batch.addresses[i];
+			headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			headers[i].msg_hdr.msg_iov = &vectors[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		// sendmmsg stops at the first datagram that fails, skip it and carry on with the rest
+		uint32_t numSent = 0;
+		while (numSent < batch.count)
+		{
+			int32_t result = sendmmsg(socket, headers + numSent, batch.count - numSent, 0);
+			if (result < 0)
 			{
+				int32_t error = s_socketError();
+				if (!s_socketWouldBlock(error))
+				{
+					LogError("sendmmsg failed: {}", error);
+				}
+				numSent++;
+				continue;
+			}
 
-				e2::NetPeerAddress peerAddress;
-				peerAddress.address = recvAddr.sin_addr.s_addr;
-				peerAddress.port = recvAddr.sin_port;
+			numSent += uint32_t(result);
+		}
+#else
+		for (uint32_t i = 0; i < batch.count; i++)
+		{
+			sendto(socket, reinterpret_cast<char*>(batch.data[i]), int32_t(batch.sizes[i]), 0, (sockaddr*)&batch.addresses[i], sizeof(sockaddr_in));
+		}
+#endif
 
-				//LogNotice("Received UDP frame from {}.{}.{}.{}:{}, at {} bytes",
-				//	uint8_t(peerAddress.address),
-				//	uint8_t(peerAddress.address >> 8),
-				//	uint8_t(peerAddress.address >> 16),
-				//	uint8_t(peerAddress.address >> 24),
-				//	ntohs(peerAddress.port),
-				//	bytesRead);
+		batch.count = 0;
+	}
 
-				e2::NetworkState currentState = manager->currentState();
+	static void s_handleFrame(e2::NetworkManager* manager, sockaddr_in const& recvAddr, uint8_t const* frameData, int32_t frameSize)
+	{
+		e2::NetPeerAddress peerAddress;
+		peerAddress.address = recvAddr.sin_addr.s_addr;
+		peerAddress.port = recvAddr.sin_port;
+
+		//LogNotice("Received UDP frame from {}.{}.{}.{}:{}, at {} bytes",
+		//	uint8_t(peerAddress.address),
+		//	uint8_t(peerAddress.address >> 8),
+		//	uint8_t(peerAddress.address >> 16),
+		//	uint8_t(peerAddress.address >> 24),
+		//	ntohs(peerAddress.port),
+		//	frameSize);
+
+		e2::NetworkState currentState = manager->currentState();
+
+		bool isServer = (currentState == e2::NetworkState::Server);
+		bool isClient = !isServer && (currentState != e2::NetworkState::Offline);
+		bool isClientConnecting = currentState == e2::NetworkState::Client_Connecting;
+		bool isClientConnected = isClient && !isClientConnecting;
+
+		if (isClientConnecting)
+		{
+			manager->flagConnected();
+		}
 
-				bool isServer = (currentState == e2::NetworkState::Server);
-				bool isClient = !isServer && (currentState != e2::NetworkState::Offline);
-				bool isClientConnecting = currentState == e2::NetworkState::Client_Connecting;
-				bool isClientConnected = isClient && !isClientConnecting;
+		// only this thread destroys peer states, so the pointer stays valid while we use it
+		e2::NetPeerState* peerState = manager->getOrCreatePeerState(peerAddress);
 
-				if (isClientConnecting)
-				{
-					manager->flagConnected();
-				}
+		e2::RawMemoryStream rawStream(const_cast<uint8_t*>(frameData), frameSize, true);
+		uint8_t frameTypeInt{};
+		uint8_t frameFlagsInt{};
+		rawStream >> frameTypeInt >> frameFlagsInt;
 
-				e2::NetPeerState* peerState = manager->getOrCreatePeerState(peerAddress); // @todo mutex?
+		e2::NetFrameType frameType = e2::NetFrameType(frameTypeInt);
+		e2::NetFrameFlags frameFlags = e2::NetFrameFlags(frameFlagsInt);
+		if (frameType == e2::NetFrameType::DataFragment)
+		{
+			e2::NetFragment newFragment;
 
-				e2::RawMemoryStream rawStream(recvBuff.data(), bytesRead, true);
-				uint8_t frameTypeInt{};
-				uint8_t frameFlagsInt{};
-				rawStream >> frameTypeInt >> frameFlagsInt;
+			if (uint64_t(frameSize) < e2::netFragmentHeaderSize)
+			{
+				LogError("frame of {} bytes is too small for a fragment, dropping", frameSize);
+				return;
+			}
 
-				e2::NetFrameType frameType = e2::NetFrameType(frameTypeInt);
-				e2::NetFrameFlags frameFlags = e2::NetFrameFlags(frameFlagsInt);
-				if (frameType == e2::NetFrameType::DataFragment)
-				{
-					e2::NetFragment newFragment;
+			uint8_t channelInt{};
+			rawStream >> newFragment.packetId;
+			rawStream >> newFragment.fragmentIndex;
+			rawStream >> newFragment.numFragments;
+			rawStream >> newFragment.fragmentSize;
+			rawStream >> channelInt;
+			rawStream >> newFragment.sequence;
+			rawStream >> newFragment.ack;
+			rawStream >> newFragment.ackBits;
+			newFragment.channel = e2::NetChannel(channelInt);
+
+			if (rawStream.remaining() != newFragment.fragmentSize)
+			{
+				LogError("Expected {} bytes, but got {}, invalid fragment", newFragment.fragmentSize, rawStream.remaining());
+				return;
+			}
 
-					rawStream >> newFragment.packetId;
-					rawStream >> newFragment.fragmentIndex;
-					rawStream >> newFragment.numFragments;
-					rawStream >> newFragment.fragmentSize;
+			bool isLastFragment = newFragment.fragmentIndex == newFragment.numFragments - 1;
+			if (newFragment.fragmentIndex >= newFragment.numFragments || newFragment.numFragments > e2::maxNumFragments || newFragment.fragmentSize > e2::maxFragmentPayloadSize || (!isLastFragment && newFragment.fragmentSize != e2::maxFragmentPayloadSize) || channelInt >= uint8_t(e2::NetChannel::Count))
+			{
+				LogError("invalid fragment {}/{} of {} bytes, dropping", newFragment.fragmentIndex, newFragment.numFragments, newFragment.fragmentSize);
+				return;
+			}
 
-					if (rawStream.remaining() != newFragment.fragmentSize)
+			// acks are taken from the fragment that completes the packet, channel and sequence are the same in all of them
+			auto fillHeader = [&newFragment, frameFlags](e2::NetPacket& packet) {
+				packet.channel = newFragment.channel;
+				packet.packetId = newFragment.packetId;
+				packet.sequence = newFragment.sequence;
+				packet.hasAck = (frameFlags & e2::NetFrameFlags::HasAck) == e2::NetFrameFlags::HasAck;
+				packet.ack = newFragment.ack;
+				packet.ackBits = newFragment.ackBits;
+			};
+
+			if (newFragment.numFragments > 1)
+			{
+				auto packetStateIt = peerState->receivingPackets.find(newFragment.packetId);
+				if (packetStateIt == peerState->receivingPackets.end())
+				{
+					// a header is all it takes to make us allocate, so only start packets that fit in this peer's budget and the global one.
+					// the new one is dropped rather than an old one, so a flood can't push out packets that are nearly done
+					uint8_t sizeClass = e2::NetReassemblyPool::sizeClass(newFragment.numFragments);
+					uint64_t bufferSize = e2::NetReassemblyPool::bufferSize(sizeClass);
+					uint64_t peerBytes{};
+					for (auto const& [packetId, receiveState] : peerState->receivingPackets)
+						peerBytes += e2::NetReassemblyPool::bufferSize(receiveState.sizeClass);
+
+					if (peerBytes + bufferSize > e2::maxReassemblyBytesPerPeer || manager->reassemblyPool().bytesInUse() + bufferSize > e2::maxReassemblyBytes)
 					{
-						LogError("Expected {} bytes, but got {}, invalid fragment", newFragment.fragmentSize, rawStream.remaining());
-						continue;
+						manager->countOverBudget();
+						return;
 					}
 
-					if (newFragment.numFragments > 1)
+					// cap what a single peer can make us hold on to
+					if (peerState->receivingPackets.size() >= e2::maxReassemblingPacketsPerPeer)
 					{
-						auto packetStateIt = peerState->receivingPackets.find(newFragment.packetId);
-						if (packetStateIt == peerState->receivingPackets.end())
-						{
-							e2::NetReceiveState newState;
-							newState.numFragments = newFragment.numFragments;
-							newState.fragmentsReceived = new bool[newState.numFragments];
-							newState.packetData = new uint8_t[newState.numFragments * e2::maxFragmentPayloadSize];
-
-
-							if (newFragment.fragmentIndex == newFragment.numFragments - 1)
-							{
-								newState.packetSize = (e2::maxFragmentPayloadSize * (newState.numFragments - 1)) + newFragment.fragmentSize;
-							}
-							else
-							{
-								newState.packetSize = 0; // this is set when last fragment is resolved
-							}
-
-							newState.fragmentsReceived[newFragment.fragmentIndex] = true;
-							uint8_t* writeFragmentData = newState.packetData + (newFragment.fragmentIndex * e2::maxFragmentPayloadSize);
-							std::memcpy(writeFragmentData, rawStream.data() + rawStream.cursor(), newFragment.fragmentSize);
-
-							peerState->receivingPackets[newFragment.packetId] = newState;
-						}
-						else
+						auto oldestIt = peerState->receivingPackets.begin();
+						for (auto it = peerState->receivingPackets.begin(); it != peerState->receivingPackets.end(); it++)
 						{
-							e2::NetReceiveState& packetState = packetStateIt->second;
-
-							if (newFragment.fragmentIndex == newFragment.numFragments - 1)
-							{
-								packetState.packetSize = (e2::maxFragmentPayloadSize * (packetState.numFragments - 1)) + newFragment.fragmentSize;
-							}
-							packetState.fragmentsReceived[newFragment.fragmentIndex] = true;
-							uint8_t* writeFragmentData = packetState.packetData + (newFragment.fragmentIndex * e2::maxFragmentPayloadSize);
-							std::memcpy(writeFragmentData, rawStream.data() + rawStream.cursor(), newFragment.fragmentSize);
-
-							bool allWritten = true;
-							for (uint16_t i = 0; i < packetState.numFragments; i++)
-							{
-								if (!packetState.fragmentsReceived[i])
-								{
-									allWritten = false;
-									break;
-								}
-							}
-
-							if (allWritten)
-							{
-								e2::NetPacket newPacket(peerAddress, packetState.packetData, packetState.packetSize);
-								manager->receivePacket(newPacket);
-
-								delete[] packetState.packetData;
-								delete[] packetState.fragmentsReceived;
-								peerState->receivingPackets.erase(newFragment.packetId);
-
-							}
+							if (it->second.firstReceived.durationSince().seconds() > oldestIt->second.firstReceived.durationSince().seconds())
+								oldestIt = it;
 						}
+
+						LogWarning("too many incomplete packets from peer, dropping packet {}", oldestIt->first);
+						manager->releaseReceiveState(oldestIt->second);
+						peerState->receivingPackets.erase(oldestIt);
 					}
-					else
-					{
-						e2::NetPacket newPacket(peerAddress, rawStream.data() + rawStream.cursor(), newFragment.fragmentSize);
-						manager->receivePacket(newPacket);
-					}
+
+					e2::NetReceiveState newState;
+					newState.numFragments = newFragment.numFragments;
+					newState.packetData = manager->reassemblyPool().acquire(newState.numFragments, newState.sizeClass);
+					newState.fragmentsReceived = newState.packetData + e2::NetReassemblyPool::bitsOffset(newState.sizeClass);
+					newState.firstReceived = e2::timeNow();
+
+					packetStateIt = peerState->receivingPackets.emplace(newFragment.packetId, newState).first;
 				}
-				else if (frameType == e2::NetFrameType::Disconnect)
+				else if (packetStateIt->second.numFragments != newFragment.numFragments)
 				{
-					if (isClient)
-					{
-						LogNotice("Server sent disconnect, so we are disconnecting");
-						manager->notifyServerDisconnected();
-					}
-					else if (isServer)
-					{
-						LogNotice("Client sent disconnect, so we are dropping them");
-						manager->notifyClientDisconnected(peerAddress);
-					}
+					LogError("fragment count mismatch for packet {}, dropping fragment", newFragment.packetId);
+					return;
 				}
-				else if (frameType == e2::NetFrameType::TryConnect)
-				{
-					if (isServer)
-					{
-						// @todo send connect established or failed 
 
-						uint8_t resp[] = { (uint8_t)e2::NetFrameType::ConnectEstablished, (uint8_t)e2::NetFrameFlags::Default };
-						int32_t bytesSent = sendto(manager->platformSocket(), reinterpret_cast<char*>(resp), 2, 0, (SOCKADDR*)&recvAddr, sizeof(recvAddr));
-						if (bytesSent == SOCKET_ERROR)
-						{
-							LogError("sendto failed: {}", WSAGetLastError());
-						}
-						else
-						{
-							LogNotice("Sent {} bytes", bytesSent);
-						}
+				e2::NetReceiveState& packetState = packetStateIt->second;
 
-						manager->notifyClientConnected(peerAddress);
+				uint8_t receivedMask = uint8_t(1 << (newFragment.fragmentIndex % 8));
+				uint8_t& receivedBits = packetState.fragmentsReceived[newFragment.fragmentIndex / 8];
+				if (receivedBits & receivedMask)
+				{
+					// duplicate
+					return;
+				}
 
-					}
+				receivedBits |= receivedMask;
+				packetState.numReceived++;
+
+				if (isLastFragment)
+				{
+					packetState.packetSize = uint32_t((e2::maxFragmentPayloadSize * (packetState.numFragments - 1)) + newFragment.fragmentSize);
 				}
-			}
 
-			// send fragments 
+				uint8_t* writeFragmentData = packetState.packetData + (newFragment.fragmentIndex * e2::maxFragmentPayloadSize);
+				std::memcpy(writeFragmentData, rawStream.data() + rawStream.cursor(), newFragment.fragmentSize);
 
-			thread_local e2::StackVector<e2::NetSendFragment, e2::maxBufferedPackets> swapBuffer;
-			swapBuffer.clear();
+				if (packetState.numReceived == packetState.numFragments)
+				{
+					e2::NetPacket newPacket(peerAddress, packetState.packetData, packetState.packetSize);
+					fillHeader(newPacket);
+					manager->receivePacket(newPacket);
 
-			manager->fetchOutgoing(swapBuffer);
+					manager->releaseReceiveState(packetState);
+					peerState->receivingPackets.erase(packetStateIt);
+				}
+			}
+			else
+			{
+				e2::NetPacket newPacket(peerAddress, rawStream.data() + rawStream.cursor(), newFragment.fragmentSize);
+				fillHeader(newPacket);
+				manager->receivePacket(newPacket);
+			}
+		}
+		else if (frameType == e2::NetFrameType::Ack)
+		{
+			if (uint64_t(frameSize) != e2::netAckFrameSize)
+			{
+				LogError("ack frame of {} bytes, expected {}, dropping", frameSize, e2::netAckFrameSize);
+				return;
+			}
 
-			thread_local uint8_t fragBuff[e2::netFrameSize];
-			thread_local uint64_t fragBuffSize = 0;
-			for (e2::NetSendFragment& frag : swapBuffer)
+			e2::NetPacket ackPacket;
+			ackPacket.peerAddress = peerAddress;
+			ackPacket.ackOnly = true;
+			ackPacket.hasAck = (frameFlags & e2::NetFrameFlags::HasAck) == e2::NetFrameFlags::HasAck;
+			rawStream >> ackPacket.ack >> ackPacket.ackBits;
+			manager->receivePacket(ackPacket);
+		}
+		else if (frameType == e2::NetFrameType::Disconnect)
+		{
+			if (isClient)
+			{
+				LogNotice("Server sent disconnect, so we are disconnecting");
+				manager->notifyServerDisconnected();
+			}
+			else if (isServer)
+			{
+				LogNotice("Client sent disconnect, so we are dropping them");
+				manager->notifyClientDisconnected(peerAddress);
+			}
+		}
+		else if (frameType == e2::NetFrameType::TryConnect)
+		{
+			if (isServer)
 			{
-				sockaddr_in addr;
-				addr.sin_family = AF_INET;
-				addr.sin_addr.s_addr = frag.address.address;
-				addr.sin_port = frag.address.port;
+				// @todo send connect established or failed 
 
-				uint64_t fullSize = 2;
-				if (frag.fragment.frameType == e2::NetFrameType::DataFragment)
+				uint8_t resp[] = { (uint8_t)e2::NetFrameType::ConnectEstablished, (uint8_t)e2::NetFrameFlags::Default };
+				int32_t bytesSent = sendto(manager->platformSocket(), reinterpret_cast<char*>(resp), 2, 0, (sockaddr*)&recvAddr, sizeof(recvAddr));
+				if (bytesSent < 0)
+				{
+					LogError("sendto failed: {}", s_socketError());
+				}
+				else
 				{
+					LogNotice("Sent {} bytes", bytesSent);
+				}
+
+				manager->notifyClientConnected(peerAddress);
+
+			}
+		}
+	}
 
-					fullSize = e2::netFragmentHeaderSize + frag.fragment.fragmentSize;
+	/** Queues frag into batch, sending the batch when it fills up. Frames held back by the latency shim skip the batch */
+	static void s_sendFragment(e2::NetworkManager* manager, e2::NetSendFragment const& frag, NetDatagramBatch& batch)
+	{
+		float simulatedLoss = manager->simulatedPacketLoss();
+		if (simulatedLoss > 0.0f)
+		{
+			thread_local std::mt19937 lossRandom{ std::random_device{}() };
+			if (std::uniform_real_distribution<float>(0.0f, 1.0f)(lossRandom) < simulatedLoss)
+				return;
+		}
 
-					e2::RawMemoryStream rawStream(fragBuff, fullSize, true);
+		double simulatedLatency = manager->simulatedLatency();
+		double simulatedJitter = manager->simulatedJitter();
+		if (simulatedLatency > 0.0 || simulatedJitter > 0.0)
+		{
+			thread_local std::mt19937 latencyRandom{ std::random_device{}() };
+			double delay = simulatedLatency + std::uniform_real_distribution<double>(0.0, simulatedJitter)(latencyRandom);
+
+			e2::NetDelayedFrame delayed;
+			delayed.releaseAt = e2::timeNow();
+			delayed.releaseAt.m_point += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(delay));
+			delayed.address = frag.address;
+			delayed.size = uint16_t(s_writeFrame(frag.fragment, delayed.data));
+			manager->delayFrame(delayed);
+			return;
+		}
 
-					rawStream << uint8_t(frag.fragment.frameType);
-					rawStream << uint8_t(frag.fragment.frameFlags);
+		sockaddr_in& addr = batch.addresses[batch.count];
+		addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = frag.address.address;
+		addr.sin_port = frag.address.port;
 
-					rawStream << frag.fragment.packetId;
-					rawStream << frag.fragment.fragmentIndex;
-					rawStream << frag.fragment.numFragments;
-					rawStream << frag.fragment.fragmentSize;
-					rawStream.write(frag.fragment.fragmentPayload, frag.fragment.fragmentSize);
-				}
-				else
-				{
-					e2::RawMemoryStream rawStream(fragBuff, fullSize, true);
+		batch.sizes[batch.count] = uint32_t(s_writeFrame(frag.fragment, batch.data[batch.count]));
+		if (++batch.count == netDatagramBatch)
+			s_sendBatch(manager->platformSocket(), batch);
+	}
+
+	static void s_networkThread(e2::NetworkManager* manager)
+	{
+		// the two batches are ~66KB, keep them off the thread stack
+		std::unique_ptr<NetDatagramBatch> recvBatch = std::make_unique<NetDatagramBatch>();
+		std::unique_ptr<NetDatagramBatch> sendBatch = std::make_unique<NetDatagramBatch>();
+		uint32_t nextDelayedMs = UINT32_MAX;
+
+		while (manager->threadRunning())
+		{
+			// sleeps until the socket is readable or the game thread has something for us, so an idle connection costs nothing.
+			// while packets are being reassembled, wake up now and then to time them out, and wake up for frames held back by the latency shim
+			manager->waitForWork(glm::min(manager->reassemblyPool().numInUse() > 0 ? 500u : UINT32_MAX, nextDelayedMs));
+			manager->expireReassembly();
 
-					rawStream << uint8_t(frag.fragment.frameType);
-					rawStream << uint8_t(frag.fragment.frameFlags);
+			// drain every datagram that is ready, before going back to sleep
+			for (uint32_t i = 0; i < e2::maxBufferedPackets; i += netDatagramBatch)
+			{
+				s_receiveBatch(manager->platformSocket(), *recvBatch);
+				for (uint32_t d = 0; d < recvBatch->count; d++)
+				{
+					s_handleFrame(manager, recvBatch->addresses[d], recvBatch->data[d], int32_t(recvBatch->sizes[d]));
 				}
 
-				sendto(manager->platformSocket(), reinterpret_cast<char*>(fragBuff), fullSize, 0, (SOCKADDR*)&addr, sizeof(addr));
+				if (recvBatch->count < netDatagramBatch)
+					break;
 			}
-#endif
+
+			// send everything queued since last time
+			e2::NetSendFragment frag;
+			while (manager->popOutgoing(frag))
+			{
+				s_sendFragment(manager, frag, *sendBatch);
+			}
+			s_sendBatch(manager->platformSocket(), *sendBatch);
+
+			nextDelayedMs = manager->sendDelayedFrames();
 		}
 	}
 }
@@ -267,11 +533,11 @@ void e2::NetworkManager::disable()
 	if (m_thread.joinable())
 	{
 		m_killFlag = true;
+		wakeThread();
 		m_thread.join();
 	}
 
-#if defined(_WIN64)
-	if (m_socket != INVALID_SOCKET)
+	if (m_socket != e2::invalidNetSocket)
 	{
 
 		for (auto &[address, otherState] : m_peerStates)
@@ -281,12 +547,34 @@ void e2::NetworkManager::disable()
 			otherAddr.sin_family = AF_INET;
 			otherAddr.sin_addr.s_addr = address.address;
 			otherAddr.sin_port = address.port;
-			sendto(m_socket, reinterpret_cast<char*>(discFrame), 2, 0, (SOCKADDR*) & otherAddr, sizeof(otherAddr));
+			sendto(m_socket, reinterpret_cast<char*>(discFrame), 2, 0, (sockaddr*)&otherAddr, sizeof(otherAddr));
 		}
 
-		closesocket(m_socket);
-		m_socket = INVALID_SOCKET;
+		s_closeSocket(m_socket);
+		m_socket = e2::invalidNetSocket;
 	}	
+
+#if defined(_WIN64)
+	if (m_socketEvent != WSA_INVALID_EVENT)
+	{
+		WSACloseEvent(m_socketEvent);
+		m_socketEvent = WSA_INVALID_EVENT;
+	}
+
+	if (m_wakeEvent != WSA_INVALID_EVENT)
+	{
+		WSACloseEvent(m_wakeEvent);
+		m_wakeEvent = WSA_INVALID_EVENT;
+	}
+#else
+	for (int& fd : m_wakePipe)
+	{
+		if (fd != -1)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
 #endif
 
 
@@ -294,10 +582,7 @@ void e2::NetworkManager::disable()
 	{
 		for (auto& [packetId, recvState] : state->receivingPackets)
 		{
-			if (recvState.packetData)
-				delete[] recvState.packetData;
-			if (recvState.fragmentsReceived)
-				delete[] recvState.fragmentsReceived;
+			releaseReceiveState(recvState);
 		}
 		e2::destroy(state);
 	}
@@ -305,6 +590,16 @@ void e2::NetworkManager::disable()
 	m_peerStates.clear();
 	m_incomingBuffer.clear();
 	m_outgoingBuffer.clear();
+	m_pendingFragments.clear();
+	m_delayedFrames.clear();
+	m_reassemblyPool.clear();
+
+	// the thread is gone, events it queued for a connection we left are stale
+	{
+		std::scoped_lock lock(m_eventMutex);
+		m_events.clear();
+	}
+	m_connectedFlag = false;
 
 	m_state = e2::NetworkState::Offline;
 }
@@ -315,35 +610,32 @@ void e2::NetworkManager::startServer(uint16_t port)
 
 	m_hostPort = port;
 
-#if defined(_WIN64)
 	m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (m_socket == INVALID_SOCKET)
+	if (m_socket == e2::invalidNetSocket)
 	{
-		LogError("socket failed: {}", WSAGetLastError());
+		LogError("socket failed: {}", s_socketError());
 		m_state = e2::NetworkState::Offline;
 		return;
 	}
 
-	u_long mode = 1; // 1 = non-blocking, 0 = blocking
-	ioctlsocket(m_socket, FIONBIO, &mode);
+	s_configureSocket(m_socket);
 
 	m_recvAddr.sin_family = AF_INET;
 	m_recvAddr.sin_port = htons(m_hostPort);
 	m_recvAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-	int32_t result = bind(m_socket, (SOCKADDR*)&m_recvAddr, sizeof(m_recvAddr));
+	int32_t result = bind(m_socket, (sockaddr*)&m_recvAddr, sizeof(m_recvAddr));
 	if (result != 0)
 	{
-		LogError("bind failed: {}", WSAGetLastError());
-		closesocket(m_socket);
+		LogError("bind failed: {}", s_socketError());
+		s_closeSocket(m_socket);
+		m_socket = e2::invalidNetSocket;
 		m_state = e2::NetworkState::Offline;
 		return;
 	}
-#endif
 
 	m_state = e2::NetworkState::Server;
 
-	m_killFlag = false;
-	m_thread = std::thread(::s_networkThread, this);
+	startThread();
 }
 
 void e2::NetworkManager::tryConnect(e2::NetPeerAddress const& address)
@@ -365,23 +657,21 @@ void e2::NetworkManager::tryConnect(e2::NetPeerAddress const& address)
 
 	m_state = e2::NetworkState::Client_Connecting;
 
-#if defined(_WIN64)
 	m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (m_socket == INVALID_SOCKET)
+	if (m_socket == e2::invalidNetSocket)
 	{
-		LogError("socket failed: {}", WSAGetLastError());
+		LogError("socket failed: {}", s_socketError());
 		m_state = e2::NetworkState::Offline;
 		return;
 	}
 
-	u_long mode = 1; // 1 = non-blocking, 0 = blocking
-	ioctlsocket(m_socket, FIONBIO, &mode);
+	s_configureSocket(m_socket);
 
 	uint8_t sendTo[] = { (uint8_t)e2::NetFrameType::TryConnect, (uint8_t)e2::NetFrameFlags::Default };
-	int32_t bytesSent = sendto(m_socket, reinterpret_cast<char*>(sendTo), 2, 0, (SOCKADDR*)&addr, sizeof(addr));
-	if (bytesSent == SOCKET_ERROR)
+	int32_t bytesSent = sendto(m_socket, reinterpret_cast<char*>(sendTo), 2, 0, (sockaddr*)&addr, sizeof(addr));
+	if (bytesSent < 0)
 	{
-		LogError("sendto failed: {}", WSAGetLastError());
+		LogError("sendto failed: {}", s_socketError());
 		disable();
 		return;
 	}
@@ -392,11 +682,11 @@ void e2::NetworkManager::tryConnect(e2::NetPeerAddress const& address)
 
 
 	struct sockaddr_in localAddr;
-	int localAddrLen = sizeof(localAddr);
+	socklen_t localAddrLen = sizeof(localAddr);
 
-	if (getsockname(m_socket, (struct sockaddr*)&localAddr, &localAddrLen) == SOCKET_ERROR)
+	if (getsockname(m_socket, (struct sockaddr*)&localAddr, &localAddrLen) < 0)
 	{
-		LogError("getsockname failed: {}", WSAGetLastError());
+		LogError("getsockname failed: {}", s_socketError());
 	}
 	else
 	{
@@ -407,13 +697,11 @@ void e2::NetworkManager::tryConnect(e2::NetPeerAddress const& address)
 	}
 
 
-#endif
 
 
 
 
-	m_killFlag = false;
-	m_thread = std::thread(::s_networkThread, this);
+	startThread();
 
 	// @todo send tryconnect 
 	m_timesTriedConnect = 0;
@@ -422,17 +710,70 @@ void e2::NetworkManager::tryConnect(e2::NetPeerAddress const& address)
 
 void e2::NetworkManager::notifyServerDisconnected()
 {
-	m_disconnectFlag = true;
+	queueEvent(e2::NetEventType::Disconnected, m_serverAddress);
 }
 
 void e2::NetworkManager::flagConnected()
 {
-	if (m_state == e2::NetworkState::Client_Connecting)
+	if (!m_connectedFlag.exchange(true))
+		queueEvent(e2::NetEventType::Connected, m_serverAddress);
+}
+
+void e2::NetworkManager::queueEvent(e2::NetEventType type, NetPeerAddress const& address)
+{
+	std::scoped_lock lock(m_eventMutex);
+	m_events.push_back({ type, address });
+}
+
+void e2::NetworkManager::raiseEvents()
+{
+	m_eventScratch.clear();
+	{
+		std::scoped_lock lock(m_eventMutex);
+		m_eventScratch.swap(m_events);
+	}
+
+	for (e2::NetEvent const& event : m_eventScratch)
 	{
-		m_state = e2::NetworkState::Client_Connected;
+		switch (event.type)
+		{
+		case e2::NetEventType::Connected:
+			if (m_state == e2::NetworkState::Client_Connecting)
+			{
+				m_state = e2::NetworkState::Client_Connected;
+				for (auto cb : m_netCallbacks)
+					cb->onConnected(event.address);
+			}
+			break;
+
+		case e2::NetEventType::Disconnected:
+			if (m_state != e2::NetworkState::Offline)
+			{
+				for (auto cb : m_netCallbacks)
+					cb->onDisconnected(event.address);
+
+				// disable() empties the queue, and nothing left in this batch applies to a closed connection
+				disable();
+				return;
+			}
+			break;
+
+		case e2::NetEventType::PeerConnected:
+			if (m_state == e2::NetworkState::Server)
+			{
+				for (auto cb : m_netCallbacks)
+					cb->onPeerConnected(event.address);
+			}
+			break;
 
-		for (auto cb : m_netCallbacks)
-			cb->onConnected(m_serverAddress);
+		case e2::NetEventType::PeerDisconnected:
+			if (m_state == e2::NetworkState::Server)
+			{
+				for (auto cb : m_netCallbacks)
+					cb->onPeerDisconnected(event.address);
+			}
+			break;
+		}
 	}
 }
 
@@ -480,108 +821,174 @@ void e2::NetworkManager::update(double deltaTime)
 				tryConnectFragment.fragment.fragmentSize = 0;
 				tryConnectFragment.fragment.numFragments = 0;
 				tryConnectFragment.fragment.packetId = 0;
-				std::scoped_lock lock(m_syncMutex);
-				m_outgoingBuffer.push(tryConnectFragment);
+				if (m_outgoingBuffer.push(tryConnectFragment))
+					wakeThread();
 			}
 		}
 
-		thread_local e2::StackVector<e2::NetPacket, e2::maxBufferedPackets> swapBuffer;
-		swapBuffer.clear();
+		updateReliability();
+		flushOutgoing();
+
+		// at most one ring worth per update, so a flood can't starve the frame
+		for (uint32_t i = 0; i < e2::maxBufferedPackets && m_state != e2::NetworkState::Offline; i++)
 		{
-			std::scoped_lock lock(m_syncMutex);
-			for (e2::NetPacket& packet : m_incomingBuffer)
+			e2::NetPacket packet;
+			if (!m_incomingBuffer.pop(packet))
+				break;
+
+			m_deliverScratch.clear();
+			deliverIncoming(packet, m_deliverScratch);
+
+			for (e2::NetPacket& readyPacket : m_deliverScratch)
 			{
-				swapBuffer.push(packet);
-			}
-			m_incomingBuffer.clear();
-		}
+				// a handler may have taken us offline
+				if (m_state == e2::NetworkState::Offline)
+					break;
 
-		for (e2::NetPacket& packet : swapBuffer)
-		{
-			handleReceivedPacket(packet);
+				handleReceivedPacket(readyPacket);
+			}
 		}
 	}
-	
-	if (m_disconnectFlag)
-	{
-		for (auto cb : m_netCallbacks)
-			cb->onDisconnected(m_serverAddress);
 
-		disable();
-		m_disconnectFlag = false;
-	}
+	// after the packets, which mostly arrived before the event did
+	raiseEvents();
 }
 
 e2::NetPeerState *e2::NetworkManager::getOrCreatePeerState(NetPeerAddress const& peerAddress)
 {
-	std::scoped_lock lock(m_syncMutex);
+	std::scoped_lock lock(m_peerMutex);
+	return findOrCreatePeerState(peerAddress);
+}
+
+e2::NetPeerState* e2::NetworkManager::findOrCreatePeerState(NetPeerAddress const& peerAddress)
+{
 	auto stateIt = m_peerStates.find(peerAddress);
-	if (stateIt == m_peerStates.end())
+	if (stateIt != m_peerStates.end())
+		return stateIt->second;
+
+	e2::NetPeerState *newState = e2::create<e2::NetPeerState>();
+	newState->peerAddress = peerAddress;
+	newState->statsWindowStart = e2::timeNow();
+	m_peerStates[peerAddress] = newState;
+	return newState;
+}
+
+void e2::NetworkManager::notifyClientDisconnected(NetPeerAddress const& address)
+{
 	{
-		e2::NetPeerState *newState = e2::create<e2::NetPeerState>();
-		newState->peerAddress = peerAddress;
-		m_peerStates[peerAddress] = newState;
+		std::scoped_lock lock(m_peerMutex);
+		auto stateIt = m_peerStates.find(address);
+		if (stateIt != m_peerStates.end())
+		{
+			e2::NetPeerState* state = stateIt->second;
 
+			for (auto& [packetId, recvState] : state->receivingPackets)
+			{
+				releaseReceiveState(recvState);
+			}
+			e2::destroy(state);
+			m_peerStates.erase(address);
+		}
 	}
 
-	return m_peerStates[peerAddress];
+	queueEvent(e2::NetEventType::PeerDisconnected, address);
 }
 
-void e2::NetworkManager::notifyClientDisconnected(NetPeerAddress const& address)
+void e2::NetworkManager::notifyClientConnected(NetPeerAddress const& address)
 {
-	std::scoped_lock lock(m_syncMutex);
-	auto stateIt = m_peerStates.find(address);
-	if (stateIt != m_peerStates.end())
+	queueEvent(e2::NetEventType::PeerConnected, address);
+}
+
+bool e2::NetworkManager::popOutgoing(e2::NetSendFragment& outFragment)
+{
+	return m_outgoingBuffer.pop(outFragment);
+}
+
+void e2::NetworkManager::waitForWork(uint32_t timeoutMs)
+{
+#if defined(_WIN64)
+	WSAEVENT events[2] = { m_socketEvent, m_wakeEvent };
+	DWORD result = WSAWaitForMultipleEvents(2, events, FALSE, timeoutMs == UINT32_MAX ? WSA_INFINITE : DWORD(timeoutMs), FALSE);
+	if (result == WSA_WAIT_FAILED)
 	{
-		e2::NetPeerState* state = stateIt->second;
+		LogError("WSAWaitForMultipleEvents failed: {}", s_socketError());
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return;
+	}
 
-		for (auto& [packetId, recvState] : state->receivingPackets)
+	// reset both before the caller drains socket and ring, anything that arrives after this signals again so no wakeup is lost
+	WSANETWORKEVENTS networkEvents;
+	WSAEnumNetworkEvents(m_socket, m_socketEvent, &networkEvents);
+	WSAResetEvent(m_wakeEvent);
+#else
+	pollfd fds[2] = { { m_socket, POLLIN, 0 }, { m_wakePipe[0], POLLIN, 0 } };
+	int result = poll(fds, 2, timeoutMs == UINT32_MAX ? -1 : int(timeoutMs));
+	if (result < 0)
+	{
+		// a signal (like the one asking a headless server to stop) interrupts the wait, that's not an error
+		if (errno != EINTR)
 		{
-			if (recvState.packetData)
-				delete[] recvState.packetData;
-			if (recvState.fragmentsReceived)
-				delete[] recvState.fragmentsReceived;
+			LogError("poll failed: {}", errno);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
-		e2::destroy(state);
-		m_peerStates.erase(address);
+		return;
 	}
 
-	if (m_state == e2::NetworkState::Server)
+	// the socket is level triggered and needs no reset. Empty the pipe before the caller drains the ring, anything queued after this writes again
+	if (fds[1].revents & POLLIN)
 	{
-		for (auto cb : m_netCallbacks)
-			cb->onPeerDisconnected(address);
+		uint8_t drain[64];
+		while (read(m_wakePipe[0], drain, sizeof(drain)) > 0);
 	}
+#endif
 }
 
-void e2::NetworkManager::notifyClientConnected(NetPeerAddress const& address)
+void e2::NetworkManager::startThread()
 {
-	if (m_state == e2::NetworkState::Server)
+#if defined(_WIN64)
+	m_socketEvent = WSACreateEvent();
+	m_wakeEvent = WSACreateEvent();
+	if (WSAEventSelect(m_socket, m_socketEvent, FD_READ) < 0)
+	{
+		LogError("WSAEventSelect failed: {}", s_socketError());
+	}
+#else
+	if (pipe(m_wakePipe) != 0)
+	{
+		LogError("pipe failed: {}", errno);
+	}
+	else
 	{
-		for (auto cb : m_netCallbacks)
-			cb->onPeerConnected(address);
+		fcntl(m_wakePipe[0], F_SETFL, fcntl(m_wakePipe[0], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(m_wakePipe[1], F_SETFL, fcntl(m_wakePipe[1], F_GETFL, 0) | O_NONBLOCK);
 	}
+#endif
+
+	m_killFlag = false;
+	m_thread = std::thread(::s_networkThread, this);
 }
 
-void e2::NetworkManager::fetchOutgoing(e2::StackVector<e2::NetSendFragment, e2::maxBufferedPackets>& outSwap)
+void e2::NetworkManager::wakeThread()
 {
-	std::scoped_lock lock(m_syncMutex);
-	for (e2::NetSendFragment& frag : m_outgoingBuffer)
+#if defined(_WIN64)
+	if (m_wakeEvent != WSA_INVALID_EVENT)
+		WSASetEvent(m_wakeEvent);
+#else
+	// if the pipe is full a wakeup is already pending, so a failed write loses nothing
+	if (m_wakePipe[1] != -1)
 	{
-		outSwap.push(frag);
+		uint8_t wake = 1;
+		[[maybe_unused]] ssize_t written = write(m_wakePipe[1], &wake, 1);
 	}
-	m_outgoingBuffer.clear();
-	
+#endif
 }
 
 void e2::NetworkManager::receivePacket(e2::NetPacket& newPacket)
 {
-	std::scoped_lock lock(m_syncMutex);
-	if (m_incomingBuffer.full())
+	if (!m_incomingBuffer.push(newPacket))
 	{
 		LogError("incoming packet buffer full, dropping packet");
-		return;
 	}
-	m_incomingBuffer.push(newPacket);
 }
 
 void e2::NetworkManager::handleReceivedPacket(e2::NetPacket& packet)
@@ -594,7 +1001,7 @@ void e2::NetworkManager::handleReceivedPacket(e2::NetPacket& packet)
 }
 
 
-void e2::NetworkManager::broadcastPacket(e2::HeapStream& packet)
+void e2::NetworkManager::broadcastPacket(e2::HeapStream& packet, e2::NetChannel channel)
 {
 	if (!isServer())
 	{
@@ -607,9 +1014,19 @@ void e2::NetworkManager::broadcastPacket(e2::HeapStream& packet)
 	uint8_t const* packetData = packet.read(packetSize);
 	packet.seek(0);
 
-	for (auto& [address, state] : m_peerStates)
+	// the network thread may add peers while we send, so work from a copy
+	thread_local std::vector<e2::NetPeerAddress> addresses;
+	addresses.clear();
+	{
+		std::scoped_lock lock(m_peerMutex);
+		for (auto& [address, state] : m_peerStates)
+			addresses.push_back(address);
+	}
+
+	for (e2::NetPeerAddress const& address : addresses)
 	{
 		e2::NetPacket netPacket(address, packetData, packetSize); 
+		netPacket.channel = channel;
 		sendPacket(netPacket);
 	}
 }
@@ -618,31 +1035,657 @@ void e2::NetworkManager::sendPacket(e2::NetPacket& outPacket)
 {
 	outPacket.data.seek(0);
 	uint64_t size = outPacket.data.remaining();
-	if (size > e2::maxFragmentPayloadSize)
+	if (size > e2::maxNetPacketSize)
 	{
-		LogError("We do not support sending multi frag packets yet @todo");
+		LogError("packet of {} bytes is larger than maxNetPacketSize, dropping", size);
 		return;
 	}
 
-	e2::NetSendFragment sendFragment;
+	uint8_t const* packetData = outPacket.data.read(size);
+	{
+		// the network thread may drop this peer at any time, so only touch it under the lock
+		std::scoped_lock lock(m_peerMutex);
+		e2::NetPeerState* peerState = findOrCreatePeerState(outPacket.peerAddress);
+		uint16_t sequence = peerState->outgoingSequences[size_t(outPacket.channel)]++;
+
+		if (outPacket.channel == e2::NetChannel::ReliableOrdered)
+		{
+			e2::NetUnackedPacket& unacked = peerState->unacked.emplace_back();
+			unacked.sequence = sequence;
+			unacked.numSends = 1;
+			unacked.lastSent = e2::timeNow();
+			unacked.data.assign(packetData, packetData + size);
+		}
+
+		queuePacket(peerState, outPacket.channel, sequence, packetData, size);
+	}
+
+	flushOutgoing();
+}
+
+uint16_t e2::NetworkManager::queuePacket(e2::NetPeerState* peer, e2::NetChannel channel, uint16_t sequence, uint8_t const* packetData, uint64_t packetSize)
+{
+	uint64_t numFragments = glm::max<uint64_t>(1, (packetSize + e2::maxFragmentPayloadSize - 1) / e2::maxFragmentPayloadSize);
+	uint16_t packetId = peer->outgoingPacketIndex++;
+	e2::Moment now = e2::timeNow();
+
+	// a record we're about to overwrite that never got acked was lost, if it wasn't counted already
+	e2::NetSentRecord& record = peer->sentHistory[packetId % e2::netSentHistorySize];
+	if (record.valid && !record.acked && !record.countedLost)
+		peer->windowLost++;
+
+	record = e2::NetSentRecord();
+	record.valid = true;
+	record.packetId = packetId;
+	record.sentAt = now;
+	record.reliable = channel == e2::NetChannel::ReliableOrdered;
+	record.sequence = sequence;
+
+	for (uint64_t i = 0; i < numFragments; i++)
+	{
+		uint64_t fragmentOffset = i * e2::maxFragmentPayloadSize;
+
+		e2::NetSendFragment& sendFragment = m_pendingFragments.emplace_back();
+		sendFragment.address = peer->peerAddress;
+		sendFragment.fragment.frameType = e2::NetFrameType::DataFragment;
+		sendFragment.fragment.frameFlags = peer->hasRemote ? e2::NetFrameFlags::HasAck : e2::NetFrameFlags::Default;
+		sendFragment.fragment.packetId = packetId;
+		sendFragment.fragment.fragmentIndex = uint16_t(i);
+		sendFragment.fragment.numFragments = uint16_t(numFragments);
+		sendFragment.fragment.fragmentSize = uint16_t(glm::min<uint64_t>(e2::maxFragmentPayloadSize, packetSize - fragmentOffset));
+		sendFragment.fragment.channel = channel;
+		sendFragment.fragment.sequence = sequence;
+		sendFragment.fragment.ack = peer->remoteSequence;
+		sendFragment.fragment.ackBits = peer->remoteAckBits;
+		if (sendFragment.fragment.fragmentSize > 0)
+			memcpy(sendFragment.fragment.fragmentPayload, packetData + fragmentOffset, sendFragment.fragment.fragmentSize);
+	}
+
+	// acks rode along, no need for a bare one
+	peer->ackPending = false;
+	peer->lastSent = now;
+	peer->windowSentBytes += packetSize + numFragments * e2::netFragmentHeaderSize;
+
+	return packetId;
+}
+
+void e2::NetworkManager::processAcks(e2::NetPeerState* peer, uint16_t ack, uint32_t ackBits)
+{
+	e2::Moment now = e2::timeNow();
+	for (uint32_t i = 0; i <= 32; i++)
+	{
+		// bit n acks the packet n+1 before ack
+		if (i > 0 && (ackBits & (1u << (i - 1))) == 0)
+			continue;
+
+		uint16_t packetId = uint16_t(ack - i);
+		e2::NetSentRecord& record = peer->sentHistory[packetId % e2::netSentHistorySize];
+		if (!record.valid || record.acked || record.packetId != packetId)
+			continue;
+
+		record.acked = true;
+		if (!record.countedLost)
+			peer->windowAcked++;
+
+		// every transmission has its own packet id, so samples are never ambiguous (RFC 6298 smoothing)
+		double sample = (now - record.sentAt).seconds();
+		e2::NetPeerStats& stats = peer->stats;
+		if (!peer->hasRoundTripSample)
+		{
+			stats.roundTripTime = sample;
+			stats.jitter = sample * 0.5;
+			peer->hasRoundTripSample = true;
+		}
+		else
+		{
+			stats.jitter = 0.75 * stats.jitter + 0.25 * glm::abs(stats.roundTripTime - sample);
+			stats.roundTripTime = 0.875 * stats.roundTripTime + 0.125 * sample;
+		}
+
+		if (record.reliable)
+		{
+			auto it = std::find_if(peer->unacked.begin(), peer->unacked.end(), [&record](e2::NetUnackedPacket const& unacked) {
+				return unacked.sequence == record.sequence;
+			});
+
+			if (it != peer->unacked.end())
+				peer->unacked.erase(it);
+		}
+	}
+}
+
+void e2::NetworkManager::deliverIncoming(e2::NetPacket& packet, std::vector<e2::NetPacket>& outPackets)
+{
+	std::scoped_lock lock(m_peerMutex);
+
+	// peer was dropped while this was in flight
+	auto peerIt = m_peerStates.find(packet.peerAddress);
+	if (peerIt == m_peerStates.end())
+		return;
+
+	e2::NetPeerState* peer = peerIt->second;
 
-	sendFragment.address = outPacket.peerAddress;
-	sendFragment.fragment.frameType = e2::NetFrameType::DataFragment;
-	sendFragment.fragment.frameFlags = e2::NetFrameFlags::Default;
-	sendFragment.fragment.fragmentIndex = 0;
-	sendFragment.fragment.numFragments = 1;
-	sendFragment.fragment.fragmentSize = size;
-	memcpy(sendFragment.fragment.fragmentPayload, outPacket.data.read(size), size);
+	if (packet.hasAck)
+		processAcks(peer, packet.ack, packet.ackBits);
 
-	std::scoped_lock lock(m_syncMutex);
-	if (m_outgoingBuffer.full())
+	if (packet.ackOnly)
 	{
-		LogError("outgoing packet buffer full, dropping packet");
+		peer->windowReceivedBytes += e2::netAckFrameSize;
 		return;
 	}
-	e2::NetPeerState* peerState = getOrCreatePeerState(outPacket.peerAddress);
-	sendFragment.fragment.packetId = peerState->outgoingPacketIndex;
-	m_outgoingBuffer.push(sendFragment);
+
+	peer->windowReceivedBytes += packet.data.size() + e2::netFragmentHeaderSize;
+
+	// remember it for our acks. duplicates too, a resend may have crossed our ack
+	if (!peer->hasRemote)
+	{
+		peer->hasRemote = true;
+		peer->remoteSequence = packet.packetId;
+		peer->remoteAckBits = 0;
+	}
+	else if (e2::netSequenceGreater(packet.packetId, peer->remoteSequence))
+	{
+		// slide the window forward, the previous newest becomes bit shift-1
+		uint16_t shift = uint16_t(packet.packetId - peer->remoteSequence);
+		uint32_t ackBits = shift >= 32 ? 0u : peer->remoteAckBits << shift;
+		if (shift <= 32)
+			ackBits |= 1u << (shift - 1);
+
+		peer->remoteAckBits = ackBits;
+		peer->remoteSequence = packet.packetId;
+	}
+	else
+	{
+		uint16_t age = uint16_t(peer->remoteSequence - packet.packetId);
+		if (age >= 1 && age <= 32)
+			peer->remoteAckBits |= 1u << (age - 1);
+	}
+	peer->ackPending = true;
+
+	if (packet.channel == e2::NetChannel::Unreliable)
+	{
+		outPackets.push_back(std::move(packet));
+	}
+	else if (packet.channel == e2::NetChannel::UnreliableSequenced)
+	{
+		if (!peer->hasSequenced || e2::netSequenceGreater(packet.sequence, peer->lastSequenced))
+		{
+			peer->hasSequenced = true;
+			peer->lastSequenced = packet.sequence;
+			outPackets.push_back(std::move(packet));
+		}
+	}
+	else if (packet.channel == e2::NetChannel::ReliableOrdered)
+	{
+		if (packet.sequence == peer->nextReliableSequence)
+		{
+			outPackets.push_back(std::move(packet));
+			peer->nextReliableSequence++;
+
+			// this may have been the gap holding others back
+			for (auto it = peer->bufferedReliable.find(peer->nextReliableSequence); it != peer->bufferedReliable.end(); it = peer->bufferedReliable.find(peer->nextReliableSequence))
+			{
+				outPackets.push_back(std::move(it->second));
+				peer->bufferedReliable.erase(it);
+				peer->nextReliableSequence++;
+			}
+		}
+		else if (e2::netSequenceGreater(packet.sequence, peer->nextReliableSequence) && uint16_t(packet.sequence - peer->nextReliableSequence) < e2::maxBufferedReliablePackets)
+		{
+			// ahead of a gap, hold on to it. does nothing if it's a duplicate
+			peer->bufferedReliable.emplace(packet.sequence, std::move(packet));
+		}
+		// anything else was delivered already, or is too far ahead and will be resent
+	}
+}
+
+void e2::NetworkManager::updateReliability()
+{
+	e2::Moment now = e2::timeNow();
+
+	// what we queued earlier is still waiting on send budget, resending now would only add to the backlog
+	bool congested = m_pendingFragments.size() * e2::netFrameSize > e2::netSendBurstBytes;
+
+	std::scoped_lock lock(m_peerMutex);
+	for (auto& [address, peer] : m_peerStates)
+	{
+		e2::NetPeerStats& stats = peer->stats;
+		double resendTimeout = e2::netInitialResendTimeout;
+		if (peer->hasRoundTripSample)
+			resendTimeout = glm::clamp(stats.roundTripTime + 4.0 * stats.jitter, e2::netMinResendTimeout, e2::netMaxResendTimeout);
+
+		// not acked within two timeouts counts as lost
+		for (e2::NetSentRecord& record : peer->sentHistory)
+		{
+			if (record.valid && !record.acked && !record.countedLost && (now - record.sentAt).seconds() > resendTimeout * 2.0)
+			{
+				record.countedLost = true;
+				peer->windowLost++;
+			}
+		}
+
+		if (!congested)
+		{
+			for (e2::NetUnackedPacket& unacked : peer->unacked)
+			{
+				// exponential backoff, so a congested or dead link isn't hammered
+				double timeout = glm::min(resendTimeout * double(1u << glm::min(unacked.numSends - 1, 5u)), e2::netMaxResendTimeout);
+				if ((now - unacked.lastSent).seconds() < timeout)
+					continue;
+
+				queuePacket(peer, e2::NetChannel::ReliableOrdered, unacked.sequence, unacked.data.data(), unacked.data.size());
+				unacked.numSends++;
+				unacked.lastSent = now;
+				stats.numResent++;
+			}
+		}
+
+		if (peer->ackPending && (now - peer->lastSent).seconds() >= e2::netAckDelay)
+		{
+			e2::NetSendFragment& ackFragment = m_pendingFragments.emplace_back();
+			ackFragment.address = peer->peerAddress;
+			ackFragment.fragment.frameType = e2::NetFrameType::Ack;
+			ackFragment.fragment.frameFlags = e2::NetFrameFlags::HasAck;
+			ackFragment.fragment.packetId = 0;
+			ackFragment.fragment.fragmentIndex = 0;
+			ackFragment.fragment.numFragments = 0;
+			ackFragment.fragment.fragmentSize = 0;
+			ackFragment.fragment.ack = peer->remoteSequence;
+			ackFragment.fragment.ackBits = peer->remoteAckBits;
+
+			peer->ackPending = false;
+			peer->lastSent = now;
+			peer->windowSentBytes += e2::netAckFrameSize;
+		}
+
+		stats.numUnacked = uint32_t(peer->unacked.size());
+
+		double windowSeconds = (now - peer->statsWindowStart).seconds();
+		if (windowSeconds >= 1.0)
+		{
+			stats.sentBytesPerSecond = double(peer->windowSentBytes) / windowSeconds;
+			stats.receivedBytesPerSecond = double(peer->windowReceivedBytes) / windowSeconds;
+
+			uint32_t numResolved = peer->windowAcked + peer->windowLost;
+			if (numResolved > 0)
+				stats.packetLoss = double(peer->windowLost) / double(numResolved);
+
+			peer->statsWindowStart = now;
+			peer->windowSentBytes = 0;
+			peer->windowReceivedBytes = 0;
+			peer->windowAcked = 0;
+			peer->windowLost = 0;
+		}
+	}
+}
+
+bool e2::NetworkManager::peerStats(e2::NetPeerAddress const& address, e2::NetPeerStats& outStats)
+{
+	std::scoped_lock lock(m_peerMutex);
+	auto peerIt = m_peerStates.find(address);
+	if (peerIt == m_peerStates.end())
+		return false;
+
+	outStats = peerIt->second->stats;
+	outStats.numUnacked = uint32_t(peerIt->second->unacked.size());
+	return true;
+}
+
+void e2::NetworkManager::delayFrame(e2::NetDelayedFrame const& frame)
+{
+	auto laterFirst = [](e2::NetDelayedFrame const& lhs, e2::NetDelayedFrame const& rhs) {
+		return lhs.releaseAt.m_point > rhs.releaseAt.m_point;
+	};
+
+	m_delayedFrames.push_back(frame);
+	std::push_heap(m_delayedFrames.begin(), m_delayedFrames.end(), laterFirst);
+}
+
+uint32_t e2::NetworkManager::sendDelayedFrames()
+{
+	auto laterFirst = [](e2::NetDelayedFrame const& lhs, e2::NetDelayedFrame const& rhs) {
+		return lhs.releaseAt.m_point > rhs.releaseAt.m_point;
+	};
+
+	e2::Moment now = e2::timeNow();
+	while (!m_delayedFrames.empty())
+	{
+		e2::NetDelayedFrame const& next = m_delayedFrames.front();
+		if (next.releaseAt.m_point > now.m_point)
+		{
+			double untilNext = (e2::Moment(next.releaseAt) - now).seconds();
+			return uint32_t(glm::ceil(untilNext * 1000.0));
+		}
+
+		sockaddr_in addr;
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = next.address.address;
+		addr.sin_port = next.address.port;
+		sendto(m_socket, reinterpret_cast<char const*>(next.data), next.size, 0, (sockaddr*)&addr, sizeof(addr));
+
+		std::pop_heap(m_delayedFrames.begin(), m_delayedFrames.end(), laterFirst);
+		m_delayedFrames.pop_back();
+	}
+
+	return UINT32_MAX;
+}
+
+void e2::NetworkManager::flushOutgoing()
+{
+	e2::Moment now = e2::timeNow();
+	m_sendBudget = glm::min(m_sendBudget + (now - m_lastFlush).seconds() * double(e2::netSendBytesPerSecond), double(e2::netSendBurstBytes));
+	m_lastFlush = now;
+
+	bool queuedAny = false;
+	while (!m_pendingFragments.empty() && m_sendBudget > 0.0)
+	{
+		e2::NetSendFragment& sendFragment = m_pendingFragments.front();
+		if (!m_outgoingBuffer.push(sendFragment))
+			break;
+
+		m_sendBudget -= double(e2::netFragmentHeaderSize + sendFragment.fragment.fragmentSize);
+		m_pendingFragments.pop_front();
+		queuedAny = true;
+	}
+
+	if (queuedAny)
+		wakeThread();
+}
+
+void e2::NetworkManager::releaseReceiveState(e2::NetReceiveState& state)
+{
+	if (state.packetData)
+		m_reassemblyPool.release(state.packetData, state.sizeClass);
+
+	state.packetData = nullptr;
+	state.fragmentsReceived = nullptr;
+}
+
+void e2::NetworkManager::expireReassembly()
+{
+	if (m_numOverBudget > 0)
+	{
+		LogWarning("dropped {} fragments that would have gone over the reassembly budget", m_numOverBudget);
+		m_numOverBudget = 0;
+	}
+
+	if (m_reassemblyPool.numInUse() == 0)
+		return;
+
+	uint32_t numExpired{};
+	std::scoped_lock lock(m_peerMutex);
+	for (auto& [address, state] : m_peerStates)
+	{
+		for (auto it = state->receivingPackets.begin(); it != state->receivingPackets.end(); )
+		{
+			if (it->second.firstReceived.durationSince().seconds() > e2::netReassemblyTimeout)
+			{
+				releaseReceiveState(it->second);
+				it = state->receivingPackets.erase(it);
+				numExpired++;
+			}
+			else
+			{
+				it++;
+			}
+		}
+	}
+
+	if (numExpired > 0)
+		LogWarning("dropped {} incomplete packets after {}s", numExpired, e2::netReassemblyTimeout);
+}
+
+bool e2::NetworkManager::benchmarkLoopback(uint16_t port, uint32_t numPackets)
+{
+	if (m_state != e2::NetworkState::Offline)
+	{
+		LogError("loopback benchmark needs the network to be offline");
+		return false;
+	}
+
+	startServer(port);
+	if (m_state != e2::NetworkState::Server)
+		return false;
+
+	e2::NetSocket sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sender == e2::invalidNetSocket)
+	{
+		LogError("socket failed: {}", s_socketError());
+		disable();
+		return false;
+	}
+
+	sockaddr_in addr;
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	// one small single-fragment packet, same framing as s_sendFragment
+	e2::NetFragment fragment{};
+	fragment.frameType = e2::NetFrameType::DataFragment;
+	fragment.frameFlags = e2::NetFrameFlags::Default;
+	fragment.numFragments = 1;
+	fragment.fragmentSize = 8;
+	fragment.channel = e2::NetChannel::Unreliable;
+
+	uint8_t frame[e2::netFrameSize];
+	uint64_t frameSize = ::s_writeFrame(fragment, frame);
+
+	uint32_t numSent{};
+	uint32_t numReceived{};
+	e2::Moment begin = e2::timeNow();
+	while (numReceived < numPackets && begin.durationSince().seconds() < 5.0)
+	{
+		// bound what's in flight, so we measure throughput rather than how fast the socket buffer overflows
+		while (numSent < numPackets && numSent - numReceived < e2::maxBufferedPackets / 2)
+		{
+			sendto(sender, reinterpret_cast<char*>(frame), int32_t(frameSize), 0, (sockaddr*)&addr, sizeof(addr));
+			numSent++;
+		}
+
+		e2::NetPacket packet;
+		while (m_incomingBuffer.pop(packet))
+			numReceived++;
+	}
+	double seconds = begin.durationSince().seconds();
+
+	// what's in flight fits the socket buffer many times over, so loopback must not lose any
+	bool passed = numReceived == numPackets;
+	if (passed)
+		LogNotice("loopback benchmark passed: {} of {} packets arrived in {:.3f}s, {:.0f} packets/s", numReceived, numPackets, seconds, double(numReceived) / seconds);
+	else
+		LogError("loopback benchmark failed: {} of {} packets arrived in {:.3f}s", numReceived, numPackets, seconds);
+
+	s_closeSocket(sender);
+
+	disable();
+	return passed;
+}
+
+bool e2::NetworkManager::testLoopbackFragments(uint16_t port, uint32_t packetSize, uint32_t numPackets, float packetLoss)
+{
+	if (m_state != e2::NetworkState::Offline)
+	{
+		LogError("loopback fragment test needs the network to be offline");
+		return false;
+	}
+
+	startServer(port);
+	if (m_state != e2::NetworkState::Server)
+		return false;
+
+	setSimulatedPacketLoss(packetLoss);
+
+	e2::NetPeerAddress selfAddress;
+	selfAddress.address = htonl(INADDR_LOOPBACK);
+	selfAddress.port = htons(port);
+
+	auto patternByte = [](uint32_t packetIndex, uint32_t byteIndex) -> uint8_t {
+		return uint8_t((packetIndex * 31 + byteIndex * 7) & 0xFF);
+	};
+
+	std::vector<uint8_t> payload(packetSize);
+	for (uint32_t p = 0; p < numPackets; p++)
+	{
+		for (uint32_t i = 0; i < packetSize; i++)
+			payload[i] = patternByte(p, i);
+
+		e2::NetPacket packet;
+		packet.peerAddress = selfAddress;
+		packet.data << p;
+		packet.data.write(payload.data(), payload.size());
+		sendPacket(packet);
+	}
+
+	uint32_t numIntact{};
+	uint32_t numCorrupt{};
+
+	// long enough to pace everything out, and for whatever is left incomplete to time out
+	double transferSeconds = double(numPackets) * double(packetSize) / double(e2::netSendBytesPerSecond);
+	double deadline = transferSeconds + e2::netReassemblyTimeout + 1.5;
+
+	e2::Moment begin = e2::timeNow();
+	while (begin.durationSince().seconds() < deadline)
+	{
+		flushOutgoing();
+
+		e2::NetPacket packet;
+		while (m_incomingBuffer.pop(packet))
+		{
+			uint32_t packetIndex{};
+			packet.data >> packetIndex;
+
+			bool intact = packet.data.remaining() == packetSize;
+			if (intact)
+			{
+				uint8_t const* received = packet.data.read(packetSize);
+				for (uint32_t i = 0; i < packetSize && intact; i++)
+					intact = received[i] == patternByte(packetIndex, i);
+			}
+
+			if (intact)
+				numIntact++;
+			else
+				numCorrupt++;
+		}
+
+		// done early if everything arrived and nothing is left to time out
+		if (numIntact + numCorrupt == numPackets && m_pendingFragments.empty())
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	uint32_t numLeft = m_reassemblyPool.numInUse();
+
+	// a packet survives when every one of its fragments does. Demand half of that, loss is random
+	uint32_t numFragments = uint32_t((packetSize + e2::maxFragmentPayloadSize - 1) / e2::maxFragmentPayloadSize);
+	double expectedIntact = double(numPackets) * std::pow(1.0 - double(packetLoss), double(numFragments));
+	bool enoughIntact = packetLoss > 0.0f ? double(numIntact) >= expectedIntact * 0.5 : numIntact == numPackets;
+	bool passed = numCorrupt == 0 && numLeft == 0 && enoughIntact;
+
+	LogNotice("loopback fragment test {}: {} packets of {} bytes at {:.1f}% frame loss, {} intact, {} corrupt, {} lost, {} left in reassembly after {:.2f}s",
+		passed ? "passed" : "FAILED", numPackets, packetSize, packetLoss * 100.0f, numIntact, numCorrupt, numPackets - numIntact - numCorrupt, numLeft, begin.durationSince().seconds());
+
+	setSimulatedPacketLoss(0.0f);
+	disable();
+	return passed;
+}
+
+bool e2::NetworkManager::testLoopbackReliability(uint16_t port, uint32_t numMessages, float packetLoss, double latency, double jitter)
+{
+	if (m_state != e2::NetworkState::Offline)
+	{
+		LogError("loopback reliability test needs the network to be offline");
+		return false;
+	}
+
+	startServer(port);
+	if (m_state != e2::NetworkState::Server)
+		return false;
+
+	setSimulatedPacketLoss(packetLoss);
+	setSimulatedLatency(latency, jitter);
+
+	e2::NetPeerAddress selfAddress;
+	selfAddress.address = htonl(INADDR_LOOPBACK);
+	selfAddress.port = htons(port);
+
+	// even messages go reliable-ordered, odd ones unreliable-sequenced
+	uint32_t numReliable = (numMessages + 1) / 2;
+	uint32_t numSent{};
+	uint32_t numReliableReceived{};
+	uint32_t numOutOfOrder{};
+	uint32_t numSequencedReceived{};
+	uint32_t numSequencedBackwards{};
+	int64_t lastSequencedIndex = -1;
+
+	e2::NetPeerStats stats;
+	std::vector<e2::NetPacket> readyPackets;
+
+	e2::Moment begin = e2::timeNow();
+	while (begin.durationSince().seconds() < 30.0)
+	{
+		// one message per tick like a game would, so acks get to ride along with data
+		if (numSent < numMessages)
+		{
+			e2::NetPacket packet;
+			packet.peerAddress = selfAddress;
+			packet.channel = numSent % 2 == 0 ? e2::NetChannel::ReliableOrdered : e2::NetChannel::UnreliableSequenced;
+			packet.data << numSent;
+			sendPacket(packet);
+			numSent++;
+		}
+
+		updateReliability();
+		flushOutgoing();
+
+		e2::NetPacket packet;
+		while (m_incomingBuffer.pop(packet))
+		{
+			readyPackets.clear();
+			deliverIncoming(packet, readyPackets);
+
+			for (e2::NetPacket& readyPacket : readyPackets)
+			{
+				uint32_t messageIndex{};
+				readyPacket.data >> messageIndex;
+
+				if (readyPacket.channel == e2::NetChannel::ReliableOrdered)
+				{
+					if (messageIndex != numReliableReceived * 2)
+						numOutOfOrder++;
+					numReliableReceived++;
+				}
+				else
+				{
+					if (int64_t(messageIndex) <= lastSequencedIndex)
+						numSequencedBackwards++;
+					lastSequencedIndex = messageIndex;
+					numSequencedReceived++;
+				}
+			}
+		}
+
+		if (numSent == numMessages && numReliableReceived >= numReliable && peerStats(selfAddress, stats) && stats.numUnacked == 0)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	peerStats(selfAddress, stats);
+	bool passed = numReliableReceived == numReliable && numOutOfOrder == 0 && numSequencedBackwards == 0 && stats.numUnacked == 0;
+
+	LogNotice("loopback reliability test {}: {} messages at {:.1f}% frame loss, {:.0f}ms (+{:.0f}ms) latency. reliable {}/{} ({} out of order), sequenced {}/{} ({} backwards) after {:.2f}s",
+		passed ? "passed" : "FAILED", numMessages, packetLoss * 100.0f, latency * 1000.0, jitter * 1000.0, numReliableReceived, numReliable, numOutOfOrder,
+		numSequencedReceived, numMessages - numReliable, numSequencedBackwards, begin.durationSince().seconds());
+	LogNotice("loopback reliability stats: rtt {:.1f}ms, jitter {:.1f}ms, loss {:.1f}%, {:.1f}KB/s out, {:.1f}KB/s in, {} resent",
+		stats.roundTripTime * 1000.0, stats.jitter * 1000.0, stats.packetLoss * 100.0, stats.sentBytesPerSecond / 1024.0, stats.receivedBytesPerSecond / 1024.0, stats.numResent);
+
+	setSimulatedPacketLoss(0.0f);
+	setSimulatedLatency(0.0, 0.0);
+	disable();
+	return passed;
 }
 
 void e2::NetworkManager::registerHandler(uint8_t handlerId, PacketHandlerCallback handler)
@@ -666,3 +1709,73 @@ e2::NetPacket::NetPacket(e2::NetPeerAddress const& address, uint8_t const* packe
 	data.write(packetData, packetSize);
 	data.seek(0);
 }
+
+e2::NetReassemblyPool::~NetReassemblyPool()
+{
+	clear();
+}
+
+uint8_t* e2::NetReassemblyPool::acquire(uint16_t numFragments, uint8_t& outSizeClass)
+{
+	outSizeClass = sizeClass(numFragments);
+
+	uint8_t* buffer{};
+	std::vector<uint8_t*>& freeList = m_free[outSizeClass];
+	if (!freeList.empty())
+	{
+		buffer = freeList.back();
+		freeList.pop_back();
+	}
+	else
+	{
+		buffer = new uint8_t[bufferSize(outSizeClass)];
+	}
+
+	uint64_t capacity = uint64_t(1) << outSizeClass;
+	std::memset(buffer + bitsOffset(outSizeClass), 0, (capacity + 7) / 8);
+
+	m_numInUse++;
+	m_bytesInUse += bufferSize(outSizeClass);
+	return buffer;
+}
+
+void e2::NetReassemblyPool::release(uint8_t* buffer, uint8_t sizeClass)
+{
+	m_numInUse--;
+	m_bytesInUse -= bufferSize(sizeClass);
+
+	std::vector<uint8_t*>& freeList = m_free[sizeClass];
+	if (freeList.size() >= maxPooledPerClass)
+	{
+		delete[] buffer;
+		return;
+	}
+
+	freeList.push_back(buffer);
+}
+
+void e2::NetReassemblyPool::clear()
+{
+	for (std::vector<uint8_t*>& freeList : m_free)
+	{
+		for (uint8_t* buffer : freeList)
+			delete[] buffer;
+		freeList.clear();
+	}
+}
+
+uint64_t e2::NetReassemblyPool::bitsOffset(uint8_t sizeClass)
+{
+	return (uint64_t(1) << sizeClass) * e2::maxFragmentPayloadSize;
+}
+
+uint8_t e2::NetReassemblyPool::sizeClass(uint16_t numFragments)
+{
+	return uint8_t(std::bit_width(uint32_t(glm::max<uint16_t>(numFragments, 1)) - 1));
+}
+
+uint64_t e2::NetReassemblyPool::bufferSize(uint8_t sizeClass)
+{
+	uint64_t capacity = uint64_t(1) << sizeClass;
+	return bitsOffset(sizeClass) + (capacity + 7) / 8;
+}
@@ -31,75 +31,85 @@ uint32_t e2::RenderManager::paddedBufferSize(uint32_t originalSize)
 }
 
 
-e2::IVertexLayout* e2::RenderManager::getOrCreateVertexLayout(e2::VertexAttributeFlags flags)
+e2::IVertexLayout* e2::RenderManager::getOrCreateVertexLayout(e2::VertexAttributeFlags flags, bool instanced, bool quantized)
 {
 	std::scoped_lock lock(m_vertexLayoutCacheMutex);
-	uint8_t index = uint8_t(flags);
+	uint8_t index = uint8_t(flags) + (instanced ? e2::maxNumAttributePermutations : 0) + (quantized ? e2::maxNumAttributePermutations * 2 : 0);
 	if (m_vertexLayoutCache[index])
 		return m_vertexLayoutCache[index];
 
 	uint32_t currentIndex = 0;
 	e2::VertexLayoutCreateInfo createInfo{};
 
-	auto addVec4 = [&currentIndex, &createInfo]() {
+	auto addStream = [&currentIndex, &createInfo, quantized](e2::VertexStream stream) {
 		e2::VertexLayoutAttribute newAttribute;
 		newAttribute.bindingIndex = currentIndex++;
-		newAttribute.format = VertexFormat::Vec4;
+		newAttribute.format = e2::vertexStreamFormat(stream, quantized);
 		newAttribute.offset = 0;
 		createInfo.attributes.push(newAttribute);
 
 		e2::VertexLayoutBinding newBinding;
 		newBinding.rate = VertexRate::PerVertex;
-		newBinding.stride = sizeof(glm::vec4);
-		createInfo.bindings.push(newBinding);
-	};
-
-	auto addVec4u = [&currentIndex, &createInfo]() {
-		e2::VertexLayoutAttribute newAttribute;
-		newAttribute.bindingIndex = currentIndex++;
-		newAttribute.format = VertexFormat::Vec4u;
-		newAttribute.offset = 0;
-		createInfo.attributes.push(newAttribute);
-
-		e2::VertexLayoutBinding newBinding;
-		newBinding.rate = VertexRate::PerVertex;
-		newBinding.stride = sizeof(glm::uvec4);
+		newBinding.stride = e2::vertexStreamStride(stream, quantized);
 		createInfo.bindings.push(newBinding);
 	};
 
 	// add position 
-	addVec4();
+	addStream(e2::VertexStream::Position);
 
 	// add normal and tangent
 	if (uint8_t(flags) & uint8_t(e2::VertexAttributeFlags::Normal))
 	{
-		addVec4();
-		addVec4();
+		addStream(e2::VertexStream::Normal);
+		addStream(e2::VertexStream::Tangent);
 	}
 
 	// add texcoords01 
 	if (uint8_t(flags) & uint8_t(e2::VertexAttributeFlags::TexCoords01))
 	{
-		addVec4();
+		addStream(e2::VertexStream::TexCoords01);
 	}
 
 	// add texcoords23 
 	if (uint8_t(flags) & uint8_t(e2::VertexAttributeFlags::TexCoords23))
 	{
-		addVec4();
+		addStream(e2::VertexStream::TexCoords23);
 	}
 	
 	// add color 
 	if (uint8_t(flags) & uint8_t(e2::VertexAttributeFlags::Color))
 	{
-		addVec4();
+		addStream(e2::VertexStream::Color);
 	}
 
 	// add bone weights and ids
 	if (uint8_t(flags) & uint8_t(e2::VertexAttributeFlags::Bones))
 	{
-		addVec4();
-		addVec4u();
+		addStream(e2::VertexStream::Weights);
+		addStream(e2::VertexStream::Bones);
+	}
+
+	// add instance data, both attributes from one per-instance binding after the mesh bindings
+	if (instanced)
+	{
+		uint32_t instanceBinding = currentIndex++;
+
+		e2::VertexLayoutAttribute transformAttribute;
+		transformAttribute.bindingIndex = instanceBinding;
+		transformAttribute.format = VertexFormat::Vec4;
+		transformAttribute.offset = offsetof(e2::InstanceData, transform);
+		createInfo.attributes.push(transformAttribute);
+
+		e2::VertexLayoutAttribute parametersAttribute;
+		parametersAttribute.bindingIndex = instanceBinding;
+		parametersAttribute.format = VertexFormat::Vec4;
+		parametersAttribute.offset = offsetof(e2::InstanceData, parameters);
+		createInfo.attributes.push(parametersAttribute);
+
+		e2::VertexLayoutBinding newBinding;
+		newBinding.rate = VertexRate::PerInstance;
+		newBinding.stride = sizeof(e2::InstanceData);
+		createInfo.bindings.push(newBinding);
 	}
 
 	e2::IVertexLayout* newLayout = renderContext()->createVertexLayout(createInfo);
@@ -204,8 +214,8 @@ void e2::RenderManager::invalidatePipelines()
 e2::RenderManager::RenderManager(Engine* owner)
 	: e2::Manager(owner)
 {
-	m_vertexLayoutCache.resize(e2::maxNumAttributePermutations);
-	for (uint32_t i = 0; i < e2::maxNumAttributePermutations; i++)
+	m_vertexLayoutCache.resize(e2::maxNumAttributePermutations * 4);
+	for (uint32_t i = 0; i < e2::maxNumAttributePermutations * 4; i++)
 	{
 		m_vertexLayoutCache[i] = nullptr;
 	}
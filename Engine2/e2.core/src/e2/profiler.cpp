@@ -0,0 +1,670 @@
+
+#include "e2/profiler.hpp"
+
+#if defined(E2_PROFILER)
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace e2
+{
+	/** A thread's scopes and events for one profiler. The stack is only touched by its thread, the events under the mutex */
+	struct ProfileThread
+	{
+		struct OpenScope
+		{
+			e2::ProfileMarker marker;
+			uint64_t start{};
+			uint64_t childDuration{};
+		};
+
+		e2::StackVector<OpenScope, e2::profileStackSize> stack;
+
+		std::mutex mutex;
+		std::vector<e2::ProfileEvent> events;
+		uint64_t head{}; // events ever written, events[head % profileEventBufferSize] is the next one
+		uint64_t rolledUp{}; // events newFrame has rolled up
+
+		uint32_t index{};
+		std::string name;
+
+		void push(e2::ProfileEvent const& newEvent)
+		{
+			std::scoped_lock lock(mutex);
+			if (events.empty())
+				events.resize(e2::profileEventBufferSize);
+
+			events[head % e2::profileEventBufferSize] = newEvent;
+			head++;
+		}
+	};
+}
+
+namespace
+{
+	std::atomic<uint64_t> nextProfilerSerial{ 1 };
+
+	struct ThreadBinding
+	{
+		uint64_t serial{};
+		std::shared_ptr<e2::ProfileThread> thread;
+	};
+
+	// profilers this thread has profiled with, and the one it used last
+	thread_local std::vector<ThreadBinding> threadBindings;
+	thread_local uint64_t lastSerial{};
+	thread_local e2::ProfileThread* lastThread{};
+
+	uint64_t profileTime()
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	char const* groupName(e2::ProfileGroupId group)
+	{
+		switch (group)
+		{
+		case e2::ProfileGroupId::Animation: return "Animation";
+		case e2::ProfileGroupId::Rendering: return "Rendering";
+		case e2::ProfileGroupId::Scripting: return "Scripting";
+		case e2::ProfileGroupId::WorldGeneration: return "WorldGeneration";
+		case e2::ProfileGroupId::Async: return "Async";
+		default: return "Default";
+		}
+	}
+
+	void appendJsonString(std::string& out, std::string_view text)
+	{
+		out += '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if (uint8_t(c) < 0x20)
+				std::format_to(std::back_inserter(out), "\\u{:04x}", uint32_t(c));
+			else
+				out += c;
+		}
+		out += '"';
+	}
+}
+
+e2::Profiler::Profiler()
+	: m_serial(::nextProfilerSerial.fetch_add(1))
+{
+	m_groups.resize(size_t(e2::ProfileGroupId::Count));
+	for (uint8_t i = 0; i < uint8_t(e2::ProfileGroupId::Count); i++)
+		m_groups[i].displayName = ::groupName(e2::ProfileGroupId(i));
+}
+
+e2::Profiler::~Profiler()
+{
+	// threads drop their buffers for this profiler the next time they look theirs up
+	std::scoped_lock lock(m_threadsMutex);
+	m_threads.clear();
+}
+
+e2::ProfileThread* e2::Profiler::thread()
+{
+	if (::lastSerial == m_serial)
+		return ::lastThread;
+
+	std::shared_ptr<e2::ProfileThread> found;
+	for (::ThreadBinding& binding : ::threadBindings)
+	{
+		if (binding.serial == m_serial)
+		{
+			found = binding.thread;
+			break;
+		}
+	}
+
+	if (!found)
+	{
+		// buffers only this thread still holds belong to profilers that are gone
+		std::erase_if(::threadBindings, [](::ThreadBinding const& binding) {
+			return binding.thread.use_count() == 1;
+		});
+
+		found = std::make_shared<e2::ProfileThread>();
+
+		std::scoped_lock lock(m_threadsMutex);
+		found->index = uint32_t(m_threads.size());
+		found->name = std::format("Thread {}", found->index);
+		m_threads.push_back(found);
+		::threadBindings.push_back({ m_serial, found });
+	}
+
+	::lastSerial = m_serial;
+	::lastThread = found.get();
+	return ::lastThread;
+}
+
+void e2::Profiler::start()
+{
+	if (m_enabled)
+		return;
+
+	for (uint8_t i = 0; i < uint8_t(e2::ProfileGroupId::Count); i++)
+	{
+		e2::ProfileGroup* grp = &m_groups[i];
+		grp->highTimeInFrame = 0.0;
+
+		grp->avgTimeInFrame = 0.0;
+		grp->timeInFrame = 0.0;
+	}
+
+	{
+		std::scoped_lock lock(m_threadsMutex);
+		for (std::shared_ptr<e2::ProfileThread>& thread : m_threads)
+		{
+			std::scoped_lock threadLock(thread->mutex);
+			thread->head = 0;
+			thread->rolledUp = 0;
+		}
+	}
+
+	m_functions.clear();
+	m_numFrames = 0;
+	m_startTime = ::profileTime();
+	m_frameStart = m_startTime;
+	m_enabled = true;
+}
+
+void e2::Profiler::stop()
+{
+	m_enabled = false;
+}
+
+void e2::Profiler::newFrame()
+{
+	if (!m_enabled)
+		return;
+
+	uint64_t now = ::profileTime();
+
+	static e2::ProfileMarker const frameMarker{ "Frame" };
+	e2::ProfileEvent frameEvent;
+	frameEvent.marker = frameMarker;
+	frameEvent.type = e2::ProfileEventType::Frame;
+	frameEvent.start = m_frameStart;
+	frameEvent.duration = now - m_frameStart;
+	frameEvent.value = double(m_numFrames);
+	thread()->push(frameEvent);
+	m_frameStart = now;
+
+	std::vector<std::shared_ptr<e2::ProfileThread>> threads;
+	{
+		std::scoped_lock lock(m_threadsMutex);
+		threads = m_threads;
+	}
+
+	for (std::shared_ptr<e2::ProfileThread>& thread : threads)
+	{
+		std::scoped_lock lock(thread->mutex);
+
+		// anything older has been overwritten already
+		uint64_t first = std::max(thread->rolledUp, thread->head > e2::profileEventBufferSize ? thread->head - e2::profileEventBufferSize : 0);
+		for (uint64_t i = first; i < thread->head; i++)
+		{
+			e2::ProfileEvent const& event = thread->events[i % e2::profileEventBufferSize];
+			if (event.type != e2::ProfileEventType::Scope)
+				continue;
+
+			auto finder = m_functions.find(event.marker.name);
+			if (finder == m_functions.end())
+			{
+				finder = m_functions.emplace(event.marker.name, e2::ProfileFunction()).first;
+				finder->second.displayName = event.marker.name;
+			}
+
+			e2::ProfileFunction* func = &finder->second;
+			double secondsInScope = double(event.selfDuration) / 1e9;
+
+			m_groups[size_t(event.marker.group)].timeInFrame += secondsInScope;
+
+			func->timeInFrame += secondsInScope;
+			func->timeInScope += secondsInScope;
+			if (secondsInScope > func->highTimeInScope)
+				func->highTimeInScope = secondsInScope;
+			func->avgTimeInScope = (double(func->timesInScope) * func->avgTimeInScope + secondsInScope) / (double(func->timesInScope) + 1.0);
+
+			func->timesInScope++;
+		}
+
+		thread->rolledUp = thread->head;
+	}
+
+	for (auto& [id, function] : m_functions)
+	{
+		e2::ProfileFunction* func = &function;
+		
+		if (func->timeInFrame > func->highTimeInFrame)
+			func->highTimeInFrame = func->timeInFrame;
+
+		func->avgTimeInFrame = (double(m_numFrames) * func->avgTimeInFrame + func->timeInFrame) / (double(m_numFrames) + 1.0);
+
+		func->timeInFrame = 0.0;
+	}
+
+	for (uint8_t i = 0; i < uint8_t(e2::ProfileGroupId::Count); i++)
+	{
+		e2::ProfileGroup* grp = &m_groups[i];
+		if (grp->timeInFrame > grp->highTimeInFrame)
+			grp->highTimeInFrame = grp->timeInFrame;
+
+		grp->avgTimeInFrame = (double(m_numFrames) * grp->avgTimeInFrame + grp->timeInFrame) / (double(m_numFrames) + 1.0);
+		grp->timeInFrame = 0.0;
+	}
+
+	m_numFrames++;
+}
+
+bool e2::Profiler::beginScope(e2::ProfileMarker const& marker)
+{
+	if (!m_enabled.load(std::memory_order_relaxed))
+		return false;
+
+	e2::ProfileThread* thread = this->thread();
+	if (thread->stack.size() >= e2::profileStackSize)
+	{
+		LogError("Profile scopes nested deeper than {}, ignoring {}", e2::profileStackSize, marker.name);
+		return false;
+	}
+
+	e2::ProfileThread::OpenScope newScope;
+	newScope.marker = marker;
+	newScope.start = ::profileTime();
+	thread->stack.push(newScope);
+	return true;
+}
+
+void e2::Profiler::endScope()
+{
+	uint64_t now = ::profileTime();
+
+	e2::ProfileThread* thread = this->thread();
+	if (thread->stack.empty())
+	{
+		LogError("Mismatching profiler scope brackets; ended scope but we ain't got none.");
+		return;
+	}
+
+	e2::ProfileThread::OpenScope top = thread->stack.back();
+	thread->stack.pop();
+
+	uint64_t duration = now - top.start;
+	if (!thread->stack.empty())
+		thread->stack.back().childDuration += duration;
+
+	// scopes opened before a stop still have to be closed, but aren't recorded
+	if (!m_enabled.load(std::memory_order_relaxed) || top.start < m_startTime)
+		return;
+
+	e2::ProfileEvent newEvent;
+	newEvent.marker = top.marker;
+	newEvent.type = e2::ProfileEventType::Scope;
+	newEvent.depth = uint8_t(std::min<size_t>(thread->stack.size(), UINT8_MAX));
+	newEvent.start = top.start;
+	newEvent.duration = duration;
+	newEvent.selfDuration = duration - top.childDuration;
+	thread->push(newEvent);
+}
+
+void e2::Profiler::counter(e2::ProfileMarker const& marker, double value)
+{
+	if (!m_enabled.load(std::memory_order_relaxed))
+		return;
+
+	e2::ProfileEvent newEvent;
+	newEvent.marker = marker;
+	newEvent.type = e2::ProfileEventType::Counter;
+	newEvent.start = ::profileTime();
+	newEvent.value = value;
+	thread()->push(newEvent);
+}
+
+void e2::Profiler::setThreadName(std::string const& name)
+{
+	e2::ProfileThread* thread = this->thread();
+	std::scoped_lock lock(thread->mutex);
+	thread->name = name;
+}
+
+e2::ProfileReport e2::Profiler::report()
+{
+	e2::ProfileReport returner;
+	for (auto& [id, func] : m_functions)
+	{
+		returner.functions.push_back(func);
+	}
+	std::sort(returner.functions.begin(), returner.functions.end(), [](e2::ProfileFunction const& lhs, e2::ProfileFunction const& rhs) -> bool { return lhs.avgTimeInFrame > rhs.avgTimeInFrame;  });
+
+	returner.groups = m_groups;
+	
+	return returner;
+}
+
+uint32_t e2::Profiler::numThreads()
+{
+	std::scoped_lock lock(m_threadsMutex);
+	return uint32_t(m_threads.size());
+}
+
+std::vector<e2::ProfileEvent> e2::Profiler::events(uint32_t threadIndex)
+{
+	std::shared_ptr<e2::ProfileThread> thread;
+	{
+		std::scoped_lock lock(m_threadsMutex);
+		if (threadIndex >= m_threads.size())
+			return {};
+		thread = m_threads[threadIndex];
+	}
+
+	std::vector<e2::ProfileEvent> returner;
+	std::scoped_lock lock(thread->mutex);
+	uint64_t first = thread->head > e2::profileEventBufferSize ? thread->head - e2::profileEventBufferSize : 0;
+	returner.reserve(thread->head - first);
+	for (uint64_t i = first; i < thread->head; i++)
+		returner.push_back(thread->events[i % e2::profileEventBufferSize]);
+
+	return returner;
+}
+
+std::string e2::Profiler::traceJson()
+{
+	std::vector<std::shared_ptr<e2::ProfileThread>> threads;
+	{
+		std::scoped_lock lock(m_threadsMutex);
+		threads = m_threads;
+	}
+
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separate = [&out, &first]() {
+		if (!first)
+			out += ",\n";
+		first = false;
+	};
+
+	for (std::shared_ptr<e2::ProfileThread>& thread : threads)
+	{
+		std::string name;
+		{
+			std::scoped_lock lock(thread->mutex);
+			name = thread->name;
+		}
+
+		separate();
+		std::format_to(std::back_inserter(out), "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":", thread->index);
+		::appendJsonString(out, name);
+		out += "}}";
+
+		for (e2::ProfileEvent const& event : events(thread->index))
+		{
+			// microseconds since start, which is what trace viewers expect
+			double ts = double(int64_t(event.start - m_startTime)) / 1000.0;
+
+			separate();
+			if (event.type == e2::ProfileEventType::Scope)
+			{
+				out += "{\"name\":";
+				::appendJsonString(out, event.marker.name);
+				std::format_to(std::back_inserter(out), ",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}", ::groupName(event.marker.group), ts, double(event.duration) / 1000.0, thread->index);
+			}
+			else if (event.type == e2::ProfileEventType::Counter)
+			{
+				out += "{\"name\":";
+				::appendJsonString(out, event.marker.name);
+				std::format_to(std::back_inserter(out), ",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":1,\"tid\":{},\"args\":{{\"value\":{}}}}}", ts, thread->index, event.value);
+			}
+			else
+			{
+				std::format_to(std::back_inserter(out), "{{\"name\":\"Frame {}\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.3f},\"pid\":1,\"tid\":{}}}", uint64_t(event.value), ts + double(event.duration) / 1000.0, thread->index);
+			}
+		}
+	}
+
+	out += "\n]}\n";
+	return out;
+}
+
+bool e2::Profiler::writeTrace(std::string const& path)
+{
+	std::string json = traceJson();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(json.data(), json.size());
+	if (!file)
+	{
+		LogError("Failed to write trace {}", path);
+		return false;
+	}
+
+	return true;
+}
+
+namespace
+{
+	void spinFor(uint64_t nanoseconds)
+	{
+		uint64_t end = ::profileTime() + nanoseconds;
+		while (::profileTime() < end);
+	}
+
+	/** Checks a thread's scopes nest, sit at the right depth, and that their exclusive times add up */
+	bool checkNesting(std::vector<e2::ProfileEvent> const& events, uint32_t threadIndex)
+	{
+		for (e2::ProfileEvent const& parent : events)
+		{
+			if (parent.type != e2::ProfileEventType::Scope)
+				continue;
+
+			uint64_t childDuration{};
+			for (e2::ProfileEvent const& child : events)
+			{
+				if (&child == &parent || child.type != e2::ProfileEventType::Scope)
+					continue;
+
+				bool inside = child.start >= parent.start && child.start + child.duration <= parent.start + parent.duration;
+				bool outside = child.start + child.duration <= parent.start || child.start >= parent.start + parent.duration;
+				bool around = parent.start >= child.start && parent.start + parent.duration <= child.start + child.duration;
+				if (!inside && !outside && !around)
+				{
+					LogError("thread {}: {} and {} overlap without nesting", threadIndex, parent.marker.name, child.marker.name);
+					return false;
+				}
+
+				if (inside && !around && child.depth <= parent.depth)
+				{
+					LogError("thread {}: {} at depth {} is inside {} at depth {}", threadIndex, child.marker.name, child.depth, parent.marker.name, parent.depth);
+					return false;
+				}
+
+				if (inside && !around && child.depth == parent.depth + 1)
+					childDuration += child.duration;
+			}
+
+			if (parent.selfDuration != parent.duration - childDuration)
+			{
+				LogError("thread {}: {} has {}ns to itself, expected {}ns", threadIndex, parent.marker.name, parent.selfDuration, parent.duration - childDuration);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	uint64_t countOf(std::string const& text, std::string_view pattern)
+	{
+		uint64_t count{};
+		for (size_t offset = text.find(pattern); offset != std::string::npos; offset = text.find(pattern, offset + pattern.size()))
+			count++;
+		return count;
+	}
+}
+
+bool e2::testProfiler()
+{
+	static e2::ProfileMarker const outerMarker{ "testProfiler.outer" };
+	static e2::ProfileMarker const innerMarker{ "testProfiler.inner", e2::ProfileGroupId::Async };
+	static e2::ProfileMarker const leafMarker{ "testProfiler.leaf", e2::ProfileGroupId::Async };
+	static e2::ProfileMarker const counterMarker{ "testProfiler.counter" };
+	static e2::ProfileMarker const emptyMarker{ "testProfiler.empty" };
+
+	constexpr uint32_t numWorkers = 4;
+	constexpr uint32_t numIterations = 500;
+
+	bool success = true;
+
+	e2::Profiler profiler;
+	profiler.start();
+	profiler.setThreadName("Test main");
+
+	// workers profile the same markers while the main thread has a scope open the whole time
+	{
+		e2::ProfileBlock outer(&profiler, outerMarker);
+
+		std::vector<std::thread> workers;
+		for (uint32_t t = 0; t < numWorkers; t++)
+		{
+			workers.emplace_back([&profiler, t]() {
+				profiler.setThreadName(std::format("Test worker {}", t));
+				for (uint32_t i = 0; i < numIterations; i++)
+				{
+					e2::ProfileBlock outer(&profiler, outerMarker);
+					::spinFor(2000);
+					{
+						e2::ProfileBlock inner(&profiler, innerMarker);
+						::spinFor(1000);
+						{
+							e2::ProfileBlock leaf(&profiler, leafMarker);
+							::spinFor(1000);
+						}
+					}
+					{
+						e2::ProfileBlock inner(&profiler, innerMarker);
+						::spinFor(500);
+					}
+					profiler.counter(counterMarker, double(i));
+				}
+			});
+		}
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	profiler.newFrame();
+
+	uint64_t numScopes{};
+	uint32_t numThreads = profiler.numThreads();
+	if (numThreads != numWorkers + 1)
+	{
+		LogError("{} threads profiled, expected {}", numThreads, numWorkers + 1);
+		success = false;
+	}
+
+	for (uint32_t i = 0; i < numThreads; i++)
+	{
+		std::vector<e2::ProfileEvent> events = profiler.events(i);
+		if (!::checkNesting(events, i))
+			success = false;
+
+		uint64_t threadScopes{}, threadCounters{}, threadFrames{};
+		for (e2::ProfileEvent const& event : events)
+		{
+			if (event.type == e2::ProfileEventType::Scope)
+				threadScopes++;
+			else if (event.type == e2::ProfileEventType::Counter)
+				threadCounters++;
+			else
+				threadFrames++;
+		}
+
+		// the main thread has its outer scope and the frame, every worker has its own scopes and nothing of the others
+		bool mainThread = i == 0;
+		uint64_t expectedScopes = mainThread ? 1 : numIterations * 4;
+		uint64_t expectedCounters = mainThread ? 0 : numIterations;
+		uint64_t expectedFrames = mainThread ? 1 : 0;
+		if (threadScopes != expectedScopes || threadCounters != expectedCounters || threadFrames != expectedFrames)
+		{
+			LogError("thread {}: {} scopes, {} counters, {} frames. Expected {}, {}, {}", i, threadScopes, threadCounters, threadFrames, expectedScopes, expectedCounters, expectedFrames);
+			success = false;
+		}
+
+		numScopes += threadScopes;
+	}
+
+	// rolled up over every thread, outer only counts the time nothing nested was open
+	e2::ProfileReport report = profiler.report();
+	for (e2::ProfileFunction const& function : report.functions)
+	{
+		uint64_t expected = function.displayName == outerMarker.name ? numWorkers * numIterations + 1 : function.displayName == innerMarker.name ? numWorkers * numIterations * 2 : numWorkers * numIterations;
+		if (function.timesInScope != expected)
+		{
+			LogError("{} rolled up {} times, expected {}", function.displayName, function.timesInScope, expected);
+			success = false;
+		}
+	}
+
+	if (report.functions.size() != 3)
+	{
+		LogError("{} functions rolled up, expected 3", report.functions.size());
+		success = false;
+	}
+
+	double leafSeconds = report.groups[size_t(e2::ProfileGroupId::Async)].avgTimeInFrame;
+	double expectedLeafSeconds = double(numWorkers * numIterations) * 2500.0 / 1e9;
+	if (leafSeconds < expectedLeafSeconds)
+	{
+		LogError("async group has {:.3f} ms, expected at least {:.3f} ms", leafSeconds * 1000.0, expectedLeafSeconds * 1000.0);
+		success = false;
+	}
+
+	std::string json = profiler.traceJson();
+	uint64_t numExported = ::countOf(json, "\"ph\":\"X\"");
+	uint64_t numNamed = ::countOf(json, "\"ph\":\"M\"");
+	if (numExported != numScopes || numNamed != numThreads || ::countOf(json, "\"Test worker 3\"") != 1 || ::countOf(json, "\"ph\":\"C\"") != numWorkers * numIterations)
+	{
+		LogError("trace has {} scopes and {} thread names, expected {} and {}", numExported, numNamed, numScopes, numThreads);
+		success = false;
+	}
+
+	// cost of a scope that records, and one that doesn't
+	constexpr uint32_t numTimed = 1000000;
+	uint64_t enabledStart = ::profileTime();
+	for (uint32_t i = 0; i < numTimed; i++)
+	{
+		e2::ProfileBlock block(&profiler, emptyMarker);
+	}
+	double enabledNs = double(::profileTime() - enabledStart) / numTimed;
+
+	if (profiler.events(0).size() != e2::profileEventBufferSize)
+	{
+		LogError("event buffer holds {} events, expected {}", profiler.events(0).size(), e2::profileEventBufferSize);
+		success = false;
+	}
+
+	profiler.stop();
+	uint64_t disabledStart = ::profileTime();
+	for (uint32_t i = 0; i < numTimed; i++)
+	{
+		e2::ProfileBlock block(&profiler, emptyMarker);
+	}
+	double disabledNs = double(::profileTime() - disabledStart) / numTimed;
+
+	LogNotice("profiler: {} scopes on {} threads, {} bytes of trace. A scope costs {:.1f} ns profiling, {:.1f} ns stopped", numScopes, numThreads, json.size(), enabledNs, disabledNs);
+
+	if (success)
+		LogNotice("profiler tests passed");
+
+	return success;
+}
+
+#endif
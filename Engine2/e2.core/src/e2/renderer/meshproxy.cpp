@@ -3,9 +3,12 @@
 #include "e2/managers/rendermanager.hpp"
 #include "e2/renderer/shadermodel.hpp"
 #include "e2/assets/mesh.hpp"
+#include "e2/assets/meshlod.hpp"
 #include "e2/assets/material.hpp"
 #include "e2/game/session.hpp"
 #include "e2/transform.hpp"
+#include "e2/rhi/rendercontext.hpp"
+#include "e2/rhi/databuffer.hpp"
 
 #include <glm/gtx/matrix_decompose.hpp>
 
@@ -50,8 +53,32 @@ e2::MeshProxy::MeshProxy(e2::Session* inSession, e2::MeshProxyConfiguration cons
 		lods.push(newLod);
 	}
 
+	// a single mesh with simplified levels gets them as lods of their own, instanced proxies only draw lod 0 so they skip this
+	if (lods.size() == 1 && config.maxInstances == 0 && lods[0].asset->lodCount() > 1)
+	{
+		for (uint8_t level = 1; level < lods[0].asset->lodCount() && lods.size() < e2::maxNumLods; level++)
+		{
+			MeshProxyLOD newLod = lods[0];
+			newLod.level = level;
+			newLod.maxScreenSize = lods[0].asset->lodScreenSize(level);
+			lods.push(newLod);
+		}
+	}
+
 	modelMatrix = glm::identity<glm::mat4>();
 	modelMatrixDirty = true;
+
+	maxInstances = config.maxInstances;
+	if (maxInstances > 0)
+	{
+		e2::DataBufferCreateInfo bufferCreateInfo;
+		bufferCreateInfo.type = BufferType::VertexBuffer;
+		bufferCreateInfo.dynamic = true;
+		bufferCreateInfo.size = sizeof(e2::InstanceData) * maxInstances;
+		instanceBuffers[0] = renderContext()->createDataBuffer(bufferCreateInfo);
+		instanceBuffers[1] = renderContext()->createDataBuffer(bufferCreateInfo);
+		instances.reserve(maxInstances);
+	}
 	
 	invalidatePipeline();
 	enable();
@@ -61,6 +88,12 @@ e2::MeshProxy::~MeshProxy()
 {
 	disable();
 	session->m_meshProxies.erase(this);
+
+	// the instance buffers may still be read by frames in flight
+	if (instanceBuffers[0])
+		e2::discard(instanceBuffers[0]);
+	if (instanceBuffers[1])
+		e2::discard(instanceBuffers[1]);
 }
 
 bool e2::MeshProxy::enabled()
@@ -103,6 +136,16 @@ void e2::MeshProxy::setMaterial(uint8_t submesh, uint8_t lodIndex, e2::MaterialP
 	disable();
 	lods[lodIndex].materialProxies[submesh] = materialProxy;
 
+	// simplified levels draw with the materials of the full detail level
+	if (lods[lodIndex].level == 0)
+	{
+		for (MeshProxyLOD& lod : lods)
+		{
+			if (lod.level > 0 && lod.asset == lods[lodIndex].asset)
+				lod.materialProxies[submesh] = materialProxy;
+		}
+	}
+
 	invalidatePipeline();
 
 	if (wasEnabled)
@@ -125,17 +168,37 @@ void e2::MeshProxy::invalidatePipeline()
 		lod.shadowPipelineLayouts.resize(lod.asset->submeshCount());
 		lod.pipelines.resize(lod.asset->submeshCount());
 		lod.shadowPipelines.resize(lod.asset->submeshCount());
+		lod.instancedVertexLayouts.resize(lod.asset->submeshCount());
 
 		for (uint8_t submeshIndex = 0; submeshIndex < lod.asset->submeshCount(); submeshIndex++)
 		{
 			e2::ShaderModel* model = lod.materialProxies[submeshIndex]->asset->model();
+
+			e2::RendererFlags baseFlags = skinProxy ? RendererFlags::Skin : e2::RendererFlags::None;
+			lod.instancedVertexLayouts[submeshIndex] = nullptr;
+			if (instanced())
+			{
+				if (!model->supportsInstancing())
+				{
+					LogError("shader model doesn't support instancing, submesh {} of lod {} will not render", uint32_t(submeshIndex), uint32_t(lodIndex));
+					lod.pipelineLayouts[submeshIndex] = nullptr;
+					lod.shadowPipelineLayouts[submeshIndex] = nullptr;
+					lod.pipelines[submeshIndex] = nullptr;
+					lod.shadowPipelines[submeshIndex] = nullptr;
+					continue;
+				}
+
+				baseFlags = baseFlags | e2::RendererFlags::Instanced;
+				lod.instancedVertexLayouts[submeshIndex] = renderManager()->getOrCreateVertexLayout(lod.asset->specification(submeshIndex).attributeFlags, true, lod.asset->specification(submeshIndex).quantized);
+			}
+
 			lod.pipelineLayouts[submeshIndex] = model->getOrCreatePipelineLayout(this, lodIndex, submeshIndex, false);
-			lod.pipelines[submeshIndex] = model->getOrCreatePipeline(this, lodIndex, submeshIndex, skinProxy ? RendererFlags::Skin : e2::RendererFlags::None);
+			lod.pipelines[submeshIndex] = model->getOrCreatePipeline(this, lodIndex, submeshIndex, baseFlags);
 
 			if (model->supportsShadows())
 			{
 				lod.shadowPipelineLayouts[submeshIndex] = model->getOrCreatePipelineLayout(this, lodIndex, submeshIndex, true);
-				lod.shadowPipelines[submeshIndex] = model->getOrCreatePipeline(this, lodIndex, submeshIndex, skinProxy ? RendererFlags::Skin | RendererFlags::Shadow : e2::RendererFlags::Shadow);
+				lod.shadowPipelines[submeshIndex] = model->getOrCreatePipeline(this, lodIndex, submeshIndex, baseFlags | RendererFlags::Shadow);
 			}
 			else
 			{
@@ -191,15 +254,62 @@ void e2::MeshProxy::setRotation(float newRotation)
 	modelMatrixDirty = true;
 }
 
-bool e2::MeshProxy::lodTest(uint8_t lod, float distance)
+void e2::MeshProxy::setInstances(e2::InstanceData const* data, uint32_t count)
 {
+	if (!instanced())
+	{
+		LogError("not an instanced proxy");
+		return;
+	}
+
+	if (count > maxInstances)
+	{
+		LogError("too many instances, {} of max {}", count, maxInstances);
+		count = maxInstances;
+	}
+
+	instances.assign(data, data + count);
+	instancesDirty = true;
+}
+
+void e2::MeshProxy::updateLod(glm::vec3 const& viewOrigin, float tanHalfFov)
+{
+	if (lods.size() < 2)
+	{
+		currentLod = 0;
+		return;
+	}
+
+	glm::vec3 meshOrigin = modelMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float distance = glm::distance(viewOrigin, meshOrigin);
+
+	if (lods[1].maxScreenSize > 0.0f)
+	{
+		float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+		float screenSize = e2::projectedScreenSize(lods[0].asset->radius() * scale, distance, tanHalfFov);
+
+		float maxScreenSizes[e2::maxNumLods]{};
+		for (uint8_t i = 0; i < lods.size(); i++)
+			maxScreenSizes[i] = lods[i].maxScreenSize;
+
+		currentLod = e2::selectLod(maxScreenSizes, uint8_t(lods.size()), currentLod, screenSize, e2::lodHysteresis);
+		return;
+	}
+
+	currentLod = UINT8_MAX;
 	for (uint8_t i = 0; i < lods.size(); i++)
 	{
 		if (distance <= lods[i].maxDistance || lods[i].maxDistance <= 0.0001f)
-			return lod == i;
+		{
+			currentLod = i;
+			return;
+		}
 	}
+}
 
-	return false;
+bool e2::MeshProxy::lodTest(uint8_t lod)
+{
+	return lod == currentLod;
 }
 
 e2::MeshProxyLOD* e2::MeshProxy::lodByDistance(float distance)
@@ -218,6 +328,7 @@ e2::SkinProxy::SkinProxy(e2::Session* inSession, e2::SkinProxyConfiguration cons
 	, skeletonAsset(config.skeleton)
 	, meshAsset(config.mesh)
 {
+	numBones = glm::clamp(meshAsset->numBones(), 1U, uint32_t(e2::maxNumSkeletonBones));
 	id = session->registerSkinProxy(this);
 }
 
@@ -29,6 +29,41 @@
 	}
 }*/
 
+e2::VertexFormat e2::vertexStreamFormat(e2::VertexStream stream, bool quantized)
+{
+	switch (stream)
+	{
+	case e2::VertexStream::Position:
+	case e2::VertexStream::TexCoords01:
+	case e2::VertexStream::TexCoords23:
+		return quantized ? e2::VertexFormat::Vec4Half : e2::VertexFormat::Vec4;
+	case e2::VertexStream::Normal:
+	case e2::VertexStream::Tangent:
+		return quantized ? e2::VertexFormat::Vec4Snorm8 : e2::VertexFormat::Vec4;
+	case e2::VertexStream::Color:
+	case e2::VertexStream::Weights:
+		return quantized ? e2::VertexFormat::Vec4Unorm8 : e2::VertexFormat::Vec4;
+	case e2::VertexStream::Bones:
+	default:
+		return quantized ? e2::VertexFormat::Vec4u8 : e2::VertexFormat::Vec4u;
+	}
+}
+
+uint32_t e2::vertexStreamStride(e2::VertexStream stream, bool quantized)
+{
+	switch (e2::vertexStreamFormat(stream, quantized))
+	{
+	case e2::VertexFormat::Vec4Half:
+		return sizeof(uint16_t) * 4;
+	case e2::VertexFormat::Vec4Snorm8:
+	case e2::VertexFormat::Vec4Unorm8:
+	case e2::VertexFormat::Vec4u8:
+		return sizeof(uint8_t) * 4;
+	default:
+		return sizeof(glm::vec4);
+	}
+}
+
 void e2::applyVertexAttributeDefines(VertexAttributeFlags flags, ShaderCreateInfo& outInfo)
 {
 	// @todo utility functions to get defines from these 
@@ -371,6 +371,11 @@ void e2::Renderer::prepareFrame(double deltaTime)
 	m_rendererData.projectionMatrix = m_view.calculateProjectionMatrix(m_resolution);
 	m_rendererData.viewMatrix = m_view.calculateViewMatrix();
 
+	// lods are picked once per frame from the main view, shadows draw the same lods so they match what casts them
+	float tanHalfFov = glm::tan(glm::radians(float(m_view.fov)) * 0.5f);
+	for (e2::MeshProxy* meshProxy : m_session->meshProxies())
+		meshProxy->updateLod(glm::vec3(m_view.origin), tanHalfFov);
+
 	// calculate shadow matrices 
 	{
 		float maxDist = 100.0f;
@@ -456,19 +461,20 @@ void e2::Renderer::recordShadows(double deltaTime, e2::ICommandBuffer* buff)
 	buff->clearDepth(1.0f);
 	buff->endRender();
 
-	glm::mat4 shadowMatrix = glm::inverse(m_rendererData.shadowView);
-	glm::vec3 shadowCameraPosition = shadowMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-
 	// Setup render target states
 	buff->beginRender(m_shadowBuffer.renderTarget);
 
 	for (e2::MeshProxyLODEntry const& lodEntry : shadowSubmeshes)
 	{
 		e2::MeshProxy* meshProxy = lodEntry.proxy;
-		glm::vec3 meshOrigin = meshProxy->modelMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-		float cameraDistance = glm::distance(shadowCameraPosition, meshOrigin);
 
-		if (!lodEntry.proxy->lodTest(lodEntry.lod, cameraDistance))
+		// instanced proxies are drawn at their first lod, whoever fills them picks lods per instance (one proxy per lod)
+		if (meshProxy->instanced())
+		{
+			if (lodEntry.lod != 0 || meshProxy->numInstances[frameIndex] == 0)
+				continue;
+		}
+		else if (!lodEntry.proxy->lodTest(lodEntry.lod))
 			continue;
 
 
@@ -494,16 +500,26 @@ void e2::Renderer::recordShadows(double deltaTime, e2::ICommandBuffer* buff)
 		buff->pushConstants(shadowPipelineLayout, 0, sizeof(e2::ShadowPushConstantData), reinterpret_cast<uint8_t*>(&shadowPushConstantData));
 
 		// Bind vertex states
-		buff->bindVertexLayout(meshSpec.vertexLayout);
-		buff->bindIndexBuffer(meshSpec.indexBuffer);
+		uint32_t instanceCount = 1;
+		if (meshProxy->instanced())
+		{
+			instanceCount = meshProxy->numInstances[frameIndex];
+			buff->bindVertexLayout(meshProxyLOD->instancedVertexLayouts[submeshIndex]);
+			buff->bindVertexBuffer(meshSpec.vertexAttributes.size(), meshProxy->instanceBuffers[frameIndex]);
+		}
+		else
+		{
+			buff->bindVertexLayout(meshSpec.vertexLayout);
+		}
+		buff->bindIndexBuffer(meshSpec.indexBuffer, meshSpec.indexFormat);
 		for (uint8_t i = 0; i < meshSpec.vertexAttributes.size(); i++)
 			buff->bindVertexBuffer(i, meshSpec.vertexAttributes[i]);
 
-		uint32_t skinId = meshProxy->skinProxy ? meshProxy->skinProxy->id : 0;
+		uint32_t skinOffset = meshProxy->skinProxy && meshProxy->skinProxy->paletteOffset != UINT32_MAX ? meshProxy->skinProxy->paletteOffset : 0;
 		// Bind descriptor sets (0 is renderer, 1 is model, 2 is material, 3 is reserved)
 		uint32_t offsets[2] = {
 			renderManager()->paddedBufferSize(sizeof(glm::mat4)) * meshProxy->id,
-			renderManager()->paddedBufferSize(sizeof(glm::mat4) * e2::maxNumSkeletonBones) * skinId
+			skinOffset
 		};
 
 		buff->bindDescriptorSet(shadowPipelineLayout, 0, modelSet, 2, &offsets[0]);
@@ -511,7 +527,8 @@ void e2::Renderer::recordShadows(double deltaTime, e2::ICommandBuffer* buff)
 		meshProxyLOD->materialProxies[submeshIndex]->bind(buff, frameIndex, true);
 
 		// Issue drawcall
-		buff->draw(meshSpec.indexCount, 1);
+		e2::SubmeshLod lodRange = meshSpec.lod(meshProxyLOD->level);
+		buff->draw(lodRange.indexCount, instanceCount, lodRange.firstIndex);
 
 
 		meshProxyLOD->materialProxies[submeshIndex]->unbind(buff, frameIndex, true);
@@ -605,10 +622,13 @@ void e2::Renderer::recordRenderLayers(double deltaTime, e2::ICommandBuffer* buff
 		for (e2::MeshProxyLODEntry const& lodEntry : submeshSet)
 		{
 			e2::MeshProxy* meshProxy = lodEntry.proxy;
-			glm::vec3 meshOrigin = meshProxy->modelMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-			float cameraDistance = glm::distance(glm::vec3(m_view.origin), meshOrigin);
 
-			if (!lodEntry.proxy->lodTest(lodEntry.lod, cameraDistance))
+			if (meshProxy->instanced())
+			{
+				if (lodEntry.lod != 0 || meshProxy->numInstances[frameIndex] == 0)
+					continue;
+			}
+			else if (!lodEntry.proxy->lodTest(lodEntry.lod))
 				continue;
 
 
@@ -638,8 +658,18 @@ void e2::Renderer::recordRenderLayers(double deltaTime, e2::ICommandBuffer* buff
 			buff->pushConstants(pipelineLayout, 0, sizeof(e2::PushConstantData), reinterpret_cast<uint8_t*>(&pushConstantData));
 
 			// Bind vertex states
-			buff->bindVertexLayout(meshSpec.vertexLayout);
-			buff->bindIndexBuffer(meshSpec.indexBuffer);
+			uint32_t instanceCount = 1;
+			if (meshProxy->instanced())
+			{
+				instanceCount = meshProxy->numInstances[frameIndex];
+				buff->bindVertexLayout(meshProxyLOD->instancedVertexLayouts[submeshIndex]);
+				buff->bindVertexBuffer(meshSpec.vertexAttributes.size(), meshProxy->instanceBuffers[frameIndex]);
+			}
+			else
+			{
+				buff->bindVertexLayout(meshSpec.vertexLayout);
+			}
+			buff->bindIndexBuffer(meshSpec.indexBuffer, meshSpec.indexFormat);
 			for (uint8_t i = 0; i < meshSpec.vertexAttributes.size(); i++)
 				buff->bindVertexBuffer(i, meshSpec.vertexAttributes[i]);
 
@@ -647,10 +677,10 @@ void e2::Renderer::recordRenderLayers(double deltaTime, e2::ICommandBuffer* buff
 			// Bind descriptor sets (0 is renderer, 1 is model, 2 is material, 3 is reserved)
 			buff->bindDescriptorSet(pipelineLayout, 0, rendererSet);
 
-			uint32_t skinId = meshProxy->skinProxy ? meshProxy->skinProxy->id : 0;
+			uint32_t skinOffset = meshProxy->skinProxy && meshProxy->skinProxy->paletteOffset != UINT32_MAX ? meshProxy->skinProxy->paletteOffset : 0;
 			uint32_t offsets[2] = {
 				renderManager()->paddedBufferSize(sizeof(glm::mat4)) * meshProxy->id,
-				renderManager()->paddedBufferSize(sizeof(glm::mat4) * e2::maxNumSkeletonBones) * skinId
+				skinOffset
 			};
 
 			buff->bindDescriptorSet(pipelineLayout, 1, modelSet, 2, &offsets[0]);
@@ -658,7 +688,8 @@ void e2::Renderer::recordRenderLayers(double deltaTime, e2::ICommandBuffer* buff
 			meshProxyLOD->materialProxies[submeshIndex]->bind(buff, frameIndex, false);
 
 			// Issue drawcall
-			buff->draw(meshSpec.indexCount, 1);
+			e2::SubmeshLod lodRange = meshSpec.lod(meshProxyLOD->level);
+			buff->draw(lodRange.indexCount, instanceCount, lodRange.firstIndex);
 
 			meshProxyLOD->materialProxies[submeshIndex]->unbind(buff, frameIndex, false);
 
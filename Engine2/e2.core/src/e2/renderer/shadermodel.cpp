@@ -36,6 +36,11 @@ bool e2::ShaderModel::supportsShadows()
 	return false;
 }
 
+bool e2::ShaderModel::supportsInstancing()
+{
+	return false;
+}
+
 void e2::ShaderModel::active(bool newValue)
 {
 	m_active = newValue;
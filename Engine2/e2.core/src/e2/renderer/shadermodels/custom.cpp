@@ -40,6 +40,16 @@ e2::CustomModel::~CustomModel()
 			e2::destroy(m_pipelineCache[i].pipeline);
 	}
 
+	for (auto& [flags, entry] : m_instancedPipelineCache)
+	{
+		if (entry.vertexShader)
+			e2::destroy(entry.vertexShader);
+		if (entry.fragmentShader)
+			e2::destroy(entry.fragmentShader);
+		if (entry.pipeline)
+			e2::destroy(entry.pipeline);
+	}
+
 	if(m_proxyUniformBuffers[0])
 		e2::destroy(m_proxyUniformBuffers[0]);
 
@@ -377,15 +387,20 @@ e2::IPipeline* e2::CustomModel::getOrCreatePipeline(e2::MeshProxy* proxy, uint8_
 		materialFlags |= 1 << ((uint16_t)e2::CustomFlags::TextureFlagsOffset + i);
 	}
 
+	// instancing has no bit of its own in CustomFlags, it picks the cache instead
+	bool instanced = (rendererFlags & e2::RendererFlags::Instanced) == e2::RendererFlags::Instanced;
+	uint16_t rendererFlagsInt = uint16_t(uint8_t(rendererFlags) & ~uint8_t(e2::RendererFlags::Instanced));
+
 	uint16_t lwFlagsInt = (geometryFlags << (uint16_t)e2::CustomFlags::VertexFlagsOffset)
-		| (uint16_t(rendererFlags) << (uint16_t)e2::CustomFlags::RendererFlagsOffset)
+		| (rendererFlagsInt << (uint16_t)e2::CustomFlags::RendererFlagsOffset)
 		| (materialFlags);
 
 	e2::CustomFlags lwFlags = (e2::CustomFlags)lwFlagsInt;
 
-	if (m_pipelineCache[uint16_t(lwFlags)].pipeline)
+	e2::CustomCacheEntry& cacheEntry = instanced ? m_instancedPipelineCache[lwFlagsInt] : m_pipelineCache[lwFlagsInt];
+	if (cacheEntry.pipeline)
 	{
-		return m_pipelineCache[uint16_t(lwFlags)].pipeline;
+		return cacheEntry.pipeline;
 	}
 
 	e2::CustomCacheEntry newEntry;
@@ -394,6 +409,9 @@ e2::IPipeline* e2::CustomModel::getOrCreatePipeline(e2::MeshProxy* proxy, uint8_
 
 	e2::applyVertexAttributeDefines(spec.attributeFlags, shaderInfo);
 
+	if (instanced)
+		shaderInfo.defines.push({ "Renderer_Instanced", "1" });
+
 	bool shadows = (lwFlags & e2::CustomFlags::Shadow) == e2::CustomFlags::Shadow;
 	if (shadows)
 		shaderInfo.defines.push({ "Renderer_Shadow", "1" });
@@ -439,7 +457,7 @@ e2::IPipeline* e2::CustomModel::getOrCreatePipeline(e2::MeshProxy* proxy, uint8_
 	}
 
 
-	m_pipelineCache[uint16_t(lwFlags)] = newEntry;
+	cacheEntry = newEntry;
 	return newEntry.pipeline;
 }
 
@@ -448,6 +466,11 @@ bool e2::CustomModel::supportsShadows()
 	return m_supportsShadows;
 }
 
+bool e2::CustomModel::supportsInstancing()
+{
+	return true;
+}
+
 void e2::CustomModel::invalidatePipelines()
 {
 
@@ -474,6 +497,19 @@ void e2::CustomModel::invalidatePipelines()
 		entry.pipeline = nullptr;
 	}
 
+	for (auto& [flags, entry] : m_instancedPipelineCache)
+	{
+		if (entry.vertexShader)
+			e2::discard(entry.vertexShader);
+
+		if (entry.fragmentShader)
+			e2::discard(entry.fragmentShader);
+
+		if (entry.pipeline)
+			e2::discard(entry.pipeline);
+	}
+	m_instancedPipelineCache.clear();
+
 }
 
 e2::Name e2::CustomModel::name()
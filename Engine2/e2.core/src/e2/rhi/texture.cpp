@@ -22,3 +22,8 @@ e2::ISampler::~ISampler()
 {
 
 }
+
+bool e2::isBlockCompressed(e2::TextureFormat format)
+{
+	return format >= e2::TextureFormat::BC1 && format <= e2::TextureFormat::BC7SRGB;
+}
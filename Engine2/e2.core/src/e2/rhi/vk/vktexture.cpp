@@ -97,7 +97,8 @@ e2::ITexture_Vk::ITexture_Vk(IRenderContext* context, e2::TextureCreateInfo cons
 	vkCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	vkCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-	if (m_vkAspectFlags & VK_IMAGE_ASPECT_COLOR_BIT)
+	// block compressed formats can't be rendered to
+	if ((m_vkAspectFlags & VK_IMAGE_ASPECT_COLOR_BIT) && !e2::isBlockCompressed(createInfo.format))
 		vkCreateInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
 	if (m_vkAspectFlags & (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT))
@@ -115,6 +116,10 @@ e2::ITexture_Vk::ITexture_Vk(IRenderContext* context, e2::TextureCreateInfo cons
 
 	VkImageViewCreateInfo viewCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 	viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY };
+
+	// single channel masks sample as grayscale, like the RGBA8 they replace
+	if (createInfo.format == e2::TextureFormat::BC4)
+		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R,VK_COMPONENT_SWIZZLE_R,VK_COMPONENT_SWIZZLE_R,VK_COMPONENT_SWIZZLE_ONE };
 	viewCreateInfo.format = m_vkFormat;
 	viewCreateInfo.image = m_vkImage;
 
@@ -321,6 +326,14 @@ VkFormat e2::ITexture_Vk::e2ToVk(e2::TextureFormat textureFormat)
 		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::D24S8] = VK_FORMAT_D24_UNORM_S8_UINT;
 		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::D32S8] = VK_FORMAT_D32_SFLOAT_S8_UINT;
 		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::S8] = VK_FORMAT_S8_UINT;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC1] = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC1SRGB] = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC3] = VK_FORMAT_BC3_UNORM_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC3SRGB] = VK_FORMAT_BC3_SRGB_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC4] = VK_FORMAT_BC4_UNORM_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC5] = VK_FORMAT_BC5_UNORM_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC7] = VK_FORMAT_BC7_UNORM_BLOCK;
+		::e2ToVkMap_Format[(uint64_t)e2::TextureFormat::BC7SRGB] = VK_FORMAT_BC7_SRGB_BLOCK;
 	}
 
 	return ::e2ToVkMap_Format[(uint64_t)textureFormat];
@@ -350,6 +363,14 @@ VkImageAspectFlags e2::ITexture_Vk::e2ToAspectFlags(e2::TextureFormat textureFor
 		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::D24S8] = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
 		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::D32S8] = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
 		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::S8] = VK_IMAGE_ASPECT_STENCIL_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC1] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC1SRGB] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC3] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC3SRGB] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC4] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC5] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC7] = VK_IMAGE_ASPECT_COLOR_BIT;
+		::e2ToVkMap_AspectFlags[(uint64_t)e2::TextureFormat::BC7SRGB] = VK_IMAGE_ASPECT_COLOR_BIT;
 	}
 
 	return ::e2ToVkMap_AspectFlags[(uint64_t)textureFormat];
@@ -459,10 +459,10 @@ void e2::ICommandBuffer_Vk::bindVertexBuffer(uint32_t binding, e2::IDataBuffer*
 	vkCmdBindVertexBuffers(m_vkHandle, binding, 1, &vkBuffer->m_vkHandle, &deviceSize);
 }
 
-void e2::ICommandBuffer_Vk::bindIndexBuffer(e2::IDataBuffer* dataBuffer)
+void e2::ICommandBuffer_Vk::bindIndexBuffer(e2::IDataBuffer* dataBuffer, e2::IndexFormat format)
 {
 	e2::IDataBuffer_Vk* vkBuffer = static_cast<e2::IDataBuffer_Vk*>(dataBuffer);
-	vkCmdBindIndexBuffer(m_vkHandle, vkBuffer->m_vkHandle, 0, VK_INDEX_TYPE_UINT32); // @todo support uint16
+	vkCmdBindIndexBuffer(m_vkHandle, vkBuffer->m_vkHandle, 0, format == e2::IndexFormat::Uint16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
 }
 
 void e2::ICommandBuffer_Vk::pushConstants(e2::IPipelineLayout* layout, uint32_t offset, uint32_t size, uint8_t const* data)
@@ -471,9 +471,9 @@ void e2::ICommandBuffer_Vk::pushConstants(e2::IPipelineLayout* layout, uint32_t
 	vkCmdPushConstants(m_vkHandle, vkLayout->m_vkHandle, VK_SHADER_STAGE_ALL, offset, size, data);
 }
 
-void e2::ICommandBuffer_Vk::draw(uint32_t indexCount, uint32_t instanceCount)
+void e2::ICommandBuffer_Vk::draw(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex)
 {
-	vkCmdDrawIndexed(m_vkHandle, indexCount, instanceCount, 0, 0, 0);
+	vkCmdDrawIndexed(m_vkHandle, indexCount, instanceCount, firstIndex, 0, 0);
 }
 
 void e2::ICommandBuffer_Vk::drawNonIndexed(uint32_t vertexCount, uint32_t instanceCount)
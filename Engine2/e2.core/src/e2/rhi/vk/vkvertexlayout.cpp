@@ -45,6 +45,18 @@ namespace
 		case e2::VertexFormat::Vec4u:
 			return VK_FORMAT_R32G32B32A32_UINT;
 			break;
+		case e2::VertexFormat::Vec4Half:
+			return VK_FORMAT_R16G16B16A16_SFLOAT;
+			break;
+		case e2::VertexFormat::Vec4Snorm8:
+			return VK_FORMAT_R8G8B8A8_SNORM;
+			break;
+		case e2::VertexFormat::Vec4Unorm8:
+			return VK_FORMAT_R8G8B8A8_UNORM;
+			break;
+		case e2::VertexFormat::Vec4u8:
+			return VK_FORMAT_R8G8B8A8_UINT;
+			break;
 		}
 	}
 
@@ -9,8 +9,10 @@
 #include <GLFW/glfw3.h>
 
 
+#if defined(_WIN64)
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
 e2::IWindow_Vk::IWindow_Vk(IThreadContext* context, e2::WindowCreateInfo const& createInfo)
 	: e2::IWindow(context, createInfo)
@@ -510,11 +512,14 @@ void e2::IWindow_Vk::createGlfwWindow(e2::WindowCreateInfo const& createInfo)
 	}
 
 	m_glfwHandle = glfwCreateWindow(resolution.x, resolution.y, createInfo.title.c_str(), monitor, nullptr);
+#if defined(_WIN64)
+	// keeps tool windows out of the taskbar, other platforms show them like any window
 	if (createInfo.tool)
 	{
 		HWND hwnd = glfwGetWin32Window(m_glfwHandle);
 		SetWindowLongPtr(hwnd, GWL_EXSTYLE, WS_EX_TOOLWINDOW);
 	}
+#endif
 
 	glfwShowWindow(m_glfwHandle);
 
@@ -1,6 +1,8 @@
 
 #include "e2/timer.hpp"
 
+#include <cmath>
+
 e2::Timer::Timer()
 {
 	reset();
@@ -75,3 +77,31 @@ e2::Duration e2::Moment::operator-(e2::Moment const& rhs)
 {
 	return { m_point - rhs.m_point };
 }
+
+e2::FixedTimestep::FixedTimestep(double stepsPerSecond, uint32_t maxSteps)
+	: m_stepSeconds(1.0 / stepsPerSecond)
+	, m_maxSteps(maxSteps)
+{
+}
+
+uint32_t e2::FixedTimestep::advance(double seconds)
+{
+	m_accumulator += seconds;
+
+	uint32_t numSteps = 0;
+	while (m_accumulator >= m_stepSeconds && numSteps < m_maxSteps)
+	{
+		m_accumulator -= m_stepSeconds;
+		numSteps++;
+	}
+
+	if (m_accumulator >= m_stepSeconds)
+	{
+		double dropped = std::floor(m_accumulator / m_stepSeconds);
+		m_numDroppedSteps += uint64_t(dropped);
+		m_accumulator -= dropped * m_stepSeconds;
+	}
+
+	m_numSteps += numSteps;
+	return numSteps;
+}
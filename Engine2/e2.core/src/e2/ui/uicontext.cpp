@@ -19,10 +19,7 @@ namespace
 e2::UIContext::UIContext(e2::Context* ctx, e2::IWindow* win)
 	: m_engine(ctx->engine())
 	, m_window(win)
-	, m_dataArena(e2::maxNumUIWidgetData)
 {
-	m_clearList.reserve(1024);
-
 	// Setup command buffers 
 	e2::CommandBufferCreateInfo commandBufferInfo{};
 	m_commandBuffers[0] = renderManager()->framePool(0)->createBuffer(commandBufferInfo);
@@ -252,23 +249,10 @@ void e2::UIContext::submitFrame()
 	if(m_hasRecordedData)
 		renderManager()->queue(buff, nullptr, nullptr);
 
-	// end of frame submission: purge old data
-	m_clearList.clear();
-	for (std::pair<size_t const, e2::UIWidgetState*>& pair : m_dataMap)
-	{
-		size_t widgetHash = pair.first;
-		e2::UIWidgetState* widgetData = pair.second;
-		if (++widgetData->framesSinceActive >= e2::uiRetainFrameCount)
-		{
-			m_dataArena.destroy(widgetData);
-			m_clearList.push_back(widgetHash);
-		}
-	}
+	// end of frame submission: age widget data, what isn't reserved again is recycled as the table comes across it
+	m_widgets.newFrame();
 
-	for (size_t id : m_clearList)
-	{
-		m_dataMap.erase(id);
-	}
+	m_textLayouts.newFrame();
 }
 
 
@@ -904,15 +888,6 @@ void e2::UIContext::drawRasterText(e2::FontFace fontFace, uint8_t fontSize, e2::
 	position.y = glm::floor(position.y);
 
 	e2::UIStyle style = uiManager()->workingStyle();
-	e2::FontPtr font = renderManager()->defaultFont(fontFace);
-	// this is only for editor use, so it's fine that this contains an inline markdown parser executed every frame, and a shit ton of separate quad drawcalls etc.
-	// you guys have workstations for a reason right? What else are you going to with that insanely overspec'd CPU of yours?
-	// i really don't see what you're getting yourself so worked up about
-	std::u32string src = e2::utf8to32(markdownUtf8);
-
-	float midOffset = font->getMidlineOffset(e2::FontStyle::Regular, fontSize);
-
-	UIColor defaultColor = color;
 	const e2::UIColor accents[10] = {
 		style.bright1,	// 0 bright
 		style.dark1,	// 1 dark
@@ -926,116 +901,11 @@ void e2::UIContext::drawRasterText(e2::FontFace fontFace, uint8_t fontSize, e2::
 		style.accents[7], // 9 Green
 	};
 
-	glm::vec2 cursor = position + glm::vec2(0.f, midOffset);
-	glm::vec2 initialCursor = cursor;
-
-	uint32_t nextCodepoint = 0;
-	uint32_t prevCodepoint = 0;
-	uint32_t i = 0;
-	bool escape = false;
-	e2::FontStyle currentStyle = FontStyle::Regular;
-	for (uint32_t i = 0; i < src.size(); i++)
+	e2::UITextLayout const& layout = m_textLayouts.layout(fontFace, fontSize, markdownUtf8, false, enableColorChange);
+	for (e2::UITextGlyph const& glyph : layout.glyphs)
 	{
-		uint32_t codepoint = src[i];
-
-		bool peekable = i < src.size() - 1;
-		if (peekable)
-		{
-			nextCodepoint = src[i + 1];
-		}
-
-		// special characters
-		if (codepoint <= 32)
-		{
-			if (codepoint == 10)
-			{
-				cursor.x = initialCursor.x;
-				cursor.y += fontSize * 1.25f;
-			}
-
-			// space, just OK?
-			// literally dont know how long a space is supposed to be.
-			// should probably be scaled to the fontsize or smth @todo
-			if (codepoint == 32)
-			{
-				cursor.x += font->getSpaceAdvance(currentStyle, fontSize);
-			}
-
-			continue;
-		}
-
-		if (!escape)
-		{
-			// \ escape
-			if (codepoint == 92)
-			{
-				escape = true;
-				continue;
-			}
-			// * handle bold and italics 
-			else if (codepoint == 42)
-			{
-				// ** double means flip bold 
-				if (peekable && nextCodepoint == 42)
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Bold));
-					// add more to i, since we already parse the next codepoint here
-					i++;
-				}
-				// * single means we flip italic 
-				else
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Italic));
-				}
-
-				continue;
-			}
-			// ^ handle fontface changes 
-			else if (codepoint == 94 && peekable)
-			{
-				// s = sans 
-				if (nextCodepoint == 115)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Sans);
-				}
-				// f = serif 
-				else if (nextCodepoint == 102)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Serif);
-				}
-				// m = monospace 
-				else if (nextCodepoint == 109)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Monospace);
-				}
-				// 0-9 = accent colors (see start of function for a table)
-				else if (nextCodepoint >= 48 && nextCodepoint <= 57 && enableColorChange)
-				{
-					uint32_t colorIndex = nextCodepoint - 48;
-					color = accents[colorIndex];
-				}
-				// - = disable accent 
-				else if (nextCodepoint == 45)
-				{
-					color = defaultColor;
-				}
-				i++;
-				continue;
-			}
-		}
-
-		// normal characters start here
-		if (i != 0)
-			cursor.x += font->getRasterKerningDistance(prevCodepoint, codepoint, currentStyle, fontSize);
-
-		e2::FontGlyph const&glyph = font->getRasterGlyph(codepoint, currentStyle, fontSize);
-		
-		drawTexturedQuad(cursor + glyph.offset, glyph.size, color, font->glyphTexture(glyph.textureIndex), glyph.uvOffset, glyph.uvSize, e2::UITexturedQuadType::FontRaster,zoffset);
-
-		cursor.x += glyph.advanceX;
-
-		prevCodepoint = codepoint;
-		escape = false;
+		e2::UIColor glyphColor = glyph.color == e2::uiTextDefaultColor ? color : accents[glyph.color];
+		drawTexturedQuad(position + glyph.offset, glyph.size, glyphColor, glyph.texture, glyph.uvOffset, glyph.uvSize, e2::UITexturedQuadType::FontRaster, zoffset);
 	}
 }
 
@@ -1048,15 +918,6 @@ void e2::UIContext::drawSDFText(e2::FontFace fontFace, float fontSize, e2::UICol
 	position.y = glm::floor(position.y);
 
 	e2::UIStyle style = uiManager()->workingStyle();
-	e2::FontPtr font = renderManager()->defaultFont(fontFace);
-	// this is only for editor use, so it's fine that this contains an inline markdown parser executed every frame, and a shit ton of separate quad drawcalls etc.
-	// you guys have workstations for a reason right? What else are you going to with that insanely overspec'd CPU of yours?
-	// i really don't see what you're getting yourself so worked up about
-	std::u32string src = e2::utf8to32(markdownUtf8);
-
-	float midOffset = font->getSDFMidlineOffset(e2::FontStyle::Regular, fontSize);
-
-	UIColor defaultColor = color;
 	const e2::UIColor accents[10] = {
 		style.bright1,	// 0 bright
 		style.dark1,	// 1 dark
@@ -1070,114 +931,11 @@ void e2::UIContext::drawSDFText(e2::FontFace fontFace, float fontSize, e2::UICol
 		style.accents[7], // 9 Green
 	};
 
-	glm::vec2 cursor = position + glm::vec2(0.f, midOffset);
-
-	uint32_t nextCodepoint = 0;
-	uint32_t prevCodepoint = 0;
-	uint32_t i = 0;
-	bool escape = false;
-	e2::FontStyle currentStyle = FontStyle::Regular;
-	for (uint32_t i = 0; i < src.size(); i++)
+	e2::UITextLayout const& layout = m_textLayouts.layout(fontFace, fontSize, markdownUtf8, true, enableColorChange);
+	for (e2::UITextGlyph const& glyph : layout.glyphs)
 	{
-		uint32_t codepoint = src[i];
-
-		bool peekable = i < src.size() - 1;
-		if (peekable)
-		{
-			nextCodepoint = src[i + 1];
-		}
-
-		// special characters
-		if (codepoint <= 32)
-		{
-			// we ignore 10 (\n)
-			// space, just OK?
-			// literally dont know how long a space is supposed to be.
-			// should probably be scaled to the fontsize or smth @todo
-			if (codepoint == 32)
-			{
-				cursor.x += font->getSDFSpaceAdvance(currentStyle, fontSize);
-			}
-
-			continue;
-		}
-
-		if (!escape)
-		{
-			// \ escape
-			if (codepoint == 92)
-			{
-				escape = true;
-				continue;
-			}
-			// * handle bold and italics 
-			else if (codepoint == 42)
-			{
-				// ** double means flip bold 
-				if (peekable && nextCodepoint == 42)
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Bold));
-					// add more to i, since we already parse the next codepoint here
-					i++;
-				}
-				// * single means we flip italic 
-				else
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Italic));
-				}
-
-				continue;
-			}
-			// ^ handle fontface changes 
-			else if (codepoint == 94 && peekable)
-			{
-				// s = sans 
-				if (nextCodepoint == 115)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Sans);
-				}
-				// f = serif 
-				else if (nextCodepoint == 102)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Serif);
-				}
-				// m = monospace 
-				else if (nextCodepoint == 109)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Monospace);
-				}
-				// 0-9 = accent colors (see start of function for a table)
-				else if (nextCodepoint >= 48 && nextCodepoint <= 57 && enableColorChange)
-				{
-					uint32_t colorIndex = nextCodepoint - 48;
-					color = accents[colorIndex];
-				}
-				// - = disable accent 
-				else if (nextCodepoint == 45)
-				{
-					color = defaultColor;
-				}
-				i++;
-				continue;
-			}
-		}
-
-		// normal characters start here
-		if (i != 0)
-			cursor.x += font->getSDFKerningDistance(prevCodepoint, codepoint, currentStyle, fontSize);
-
-		e2::FontGlyph const& glyph = font->getSDFGlyph(codepoint, currentStyle);
-
-		glm::vec2 glyphSize = (glyph.size / 32.0f) * fontSize;
-		float advanceX = (glyph.advanceX / 32.0f) * fontSize;
-		glm::vec2 glyphOffset = (glyph.offset / 32.0f)* fontSize;
-
-		drawTexturedQuad(cursor + glyphOffset, glyphSize, color, font->glyphTexture(glyph.textureIndex), glyph.uvOffset, glyph.uvSize, e2::UITexturedQuadType::FontSDFShadow, zoffset);
-
-		cursor.x += advanceX;
-
-		prevCodepoint = codepoint;
-		escape = false;
+		e2::UIColor glyphColor = glyph.color == e2::uiTextDefaultColor ? color : accents[glyph.color];
+		drawTexturedQuad(position + glyph.offset, glyph.size, glyphColor, glyph.texture, glyph.uvOffset, glyph.uvSize, e2::UITexturedQuadType::FontSDFShadow, zoffset);
 	}
 }
 
@@ -1333,240 +1091,13 @@ void e2::UIContext::drawRasterTextShadow(e2::FontFace fontFace, uint8_t fontSize
 
 float e2::UIContext::calculateSDFTextWidth(e2::FontFace fontFace, float fontSize, std::string const& markdownUtf8)
 {
-	e2::UIStyle style = uiManager()->workingStyle();
-	e2::FontPtr font = renderManager()->defaultFont(fontFace);
-	// this is only for editor use, so it's fine that this contains an inline markdown parser executed every frame, and a shit ton of separate quad drawcalls etc.
-	// you guys have workstations for a reason right? What else are you going to with that insanely overspec'd CPU of yours?
-	// i really don't see what you're getting yourself so worked up about
-	std::u32string src = e2::utf8to32(markdownUtf8);
-
-	float midOffset = font->getSDFMidlineOffset(e2::FontStyle::Regular, fontSize);
-
-	glm::vec2 cursor = glm::vec2(0.f, midOffset);
-
-	uint32_t nextCodepoint = 0;
-	uint32_t prevCodepoint = 0;
-	uint32_t i = 0;
-	bool escape = false;
-	e2::FontStyle currentStyle = FontStyle::Regular;
-	for (uint32_t i = 0; i < src.size(); i++)
-	{
-		uint32_t codepoint = src[i];
-
-		bool peekable = i < src.size() - 1;
-		if (peekable)
-		{
-			nextCodepoint = src[i + 1];
-		}
-
-		// special characters
-		if (codepoint <= 32)
-		{
-			// we ignore 10 (\n)
-			// space, just OK?
-			// literally dont know how long a space is supposed to be.
-			// should probably be scaled to the fontsize or smth @todo
-			if (codepoint == 32)
-			{
-				cursor.x += font->getSDFSpaceAdvance(currentStyle, fontSize);
-			}
-
-			continue;
-		}
-
-		if (!escape)
-		{
-			// \ escape
-			if (codepoint == 92)
-			{
-				escape = true;
-				continue;
-			}
-			// * handle bold and italics 
-			else if (codepoint == 42)
-			{
-				// ** double means flip bold 
-				if (peekable && nextCodepoint == 42)
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Bold));
-					// add more to i, since we already parse the next codepoint here
-					i++;
-				}
-				// * single means we flip italic 
-				else
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Italic));
-				}
-
-				continue;
-			}
-			// ^ handle fontface changes 
-			else if (codepoint == 94 && peekable)
-			{
-				// s = sans 
-				if (nextCodepoint == 115)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Sans);
-				}
-				// f = serif 
-				else if (nextCodepoint == 102)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Serif);
-				}
-				// m = monospace 
-				else if (nextCodepoint == 109)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Monospace);
-				}
-				// 0-9 = accent colors (see start of function for a table)
-				else if (nextCodepoint >= 48 && nextCodepoint <= 57)
-				{
-					//uint32_t colorIndex = nextCodepoint - 48;
-					//color = accents[colorIndex];
-				}
-				// - = disable accent 
-				else if (nextCodepoint == 45)
-				{
-					//color = defaultColor;
-				}
-				i++;
-				continue;
-			}
-		}
-
-		// normal characters start here
-		if (i != 0)
-			cursor.x += font->getSDFKerningDistance(prevCodepoint, codepoint, currentStyle, fontSize);
-
-		e2::FontGlyph const& glyph = font->getSDFGlyph(codepoint, currentStyle);
-
-		cursor.x += (glyph.advanceX / 32.0f) * fontSize;
-
-		prevCodepoint = codepoint;
-		escape = false;
-	}
-
-	return cursor.x;
+	// color changes don't move anything, so share the layout with drawSDFText's default
+	return m_textLayouts.layout(fontFace, fontSize, markdownUtf8, true, true).width;
 }
 
 float e2::UIContext::calculateTextWidth(e2::FontFace fontFace, uint8_t fontSize, std::string const& markdownUtf8)
 {
-	e2::UIStyle style = uiManager()->workingStyle();
-	e2::FontPtr font = renderManager()->defaultFont(fontFace);
-	// this is only for editor use, so it's fine that this contains an inline markdown parser executed every frame, and a shit ton of separate quad drawcalls etc.
-	// you guys have workstations for a reason right? What else are you going to with that insanely overspec'd CPU of yours?
-	// i really don't see what you're getting yourself so worked up about
-	std::u32string src = e2::utf8to32(markdownUtf8);
-
-	float midOffset = font->getMidlineOffset(e2::FontStyle::Regular, fontSize);
-
-	glm::vec2 cursor = glm::vec2(0.f, midOffset);
-
-	uint32_t nextCodepoint = 0;
-	uint32_t prevCodepoint = 0;
-	uint32_t i = 0;
-	bool escape = false;
-	e2::FontStyle currentStyle = FontStyle::Regular;
-	for (uint32_t i = 0; i < src.size(); i++)
-	{
-		uint32_t codepoint = src[i];
-
-		bool peekable = i < src.size() - 1;
-		if (peekable)
-		{
-			nextCodepoint = src[i + 1];
-		}
-
-		// special characters
-		if (codepoint <= 32)
-		{
-			// we ignore 10 (\n)
-			// space, just OK?
-			// literally dont know how long a space is supposed to be.
-			// should probably be scaled to the fontsize or smth @todo
-			if (codepoint == 32)
-			{
-				cursor.x += font->getSpaceAdvance(currentStyle, fontSize);
-			}
-
-			continue;
-		}
-
-		if (!escape)
-		{
-			// \ escape
-			if (codepoint == 92)
-			{
-				escape = true;
-				continue;
-			}
-			// * handle bold and italics 
-			else if (codepoint == 42)
-			{
-				// ** double means flip bold 
-				if (peekable && nextCodepoint == 42)
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Bold));
-					// add more to i, since we already parse the next codepoint here
-					i++;
-				}
-				// * single means we flip italic 
-				else
-				{
-					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Italic));
-				}
-
-				continue;
-			}
-			// ^ handle fontface changes 
-			else if (codepoint == 94 && peekable)
-			{
-				// s = sans 
-				if (nextCodepoint == 115)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Sans);
-				}
-				// f = serif 
-				else if (nextCodepoint == 102)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Serif);
-				}
-				// m = monospace 
-				else if (nextCodepoint == 109)
-				{
-					font = renderManager()->defaultFont(e2::FontFace::Monospace);
-				}
-				// 0-9 = accent colors (see start of function for a table)
-				else if (nextCodepoint >= 48 && nextCodepoint <= 57)
-				{
-					//uint32_t colorIndex = nextCodepoint - 48;
-					//color = accents[colorIndex];
-				}
-				// - = disable accent 
-				else if (nextCodepoint == 45)
-				{
-					//color = defaultColor;
-				}
-				i++;
-				continue;
-			}
-		}
-
-		// normal characters start here
-		if (i != 0)
-			cursor.x += font->getRasterKerningDistance(prevCodepoint, codepoint, currentStyle, fontSize);
-
-		e2::FontGlyph const& glyph = font->getRasterGlyph(codepoint, currentStyle, fontSize);
-
-		//drawTexturedQuad(cursor + glyph.offset, glyph.size, color, font->glyphTexture(glyph.textureIndex), glyph.uvOffset, glyph.uvSize, e2::UITexturedQuadType::FontRaster);
-
-		cursor.x += glyph.advanceX;
-
-		prevCodepoint = codepoint;
-		escape = false;
-	}
-
-	return cursor.x;
+	return m_textLayouts.layout(fontFace, fontSize, markdownUtf8, false, true).width;
 }
 
 e2::UIRenderState& e2::UIContext::pushRenderState(e2::Name id, glm::vec2 const& size, glm::vec2 offset)
@@ -1964,23 +1495,9 @@ size_t e2::UIContext::getCombinedHash(e2::Name id)
 
 e2::UIWidgetState* e2::UIContext::reserve(e2::Name id, glm::vec2 const& minSize)
 {
-	e2::UIWidgetState* data = nullptr;
-
 	// resolve the data we need to use 
 	size_t combinedHash = getCombinedHash(id);
-	auto finder = m_dataMap.find(combinedHash);
-	if (finder != m_dataMap.end())
-	{
-		data = finder->second;
-		data->framesSinceActive = 0;
-	}
-	else
-	{
-		data = m_dataArena.create();
-		m_dataMap[combinedHash] = data;
-
-		data->id = combinedHash;
-	}
+	e2::UIWidgetState* data = m_widgets.reserve(combinedHash);
 
 	// set the widget size and position 
 	e2::UIRenderState& rs = renderState();
@@ -0,0 +1,402 @@
+
+#include "e2/ui/uitextlayout.hpp"
+
+#include "e2/context.hpp"
+#include "e2/managers/rendermanager.hpp"
+#include "e2/log.hpp"
+
+e2::IUITextMetrics::~IUITextMetrics()
+{
+
+}
+
+e2::UIDefaultFontMetrics::UIDefaultFontMetrics(e2::Context* context)
+	: m_context(context)
+{
+
+}
+
+float e2::UIDefaultFontMetrics::midlineOffset(e2::FontFace face, float fontSize, bool sdf)
+{
+	e2::FontPtr font = m_context->renderManager()->defaultFont(face);
+	return sdf ? font->getSDFMidlineOffset(e2::FontStyle::Regular, fontSize) : font->getMidlineOffset(e2::FontStyle::Regular, uint8_t(fontSize));
+}
+
+float e2::UIDefaultFontMetrics::spaceAdvance(e2::FontFace face, e2::FontStyle style, float fontSize, bool sdf)
+{
+	e2::FontPtr font = m_context->renderManager()->defaultFont(face);
+	return sdf ? font->getSDFSpaceAdvance(style, fontSize) : font->getSpaceAdvance(style, uint8_t(fontSize));
+}
+
+float e2::UIDefaultFontMetrics::kerning(e2::FontFace face, uint32_t left, uint32_t right, e2::FontStyle style, float fontSize, bool sdf)
+{
+	e2::FontPtr font = m_context->renderManager()->defaultFont(face);
+	return sdf ? font->getSDFKerningDistance(left, right, style, fontSize) : font->getRasterKerningDistance(left, right, style, uint8_t(fontSize));
+}
+
+e2::FontGlyph e2::UIDefaultFontMetrics::glyph(e2::FontFace face, uint32_t codepoint, e2::FontStyle style, float fontSize, bool sdf)
+{
+	e2::FontPtr font = m_context->renderManager()->defaultFont(face);
+	return sdf ? font->getSDFGlyph(codepoint, style) : font->getRasterGlyph(codepoint, style, uint8_t(fontSize));
+}
+
+e2::ITexture* e2::UIDefaultFontMetrics::glyphTexture(e2::FontFace face, uint32_t textureIndex)
+{
+	return m_context->renderManager()->defaultFont(face)->glyphTexture(textureIndex);
+}
+
+void e2::buildTextLayout(e2::IUITextMetrics* metrics, e2::FontFace fontFace, float fontSize, std::string const& markdownUtf8, bool sdf, bool enableColorChange, e2::UITextLayout& outLayout)
+{
+	outLayout.text = markdownUtf8;
+	outLayout.fontSize = fontSize;
+	outLayout.fontFace = fontFace;
+	outLayout.sdf = sdf;
+	outLayout.enableColorChange = enableColorChange;
+	outLayout.built = true;
+	outLayout.glyphs.clear();
+	outLayout.width = 0.0f;
+	outLayout.extents = glm::vec2(0.0f);
+
+	e2::FontFace currentFace = fontFace;
+	std::u32string src = e2::utf8to32(markdownUtf8);
+
+	float midOffset = metrics->midlineOffset(currentFace, fontSize, sdf);
+
+	glm::vec2 cursor = glm::vec2(0.f, midOffset);
+	glm::vec2 initialCursor = cursor;
+
+	uint8_t color = e2::uiTextDefaultColor;
+	uint32_t nextCodepoint = 0;
+	uint32_t prevCodepoint = 0;
+	bool escape = false;
+	e2::FontStyle currentStyle = FontStyle::Regular;
+	for (uint32_t i = 0; i < src.size(); i++)
+	{
+		uint32_t codepoint = src[i];
+
+		bool peekable = i < src.size() - 1;
+		if (peekable)
+		{
+			nextCodepoint = src[i + 1];
+		}
+
+		// special characters
+		if (codepoint <= 32)
+		{
+			// sdf text is single line, and the width is the sum of all advances regardless
+			if (codepoint == 10 && !sdf)
+			{
+				cursor.x = initialCursor.x;
+				cursor.y += fontSize * 1.25f;
+			}
+
+			// space, just OK?
+			// literally dont know how long a space is supposed to be.
+			// should probably be scaled to the fontsize or smth @todo
+			if (codepoint == 32)
+			{
+				float spaceAdvance = metrics->spaceAdvance(currentFace, currentStyle, fontSize, sdf);
+				cursor.x += spaceAdvance;
+				outLayout.width += spaceAdvance;
+			}
+
+			continue;
+		}
+
+		if (!escape)
+		{
+			// \ escape
+			if (codepoint == 92)
+			{
+				escape = true;
+				continue;
+			}
+			// * handle bold and italics 
+			else if (codepoint == 42)
+			{
+				// ** double means flip bold 
+				if (peekable && nextCodepoint == 42)
+				{
+					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Bold));
+					// add more to i, since we already parse the next codepoint here
+					i++;
+				}
+				// * single means we flip italic 
+				else
+				{
+					currentStyle = e2::FontStyle(uint8_t(currentStyle) ^ uint8_t(e2::FontStyle::Italic));
+				}
+
+				continue;
+			}
+			// ^ handle fontface changes 
+			else if (codepoint == 94 && peekable)
+			{
+				// s = sans 
+				if (nextCodepoint == 115)
+				{
+					currentFace = e2::FontFace::Sans;
+				}
+				// f = serif 
+				else if (nextCodepoint == 102)
+				{
+					currentFace = e2::FontFace::Serif;
+				}
+				// m = monospace 
+				else if (nextCodepoint == 109)
+				{
+					currentFace = e2::FontFace::Monospace;
+				}
+				// 0-9 = accent colors (see drawRasterText for a table)
+				else if (nextCodepoint >= 48 && nextCodepoint <= 57 && enableColorChange)
+				{
+					color = uint8_t(nextCodepoint - 48);
+				}
+				// - = disable accent 
+				else if (nextCodepoint == 45)
+				{
+					color = e2::uiTextDefaultColor;
+				}
+				i++;
+				continue;
+			}
+		}
+
+		// normal characters start here
+		if (i != 0)
+		{
+			float kerning = metrics->kerning(currentFace, prevCodepoint, codepoint, currentStyle, fontSize, sdf);
+			cursor.x += kerning;
+			outLayout.width += kerning;
+		}
+
+		e2::FontGlyph glyph = metrics->glyph(currentFace, codepoint, currentStyle, fontSize, sdf);
+		e2::UITextGlyph& newGlyph = outLayout.glyphs.emplace_back();
+		float advanceX{};
+		if (sdf)
+		{
+			newGlyph.offset = cursor + (glyph.offset / 32.0f) * fontSize;
+			newGlyph.size = (glyph.size / 32.0f) * fontSize;
+			advanceX = (glyph.advanceX / 32.0f) * fontSize;
+		}
+		else
+		{
+			newGlyph.offset = cursor + glyph.offset;
+			newGlyph.size = glyph.size;
+			advanceX = glyph.advanceX;
+		}
+		newGlyph.uvOffset = glyph.uvOffset;
+		newGlyph.uvSize = glyph.uvSize;
+		newGlyph.texture = metrics->glyphTexture(currentFace, glyph.textureIndex);
+		newGlyph.color = color;
+		outLayout.extents = glm::max(outLayout.extents, newGlyph.offset + newGlyph.size);
+
+		cursor.x += advanceX;
+		outLayout.width += advanceX;
+
+		prevCodepoint = codepoint;
+		escape = false;
+	}
+}
+
+e2::UITextLayoutCache::UITextLayoutCache(e2::IUITextMetrics* metrics)
+	: m_metrics(metrics)
+{
+
+}
+
+e2::UITextLayout const& e2::UITextLayoutCache::layout(e2::FontFace fontFace, float fontSize, std::string const& markdownUtf8, bool sdf, bool enableColorChange)
+{
+	size_t layoutHash = std::hash<std::string>{}(markdownUtf8);
+	e2::hash_combine(layoutHash, fontSize);
+	e2::hash_combine(layoutHash, uint8_t(fontFace));
+	e2::hash_combine(layoutHash, sdf);
+	e2::hash_combine(layoutHash, enableColorChange);
+
+	e2::UITextLayout& layout = m_layouts[layoutHash];
+
+	// new entries aren't built yet, and on a hash collision the text we want now takes over the slot
+	bool matches = layout.built
+		&& layout.fontSize == fontSize
+		&& layout.fontFace == fontFace
+		&& layout.sdf == sdf
+		&& layout.enableColorChange == enableColorChange
+		&& layout.text == markdownUtf8;
+
+	if (!matches)
+		e2::buildTextLayout(m_metrics, fontFace, fontSize, markdownUtf8, sdf, enableColorChange, layout);
+
+	layout.lastUsedFrame = m_frame;
+	return layout;
+}
+
+void e2::UITextLayoutCache::newFrame()
+{
+	// text layouts outlive widgets by a lot, so sweeping them every now and then is plenty
+	if (++m_frame % e2::uiTextLayoutRetainFrameCount == 0)
+		evict();
+}
+
+void e2::UITextLayoutCache::evict()
+{
+	std::erase_if(m_layouts, [this](std::pair<size_t const, e2::UITextLayout> const& pair) {
+		return m_frame - pair.second.lastUsedFrame >= e2::uiTextLayoutRetainFrameCount;
+	});
+}
+
+namespace
+{
+	/** Made up but deterministic metrics, that differ per face, style, size and codepoint so a layout built with the wrong ones shows */
+	class TestTextMetrics : public e2::IUITextMetrics
+	{
+	public:
+		virtual float midlineOffset(e2::FontFace face, float fontSize, bool sdf) override
+		{
+			return fontSize * (sdf ? 0.3f : 0.25f) + float(face);
+		}
+
+		virtual float spaceAdvance(e2::FontFace face, e2::FontStyle style, float fontSize, bool sdf) override
+		{
+			return fontSize * 0.25f + float(face) + float(style) * 0.5f;
+		}
+
+		virtual float kerning(e2::FontFace face, uint32_t left, uint32_t right, e2::FontStyle style, float fontSize, bool sdf) override
+		{
+			return float(int32_t((left + right + uint32_t(face)) % 3) - 1) * 0.5f;
+		}
+
+		virtual e2::FontGlyph glyph(e2::FontFace face, uint32_t codepoint, e2::FontStyle style, float fontSize, bool sdf) override
+		{
+			e2::FontGlyph glyph;
+			glyph.textureIndex = codepoint % 2;
+			glyph.uvOffset = glm::vec2(float(codepoint % 16), float(codepoint / 16 % 16)) / 16.0f;
+			glyph.uvSize = glm::vec2(1.0f / 16.0f);
+			glyph.offset = glm::vec2(float(codepoint % 3), -float(codepoint % 11) - float(style));
+			glyph.size = glm::vec2(5.0f + float(codepoint % 5) + float(face), 9.0f);
+			glyph.advanceX = 6.0f + float(codepoint % 4) + float(style);
+			return glyph;
+		}
+
+		virtual e2::ITexture* glyphTexture(e2::FontFace face, uint32_t textureIndex) override
+		{
+			// nothing is drawn, any distinct non-null pointer per face and texture will do
+			return reinterpret_cast<e2::ITexture*>(uintptr_t(1 + uint32_t(face) * 16 + textureIndex) * 64);
+		}
+	};
+
+	bool equalTextLayouts(e2::UITextLayout const& lhs, e2::UITextLayout const& rhs)
+	{
+		if (lhs.text != rhs.text || lhs.fontSize != rhs.fontSize || lhs.fontFace != rhs.fontFace || lhs.sdf != rhs.sdf || lhs.enableColorChange != rhs.enableColorChange)
+			return false;
+
+		if (lhs.width != rhs.width || lhs.extents != rhs.extents || lhs.glyphs.size() != rhs.glyphs.size())
+			return false;
+
+		for (size_t i = 0; i < lhs.glyphs.size(); i++)
+		{
+			e2::UITextGlyph const& l = lhs.glyphs[i];
+			e2::UITextGlyph const& r = rhs.glyphs[i];
+			if (l.offset != r.offset || l.size != r.size || l.uvOffset != r.uvOffset || l.uvSize != r.uvSize || l.texture != r.texture || l.color != r.color)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+bool e2::testTextLayoutCache(uint32_t numStrings)
+{
+	// markup, escapes, whitespace and some multibyte utf8, glued together at random
+	constexpr char const* pieces[] = {
+		"a", "W", "fi", "Hello", "123", ".", " ", "  ", "\n",
+		"*", "**", "***", "\\*", "\\\\", "\\^",
+		"^s", "^f", "^m", "^0", "^3", "^9", "^-", "^",
+		"\xC3\xA6\xC3\xB8\xC3\xA5",
+	};
+	constexpr uint32_t numPieces = sizeof(pieces) / sizeof(pieces[0]);
+
+	// raster glyphs are baked per whole size, like the ui uses them
+	constexpr uint8_t rasterSizes[] = { 11, 12, 14 };
+
+	struct TestString
+	{
+		std::string text;
+		e2::FontFace fontFace{};
+		float fontSize{};
+		bool sdf{};
+		bool enableColorChange{};
+	};
+
+	std::vector<TestString> strings;
+	strings.reserve(numStrings);
+	for (uint32_t i = 0; i < numStrings; i++)
+	{
+		TestString& newString = strings.emplace_back();
+		uint32_t numParts = uint32_t(e2::randomInt(0, 12));
+		for (uint32_t p = 0; p < numParts; p++)
+			newString.text += pieces[e2::randomInt(0, numPieces - 1)];
+
+		newString.fontFace = e2::FontFace(e2::randomInt(0, int64_t(e2::FontFace::Count) - 1));
+		newString.sdf = e2::randomBool();
+		newString.fontSize = newString.sdf ? e2::randomFloat(8.0f, 48.0f) : float(rasterSizes[e2::randomInt(0, 2)]);
+		newString.enableColorChange = e2::randomBool();
+	}
+
+	TestTextMetrics metrics;
+	e2::UITextLayoutCache cache(&metrics);
+	e2::UITextLayout uncached;
+	size_t numGlyphs{};
+
+	for (TestString const& s : strings)
+	{
+		e2::buildTextLayout(&metrics, s.fontFace, s.fontSize, s.text, s.sdf, s.enableColorChange, uncached);
+		numGlyphs += uncached.glyphs.size();
+
+		e2::UITextLayout const& first = cache.layout(s.fontFace, s.fontSize, s.text, s.sdf, s.enableColorChange);
+		if (!equalTextLayouts(first, uncached))
+		{
+			LogError("text layout: cached layout of \"{}\" differs from uncached", s.text);
+			return false;
+		}
+
+		e2::UITextLayout const& second = cache.layout(s.fontFace, s.fontSize, s.text, s.sdf, s.enableColorChange);
+		if (&second != &first)
+		{
+			LogError("text layout: second lookup of \"{}\" didn't hit the cache", s.text);
+			return false;
+		}
+	}
+
+	// everything was cached in between, hits must still be identical to a fresh layout
+	for (TestString const& s : strings)
+	{
+		e2::buildTextLayout(&metrics, s.fontFace, s.fontSize, s.text, s.sdf, s.enableColorChange, uncached);
+		if (!equalTextLayouts(cache.layout(s.fontFace, s.fontSize, s.text, s.sdf, s.enableColorChange), uncached))
+		{
+			LogError("text layout: cached layout of \"{}\" differs from uncached after {} other lookups", s.text, numStrings);
+			return false;
+		}
+	}
+
+	// one frame short of the retain window everything must still be there, a frame later nothing
+	uint64_t numCached = cache.numLayouts();
+	for (uint32_t i = 0; i < e2::uiTextLayoutRetainFrameCount - 1; i++)
+		cache.newFrame();
+
+	cache.evict();
+	if (cache.numLayouts() != numCached)
+	{
+		LogError("text layout: {} of {} layouts evicted before they went stale", numCached - cache.numLayouts(), numCached);
+		return false;
+	}
+
+	cache.newFrame();
+	if (cache.numLayouts() != 0)
+	{
+		LogError("text layout: {} of {} stale layouts survived eviction", cache.numLayouts(), numCached);
+		return false;
+	}
+
+	LogNotice("text layout cache verified over {} strings, {} glyphs, {} layouts evicted", numStrings, numGlyphs, numCached);
+	return true;
+}
@@ -0,0 +1,268 @@
+
+#include "e2/ui/uiwidgettable.hpp"
+
+#include "e2/log.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+e2::UIWidgetTable::UIWidgetTable()
+	: m_slots(e2::uiWidgetTableSize)
+	, m_arena(e2::maxNumUIWidgetData)
+{
+	m_liveSlots.reserve(e2::maxNumUIWidgetData);
+}
+
+e2::UIWidgetState* e2::UIWidgetTable::reserve(size_t id)
+{
+	constexpr uint32_t mask = e2::uiWidgetTableSize - 1;
+	uint32_t home = homeSlot(id);
+
+	// walk the whole chain, as the id may live past a stale slot we'd otherwise take
+	Slot* recycle = nullptr;
+	Slot* empty = nullptr;
+	for (uint32_t probe = 0; probe < e2::uiWidgetTableSize; probe++)
+	{
+		Slot& slot = m_slots[(home + probe) & mask];
+		if (!slot.state)
+		{
+			empty = &slot;
+			break;
+		}
+
+		if (slot.id == id)
+		{
+			if (stale(slot.state))
+				reset(slot.state, id);
+
+			slot.state->lastFrame = m_frame;
+			return slot.state;
+		}
+
+		if (!recycle && stale(slot.state))
+			recycle = &slot;
+	}
+
+	if (recycle)
+	{
+		recycle->id = id;
+		reset(recycle->state, id);
+		return recycle->state;
+	}
+
+	if (m_numStates >= e2::maxNumUIWidgetData)
+	{
+		compact();
+		if (m_numStates >= e2::maxNumUIWidgetData)
+		{
+			LogError("more than {} widgets in use, returning nullptr", e2::maxNumUIWidgetData);
+			return nullptr;
+		}
+
+		// the chain changed, but nothing in it is stale anymore and our id still isn't in it
+		for (uint32_t probe = 0; probe < e2::uiWidgetTableSize; probe++)
+		{
+			Slot& slot = m_slots[(home + probe) & mask];
+			if (!slot.state)
+			{
+				empty = &slot;
+				break;
+			}
+		}
+	}
+
+	// the table is twice the arena size, so there is always an empty slot
+	empty->id = id;
+	empty->state = m_arena.create();
+	m_numStates++;
+	reset(empty->state, id);
+	return empty->state;
+}
+
+void e2::UIWidgetTable::newFrame()
+{
+	m_frame++;
+}
+
+uint32_t e2::UIWidgetTable::homeSlot(size_t id) const
+{
+	// ids are combined hashes that may share low bits, so mix them before masking
+	uint64_t mixed = uint64_t(id) * 0x9E3779B97F4A7C15ull;
+	return uint32_t(mixed >> 32) & (e2::uiWidgetTableSize - 1);
+}
+
+void e2::UIWidgetTable::reset(e2::UIWidgetState* state, size_t id)
+{
+	*state = e2::UIWidgetState{};
+	state->id = id;
+	state->lastFrame = m_frame;
+}
+
+void e2::UIWidgetTable::compact()
+{
+	m_liveSlots.clear();
+	for (Slot& slot : m_slots)
+	{
+		if (!slot.state)
+			continue;
+
+		if (stale(slot.state))
+		{
+			m_arena.destroy(slot.state);
+			m_numStates--;
+		}
+		else
+		{
+			m_liveSlots.push_back(slot);
+		}
+
+		slot = Slot{};
+	}
+
+	constexpr uint32_t mask = e2::uiWidgetTableSize - 1;
+	for (Slot const& live : m_liveSlots)
+	{
+		uint32_t index = homeSlot(live.id);
+		while (m_slots[index].state)
+			index = (index + 1) & mask;
+
+		m_slots[index] = live;
+	}
+
+	m_numCompactions++;
+}
+
+bool e2::testUIWidgetTable(uint32_t numFrames)
+{
+	// the table is large, keep it off the stack
+	std::unique_ptr<e2::UIWidgetTable> table = std::make_unique<e2::UIWidgetTable>();
+
+	struct ExpectedWidget
+	{
+		uint64_t lastFrame{};
+		float token{};
+	};
+	std::unordered_map<size_t, ExpectedWidget> expected;
+	std::unordered_map<size_t, e2::UIWidgetState*> reservedThisFrame;
+	std::unordered_map<e2::UIWidgetState*, size_t> stateOwners;
+	std::vector<size_t> frameIds;
+
+	uint64_t numReserved{};
+	uint64_t numKept{};
+	uint32_t maxStates{};
+
+	// windows that open for a while, each with its own set of widgets
+	constexpr uint32_t numWindows = 16;
+	uint32_t windowOpenFrames[numWindows]{};
+
+	for (uint32_t frame = 0; frame < numFrames; frame++)
+	{
+		frameIds.clear();
+
+		// a main menu that is always there
+		for (size_t i = 0; i < 200; i++)
+			frameIds.push_back(0x1000 + i);
+
+		// windows open and close
+		for (uint32_t w = 0; w < numWindows; w++)
+		{
+			if (windowOpenFrames[w] > 0)
+			{
+				windowOpenFrames[w]--;
+				for (size_t i = 0; i < 64; i++)
+					frameIds.push_back((size_t(w + 1) << 32) | i);
+			}
+			else if (e2::randomInt(0, 99) == 0)
+			{
+				windowOpenFrames[w] = uint32_t(e2::randomInt(1, 120));
+			}
+		}
+
+		// ids that share their low bits, and widgets keyed by text that changes every frame
+		for (size_t i = 0; i < 16; i++)
+			frameIds.push_back(size_t(i) << 40);
+
+		uint32_t numTransient = uint32_t(e2::randomInt(0, 64));
+		for (uint32_t i = 0; i < numTransient; i++)
+			frameIds.push_back(size_t(e2::randomInt(1, INT64_MAX)));
+
+		// widgets drawn every few frames, right on either side of the retain window
+		frameIds.push_back(0xF000 + frame % (e2::uiRetainFrameCount - 1));
+		frameIds.push_back(0xF100 + frame % e2::uiRetainFrameCount);
+
+		reservedThisFrame.clear();
+		stateOwners.clear();
+		for (size_t id : frameIds)
+		{
+			// the same widget twice in a frame gets the same state
+			auto reservedFinder = reservedThisFrame.find(id);
+
+			e2::UIWidgetState* state = table->reserve(id);
+			numReserved++;
+			if (!state || state->id != id)
+			{
+				LogError("widget table: no or wrong state for id {} in frame {}", id, frame);
+				return false;
+			}
+
+			if (reservedFinder != reservedThisFrame.end())
+			{
+				if (reservedFinder->second != state)
+				{
+					LogError("widget table: id {} got two states in frame {}", id, frame);
+					return false;
+				}
+				continue;
+			}
+
+			auto ownerFinder = stateOwners.find(state);
+			if (ownerFinder != stateOwners.end())
+			{
+				LogError("widget table: ids {} and {} share a state in frame {}", id, ownerFinder->second, frame);
+				return false;
+			}
+			reservedThisFrame[id] = state;
+			stateOwners[state] = id;
+
+			auto finder = expected.find(id);
+			bool live = finder != expected.end() && frame - finder->second.lastFrame < e2::uiRetainFrameCount;
+			if (live)
+			{
+				if (state->dragOrigin != finder->second.token)
+				{
+					LogError("widget table: id {} lost its state after {} frames, in frame {}", id, frame - finder->second.lastFrame, frame);
+					return false;
+				}
+				numKept++;
+			}
+			else if (state->dragOrigin != 0.0f || state->hovered || state->active)
+			{
+				LogError("widget table: id {} got an old state in frame {}", id, frame);
+				return false;
+			}
+
+			ExpectedWidget& widget = expected[id];
+			widget.lastFrame = frame;
+			widget.token = e2::randomFloat(1.0f, 1000.0f);
+			state->dragOrigin = widget.token;
+		}
+
+		if (table->numStates() > e2::maxNumUIWidgetData)
+		{
+			LogError("widget table: {} states, arena only has {}", table->numStates(), e2::maxNumUIWidgetData);
+			return false;
+		}
+
+		if (table->numStates() > maxStates)
+			maxStates = table->numStates();
+
+		table->newFrame();
+
+		// keep the reference small, it only needs to know about the retain window
+		if (frame % 256 == 0)
+			std::erase_if(expected, [frame](std::pair<size_t const, ExpectedWidget> const& pair) { return frame - pair.second.lastFrame >= e2::uiRetainFrameCount; });
+	}
+
+	LogNotice("widget table verified over {} frames, {} reserves, {} kept state, at most {} states, {} compactions", numFrames, numReserved, numKept, maxStates, table->numCompactions());
+	return true;
+}
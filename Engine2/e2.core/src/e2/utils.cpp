@@ -17,6 +17,20 @@
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <cstring>
+
+#if defined(_WIN64)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #if defined(E2_DEVELOPMENT)
 #include <stacktrace>
@@ -410,6 +424,27 @@ bool e2::writeFile(std::string const& path, std::string const& data)
 
 }
 
+bool e2::syncFile(std::string const& path)
+{
+#if defined(_WIN64)
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool flushed = FlushFileBuffers(handle) != 0;
+	CloseHandle(handle);
+	return flushed;
+#else
+	int handle = ::open(path.c_str(), O_WRONLY);
+	if (handle < 0)
+		return false;
+
+	bool flushed = ::fsync(handle) == 0;
+	::close(handle);
+	return flushed;
+#endif
+}
+
 E2_API bool e2::readFileWithIncludes(std::string const& path, std::string& resolvedData)
 {
 	std::string currentBuffer;
@@ -567,7 +602,7 @@ e2::Name::Name(std::string const& s)
 		}
 
 		m_index = ::nameCursor;
-		strcpy_s(&::nameBuffer[m_index], s.size() + 1, s.c_str());
+		std::memcpy(&::nameBuffer[m_index], s.c_str(), s.size() + 1);
 		//::nameBuffer[m_index + s.size()] = '\0';
 		::nameCursor += (uint32_t)s.size() + 1;
 
@@ -5,6 +5,7 @@
 //#include <e2/renderer/shared.hpp>
 #include <e2/utils.hpp>
 #include <e2/export.hpp>
+#include <e2/assets/texturecompression.hpp>
 
 
 #include <vector>
@@ -32,6 +33,11 @@ namespace e2
 
 		bool writeAssets();
 	protected:
+		/** Writes mips as RGBA8 block compressed to the format that fits usage, building the chain first if doGenMips */
+		bool writeCompressed(std::vector<std::string> const& mipSources, bool doGenMips, e2::TextureUsage usage, bool highQuality, bool uncompressed, e2::IStream& textureData);
+
+		/** Writes mips as RGBA32 floats, left for the GPU to generate if doGenMips */
+		bool writeHdr(std::vector<std::string> const& mipSources, bool doGenMips, e2::IStream& textureData);
 
 		TextureImportConfig m_config;
 
@@ -4,6 +4,7 @@
 #include <editor/importer.hpp>
 //#include <e2/renderer/shared.hpp>
 #include <e2/renderer/meshspecification.hpp>
+#include <e2/assets/meshlod.hpp>
 #include <e2/utils.hpp>
 #include <e2/export.hpp>
 #include <e2/dmesh/dmesh.hpp>
@@ -26,6 +27,9 @@ namespace e2
 		std::string outputDirectory{"./assets/"};
 
 		std::unordered_map<std::string, std::string> materialMappings;
+
+		/** How many simplified levels of detail to build and how far to take them */
+		e2::MeshLodSettings lods;
 	};
 
 	struct UfbxImportAttribute
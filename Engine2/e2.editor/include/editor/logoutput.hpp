@@ -38,7 +38,7 @@ namespace e2
 
 		float m_scrollOffset{};
 		bool m_autoScroll{true};
-		uint32_t m_lastNumEntries{};
+		uint64_t m_lastNumEntries{};
 	};
 
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "editor/importers/meshimporter.hpp"
 
 #include "e2/assets/asset.hpp"
+#include "e2/assets/meshquantization.hpp"
+#include "e2/assets/meshlod.hpp"
 #include "e2/utils.hpp"
 #include "e2/managers/assetmanager.hpp"
 #include "e2/ui/uicontext.hpp"
@@ -812,21 +814,82 @@ bool e2::MeshImporter::writeAssets()
 			meshData << uint32_t(pair.second);
 		}
 
+		// simplified levels of every submesh, as index lists over the full detail vertices
+		std::vector<e2::LodSource> lodSources;
+		for (e2::ImportSubmesh &submesh : m_mesh.submeshes)
+		{
+			e2::ImportSubmesh::IntermediateData& im = submesh.intermediate;
+
+			e2::LodSource source;
+			source.indices = reinterpret_cast<uint32_t const*>(im.indexData.data());
+			source.numIndices = im.indexCount;
+			source.positions = reinterpret_cast<glm::vec4 const*>(im.attributes[0].vertexData.data());
+			source.numVertices = im.vertexCount;
+
+			// weights and bone ids are the last two streams
+			if ((im.attributeFlags & e2::VertexAttributeFlags::Bones) == e2::VertexAttributeFlags::Bones)
+			{
+				source.weights = reinterpret_cast<glm::vec4 const*>(im.attributes[im.attributes.size() - 2].vertexData.data());
+				source.bones = reinterpret_cast<glm::uvec4 const*>(im.attributes[im.attributes.size() - 1].vertexData.data());
+			}
+
+			lodSources.push_back(source);
+		}
+
+		e2::MeshLods lods;
+		e2::generateMeshLods(m_config.lods, lodSources.data(), uint32_t(lodSources.size()), lods);
+
+		meshData << lods.radius;
+		meshData << uint8_t(lods.screenSizes.size());
+		for (float screenSize : lods.screenSizes)
+			meshData << screenSize;
+
 		meshData << uint32_t(m_mesh.submeshes.size());
+		uint32_t submeshIndex = 0;
 		for (e2::ImportSubmesh &submesh : m_mesh.submeshes)
 		{
 
 			e2::ImportSubmesh::IntermediateData& im = submesh.intermediate;
+
+			// quantized if every stream stays within tolerance, 16 bit indices if they fit
+			uint8_t const* streams[e2::maxNumSpecificationAttributes]{};
+			for (uint32_t i = 0; i < im.attributes.size(); i++)
+				streams[i] = im.attributes[i].vertexData.data();
+
+			// the index buffer holds every level, full detail first
+			e2::LodSubmesh const& submeshLods = lods.submeshes[submeshIndex];
+
+			e2::EncodedSubmesh encoded;
+			e2::encodeSubmeshStreams(im.attributeFlags, im.vertexCount, uint32_t(submeshLods.indices.size()), submeshLods.indices.data(), streams, true, encoded);
+
 			meshData << im.vertexCount;
 			meshData << im.indexCount;
 			meshData << uint8_t(im.attributeFlags);
-			meshData << uint32_t(im.indexData.size());
-			meshData << im.indexData;
-			for (ImportAttribute & attr : im.attributes)
+			meshData << uint8_t(encoded.quantized);
+			meshData << uint8_t(encoded.indexFormat);
+
+			meshData << uint8_t(submeshLods.levels.size());
+			for (uint32_t i = 0; i < submeshLods.levels.size(); i++)
 			{
-				meshData << uint32_t(attr.vertexData.size());
-				meshData << attr.vertexData;
+				e2::SubmeshLod const& level = submeshLods.levels[i];
+				meshData << level.firstIndex;
+				meshData << level.indexCount;
+				meshData << level.error;
+				LogNotice("{} submesh {} lod {}: {} of {} triangles, error {}", m_mesh.meshName, submeshIndex, i + 1, level.indexCount / 3, im.indexCount / 3, level.error);
 			}
+
+			meshData << uint32_t(encoded.indexData.size());
+			meshData.write(encoded.indexData.data(), encoded.indexData.size());
+
+			uint64_t encodedSize = encoded.indexData.size();
+			for (std::vector<uint8_t> const& stream : encoded.streams)
+			{
+				meshData << uint32_t(stream.size());
+				meshData.write(stream.data(), stream.size());
+				encodedSize += stream.size();
+			}
+
+			LogNotice("{} submesh {}: {} bytes, {}", m_mesh.meshName, submeshIndex++, encodedSize, encoded.quantized ? "quantized" : "full precision");
 		}
 
 		meshData.seek(0);
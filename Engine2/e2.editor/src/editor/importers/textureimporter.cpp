@@ -5,6 +5,7 @@
 #include "e2/utils.hpp"
 #include "e2/managers/assetmanager.hpp"
 #include "e2/rhi/texture.hpp"
+#include "e2/assets/texturecompression.hpp"
 
 #include <stb_image.h>
 
@@ -45,6 +46,13 @@ bool e2::TextureImporter::writeAssets()
 
 	bool srgb = true;
 	bool hdr = false;
+	bool normal = false;
+
+	// BC7 instead of BC1/BC3, for textures where the blockiness shows
+	bool highQuality = false;
+
+	// plain RGBA8, for the odd texture that has to stay exact
+	bool uncompressed = false;
 
 	bool doGenMips = false;
 
@@ -72,6 +80,17 @@ bool e2::TextureImporter::writeAssets()
 				if (trimmed == "#linear")
 					srgb = false;
 
+				if (trimmed == "#normal")
+				{
+					normal = true;
+					srgb = false;
+				}
+
+				if (trimmed == "#hq")
+					highQuality = true;
+
+				if (trimmed == "#uncompressed")
+					uncompressed = true;
 
 				continue;
 			}
@@ -89,6 +108,9 @@ bool e2::TextureImporter::writeAssets()
 			srgb = true;
 
 		hdr = inFileLower.contains("hdr");
+		normal = inFileLower.contains("normal");
+		highQuality = inFileLower.contains("hq");
+		uncompressed = inFileLower.contains("uncompressed");
 
 		doGenMips = true;
 		mipSources.push_back(m_config.input);
@@ -108,13 +130,114 @@ bool e2::TextureImporter::writeAssets()
 
 	e2::HeapStream textureData;
 
+	if (!hdr)
+	{
+		if (!writeCompressed(mipSources, doGenMips, normal ? e2::TextureUsage::Normal : srgb ? e2::TextureUsage::Color : e2::TextureUsage::Linear, highQuality, uncompressed, textureData))
+			return false;
+	}
+	else if (!writeHdr(mipSources, doGenMips, textureData))
+	{
+		return false;
+	}
+
+	textureData.seek(0);
+	textureHeader.size = textureData.size();
+
+	e2::FileStream fileBuffer(outFile, e2::FileMode::ReadWrite | e2::FileMode::Truncate, true);
+	fileBuffer << textureHeader;
+	fileBuffer << textureData;
+	if (fileBuffer.valid())
+	{
+		assetManager()->database().invalidateAsset(outFile);
+		return true;
+	}
+	else
+	{
+		LogError("Failed to create texture, could not write to file: {}", outFile);
+		//return e2::UUID();
+		return false;
+	}
+}
+
+bool e2::TextureImporter::writeCompressed(std::vector<std::string> const& mipSources, bool doGenMips, e2::TextureUsage usage, bool highQuality, bool uncompressed, e2::IStream& textureData)
+{
+	std::vector<std::vector<uint8_t>> mips;
+	std::vector<glm::uvec2> resolutions;
+	for (std::string const& source : mipSources)
+	{
+		int32_t x, y, n;
+		uint8_t* imageData = stbi_load(source.c_str(), &x, &y, &n, 4);
+		if (!imageData)
+		{
+			LogError("Failed to read file {}", source);
+			return false;
+		}
+
+		mips.push_back(std::vector<uint8_t>(imageData, imageData + uint64_t(x) * uint64_t(y) * 4));
+		resolutions.push_back(glm::uvec2(x, y));
+		stbi_image_free(imageData);
+	}
+
+	// the chain is built here, filtered properly per usage, instead of blitted on the GPU at load
+	if (doGenMips)
+	{
+		std::vector<uint8_t> source = std::move(mips[0]);
+		e2::generateMipChain(source.data(), resolutions[0], usage, mips);
+
+		resolutions.resize(mips.size());
+		for (uint32_t i = 1; i < resolutions.size(); i++)
+			resolutions[i] = glm::max(resolutions[i - 1] / 2u, glm::uvec2(1, 1));
+	}
+
+	bool hasAlpha = false;
+	bool grayscale = true;
+	for (uint64_t i = 0; i < mips[0].size(); i += 4)
+	{
+		hasAlpha = hasAlpha || mips[0][i + 3] != 255;
+		grayscale = grayscale && mips[0][i] == mips[0][i + 1] && mips[0][i] == mips[0][i + 2];
+	}
+
+	e2::TextureFormat format = e2::chooseBlockFormat(usage, hasAlpha, grayscale, highQuality);
+	if (uncompressed)
+		format = usage == e2::TextureUsage::Color ? e2::TextureFormat::SRGB8A8 : e2::TextureFormat::RGBA8;
+
+	textureData << resolutions[0];
+	textureData << uint8_t(mips.size());
+	textureData << uint8_t(0);
+	textureData << uint8_t(format);
+
+	uint64_t rawSize{};
+	uint64_t writtenSize{};
+	std::vector<uint8_t> blocks;
+	for (uint32_t i = 0; i < mips.size(); i++)
+	{
+		rawSize += mips[i].size();
+		if (uncompressed)
+		{
+			textureData << uint64_t(mips[i].size());
+			textureData.write(mips[i].data(), mips[i].size());
+			writtenSize += mips[i].size();
+			continue;
+		}
+
+		if (!e2::encodeBlocks(format, mips[i].data(), resolutions[i], blocks))
+			return false;
+
+		textureData << uint64_t(blocks.size());
+		textureData.write(blocks.data(), blocks.size());
+		writtenSize += blocks.size();
+	}
+
+	LogNotice("{}x{}, {} mips, format {}: {} bytes ({} as rgba8)", resolutions[0].x, resolutions[0].y, mips.size(), uint32_t(format), writtenSize, rawSize);
+	return true;
+}
+
+bool e2::TextureImporter::writeHdr(std::vector<std::string> const& mipSources, bool doGenMips, e2::IStream& textureData)
+{
 	int32_t x, y, n;
 
 	// we do this to retrieve mip 0 resoulution
-	if (hdr)
-		stbi_loadf(mipSources[0].c_str(), &x, &y, &n, 4);
-	else
-		stbi_load(mipSources[0].c_str(), &x, &y, &n, 4);
+	stbi_loadf(mipSources[0].c_str(), &x, &y, &n, 4);
 
 	glm::uvec2 resolution(x, y);
 	textureData << resolution;
@@ -130,15 +253,11 @@ bool e2::TextureImporter::writeAssets()
 
 	textureData << (doGenMips ? uint8_t(1) : uint8_t(0));
 
-	textureData << uint8_t(srgb ? e2::TextureFormat::SRGB8A8 : hdr ? e2::TextureFormat::RGBA32 : e2::TextureFormat::RGBA8);
+	textureData << uint8_t(e2::TextureFormat::RGBA32);
 	
 	for (uint8_t i = 0; i < mipSources.size(); i++)
 	{
-		uint8_t* imageData{};
-		if (hdr)
-			imageData = reinterpret_cast<uint8_t*>(stbi_loadf(mipSources[i].c_str(), &x, &y, &n, 4));
-		else
-			imageData = stbi_load(mipSources[i].c_str(), &x, &y, &n, 4);
+		uint8_t* imageData = reinterpret_cast<uint8_t*>(stbi_loadf(mipSources[i].c_str(), &x, &y, &n, 4));
 
 		if (!imageData)
 		{
@@ -146,36 +265,13 @@ bool e2::TextureImporter::writeAssets()
 			return false;
 		}
 
-		if (hdr)
-			textureData << uint64_t(x * y * 4 * 4);
-		else
-			textureData << uint64_t(x * y * 4);
-
-		if (hdr)
-			textureData.write(imageData, uint64_t(x * y * 4 * 4));
-		else
-			textureData.write(imageData, uint64_t(x * y * 4));
+		textureData << uint64_t(x * y * 4 * 4);
+		textureData.write(imageData, uint64_t(x * y * 4 * 4));
 
 		stbi_image_free(imageData);
 	}
 
-	textureData.seek(0);
-	textureHeader.size = textureData.size();
-
-	e2::FileStream fileBuffer(outFile, e2::FileMode::ReadWrite | e2::FileMode::Truncate, true);
-	fileBuffer << textureHeader;
-	fileBuffer << textureData;
-	if (fileBuffer.valid())
-	{
-		assetManager()->database().invalidateAsset(outFile);
-		return true;
-	}
-	else
-	{
-		LogError("Failed to create texture, could not write to file: {}", outFile);
-		//return e2::UUID();
-		return false;
-	}
+	return true;
 }
 
 
@@ -24,7 +24,7 @@ void e2::LogOutput::update(e2::UIContext* ui, double seconds)
 {
 	e2::UIStyle& style = uiManager()->workingStyle();
 
-	uint32_t newEntries = e2::Log::numEntries();
+	uint64_t newEntries = e2::Log::numWritten();
 	bool haveNewEntries = (newEntries != m_lastNumEntries);
 	m_lastNumEntries = newEntries;
 
@@ -0,0 +1,99 @@
+
+#pragma once
+
+#include <e2/utils.hpp>
+#include "game/gamecontext.hpp"
+#include "game/shared.hpp"
+#include "game/hex.hpp"
+
+#include <vector>
+#include <unordered_map>
+
+namespace e2
+{
+	class CollisionComponent;
+	class MovementComponent;
+
+	/** Static collisions (trees and terrain) for one chunk, grouped by hex */
+	struct StaticCollisionChunk
+	{
+		e2::CollisionSet circles;
+
+		// circles for local hex i (row-major like TilePage) are [hexStart[i], hexStart[i+1])
+		uint32_t hexStart[e2::hexChunkResolution * e2::hexChunkResolution + 1]{};
+	};
+
+	struct MoveRequest
+	{
+		e2::MovementComponent* movement{};
+
+		// invalidated after the move, so the mover lands in the right bucket before later groups query
+		e2::CollisionComponent* collision{};
+
+		float radius{};
+		glm::vec2 direction{};
+		float energy{};
+		e2::CollisionType mask{ e2::CollisionType::All };
+
+		// written by solveMoves
+		float energyLeft{};
+	};
+
+	/**
+	 * Persistent broadphase for game collisions.
+	 * Trees and terrain are built once per chunk and kept until something in the chunk changes (invalidateStatic) or it streams out.
+	 * Collision components are bucketed per hex, and moved between buckets by CollisionComponent::invalidate.
+	 * Component positions are read at query time, since not every mover invalidates right after moving.
+	 */
+	class CollisionWorld : public e2::GameContext
+	{
+	public:
+		CollisionWorld(e2::Game* g);
+		~CollisionWorld();
+
+		virtual e2::Game* game() override;
+
+		void registerComponent(e2::CollisionComponent* component, glm::ivec2 const& hex);
+		void unregisterComponent(e2::CollisionComponent* component, glm::ivec2 const& hex);
+
+		/** Drops static collisions for the chunk containing hex, call whenever trees or terrain in it change */
+		void invalidateStatic(glm::ivec2 const& hex);
+
+		/** Drops static collisions for chunk, when it's streamed out. Same as invalidateStatic but takes a chunk index */
+		void evictStatic(glm::ivec2 const& chunkIndex);
+
+		/** Drops all static collisions, i.e. when the grid is replaced or loaded */
+		void clearStatic();
+
+		/** Collisions in hex (and its neighbours) whose type is in mask */
+		void query(glm::ivec2 const& hex, e2::CollisionType mask, bool includeNeighbours, e2::CollisionSet& outCollisions);
+		void query(glm::ivec2 const& hex, e2::CollisionType mask, bool includeNeighbours, std::vector<e2::Collision>& outCollisions);
+
+		/**
+		 * Moves every request in one pass. Requests are grouped by hex, so every group shares a single query.
+		 * Same result as calling MovementComponent::move on each in order, as long as they don't collide with each other.
+		 */
+		void solveMoves(std::vector<e2::MoveRequest>& requests);
+
+		uint32_t numStaticChunks()
+		{
+			return uint32_t(m_staticChunks.size());
+		}
+
+	protected:
+		e2::StaticCollisionChunk* getStaticChunk(glm::ivec2 const& chunkIndex);
+		void buildStaticChunk(glm::ivec2 const& chunkIndex, e2::StaticCollisionChunk* chunk);
+		void queryHex(glm::ivec2 const& hex, e2::CollisionType mask, e2::CollisionSet& outCollisions);
+
+		e2::Game* m_game{};
+
+		std::unordered_map<glm::ivec2, e2::StaticCollisionChunk*> m_staticChunks;
+		std::unordered_map<glm::ivec2, std::vector<e2::CollisionComponent*>> m_components;
+
+		// scratch for query(std::vector) and solveMoves
+		e2::CollisionSet m_scratch;
+		std::vector<glm::ivec2> m_moveHexes;
+		std::vector<uint32_t> m_moveOrder;
+	};
+
+}
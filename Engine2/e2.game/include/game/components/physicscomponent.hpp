@@ -74,8 +74,13 @@ namespace e2
 		virtual ~MovementComponent();
 
 		// returns energy left
-		float move(float radius, glm::vec2 const& dir, float energy, e2::CollisionType mask, std::vector<e2::Collision> const& collisions);
-		void resolve(float radius, e2::CollisionType mask, std::vector<e2::Collision> const& collisions);
+		float move(float radius, glm::vec2 const& dir, float energy, e2::CollisionType mask, e2::CollisionSet const& collisions);
+		void resolve(float radius, e2::CollisionType mask, e2::CollisionSet const& collisions);
+
+		inline e2::Entity* entity()
+		{
+			return m_entity;
+		}
 
 	protected:
 
@@ -84,6 +89,9 @@ namespace e2
 		e2::Entity* m_entity{};
 		e2::MovementSpecification* m_specification{};
 
+		// circles close to the swept segment, kept so moving doesn't allocate once warm
+		std::vector<uint32_t> m_sweepCandidates;
+
 		//e2::MovementSpecification* m_specification{};
 	};
 
@@ -49,6 +49,8 @@ namespace e2
 
 		virtual void update(double seconds) override;
 
+		virtual void applyRenderTransform() override;
+
 		virtual void onTrigger(e2::Name action, e2::Name trigger) override;
 
 		virtual void updateVisibility() override;
@@ -88,7 +90,7 @@ namespace e2
 
 		glm::vec2 m_lastPosition{};
 
-		std::vector<e2::Collision> m_collisionCache;
+		e2::CollisionSet m_collisionCache;
 	};
 
 }
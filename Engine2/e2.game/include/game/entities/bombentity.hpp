@@ -54,6 +54,8 @@ namespace e2
 
 		virtual void update(double seconds) override;
 
+		virtual void applyRenderTransform() override;
+
 		virtual void updateVisibility() override;
 		virtual void onInteract(e2::Entity* instigator);
 		virtual std::string interactText() override;
@@ -79,7 +81,7 @@ namespace e2
 		bool m_dead = false;
 		float m_killTimer{ 0.1f };
 
-		std::vector<e2::Collision> m_collisionCache;
+		e2::CollisionSet m_collisionCache;
 	};
 
 }
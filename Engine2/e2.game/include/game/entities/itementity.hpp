@@ -102,7 +102,7 @@ namespace e2
 		double m_time{};
 		float m_rotation{};
 
-		std::vector<e2::Collision> m_collisionCache;
+		e2::CollisionSet m_collisionCache;
 	};
 
 }
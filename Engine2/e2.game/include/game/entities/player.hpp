@@ -62,6 +62,11 @@ namespace e2
 
 		virtual void update(double seconds) override;
 
+		virtual void applyRenderTransform() override;
+
+		/** Pickups, interactables and boarding, once per frame after simulating, since it reacts to pressed keys */
+		void updateInteraction();
+
 		void updateLand(double seconds);
 		void updateWater(double seconds);
 
@@ -94,7 +99,7 @@ namespace e2
 		{
 			return m_movement;
 		}
-		inline std::vector<e2::Collision>& getCollisionCache()
+		inline e2::CollisionSet& getCollisionCache()
 		{
 			return m_collisionCache;
 		}
@@ -134,7 +139,7 @@ namespace e2
 		e2::FogComponent m_fog;
 
 		e2::Entity* m_interactable{};
-		std::vector<e2::Collision> m_collisionCache;
+		e2::CollisionSet m_collisionCache;
 	};
 
 
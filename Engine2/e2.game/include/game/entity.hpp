@@ -68,8 +68,18 @@ namespace e2
 
 		virtual void updateAnimation(double seconds) {};
 
+		/** Simulation, runs at the fixed simulation rate. May run zero or several times in a frame, so don't read pressed keys here */
 		virtual void update(double seconds) {};
 
+		/** Pushes renderMatrix() to mesh proxies. Called once per rendered frame after simulating, for entities in view */
+		virtual void applyRenderTransform() {};
+
+		/** Called before each simulation step. Remembers where we are, so rendering can interpolate from here to where the step takes us */
+		void beginSimulationStep();
+
+		/** World transform to render with, interpolated between the last two simulation steps */
+		glm::mat4 renderMatrix();
+
 		virtual bool interactable() { return false; }
 
 		virtual void onInteract(e2::Entity* interactor) {}
@@ -129,6 +139,11 @@ namespace e2
 		bool m_inView{}; // update automatically by game
 
 		e2::Transform* m_transform{};
+
+		// transform before the last simulation step, and which step that was. Only interpolated from while it's the latest step, so an entity that stops being simulated renders where it is
+		glm::vec3 m_previousTranslation{};
+		glm::quat m_previousRotation{ glm::identity<glm::quat>() };
+		uint64_t m_previousStep{ UINT64_MAX };
 	};
 
 
@@ -4,9 +4,13 @@
 
 
 #include <e2/application.hpp>
+#include <e2/async.hpp>
+#include <e2/buffer.hpp>
 #include <e2/assets/sound.hpp>
 #include <e2/managers/audiomanager.hpp>
 #include "game/hex.hpp"
+#include "game/pathfinding.hpp"
+#include "game/collision.hpp"
 #include "game/gamecontext.hpp"
 #include "game/resources.hpp"
 #include "game/entity.hpp"
@@ -22,29 +26,6 @@ namespace e2
 	class CollisionComponent;
 
 
-	/** @tags(arena, arenaSize=16384*128) */
-	class PathFindingHex : public e2::Object
-	{
-		ObjectDeclaration();
-	public:
-		PathFindingHex(e2::Hex const& index);
-		virtual ~PathFindingHex();
-
-		e2::Hex index;
-
-		e2::Entity* grugTarget{};
-		e2::PathFindingHex* towardsOrigin{};
-
-		uint32_t stepsFromOrigin{};
-
-		bool isBegin{};
-		bool hexHasTarget{};
-		bool instantlyReachable{};
-	};
-
-	//uint32_t maxAutoMoveRange = 128; // 128*128 = 16384 pathfindinghex
-
-
 	struct Message
 	{
 		std::string text;
@@ -52,25 +33,6 @@ namespace e2
 	};
 
 
-	/** @tags(arena, arenaSize=4096) */
-	class PathFindingAS : public e2::Object
-	{
-		ObjectDeclaration();
-	public:
-		PathFindingAS();
-		PathFindingAS(e2::Game* game, e2::Hex const& start, uint64_t range, bool ignoreVisibility = false, e2::PassableFlags passableFlags = PassableFlags::Land, bool onlyWaveRelevant = false, e2::Hex *stopWhenFound = nullptr);
-
-		~PathFindingAS();
-
-		std::vector<e2::Hex> find(e2::Hex const& target);
-
-		e2::PathFindingHex* origin{};
-		std::unordered_map<glm::ivec2, e2::PathFindingHex*> hexIndex;
-
-		
-		
-	};
-
 	class Game;
 
 	class Entity;
@@ -80,6 +42,15 @@ namespace e2
 
 	constexpr uint64_t maxEntitySpawns = 16;
 
+	/** Realtime simulation (movement, collisions, mobs, radion) steps at this rate, whatever the frame rate */
+	constexpr double simulationRate = 60.0;
+
+	/** Most simulation steps we catch up in one frame. Beyond this the game slows down instead of frames getting ever longer */
+	constexpr uint32_t maxSimulationSteps = 4;
+
+	/** Radion ticks every this many simulation steps, 10 per second */
+	constexpr uint32_t radionTickInterval = 6;
+
 	struct EntitySpawn
 	{
 		e2::Name entityId;
@@ -93,6 +64,60 @@ namespace e2
 		e2::StackVector<e2::EntitySpawn, e2::maxEntitySpawns> spawns;
 	};
 
+	constexpr uint64_t maxNumSaveTasks = 16;
+
+	/** Follows the timestamp in saves whose body is compressed. Saves from before have the raw body right after the timestamp */
+	constexpr uint32_t compressedSaveMagic = 0x5A533245; // "E2SZ"
+
+	/**
+	 * Writes a save captured in memory by Game::saveGame. Compresses it and writes it to a temp file on an async worker,
+	 * then renames that over the save, so a save is never left half written.
+	 * @tags(arena, arenaSize=e2::maxNumSaveTasks)
+	 */
+	class SaveWriteTask : public e2::AsyncTask
+	{
+		ObjectDeclaration()
+	public:
+		SaveWriteTask(e2::Game* inGame, e2::SaveMeta const& inMeta);
+		virtual ~SaveWriteTask();
+
+		virtual bool execute() override;
+		virtual bool finalize() override;
+
+		e2::Game* game{};
+		e2::SaveMeta meta;
+
+		/** Everything after the timestamp, written by the main thread before this is enqueued */
+		e2::HeapStream body;
+
+		e2::Moment begin;
+		double captureMs{};
+		double writeMs{};
+		uint64_t compressedSize{};
+		bool written{};
+	};
+
+	/**
+	 * Reads and decompresses a save on an async worker, so it happens while the main thread tears down and sets up the world it's loaded into.
+	 * @tags(arena, arenaSize=e2::maxNumSaveTasks)
+	 */
+	class SaveReadTask : public e2::AsyncTask
+	{
+		ObjectDeclaration()
+	public:
+		SaveReadTask(e2::Game* inGame, std::string const& inFileName);
+		virtual ~SaveReadTask();
+
+		virtual bool execute() override;
+
+		std::string fileName;
+
+		/** Everything after the timestamp, uncompressed */
+		e2::HeapStream body;
+		bool valid{};
+		double readMs{};
+	};
+
 	class Game : public e2::Application, public e2::GameContext
 	{
 
@@ -111,6 +136,12 @@ namespace e2
 		void readAllSaveMetas();
 		void loadGame(uint8_t slot);
 
+		/** Called by SaveWriteTask on the main thread once a save is on disk (or failed to get there) */
+		void onSaveWritten(e2::SaveWriteTask* task);
+
+		/** Blocks until every save in flight is on disk. Needs the async threads running, so never call it after preShutdown() */
+		void waitForSaves();
+
 		// thsi function inits game specific stuff (as opposed to resources). Creates grid etc
 		void setupGame();
 
@@ -122,6 +153,7 @@ namespace e2
 		void finalizeBoot();
 
 		virtual void initialize() override;
+		virtual void preShutdown() override;
 		virtual void shutdown() override;
 		virtual void update(double seconds) override;
 		void updateGame(double seconds);
@@ -168,6 +200,7 @@ namespace e2
 		void drawHitLabels();
 		void drawMinimapUI();
 		void drawDebugUI();
+
 		void drawFinalUI();
 		void drawCrosshair();
 
@@ -182,6 +215,18 @@ namespace e2
 			return m_timeDelta;
 		}
 
+		/** Simulation steps run so far */
+		uint64_t simulationSteps() const
+		{
+			return m_simulationSteps;
+		}
+
+		/** How far the current frame is between the last simulation step and the next */
+		double simulationAlpha() const
+		{
+			return m_simulation.alpha();
+		}
+
 		inline TurnState getTurnState() const
 		{
 			return m_turnState;
@@ -224,6 +269,15 @@ namespace e2
 
 		double m_timeDelta{};
 
+		// save in flight per slot, a new save of the same slot waits for it
+		e2::AsyncTaskPtr m_saveTasks[e2::numSaveSlots];
+
+		// size of the last save body, to reserve for the next capture
+		uint64_t m_lastSaveSize{};
+
+		e2::FixedTimestep m_simulation{ e2::simulationRate, e2::maxSimulationSteps };
+		uint64_t m_simulationSteps{};
+
 		e2::ScriptGraph* m_currentGraph{};
 		e2::ScriptExecutionContext* m_scriptExecutionContext{};
 
@@ -326,12 +380,13 @@ namespace e2
 		{
 			return m_playerState.entity;
 		}
+
 	protected:
 
 		e2::LightweightProxy* m_testProxy{};
 
 		// anim stuff 
-		double m_accumulatedAnimationTime{};
+		e2::FixedTimestep m_animation{ 60.0, e2::maxSimulationSteps };
 
 		// camera stuff 
 		e2::RenderView m_view;
@@ -418,9 +473,16 @@ namespace e2
 		void unregisterCollisionComponent(e2::CollisionComponent* component, glm::ivec2 const& index);
 
 		void populateCollisions(glm::ivec2 const& coordinate, CollisionType mask, std::vector<e2::Collision>& outCollisions, bool includeNeighbours = true);
+		void populateCollisions(glm::ivec2 const& coordinate, CollisionType mask, e2::CollisionSet& outCollisions, bool includeNeighbours = true);
+
+		e2::CollisionWorld* collisionWorld();
+
+		/** Moves are solved together once every entity has updated in a simulation step, see CollisionWorld::solveMoves */
+		void queueMove(e2::MoveRequest const& request);
 
 	protected:
-		std::unordered_map<glm::ivec2, std::unordered_set<e2::CollisionComponent*>> m_collisionComponents;
+		e2::CollisionWorld m_collisionWorld;
+		std::vector<e2::MoveRequest> m_queuedMoves;
 
 
 		e2::RadionManager m_radionManager;
@@ -15,9 +15,11 @@
 #include <e2/assets/sound.hpp>
 #include "game/gamecontext.hpp"
 #include "game/shared.hpp"
+#include "game/vegetation.hpp"
 
 #include <vector>
 #include <unordered_map>
+#include <atomic>
 
 namespace e2
 {
@@ -49,7 +51,12 @@ namespace e2
 		
 
 		uint32_t meshIndex{};
-		e2::MeshProxy* mesh{};
+
+		// handle in the grids tree instances, UINT32_MAX while its chunk is out of view
+		uint32_t instance{ UINT32_MAX };
+
+		// set once the tree has been turned into lumber, it's not drawn again
+		bool removed{};
 		
 		glm::vec2 worldOffset;
 		glm::vec2 fallDir;
@@ -59,7 +66,6 @@ namespace e2
 		float health{ 1.0f }; // if 0, this tree is harvested, will fall and die
 		float fallTime{ e2::maxTreeFallTime }; // if > 0 and health 0.0, currently falling, otherwise fallen and dying
 		float killTime{ 1.0f }; // if > 0 and falltime 0.0, currently dying, otherwise dead
-		float shake{ 0.0f };
 		
 		uint32_t totalLumber{};
 		uint32_t spawnedLumber{};
@@ -155,15 +161,226 @@ namespace e2
 
 	constexpr uint32_t hexChunkResolution = 6;
 
+	/** chunk including a 1 tile border on each side, this is what chunk generation needs to sample neighbours */
+	constexpr uint32_t hexChunkBorderResolution = hexChunkResolution + 2;
+	constexpr uint32_t hexChunkBorderTiles = hexChunkBorderResolution * hexChunkBorderResolution;
+
 	constexpr uint32_t maxNumExtraChunks = 1024;
 	constexpr uint32_t maxNumChunkStates = 4096;
 
 	constexpr uint32_t maxNumChunkLoadTasks = 4096;
+
+	/** number of chunks the procedural tile cache holds, must be power of two */
+	constexpr uint32_t maxNumCachedChunks = 1024;
 	constexpr uint32_t maxNumMeshesPerChunk = (hexChunkResolution * hexChunkResolution)*3;
 	constexpr uint32_t maxNumEntitiesPerChunk = (hexChunkResolution * hexChunkResolution) * 8;
 
 	class HexGrid;
 
+	/** 
+	 * Procedural tile data for one chunk, see ProceduralTileCache
+	 * Written only from mainthread, read from anywhere. sequence is odd while a write is in progress, so readers can tell if they raced a write (seqlock)
+	 */
+	struct TileCacheSlot
+	{
+		std::atomic<uint32_t> sequence{};
+		bool valid{};
+		glm::ivec2 chunkIndex{};
+		e2::TileData tiles[hexChunkResolution * hexChunkResolution];
+	};
+
+	/**
+	 * Discovered tiles for one chunk, row-major with hexChunkResolution squared entries.
+	 * Visibility and the discovered mask are kept apart from the tile records, so fog of war can sweep them without touching tiles
+	 */
+	struct TilePage
+	{
+		glm::ivec2 chunkIndex{};
+
+		// bit per tile, set if discovered
+		uint64_t discoveredMask{};
+
+		// bit per tile, set while its visibility is above zero
+		uint64_t visibleMask{};
+
+		// bumped whenever anything fog of war shows for this page changes, see FogOfWarTexels
+		uint32_t revision{};
+
+		// number of things seeing each tile
+		int32_t visibility[hexChunkResolution * hexChunkResolution]{};
+
+		e2::TileData tiles[hexChunkResolution * hexChunkResolution];
+
+		inline bool isDiscovered(uint32_t localIndex) const
+		{
+			return (discoveredMask & (uint64_t(1) << localIndex)) != 0;
+		}
+
+		inline bool isVisible(uint32_t localIndex) const
+		{
+			return (visibleMask & (uint64_t(1) << localIndex)) != 0;
+		}
+
+		/** Adds one to the visibility of a tile */
+		inline void flagVisible(uint32_t localIndex)
+		{
+			visibility[localIndex]++;
+			syncVisible(localIndex);
+		}
+
+		/** Removes one from the visibility of a tile */
+		inline void unflagVisible(uint32_t localIndex)
+		{
+			visibility[localIndex]--;
+			syncVisible(localIndex);
+		}
+
+		/** Marks a tile discovered with the given data, seen by nothing yet */
+		void discover(uint32_t localIndex, e2::TileData const& tile);
+
+		void clearVisibility();
+
+		/** Rebuilds visibleMask from visibility, after the latter was written directly */
+		void syncVisibleMask();
+
+	protected:
+		inline void syncVisible(uint32_t localIndex)
+		{
+			uint64_t bit = uint64_t(1) << localIndex;
+			bool visible = visibility[localIndex] > 0;
+			if (visible == ((visibleMask & bit) != 0))
+				return;
+
+			visibleMask ^= bit;
+			revision++;
+		}
+	};
+
+	static_assert(hexChunkResolution * hexChunkResolution <= 64, "TilePage::discoveredMask needs one bit per tile");
+
+	/** Starts the hex grid in saves, saves without it (or with another version) are from before tile pages and can't be loaded */
+	constexpr uint32_t hexGridSaveMagic = 0x47483245; // "E2HG"
+
+	/** Bump when the hex grid save layout changes */
+	constexpr uint32_t hexGridSaveVersion = 1;
+
+	/** Chunks along each side of the fog of war texture, must be power of two */
+	constexpr uint32_t fogOfWarTexelChunks = 32;
+	constexpr uint32_t fogOfWarTexelSize = fogOfWarTexelChunks * hexChunkResolution;
+
+	/** Number of GPU copies that sync from FogOfWarTexels, one per frame in flight */
+	constexpr uint32_t fogOfWarTexelConsumers = 2;
+
+	/**
+	 * CPU side of the fog of war texture, one RGBA8 texel per hex: discovered, visible, wood abundance and deep water.
+	 * Chunks wrap around it, so any fogOfWarTexelChunks squared window of chunks fits without two chunks sharing texels.
+	 * A chunk block is only rewritten when its page revision changes or another chunk takes its place, and each consumer
+	 * gets a dirty rect covering the blocks written since it last synced. Doesn't touch the GPU, so it can be verified on its own
+	 */
+	class FogOfWarTexels
+	{
+	public:
+		FogOfWarTexels();
+
+		/** Makes sure the block for chunkIndex shows page (nullptr if the chunk has no page) */
+		void updateChunk(glm::ivec2 const& chunkIndex, e2::TilePage* page);
+
+		/** Texel coordinates of a hex in offset coords */
+		static glm::uvec2 texelCoords(glm::ivec2 const& hex);
+
+		/** Texel for a hex, as last written by updateChunk. Only meaningful if its chunk was updated since another chunk took its block */
+		uint32_t texel(glm::ivec2 const& hex) const;
+
+		/** Packs the texel for one tile of a page, r is 255 if discovered, g 255 if visible, b wood abundance and a 255 if deep water */
+		static uint32_t packTexel(e2::TilePage* page, uint32_t localIndex);
+
+		/** The rect covering every block written since consumer last called markClean, false if there is none */
+		bool dirtyRect(uint32_t consumer, glm::uvec2& outOffset, glm::uvec2& outSize) const;
+
+		/** Copies a rect of texels tightly packed, row by row, for upload */
+		void copyRect(glm::uvec2 const& offset, glm::uvec2 const& size, std::vector<uint32_t>& outTexels) const;
+
+		void markClean(uint32_t consumer);
+
+		/** Marks everything dirty for every consumer, i.e. when the GPU copies are recreated */
+		void markAllDirty();
+
+		uint64_t numBlockWrites() const
+		{
+			return m_numBlockWrites;
+		}
+
+	protected:
+		struct Block
+		{
+			glm::ivec2 chunkIndex{};
+			uint32_t revision{};
+			bool valid{};
+		};
+
+		static constexpr uint32_t numBlocks = e2::fogOfWarTexelChunks * e2::fogOfWarTexelChunks;
+
+		Block m_blocks[numBlocks];
+		bool m_dirty[e2::fogOfWarTexelConsumers][numBlocks]{};
+		uint32_t m_numDirty[e2::fogOfWarTexelConsumers]{};
+
+		std::vector<uint32_t> m_texels;
+		uint64_t m_numBlockWrites{};
+	};
+
+	/**
+	 * Runs random visibility changes over a few pages and chunks that alias in FogOfWarTexels, checks every texel and isVisible against
+	 * a plain refcount model, and that consumers are given dirty rects covering every change. Logs and returns false on the first mismatch
+	 */
+	bool testFogOfWarTexels(uint32_t numIterations);
+
+	struct TileCacheStats
+	{
+		uint64_t hits{};
+		uint64_t misses{};
+		uint64_t fills{};
+		uint64_t evictions{};
+	};
+
+	/**
+	 * Procedural tile data for recently generated chunks, so pathfinding and other lookups outside of discovered tiles don't recompute noise.
+	 * Direct mapped on chunk index, a chunk evicts whatever chunk shared its slot. Filled and evicted from mainthread only, read lock-free from anywhere
+	 */
+	class ProceduralTileCache
+	{
+	public:
+		/** Tile data for hex if its chunk is cached, returns false on miss. Threadsafe */
+		bool get(glm::ivec2 const& hex, e2::TileData& outTile);
+
+		/** Bulk inserts tile data for a chunk (row-major, hexChunkResolution squared). forestProxy is not kept. Mainthread only */
+		void fill(glm::ivec2 const& chunkIndex, e2::TileData const* tiles);
+
+		/** Drops the given chunk, if it's in there. Mainthread only */
+		void evict(glm::ivec2 const& chunkIndex);
+
+		e2::TileCacheStats stats() const;
+		void resetStats();
+
+	protected:
+		e2::TileCacheSlot m_slots[e2::maxNumCachedChunks];
+		std::atomic<uint64_t> m_hits{};
+		std::atomic<uint64_t> m_misses{};
+		uint64_t m_fills{};
+		uint64_t m_evictions{};
+	};
+
+	/**
+	 * Runs random fills, evictions and lookups over chunks that alias in ProceduralTileCache and checks hits, tiles and stats against a plain model,
+	 * then keeps filling while reader threads look up, and checks no reader ever gets a torn or foreign tile. Logs and returns false on the first mismatch
+	 */
+	bool testProceduralTileCache(uint32_t numIterations);
+
+	/**
+	 * Checks HexGrid::calculateTileDataBatch and calculateChunkTileData against calculateTileData, field by field and bit for bit, for edge hexes
+	 * (origin, chunk borders, far out) and numHexes random ones, in batches of odd sizes and sizes around hexChunkBorderTiles. Logs and returns false on the first mismatch
+	 */
+	bool testTileDataBatch(uint32_t numHexes);
+
 	//struct ForestIndex
 	//{
 	//	glm::ivec2 offsetCoords;
@@ -267,16 +484,27 @@ namespace e2
 	// fog of war 
 	struct FogOfWarConstants
 	{
-		glm::mat4 mvpMatrix;
-		glm::vec4 visibility;
+		glm::mat4 vpMatrix;
+
+		// xy: first hex of the rect drawn, z: its width in hexes, w: 1 to show everything as visible
+		glm::ivec4 region;
 	};
 
 	struct OutlineConstants
 	{
-		glm::mat4 mvpMatrix;
+		glm::mat4 vpMatrix;
 		glm::vec4 color;
+
+		// x: hex scale, y: outline layer
+		glm::vec4 parameters;
 	};
 
+	/** Outline tiles per layer the outline tile texture fits to begin with, it doubles whenever a layer outgrows it */
+	constexpr uint32_t initialNumOutlineTiles = 1024;
+
+	/** Most outline tiles per layer the texture grows to (the smallest max texture width devices have to support), the rest aren't drawn */
+	constexpr uint32_t maxNumOutlineTiles = 4096;
+
 	struct BlurConstants
 	{
 		glm::vec2 direction;
@@ -449,7 +677,9 @@ namespace e2
 		void buildForestMeshes();
 
 		void saveToBuffer(e2::IStream& toBuffer);
-		void loadFromBuffer(e2::IStream& fromBuffer);
+
+		/** False if the save is from another version or truncated, the grid is left partially loaded then */
+		bool loadFromBuffer(e2::IStream& fromBuffer);
 
 		/// Chunks Begin (and World Streaming)
 
@@ -563,19 +793,37 @@ namespace e2
 
 		/// Tiles Begin
 	public:
-		/** Retrieves TileData from the given array index */
-		TileData& getTileFromIndex(size_t index);
+		/** Discovers the given hex, and returns its tile data (WARNING: This doesnt check if it already exists!) */
+		e2::TileData* discover(glm::ivec2 const& hex);
+
+		/** Retrieves tile data for the given hex, discovers it if necessary */
+		e2::TileData* getOrDiscoverTileData(glm::ivec2 const& hex);
 
-		/** Discovers the given hex, and returns its new array index (WARNING: This doesnt check if it already exists!) */
-		size_t discover(glm::ivec2 const& hex);
+		/** Retrieves the tile page for the given chunk, null if nothing in it has been discovered */
+		e2::TilePage* getTilePage(glm::ivec2 const& chunkIndex);
 
-		/** Retrieves array index to the given tile, discovers it if necessary */
-		size_t getTileIndexFromHex(glm::ivec2 const &hex);
+		/** Splits offset coords into a chunk index and a local index into that chunks TilePage */
+		static glm::ivec2 chunkIndexFromOffsetCoords(glm::ivec2 const& hex, uint32_t& outLocalIndex);
 
 		/** Retrieves tile data for the given hex, if it exists. Otherwise returns null */
 		e2::TileData* getExistingTileData(glm::ivec2 const& hex);
-		e2::TileData calculateTileData(glm::ivec2 const& hex);
+		static e2::TileData calculateTileData(glm::ivec2 const& hex);
+
+		/** Same as calculateTileData but for count hexes at once, noise is evaluated in simd batches. Results are bit-identical to calculateTileData (see testTileDataBatch). Threadsafe */
+		static void calculateTileDataBatch(glm::ivec2 const* hexes, e2::TileData* outTiles, uint32_t count);
+
+		/** Calculates tile data for the given chunk including its 1 tile border, row-major starting at local offset (-1, -1), see hexChunkBorderTiles */
+		static void calculateChunkTileData(glm::ivec2 const& chunkIndex, e2::TileData* outTiles);
+
 		e2::TileData getTileData(glm::ivec2 const& hex);
+
+		/** Procedural tile data for the given hex, served from the tile cache if its chunk has been generated, calculated otherwise. Threadsafe */
+		e2::TileData getProceduralTileData(glm::ivec2 const& hex);
+
+		e2::ProceduralTileCache& tileCache()
+		{
+			return m_tileCache;
+		}
 		/// Tiles End
 
 		/// ProcGen Begin
@@ -585,11 +833,11 @@ namespace e2
 
 		/** */
 
-		float calculateBaseHeight(glm::vec2 const& planarCoords);
-		void calculateBiome(glm::vec2 const& planarCoords, e2::TileFlags& outFlags);
-		void calculateFeaturesAndWater(glm::vec2 const& planarCoords, float baseHeight, e2::TileFlags& outFlags);
+		static float calculateBaseHeight(glm::vec2 const& planarCoords);
+		static void calculateBiome(glm::vec2 const& planarCoords, e2::TileFlags& outFlags);
+		static void calculateFeaturesAndWater(glm::vec2 const& planarCoords, float baseHeight, e2::TileFlags& outFlags);
 
-		int32_t getForestIndexForFlags(e2::TileFlags flags);
+		static int32_t getForestIndexForFlags(e2::TileFlags flags);
 		ForestState* getForestState(int32_t index);
 
 		void damageTree(glm::ivec2 const& hex, uint32_t treeIndex, float dmg);
@@ -659,16 +907,35 @@ namespace e2
 		void updateCutMask(glm::vec2 const& newCenter);
 	protected:
 
-		//
-		// list of discovered tiles 
-		std::vector<TileData> m_tiles;
-		std::vector<int32_t> m_tileVisibility;
-		std::unordered_map<glm::ivec2, uint64_t> m_tileIndex;
+		e2::TilePage* getOrCreateTilePage(glm::ivec2 const& chunkIndex);
+
+		// discovered tiles, one dense page per chunk. The list is for iteration, the index for lookups
+		std::vector<e2::TilePage*> m_tilePages;
+		std::unordered_map<glm::ivec2, e2::TilePage*> m_tilePageIndex;
+
+		// last page looked up, visibility and tile lookups tend to come in runs within the same chunk
+		e2::TilePage* m_lastTilePage{};
+
+		e2::ProceduralTileCache m_tileCache;
 
 		void updateUnpackedForests();
 
+		/** Adds or removes the instances of unpacked trees, as their chunk comes in and out of view or they're turned into lumber */
+		void showTree(e2::UnpackedTreeState& tree);
+		void hideTree(e2::UnpackedTreeState& tree);
+		void showUnpackedTrees(glm::ivec2 const& chunkIndex, bool show);
+
+		/** Hands changed tree instances to their proxies */
+		void syncTreeInstances();
+
+		/** Clock the vertex stage animates trees by */
+		float vegetationTime();
+
 		std::unordered_map<glm::ivec2, e2::UnpackedForestState> m_unpackedForests;
 
+		e2::VegetationInstances m_treeInstances;
+		e2::MeshProxy* m_treeInstanceProxies[e2::maxNumVegetationMeshes]{};
+
 		e2::MeshPtr m_resourceMeshStone;
 
 		e2::ForestState m_forestStates[3];
@@ -720,6 +987,10 @@ namespace e2
 
 		std::vector<glm::ivec2> m_outlineTiles[size_t(e2::OutlineLayer::Count)];
 
+		e2::FogOfWarTexels m_fogOfWarTexels;
+		std::vector<uint32_t> m_fogOfWarUploadScratch;
+		std::vector<glm::vec2> m_outlineUploadScratch;
+
 
 		struct FrameData
 		{
@@ -731,6 +1002,13 @@ namespace e2
 			e2::IRenderTarget* outlineTarget{  };
 			e2::ITexture* outlineTexture{  };
 
+			// fogOfWarTexels synced to the gpu, and outline tile coords (a row per layer)
+			e2::ITexture* visibilityTexture{};
+			e2::ITexture* outlineTilesTexture{};
+			uint32_t outlineTilesCapacity{};
+			bool outlineTilesDirty{ true };
+			e2::IDescriptorSet* fogOfWarSet{};
+
 			e2::IRenderTarget* minimapTarget{};
 			e2::ITexture* minimapTexture{};
 			e2::IDescriptorSet* minimapSet{};
@@ -755,6 +1033,8 @@ namespace e2
 
 
 		glm::uvec2 m_fogOfWarMaskSize{};
+		e2::IDescriptorSetLayout* m_fogOfWarSetLayout{};
+		e2::IDescriptorPool* m_fogOfWarPool{};
 		e2::IShader* m_fogOfWarVertexShader{};
 		e2::IShader* m_fogOfWarFragmentShader{};
 		e2::IPipelineLayout* m_fogOfWarPipelineLayout{};
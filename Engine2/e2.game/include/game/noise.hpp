@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#if defined(__AVX2__)
+#define E2_SIMPLEX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define E2_SIMPLEX_SSE2
+#endif
+
+namespace e2
+{
+	/** number of points the noise kernel evaluates per invocation, depends on what instruction set we were built for */
+#if defined(E2_SIMPLEX_AVX2)
+	constexpr uint32_t simplexLaneWidth = 8;
+#elif defined(E2_SIMPLEX_SSE2)
+	constexpr uint32_t simplexLaneWidth = 4;
+#else
+	constexpr uint32_t simplexLaneWidth = 1;
+#endif
+
+	/**
+	 * 2D simplex noise in range [-1, 1].
+	 * Runs the same kernel as simplexBatch, so both give bit-identical results for the same input.
+	 * Worldgen relies on this to be deterministic, so dont touch the operation order in noise.cpp unless you want to break every save ever
+	 */
+	float simplex(glm::vec2 const& v);
+
+	/**
+	 * Evaluates 2D simplex noise for count points given as separate x and y arrays, and writes the results to outValues.
+	 * Uses AVX2 or SSE2 when available, and scalar for the tail. count doesn't need to be a multiple of simplexLaneWidth.
+	 */
+	void simplexBatch(float const* xs, float const* ys, float* outValues, uint32_t count);
+
+	/** Name of the instruction set simplexBatch was built for, for debug ui */
+	char const* simplexPath();
+
+	/**
+	 * Checks simplexBatch against simplex bit for bit, over edge inputs (zeros, lattice points, floor limits, huge and non-finite values) and
+	 * numPoints random ones, in batches of every count up to a few past simplexLaneWidth. Logs and returns false on the first mismatch
+	 */
+	bool testSimplexBatch(uint32_t numPoints);
+}
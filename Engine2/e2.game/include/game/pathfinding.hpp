@@ -0,0 +1,85 @@
+#pragma once
+
+#include <e2/utils.hpp>
+
+#include "game/shared.hpp"
+
+#include <vector>
+
+namespace e2
+{
+	class HexGrid;
+
+	/**
+	 * Reusable pathfinding state for the hex grid.
+	 * Everything lives in flat arrays covering a square window of offset coords around the search origin, so a search does no allocations once warm.
+	 * Arrays are never cleared, every search bumps a generation counter and entries from older generations count as unvisited.
+	 * Not threadsafe, give every thread its own.
+	 */
+	class PathFindingContext
+	{
+	public:
+		/** maxRange is the largest range (in hex steps) this context can search */
+		PathFindingContext(uint32_t maxRange);
+
+		/**
+		 * Breadth first flood fill from origin, visits every hex reachable within range.
+		 * If ignoreVisibility is false, only visible hexes are considered (mainthread only!)
+		 * Returns number of reached hexes, including origin. Query with reached(), stepsTo(), pathTo() and visited()
+		 */
+		uint32_t floodFill(e2::HexGrid* grid, glm::ivec2 const& origin, uint32_t range, e2::PassableFlags passable, bool ignoreVisibility = true);
+
+		/**
+		 * A* from start to goal, with hex distance as heuristic. Never leaves the window of range around start.
+		 * Writes the path (start and goal included) to outPath and returns true if goal is reachable
+		 */
+		bool findPath(e2::HexGrid* grid, glm::ivec2 const& start, glm::ivec2 const& goal, uint32_t range, e2::PassableFlags passable, std::vector<glm::ivec2>& outPath, bool ignoreVisibility = true);
+
+		/** True if hex was reached by the last search */
+		bool reached(glm::ivec2 const& hex) const;
+
+		/** Number of steps from origin to hex in the last search, UINT32_MAX if not reached */
+		uint32_t stepsTo(glm::ivec2 const& hex) const;
+
+		/** Walks parents from hex back to origin of last search, writes origin-first path to outPath. Returns false if hex was not reached */
+		bool pathTo(glm::ivec2 const& hex, std::vector<glm::ivec2>& outPath) const;
+
+		/** Every hex reached by the last search, in the order they were reached */
+		std::vector<glm::ivec2> const& visited() const
+		{
+			return m_visited;
+		}
+
+		uint32_t maxRange() const
+		{
+			return m_maxRange;
+		}
+
+		struct HeapNode
+		{
+			uint32_t estimate;
+			uint32_t cost;
+			int32_t index;
+		};
+
+	protected:
+		void beginSearch(glm::ivec2 const& origin, uint32_t range);
+		int32_t localIndex(glm::ivec2 const& hex) const;
+		bool isPassable(e2::HexGrid* grid, glm::ivec2 const& hex, e2::PassableFlags passable, bool ignoreVisibility);
+
+		uint32_t m_maxRange{};
+		int32_t m_side{};
+
+		glm::ivec2 m_origin{};
+		uint32_t m_generation{};
+
+		std::vector<uint32_t> m_openGeneration;
+		std::vector<uint32_t> m_closedGeneration;
+		std::vector<uint32_t> m_cost;
+		std::vector<int32_t> m_parent;
+
+		std::vector<int32_t> m_queue;
+		std::vector<HeapNode> m_heap;
+		std::vector<glm::ivec2> m_visited;
+	};
+}
@@ -32,7 +32,8 @@ namespace e2
 		void populate(e2::ALJDescription &alj);
 		void finalize();
 
-		void update(double seconds);
+		/** Ticks every radion entity once, called every radionTickInterval simulation steps */
+		void tick();
 		virtual e2::Game* game() override;
 
 		void registerEntity(e2::RadionEntity* ent);
@@ -68,8 +69,6 @@ namespace e2
 		std::unordered_set<e2::RadionEntity*> m_tickedNodes;
 		std::unordered_set<e2::RadionEntity*> m_untickedNodes;
 
-		double m_timeAccumulator{};
-
 		std::unordered_set<e2::RadionEntity*> m_entities;
 		std::vector<e2::Name> m_discoveredEntities;
 
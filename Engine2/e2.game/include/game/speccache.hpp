@@ -0,0 +1,78 @@
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace e2
+{
+	/** Where the game keeps parsed specification files between boots */
+	constexpr char const* specCachePath = "./cache/specifications.e2c";
+
+	/** Bump when the cache layout changes, caches of other versions are rebuilt */
+	constexpr uint32_t specCacheVersion = 3;
+
+	/** A parsed specification file */
+	struct SpecDocument
+	{
+		std::string path;
+
+		/** Index into the directories it was loaded from */
+		uint32_t directory{};
+
+		nlohmann::json json;
+	};
+
+	/**
+	 * Parsed specification files, stored as MessagePack along with a hash of their source so unchanged files never have their JSON parsed again.
+	 * Every file is read and hashed on worker threads, unchanged ones have their cached json decoded and changed (or new) ones are parsed.
+	 * The cache is rewritten whenever anything changed
+	 */
+	class SpecCache
+	{
+	public:
+		SpecCache(std::string const& cachePath);
+
+		/** Every .json file under the given directories, ordered by directory then path. Files that fail to parse are logged and left out */
+		std::vector<e2::SpecDocument> load(std::vector<std::string> const& directories);
+
+		/** Files the last load took from the cache, and files it had to parse */
+		inline uint32_t numCached() const
+		{
+			return m_numCached;
+		}
+
+		inline uint32_t numParsed() const
+		{
+			return m_numParsed;
+		}
+
+		/** Source hash and MessagePack of a file as of the last load, 0 and null if it wasn't loaded */
+		uint64_t sourceHash(std::string const& path) const;
+		std::vector<uint8_t> const* encoded(std::string const& path) const;
+
+	protected:
+		struct Entry
+		{
+			std::string path;
+			uint64_t sourceHash{};
+			std::vector<uint8_t> encoded;
+		};
+
+		Entry const* find(std::string const& path) const;
+
+		bool read(std::vector<Entry>& outEntries);
+		bool write(std::vector<Entry> const& entries);
+
+		std::string m_cachePath;
+		std::vector<Entry> m_entries;
+		uint32_t m_numCached{};
+		uint32_t m_numParsed{};
+	};
+
+	/** Loads a set of files through a cache and parses them directly, and checks they match. Then changes, touches, breaks and removes files and checks only changed entries are rebuilt */
+	bool testSpecCache();
+}
@@ -0,0 +1,74 @@
+
+#pragma once
+
+#include <e2/utils.hpp>
+#include <e2/renderer/meshproxy.hpp>
+
+#include <vector>
+
+namespace e2
+{
+	/** Meshes vegetation instances can be of, one instanced draw each */
+	constexpr uint32_t maxNumVegetationMeshes = 4;
+
+	/** Instances per mesh, beyond this add() fails */
+	constexpr uint32_t maxNumVegetationInstances = 4096;
+
+	/** Shake and fall start times of instances that aren't shaking or falling */
+	constexpr float vegetationNotStarted = -1.0f;
+
+	/**
+	 * Trees as compact instance records, packed per mesh so each mesh is one instanced draw.
+	 * Records are e2::InstanceData as the forest vertex stage reads them: position and rotation in transform,
+	 * and scale, fall direction (as an angle), shake start and fall start in parameters. The shake and fall animations
+	 * are evaluated in the vertex stage from the start times, so a record only changes when a tree is hit or cut.
+	 * Removing a record moves the last one of its mesh into its place, so instances are referred to by handles that stay valid until removed
+	 */
+	class VegetationInstances
+	{
+	public:
+		/** Returns a handle to the new instance, or UINT32_MAX if its mesh is full */
+		uint32_t add(uint8_t meshIndex, glm::vec2 const& position, float rotation, float scale, float fallAngle);
+		void remove(uint32_t handle);
+
+		/** Starts the shake and fall animations at the given renderer time */
+		void shake(uint32_t handle, float time);
+		void fall(uint32_t handle, float time);
+
+		void clear();
+
+		bool valid(uint32_t handle) const;
+		e2::InstanceData const& instance(uint32_t handle) const;
+
+		uint32_t numInstances() const;
+		uint32_t numInstances(uint8_t meshIndex) const;
+		e2::InstanceData const* instances(uint8_t meshIndex) const;
+
+		/** Whether the records of meshIndex changed since the last markClean */
+		bool dirty(uint8_t meshIndex) const;
+		void markClean(uint8_t meshIndex);
+
+	protected:
+		struct Slot
+		{
+			uint8_t meshIndex{};
+			uint32_t recordIndex{ UINT32_MAX };
+		};
+
+		std::vector<e2::InstanceData> m_records[e2::maxNumVegetationMeshes];
+
+		/** Handle of each record, to fix up slots when records move */
+		std::vector<uint32_t> m_recordHandles[e2::maxNumVegetationMeshes];
+
+		bool m_dirty[e2::maxNumVegetationMeshes]{};
+
+		std::vector<Slot> m_slots;
+		std::vector<uint32_t> m_freeSlots;
+	};
+
+	/**
+	 * Adds, hits, cuts and removes random trees, and now and then unloads a chunk worth of them, checking every record and
+	 * count against a plain list of what should be there, and that only meshes that changed are flagged dirty. Logs and returns false on the first mismatch
+	 */
+	bool testVegetationInstances(uint32_t numIterations);
+}
@@ -0,0 +1,253 @@
+
+#include "game/collision.hpp"
+#include "game/components/physicscomponent.hpp"
+#include "game/entity.hpp"
+#include "game/game.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr int32_t chunkRes = int32_t(e2::hexChunkResolution);
+	constexpr uint32_t chunkTiles = e2::hexChunkResolution * e2::hexChunkResolution;
+}
+
+e2::CollisionWorld::CollisionWorld(e2::Game* g)
+	: m_game(g)
+{
+	m_scratch.reserve(256);
+}
+
+e2::CollisionWorld::~CollisionWorld()
+{
+	clearStatic();
+}
+
+e2::Game* e2::CollisionWorld::game()
+{
+	return m_game;
+}
+
+void e2::CollisionWorld::registerComponent(e2::CollisionComponent* component, glm::ivec2 const& hex)
+{
+	m_components[hex].push_back(component);
+}
+
+void e2::CollisionWorld::unregisterComponent(e2::CollisionComponent* component, glm::ivec2 const& hex)
+{
+	auto finder = m_components.find(hex);
+	if (finder == m_components.end())
+		return;
+
+	std::vector<e2::CollisionComponent*>& bucket = finder->second;
+	auto it = std::find(bucket.begin(), bucket.end(), component);
+	if (it == bucket.end())
+		return;
+
+	// order doesn't matter, swap and pop
+	*it = bucket.back();
+	bucket.pop_back();
+
+	if (bucket.empty())
+		m_components.erase(finder);
+}
+
+void e2::CollisionWorld::invalidateStatic(glm::ivec2 const& hex)
+{
+	uint32_t localIndex{};
+	evictStatic(e2::HexGrid::chunkIndexFromOffsetCoords(hex, localIndex));
+}
+
+void e2::CollisionWorld::evictStatic(glm::ivec2 const& chunkIndex)
+{
+	auto finder = m_staticChunks.find(chunkIndex);
+	if (finder == m_staticChunks.end())
+		return;
+
+	e2::destroy(finder->second);
+	m_staticChunks.erase(finder);
+}
+
+void e2::CollisionWorld::clearStatic()
+{
+	for (auto [chunkIndex, chunk] : m_staticChunks)
+		e2::destroy(chunk);
+	m_staticChunks.clear();
+}
+
+e2::StaticCollisionChunk* e2::CollisionWorld::getStaticChunk(glm::ivec2 const& chunkIndex)
+{
+	auto finder = m_staticChunks.find(chunkIndex);
+	if (finder != m_staticChunks.end())
+		return finder->second;
+
+	e2::StaticCollisionChunk* newChunk = e2::create<e2::StaticCollisionChunk>();
+	buildStaticChunk(chunkIndex, newChunk);
+	m_staticChunks[chunkIndex] = newChunk;
+	return newChunk;
+}
+
+void e2::CollisionWorld::buildStaticChunk(glm::ivec2 const& chunkIndex, e2::StaticCollisionChunk* chunk)
+{
+	e2::HexGrid* grid = hexGrid();
+	chunk->circles.clear();
+
+	glm::ivec2 chunkOffset = chunkIndex * ::chunkRes;
+	for (uint32_t i = 0; i < ::chunkTiles; i++)
+	{
+		chunk->hexStart[i] = chunk->circles.size();
+
+		glm::ivec2 coords = chunkOffset + glm::ivec2(int32_t(i) % ::chunkRes, int32_t(i) / ::chunkRes);
+		e2::Hex hex(coords);
+		e2::TileData tileData = grid->getTileData(coords);
+
+		if (tileData.isForested() && tileData.forestIndex >= 0)
+		{
+			e2::ForestState* forestState = grid->getForestState(tileData.forestIndex);
+
+			int32_t treeIndex = 0;
+			for (e2::TreeState& treeState : forestState->trees)
+			{
+				e2::Collision newCollision;
+				newCollision.type = e2::CollisionType::Tree;
+				newCollision.position = hex.planarCoords() + treeState.localOffset(&tileData, forestState);
+				newCollision.radius = 0.25f * treeState.scale;
+				newCollision.hex = coords;
+				newCollision.treeIndex = treeIndex++;
+				chunk->circles.push(newCollision);
+			}
+		}
+		else if (e2::UnpackedForestState* forestState = grid->getUnpackedForestState(coords))
+		{
+			int32_t treeIndex = 0;
+			for (e2::UnpackedTreeState& treeState : forestState->trees)
+			{
+				// harvested trees don't collide, damageTree invalidates us when one goes down
+				if (treeState.health <= 0.0f)
+				{
+					treeIndex++;
+					continue;
+				}
+
+				e2::Collision newCollision;
+				newCollision.type = e2::CollisionType::Tree;
+				newCollision.position = treeState.worldOffset;
+				newCollision.radius = 0.25f * treeState.scale;
+				newCollision.hex = coords;
+				newCollision.treeIndex = treeIndex++;
+				chunk->circles.push(newCollision);
+			}
+		}
+
+		e2::Collision terrainCollision;
+		terrainCollision.hex = coords;
+		terrainCollision.position = hex.planarCoords();
+		terrainCollision.radius = 1.0f;
+
+		if (tileData.isMountain())
+			terrainCollision.type = e2::CollisionType::Mountain;
+		else if (tileData.isShallowWater() || tileData.isDeepWater())
+			terrainCollision.type = e2::CollisionType::Water;
+		else
+			terrainCollision.type = e2::CollisionType::Land;
+
+		chunk->circles.push(terrainCollision);
+	}
+
+	chunk->hexStart[::chunkTiles] = chunk->circles.size();
+}
+
+void e2::CollisionWorld::queryHex(glm::ivec2 const& hex, e2::CollisionType mask, e2::CollisionSet& outCollisions)
+{
+	uint32_t localIndex{};
+	e2::StaticCollisionChunk* chunk = getStaticChunk(e2::HexGrid::chunkIndexFromOffsetCoords(hex, localIndex));
+	outCollisions.append(chunk->circles, chunk->hexStart[localIndex], chunk->hexStart[localIndex + 1], mask);
+
+	if ((mask & e2::CollisionType::Component) != e2::CollisionType::Component)
+		return;
+
+	auto finder = m_components.find(hex);
+	if (finder == m_components.end())
+		return;
+
+	for (e2::CollisionComponent* component : finder->second)
+	{
+		e2::Collision newCollision;
+		newCollision.type = e2::CollisionType::Component;
+		newCollision.component = component;
+		newCollision.radius = component->radius();
+		newCollision.hex = hex;
+		newCollision.position = component->entity()->planarCoords();
+		outCollisions.push(newCollision);
+	}
+}
+
+void e2::CollisionWorld::query(glm::ivec2 const& hex, e2::CollisionType mask, bool includeNeighbours, e2::CollisionSet& outCollisions)
+{
+	queryHex(hex, mask, outCollisions);
+
+	if (!includeNeighbours)
+		return;
+
+	e2::StackVector<e2::Hex, 6> neighbours = e2::Hex(hex).neighbours();
+	for (e2::Hex& n : neighbours)
+		queryHex(n.offsetCoords(), mask, outCollisions);
+}
+
+void e2::CollisionWorld::query(glm::ivec2 const& hex, e2::CollisionType mask, bool includeNeighbours, std::vector<e2::Collision>& outCollisions)
+{
+	m_scratch.clear();
+	query(hex, mask, includeNeighbours, m_scratch);
+
+	uint32_t numCollisions = m_scratch.size();
+	outCollisions.reserve(outCollisions.size() + numCollisions);
+	for (uint32_t i = 0; i < numCollisions; i++)
+		outCollisions.push_back(m_scratch.get(i));
+}
+
+void e2::CollisionWorld::solveMoves(std::vector<e2::MoveRequest>& requests)
+{
+	m_moveHexes.resize(requests.size());
+	m_moveOrder.resize(requests.size());
+	for (uint32_t i = 0; i < requests.size(); i++)
+	{
+		m_moveHexes[i] = requests[i].movement->entity()->hex().offsetCoords();
+		m_moveOrder[i] = i;
+	}
+
+	// group by hex and mask so every group shares a query, stable so requests within a group keep their order
+	auto sameGroup = [this, &requests](uint32_t lhs, uint32_t rhs) {
+		return m_moveHexes[lhs] == m_moveHexes[rhs] && requests[lhs].mask == requests[rhs].mask;
+	};
+
+	std::stable_sort(m_moveOrder.begin(), m_moveOrder.end(), [this, &requests](uint32_t lhs, uint32_t rhs) {
+		glm::ivec2 const& a = m_moveHexes[lhs];
+		glm::ivec2 const& b = m_moveHexes[rhs];
+		if (a.y != b.y)
+			return a.y < b.y;
+		if (a.x != b.x)
+			return a.x < b.x;
+		return uint8_t(requests[lhs].mask) < uint8_t(requests[rhs].mask);
+	});
+
+	uint32_t groupBegin = 0;
+	while (groupBegin < m_moveOrder.size())
+	{
+		uint32_t first = m_moveOrder[groupBegin];
+
+		m_scratch.clear();
+		query(m_moveHexes[first], requests[first].mask, true, m_scratch);
+
+		uint32_t groupEnd = groupBegin;
+		while (groupEnd < m_moveOrder.size() && sameGroup(first, m_moveOrder[groupEnd]))
+		{
+			e2::MoveRequest& request = requests[m_moveOrder[groupEnd]];
+			request.energyLeft = request.movement->move(request.radius, request.direction, request.energy, request.mask, m_scratch);
+			if (request.collision)
+				request.collision->invalidate();
+			groupEnd++;
+		}
+
+		groupBegin = groupEnd;
+	}
+}
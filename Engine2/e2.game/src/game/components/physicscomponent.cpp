@@ -83,7 +83,7 @@ e2::MovementComponent::~MovementComponent()
 {
 }
 
-float e2::MovementComponent::move(float radius, glm::vec2 const& dir, float energy, e2::CollisionType mask, std::vector<e2::Collision> const& collisions)
+float e2::MovementComponent::move(float radius, glm::vec2 const& dir, float energy, e2::CollisionType mask, e2::CollisionSet const& collisions)
 {
 	glm::vec3 worldPosition = m_entity->getTransform()->getTranslation(e2::TransformSpace::World);
 	glm::vec2 planarPosition = glm::vec2(worldPosition.x, worldPosition.z);
@@ -101,31 +101,41 @@ float e2::MovementComponent::move(float radius, glm::vec2 const& dir, float ener
 	glm::vec2 startPosition = planarPosition;
 	glm::vec2 targetPosition = planarPosition + (moveDirection * energyLeft);
 
+	// borrow our scratch for the duration, onHitEntity may end up moving us again and that call gets its own
+	std::vector<uint32_t> candidates;
+	candidates.swap(m_sweepCandidates);
+
 	constexpr uint32_t maxSolverSteps = 2;
 	for (uint32_t i = 0; i < maxSolverSteps; i++)
 	{
 
 		e2::SweepResult closestResult;
 		closestResult.moveDistance = std::numeric_limits<float>::max();
-		for (e2::Collision const& c : collisions)
+
+		// only run the full sweep test on circles close enough to the swept segment
+		e2::sweepCandidates(collisions, startPosition, targetPosition, radius, candidates);
+		for (uint32_t c : candidates)
 		{
-			if ((c.type & mask) != c.type && c.type != e2::CollisionType::Component)
+			e2::CollisionType type = collisions.types[c];
+			e2::CollisionComponent* component = collisions.components[c];
+
+			if ((type & mask) != type && type != e2::CollisionType::Component)
 				continue;
 
-			if (c.type == e2::CollisionType::Component && c.component && ( !c.component->block ||  shouldIgnore(c.component->entity()) ))
+			if (type == e2::CollisionType::Component && component && ( !component->block ||  shouldIgnore(component->entity()) ))
 				continue;
 
-			e2::SweepResult result = e2::circleSweepTest(startPosition, targetPosition, radius, c.position, c.radius);
+			e2::SweepResult result = e2::circleSweepTest(startPosition, targetPosition, radius, { collisions.x[c], collisions.y[c] }, collisions.radius[c]);
 			if (result.hit)
 			{
-				if (result.moveDistance < closestResult.moveDistance && (c.type & mask) == c.type)
+				if (result.moveDistance < closestResult.moveDistance && (type & mask) == type)
 				{
 					closestResult = result;
 				}
 
-				if (c.type == e2::CollisionType::Component)
+				if (type == e2::CollisionType::Component)
 				{
-					m_entity->onHitEntity(c.component->entity());
+					m_entity->onHitEntity(component->entity());
 				}
 			}
 		}
@@ -158,21 +168,26 @@ float e2::MovementComponent::move(float radius, glm::vec2 const& dir, float ener
 		targetPosition = startPosition + moveDirection * energyLeft;
 	}
 
-	for (e2::Collision const& c : collisions)
+	m_sweepCandidates.swap(candidates);
+
+	for (uint32_t c = 0; c < collisions.size(); c++)
 	{
-		if ((c.type & mask) != c.type)
+		e2::CollisionType type = collisions.types[c];
+		if ((type & mask) != type)
 			continue;
 
-		if (c.type == e2::CollisionType::Component && c.component && (!c.component->block || shouldIgnore(c.component->entity())))
+		e2::CollisionComponent* component = collisions.components[c];
+		if (type == e2::CollisionType::Component && component && (!component->block || shouldIgnore(component->entity())))
 			continue;
 
-		glm::vec2 cToThis = planarPosition - c.position;
+		glm::vec2 position{ collisions.x[c], collisions.y[c] };
+		glm::vec2 cToThis = planarPosition - position;
 		float distance = glm::length(cToThis);
 		cToThis = glm::normalize(cToThis);
-		bool intersect = distance < c.radius + radius;
+		bool intersect = distance < collisions.radius[c] + radius;
 		if (intersect)
 		{
-			planarPosition = c.position + cToThis * (c.radius + radius + 0.001f);
+			planarPosition = position + cToThis * (collisions.radius[c] + radius + 0.001f);
 		}
 	}
 
@@ -184,31 +199,34 @@ float e2::MovementComponent::move(float radius, glm::vec2 const& dir, float ener
 	return energyLeft;
 }
 
-void e2::MovementComponent::resolve(float radius, e2::CollisionType mask, std::vector<e2::Collision> const& collisions)
+void e2::MovementComponent::resolve(float radius, e2::CollisionType mask, e2::CollisionSet const& collisions)
 {
 	glm::vec3 worldPosition = m_entity->getTransform()->getTranslation(e2::TransformSpace::World);
 	glm::vec2 planarPosition = glm::vec2(worldPosition.x, worldPosition.z);
 
-	for (e2::Collision const& c : collisions)
+	for (uint32_t c = 0; c < collisions.size(); c++)
 	{
-		if ((c.type & mask) != c.type)
+		e2::CollisionType type = collisions.types[c];
+		if ((type & mask) != type)
 			continue;
 
-		if (c.type == e2::CollisionType::Component && c.component && (!c.component->block || shouldIgnore(c.component->entity())))
+		e2::CollisionComponent* component = collisions.components[c];
+		if (type == e2::CollisionType::Component && component && (!component->block || shouldIgnore(component->entity())))
 			continue;
 
-		if (planarPosition == c.position)
+		glm::vec2 position{ collisions.x[c], collisions.y[c] };
+		if (planarPosition == position)
 		{
 			planarPosition.y += 0.001f;
 		}
 
-		glm::vec2 cToThis = planarPosition - c.position;
+		glm::vec2 cToThis = planarPosition - position;
 		float distance = glm::length(cToThis);
 		cToThis = glm::normalize(cToThis);
-		bool intersect = distance < c.radius + radius;
+		bool intersect = distance < collisions.radius[c] + radius;
 		if (intersect)
 		{
-			planarPosition = c.position + cToThis * (c.radius + radius + 0.001f);
+			planarPosition = position + cToThis * (collisions.radius[c] + radius + 0.001f);
 		}
 	}
 
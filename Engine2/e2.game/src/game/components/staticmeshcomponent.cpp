@@ -59,7 +59,7 @@ void e2::StaticMeshComponent::applyTransform()
 	if (m_meshProxy)
 	{
 		glm::mat4 heightOffset = glm::translate(glm::identity<glm::mat4>(), { 0.0f, m_heightOffset, 0.0f });
-		m_meshProxy->modelMatrix = heightOffset * m_entity->getTransform()->getTransformMatrix(e2::TransformSpace::World) * getScaleTransform();
+		m_meshProxy->modelMatrix = heightOffset * m_entity->renderMatrix() * getScaleTransform();
 		m_meshProxy->modelMatrixDirty = true;
 	}
 }
@@ -115,12 +115,11 @@ void e2::AmberlingEntity::update(double seconds)
 		return;
 	}
 
-	m_collisionCache.clear();
-	game()->populateCollisions(hex().offsetCoords(), e2::CollisionType::All, m_collisionCache);
-
-	
 	glm::vec2 thisCoords = planarCoords();
 
+	// moves are queued and solved with every other mover after this step, resolving still queries here
+	bool queuedMove = false;
+
 	constexpr float jumpInterval = 2.0f;
 	constexpr float jumpTime = 0.9f;
 	constexpr float rotateTime = 1.3f;
@@ -141,7 +140,8 @@ void e2::AmberlingEntity::update(double seconds)
 	}
 	else if (m_mesh->isActionPlaying("hit"))
 	{
-		m_movement->move(m_collision->radius(), m_hitDirection, float(seconds) * 1.0f, e2::CollisionType::All, m_collisionCache);
+		game()->queueMove({ m_movement, m_collision, m_collision->radius(), m_hitDirection, float(seconds) * 1.0f, e2::CollisionType::All });
+		queuedMove = true;
 		float angle = e2::radiansBetween(glm::vec3(thisCoords.x, 0.0f, thisCoords.y) - glm::vec3(m_hitDirection.x, 0.0f, m_hitDirection.y), glm::vec3(thisCoords.x, 0.0f, thisCoords.y));
 		m_targetRotation = glm::angleAxis(angle, glm::vec3(e2::worldUp()));
 		m_jumping = false;
@@ -161,7 +161,8 @@ void e2::AmberlingEntity::update(double seconds)
 
 		glm::vec3 fwd = m_targetRotation * e2::worldForwardf();
 
-		m_movement->move(m_collision->radius(), glm::normalize(glm::vec2{ fwd.x, fwd.z }), float(seconds) * 1.0f, e2::CollisionType::All, m_collisionCache);
+		game()->queueMove({ m_movement, m_collision, m_collision->radius(), glm::normalize(glm::vec2{ fwd.x, fwd.z }), float(seconds) * 1.0f, e2::CollisionType::All });
+		queuedMove = true;
 
 		if (m_jumpFactor >= jumpTime)
 		{
@@ -176,6 +177,8 @@ void e2::AmberlingEntity::update(double seconds)
 	}
 	else
 	{
+		m_collisionCache.clear();
+		game()->populateCollisions(hex().offsetCoords(), e2::CollisionType::All, m_collisionCache);
 		m_movement->resolve(m_collision->radius(), e2::CollisionType::All, m_collisionCache);
 
 		m_mesh->setHeightOffset(0.0f);
@@ -198,8 +201,9 @@ void e2::AmberlingEntity::update(double seconds)
 	}
 
 
-	m_collision->invalidate();
-	m_mesh->applyTransform();
+	// solveMoves invalidates queued movers once they've moved
+	if (!queuedMove)
+		m_collision->invalidate();
 
 
 
@@ -221,6 +225,11 @@ void e2::AmberlingEntity::onTrigger(e2::Name action, e2::Name trigger)
 	}
 }
 
+void e2::AmberlingEntity::applyRenderTransform()
+{
+	m_mesh->applyTransform();
+}
+
 void e2::AmberlingEntity::updateVisibility()
 {
 	m_mesh->updateVisibility();
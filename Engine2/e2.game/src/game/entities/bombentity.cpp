@@ -150,7 +150,6 @@ void e2::BombEntity::update(double seconds)
 
 
 	m_collision->invalidate();
-	m_mesh->applyTransform();
 
 	if (!m_bombSpecification->isRedBomb)
 		m_life -= seconds;
@@ -205,6 +204,11 @@ void e2::BombEntity::update(double seconds)
 }
 
 
+void e2::BombEntity::applyRenderTransform()
+{
+	m_mesh->applyTransform();
+}
+
 void e2::BombEntity::updateVisibility()
 {
 	m_mesh->updateVisibility();
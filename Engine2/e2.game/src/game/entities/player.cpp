@@ -298,10 +298,17 @@ void e2::PlayerEntity::update(double seconds)
 	}
 
 	m_collision->invalidate();
+}
 
+void e2::PlayerEntity::applyRenderTransform()
+{
 	m_mesh->applyTransform();
 	m_boatMesh->applyTransform();
+}
 
+void e2::PlayerEntity::updateInteraction()
+{
+	e2::UIContext* ui = gameSession()->uiContext();
 
 	std::set<e2::Entity*, e2::RadialCompare> interactables; // @todo fix alloc
 
@@ -317,8 +324,9 @@ void e2::PlayerEntity::update(double seconds)
 	bool blocksLand = false;
 	bool foundLand = false;
 	glm::vec2 landPlanar = playerCoords + playerFwdPlanar * 0.5f;
-	for (e2::Collision& collision : m_collisionCache)
+	for (uint32_t i = 0; i < m_collisionCache.size(); i++)
 	{
+		e2::Collision collision = m_collisionCache.get(i);
 		if (collision.type == e2::CollisionType::Component && collision.component)
 		{
 			e2::Entity* otherEntity = collision.component->entity();
@@ -397,6 +405,9 @@ void e2::PlayerEntity::update(double seconds)
 			beCaptain();
 
 			getTransform()->setTranslation({ waterPlanar.x, translation.y, waterPlanar.y }, e2::TransformSpace::World);
+
+			// don't interpolate the jump
+			beginSimulationStep();
 		}
 	}
 	else if (!m_interactable && m_captain && !blocksLand && foundLand)
@@ -409,6 +420,9 @@ void e2::PlayerEntity::update(double seconds)
 			beLandcrab();
 
 			getTransform()->setTranslation({ landPlanar.x, translation.y, landPlanar.y }, e2::TransformSpace::World);
+
+			// don't interpolate the jump
+			beginSimulationStep();
 		}
 	}
 	else
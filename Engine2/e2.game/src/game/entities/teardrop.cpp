@@ -114,12 +114,11 @@ void e2::TeardropEntity::update(double seconds)
 		return;
 	}
 
-	m_collisionCache.clear();
-	game()->populateCollisions(hex().offsetCoords(), e2::CollisionType::All, m_collisionCache);
-
-	
 	glm::vec2 thisCoords = planarCoords();
 
+	// moves are queued and solved with every other mover after this step, resolving still queries here
+	bool queuedMove = false;
+
 	constexpr float jumpInterval = 3.0f;
 	constexpr float jumpTime = 0.5f;
 	constexpr float rotateTime = 2.3f;
@@ -140,7 +139,8 @@ void e2::TeardropEntity::update(double seconds)
 	}
 	else if (m_mesh->isActionPlaying("hit"))
 	{
-		m_movement->move(m_collision->radius(), m_hitDirection, float(seconds) * 1.0f, e2::CollisionType::All, m_collisionCache);
+		game()->queueMove({ m_movement, m_collision, m_collision->radius(), m_hitDirection, float(seconds) * 1.0f, e2::CollisionType::All });
+		queuedMove = true;
 		float angle = e2::radiansBetween(glm::vec3(thisCoords.x, 0.0f, thisCoords.y) - glm::vec3(m_hitDirection.x, 0.0f, m_hitDirection.y), glm::vec3(thisCoords.x, 0.0f, thisCoords.y));
 		m_targetRotation = glm::angleAxis(angle, glm::vec3(e2::worldUp()));
 		m_jumping = false;
@@ -160,7 +160,8 @@ void e2::TeardropEntity::update(double seconds)
 
 		glm::vec3 fwd = m_targetRotation * e2::worldForwardf();
 
-		m_movement->move(m_collision->radius(), glm::normalize(glm::vec2{ fwd.x, fwd.z }), float(seconds) * 1.0f, e2::CollisionType::All, m_collisionCache);
+		game()->queueMove({ m_movement, m_collision, m_collision->radius(), glm::normalize(glm::vec2{ fwd.x, fwd.z }), float(seconds) * 1.0f, e2::CollisionType::All });
+		queuedMove = true;
 
 		if (m_jumpFactor >= jumpTime)
 		{
@@ -175,6 +176,8 @@ void e2::TeardropEntity::update(double seconds)
 	}
 	else
 	{
+		m_collisionCache.clear();
+		game()->populateCollisions(hex().offsetCoords(), e2::CollisionType::All, m_collisionCache);
 		m_movement->resolve(m_collision->radius(), e2::CollisionType::All, m_collisionCache);
 
 		m_mesh->setHeightOffset(0.0f);
@@ -197,8 +200,9 @@ void e2::TeardropEntity::update(double seconds)
 	}
 
 
-	m_collision->invalidate();
-	m_mesh->applyTransform();
+	// solveMoves invalidates queued movers once they've moved
+	if (!queuedMove)
+		m_collision->invalidate();
 
 
 
@@ -220,6 +224,11 @@ void e2::TeardropEntity::onTrigger(e2::Name action, e2::Name trigger)
 	}
 }
 
+void e2::TeardropEntity::applyRenderTransform()
+{
+	m_mesh->applyTransform();
+}
+
 void e2::TeardropEntity::updateVisibility()
 {
 	m_mesh->updateVisibility();
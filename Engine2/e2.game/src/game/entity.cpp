@@ -132,3 +132,26 @@ e2::Hex e2::Entity::hex()
 	return e2::Hex(planarCoords());
 }
 
+void e2::Entity::beginSimulationStep()
+{
+	m_previousTranslation = m_transform->getTranslation(e2::TransformSpace::World);
+	m_previousRotation = m_transform->getRotation(e2::TransformSpace::World);
+	m_previousStep = m_game->simulationSteps();
+}
+
+glm::mat4 e2::Entity::renderMatrix()
+{
+	glm::mat4 current = m_transform->getTransformMatrix(e2::TransformSpace::World);
+	if (m_game->getTurnState() != e2::TurnState::Realtime || m_previousStep + 1 != m_game->simulationSteps())
+		return current;
+
+	float alpha = (float)m_game->simulationAlpha();
+	glm::vec3 translation = m_transform->getTranslation(e2::TransformSpace::World);
+	glm::quat rotation = m_transform->getRotation(e2::TransformSpace::World);
+
+	// swap the current translation and rotation for interpolated ones, keeping scale
+	glm::mat4 unrotate = glm::mat4_cast(glm::inverse(rotation)) * glm::translate(glm::identity<glm::mat4>(), -translation);
+	glm::mat4 interpolated = glm::translate(glm::identity<glm::mat4>(), glm::mix(m_previousTranslation, translation, alpha)) * glm::mat4_cast(glm::slerp(m_previousRotation, rotation, alpha));
+	return interpolated * unrotate * current;
+}
+
@@ -3,6 +3,7 @@
 
 #include "game/entities/player.hpp"
 #include "game/entities/itementity.hpp"
+#include "game/speccache.hpp"
 
 #include "e2/e2.hpp"
 #include "e2/managers/rendermanager.hpp"
@@ -15,6 +16,7 @@
 #include "e2/renderer/renderer.hpp"
 #include "e2/transform.hpp"
 #include "e2/buffer.hpp"
+#include "e2/compression.hpp"
 
 #include "e2/renderer/shadermodels/lightweight.hpp"
 
@@ -46,6 +48,7 @@ namespace
 
 e2::Game::Game(e2::Context* ctx)
 	: e2::Application(ctx)
+	, m_collisionWorld(this)
 	, m_radionManager(this)
 	, m_playerState(this)
 {
@@ -65,6 +68,146 @@ e2::Game::~Game()
 	
 }
 
+e2::SaveWriteTask::SaveWriteTask(e2::Game* inGame, e2::SaveMeta const& inMeta)
+	: e2::AsyncTask(inGame)
+	, game(inGame)
+	, meta(inMeta)
+{
+
+}
+
+e2::SaveWriteTask::~SaveWriteTask()
+{
+
+}
+
+bool e2::SaveWriteTask::execute()
+{
+	e2::Moment writeBegin = e2::timeNow();
+
+	std::vector<uint8_t> compressed;
+	e2::compressLZ(body.data(), body.size(), compressed);
+	compressedSize = compressed.size();
+
+	std::string fileName = meta.fileName();
+	std::string tempFileName = fileName + ".tmp";
+	{
+		e2::FileStream buf(tempFileName, e2::FileMode::ReadWrite | e2::FileMode::Truncate);
+		if (!buf.valid())
+		{
+			LogError("failed to open {} for writing", tempFileName);
+			return false;
+		}
+
+		buf << int64_t(meta.timestamp);
+		buf << e2::compressedSaveMagic;
+		buf << uint64_t(body.size());
+		if (!buf.write(compressed.data(), compressed.size()))
+		{
+			LogError("failed to write {}", tempFileName);
+			return false;
+		}
+	}
+
+	// the rename can reach the disk before the data does, so make sure the data is there first
+	if (!e2::syncFile(tempFileName))
+	{
+		LogError("failed to flush {} to disk", tempFileName);
+		return false;
+	}
+
+	// replaces the old save in one go, it's either all there or not at all
+	std::error_code error;
+	std::filesystem::rename(tempFileName, fileName, error);
+	if (error)
+	{
+		LogError("failed to replace {}: {}", fileName, error.message());
+		return false;
+	}
+
+	writeMs = writeBegin.durationSince().milliseconds();
+	written = true;
+	return true;
+}
+
+bool e2::SaveWriteTask::finalize()
+{
+	game->onSaveWritten(this);
+	return true;
+}
+
+e2::SaveReadTask::SaveReadTask(e2::Game* inGame, std::string const& inFileName)
+	: e2::AsyncTask(inGame)
+	, fileName(inFileName)
+{
+
+}
+
+e2::SaveReadTask::~SaveReadTask()
+{
+
+}
+
+bool e2::SaveReadTask::execute()
+{
+	e2::Moment readBegin = e2::timeNow();
+
+	e2::FileStream buf(fileName, e2::FileMode::ReadOnly);
+	if (!buf.valid())
+		return false;
+
+	int64_t timestamp{};
+	buf >> timestamp;
+
+	uint64_t bodyOffset = buf.cursor();
+	uint32_t magic{};
+	if (buf.remaining() >= sizeof(magic))
+		buf >> magic;
+
+	if (magic != e2::compressedSaveMagic)
+	{
+		// saved before saves were compressed, the body is right here
+		buf.seek(bodyOffset);
+		uint64_t size = buf.remaining();
+		uint8_t const* data = buf.read(size);
+		if (!data)
+			return false;
+
+		body.write(data, size);
+	}
+	else
+	{
+		uint64_t size{};
+		buf >> size;
+
+		uint64_t compressedSize = buf.remaining();
+		uint8_t const* compressed = buf.read(compressedSize);
+		if (!compressed)
+			return false;
+
+		// the size comes from the file, don't let a damaged one make us allocate whatever it says
+		if (size > compressedSize * e2::maxExpansionLZ)
+		{
+			LogError("save {} is corrupted, claims {} bytes from {} compressed", fileName, size, compressedSize);
+			return false;
+		}
+
+		std::vector<uint8_t> decompressed(size);
+		if (!e2::decompressLZ(compressed, compressedSize, decompressed.data(), size))
+		{
+			LogError("save {} is corrupted", fileName);
+			return false;
+		}
+
+		body.write(decompressed.data(), size);
+	}
+	body.seek(0);
+
+	readMs = readBegin.durationSince().milliseconds();
+	valid = true;
+	return true;
+}
+
 void e2::Game::saveGame(uint8_t slot)
 {
 	//if (m_empireTurn != m_localEmpireId)
@@ -73,15 +216,27 @@ void e2::Game::saveGame(uint8_t slot)
 	//	return;
 	//}
 
+	// one save per slot at a time, they'd fight over the temp file otherwise
+	if (m_saveTasks[slot])
+	{
+		e2::AsyncTaskPtr previous = m_saveTasks[slot];
+		asyncManager()->waitForPredicate([previous]() -> bool {
+			e2::AsyncTaskStatus status = previous->status();
+			return status == e2::AsyncTaskStatus::Completed || status == e2::AsyncTaskStatus::Failed;
+		});
+	}
+
 	e2::SaveMeta newMeta;
 	newMeta.exists = true;
 	newMeta.timestamp = std::time(nullptr);
 	newMeta.slot = slot;
 
+	// capture everything in memory in one pass, compressing and writing it is done on a worker
+	e2::SaveWriteTaskPtr task = e2::SaveWriteTaskPtr::create(this, newMeta);
+	task->begin = e2::timeNow();
+	task->body.reserve(m_lastSaveSize);
 	{
-		e2::FileStream buf(newMeta.fileName(), e2::FileMode(uint8_t(e2::FileMode::ReadWrite) | uint8_t(e2::FileMode::Truncate)));
-
-		buf << int64_t(newMeta.timestamp);
+		e2::IStream& buf = task->body;
 
 		m_hexGrid->saveToBuffer(buf);
 
@@ -126,10 +281,49 @@ void e2::Game::saveGame(uint8_t slot)
 
 		m_playerState.writeForSave(buf);
 		m_radionManager.writeForSave(buf);
+	}
+
+	task->captureMs = task->begin.durationSince().milliseconds();
+	m_lastSaveSize = task->body.size();
 
-		saveSlots[slot] = newMeta;
+	saveSlots[slot] = newMeta;
+
+	m_saveTasks[slot] = task.cast<e2::AsyncTask>();
+	asyncManager()->enqueue({ m_saveTasks[slot] });
+}
+
+void e2::Game::onSaveWritten(e2::SaveWriteTask* task)
+{
+	uint8_t slot = task->meta.slot;
+	if (m_saveTasks[slot].get() == task)
+		m_saveTasks[slot] = nullptr;
+
+	if (!task->written)
+	{
+		LogError("failed to save slot {}", slot);
+		return;
+	}
+
+	double totalMs = task->begin.durationSince().milliseconds();
+	LogNotice("Saved slot {}: {:.2f}ms capture (main thread), {:.2f}ms compress and write, {:.2f}ms total. {}KB compressed to {}KB", 
+		slot, task->captureMs, task->writeMs, totalMs, task->body.size() / 1024, task->compressedSize / 1024);
+
+	readSaveMeta(slot);
+}
+
+void e2::Game::waitForSaves()
+{
+	for (uint8_t slot = 0; slot < e2::numSaveSlots; slot++)
+	{
+		if (!m_saveTasks[slot])
+			continue;
+
+		e2::AsyncTaskPtr task = m_saveTasks[slot];
+		asyncManager()->waitForPredicate([task]() -> bool {
+			e2::AsyncTaskStatus status = task->status();
+			return status == e2::AsyncTaskStatus::Completed || status == e2::AsyncTaskStatus::Failed;
+		});
 	}
-	readAllSaveMetas();
 }
 
 e2::SaveMeta e2::Game::readSaveMeta(uint8_t slot)
@@ -176,20 +370,41 @@ void e2::Game::loadGame(uint8_t slot)
 	// header is just uint64_t discoveredTiles + int64_t timestamp
 	constexpr uint64_t headerSize = 8 ;
 
+	// a save of this slot may still be on its way to disk
+	waitForSaves();
+
+	e2::Moment loadBegin = e2::timeNow();
+
+	// read and decompress the save on a worker while we tear down and set up the world
+	e2::SaveReadTaskPtr readTask = e2::SaveReadTaskPtr::create(this, saveSlots[slot].fileName());
+	e2::AsyncTaskPtr readTaskBase = readTask.cast<e2::AsyncTask>();
+	asyncManager()->enqueue({ readTaskBase });
+
 	nukeGame();
 	setupGame();
 	m_menuMusic.stop();
 
-	e2::FileStream buf(saveSlots[slot].fileName(), e2::FileMode::ReadOnly);
-	if (!buf.valid())
+	asyncManager()->waitForPredicate([readTaskBase]() -> bool {
+		e2::AsyncTaskStatus status = readTaskBase->status();
+		return status == e2::AsyncTaskStatus::Completed || status == e2::AsyncTaskStatus::Failed;
+	});
+
+	if (!readTask->valid)
 	{
 		LogError("save slot missing or corrupted");
 		return;
 	}
 
-	buf.read(sizeof(int64_t));
+	e2::IStream& buf = readTask->body;
 
-	m_hexGrid->loadFromBuffer(buf);
+	if (!m_hexGrid->loadFromBuffer(buf))
+	{
+		LogError("save slot {} can't be loaded", slot);
+		nukeGame();
+		setupGame();
+		return;
+	}
+	m_collisionWorld.clearStatic();
 
 
 	m_hexGrid->clearAllChunks();
@@ -245,6 +460,8 @@ void e2::Game::loadGame(uint8_t slot)
 	m_playerState.readForSave(buf);
 	m_radionManager.readForSave(buf);
 
+	LogNotice("Loaded slot {} in {:.2f}ms, {:.2f}ms of it reading and decompressing in the background", slot, loadBegin.durationSince().milliseconds(), readTask->readMs);
+
 	startGame();
 }
 
@@ -316,6 +533,8 @@ void e2::Game::nukeGame()
 		m_hexGrid = nullptr;
 	}
 
+	m_collisionWorld.clearStatic();
+
 	m_radionManager.clearDiscovered();
 
 	m_globalState = GlobalState::Menu;
@@ -415,6 +634,12 @@ void e2::Game::initialize()
 	m_session->window()->showCursor(false);
 }
 
+void e2::Game::preShutdown()
+{
+	// quitting right after saving must not lose the save, and the workers writing it stop after this
+	waitForSaves();
+}
+
 void e2::Game::shutdown()
 {
 	nukeGame();
@@ -739,6 +964,11 @@ void e2::Game::updateGame(double seconds)
 			ss << std::format("{}: avg {:.3f} ms, high {:.3f} ms | avg frame {:.3f} ms, high frame {:.3f} ms", f.displayName, f.avgTimeInScope * 1000.0, f.highTimeInScope * 1000.0, f.avgTimeInFrame * 1000.0, f.highTimeInFrame * 1000.0) << std::endl;
 		}
 		LogNotice("{}", ss.str());
+
+		// open in chrome://tracing or Perfetto
+		if (profiler()->writeTrace("e2.trace.json"))
+			LogNotice("Wrote e2.trace.json");
+
 		profiler()->start();
 	}
 #endif
@@ -1112,6 +1342,7 @@ void e2::Game::findStartLocation()
 {
 	// plop us down somehwere nice 
 	std::unordered_set<glm::ivec2> attemptedStartLocations;
+	e2::PathFindingContext pathFinding(256);
 	bool foundEverything{};
 	while (!foundEverything)
 	{
@@ -1132,18 +1363,13 @@ void e2::Game::findStartLocation()
 			continue;
 
 		constexpr bool ignoreVisibility = true;
-		auto as = e2::create<e2::PathFindingAS>(this, e2::Hex(startLocation), 256, ignoreVisibility, e2::PassableFlags::Land, false, nullptr);
-		uint64_t numWalkableHexes = as->hexIndex.size();
+		uint64_t numWalkableHexes = pathFinding.floodFill(m_hexGrid, startLocation, 256, e2::PassableFlags::Land, ignoreVisibility);
 
 		std::vector<glm::ivec2> greenTiles;
 		std::vector<glm::ivec2> snowTiles;
-		for (auto& [index, tile] : as->hexIndex)
+		for (glm::ivec2 const& offsetCoords : pathFinding.visited())
 		{
-			e2::Hex currentHex = tile->index;
-			glm::ivec2 offsetCoords = currentHex.offsetCoords();
-			glm::vec2 planarCoords = currentHex.planarCoords();
-
-			e2::TileData currentTile = m_hexGrid->calculateTileData(offsetCoords);
+			e2::TileData currentTile = m_hexGrid->getProceduralTileData(offsetCoords);
 
 			if (currentTile.getBiome() == e2::TileFlags::BiomeGrassland && !currentTile.isForested())
 			{
@@ -1155,7 +1381,6 @@ void e2::Game::findStartLocation()
 				snowTiles.push_back(offsetCoords);
 			}
 		}
-		e2::destroy(as);
 
 		if (numWalkableHexes < 32 || greenTiles.size() < 8 || snowTiles.size() < 8)
 			continue;
@@ -1269,23 +1494,49 @@ void e2::Game::updateRealtime()
 	}
 
 
-	std::unordered_set<e2::Entity*> ents = m_entities;
-	for (e2::Entity* entity : ents)
+	// input, once per frame
+	m_playerState.update(m_timeDelta);
+
+	// simulation, at a fixed rate
+	uint32_t numSteps = m_simulation.advance(m_timeDelta);
+	double stepSeconds = m_simulation.stepSeconds();
+	for (uint32_t i = 0; i < numSteps; i++)
 	{
-		entity->update(m_timeDelta);
-	}
+		std::unordered_set<e2::Entity*> ents = m_entities;
+		for (e2::Entity* entity : ents)
+		{
+			entity->beginSimulationStep();
+		}
 
-	m_playerState.update(m_timeDelta);
+		for (e2::Entity* entity : ents)
+		{
+			entity->update(stepSeconds);
+		}
+
+		m_collisionWorld.solveMoves(m_queuedMoves);
+		m_queuedMoves.clear();
+
+		if (!scriptRunning() && m_simulationSteps % e2::radionTickInterval == 0)
+		{
+			m_radionManager.tick();
+		}
+
+		m_simulationSteps++;
+	}
 
 	if (m_playerState.entity)
 	{
+		m_playerState.entity->updateInteraction();
+
 		m_targetViewOrigin = m_playerState.entity->planarCoords();
 		m_hexGrid->updateCutMask(m_playerState.entity->planarCoords());
 	}
 
-	if (!scriptRunning())
+	// rendering, interpolated between the last two steps
+	for (e2::Entity* entity : m_entities)
 	{
-		m_radionManager.update(m_timeDelta);
+		if (entity->isInView())
+			entity->applyRenderTransform();
 	}
 }
 
@@ -1755,7 +2006,7 @@ void e2::Game::drawDebugUI()
 
 	float yOffset = 64.0f;
 	float xOffset = 12.0f;
-	ui->drawQuadShadow({ 0.0f, yOffset - 16.0f }, { 320.0f, 200.0f }, 8.0f, 0.9f, 4.0f);
+	ui->drawQuadShadow({ 0.0f, yOffset - 16.0f }, { 320.0f, 220.0f }, 8.0f, 0.9f, 4.0f);
 	ui->drawRasterText(e2::FontFace::Monospace, 14, 0xFFFFFFFF, { xOffset, yOffset }, std::format("^2Avg. {:.1f} ms, fps: {:.1f}", metrics.frameTimeMsMean, 1000.0f / metrics.frameTimeMsMean));
 	ui->drawRasterText(e2::FontFace::Monospace, 14, 0xFFFFFFFF, { xOffset, yOffset + (18.0f * 1.0f) }, std::format("^3High {:.1f} ms, fps: {:.1f}", metrics.frameTimeMsHigh, 1000.0f / metrics.frameTimeMsHigh));
 	ui->drawRasterText(e2::FontFace::Monospace, 14, 0xFFFFFFFF, { xOffset, yOffset + (18.0f * 2.0f) }, std::format("^4CPU FPS: {:.1f}", metrics.realCpuFps));
@@ -1767,13 +2018,16 @@ void e2::Game::drawDebugUI()
 	ui->drawRasterText(e2::FontFace::Monospace, 14, 0xFFFFFFFF, { xOffset, yOffset + (18.0f * 8.0f) }, std::format("^2View Origin: {}", m_viewOrigin));
 	ui->drawRasterText(e2::FontFace::Monospace, 14, 0xFFFFFFFF, { xOffset, yOffset + (18.0f * 9.0f) }, std::format("^3View Velocity: {}", m_viewVelocity));
 
+	e2::TileCacheStats cacheStats = m_hexGrid->tileCache().stats();
+	uint64_t cacheLookups = cacheStats.hits + cacheStats.misses;
+	ui->drawRasterText(e2::FontFace::Monospace, 14, 0xFFFFFFFF, { xOffset, yOffset + (18.0f * 10.0f) }, std::format("^4Tile cache: {:.1f}% of {} lookups", cacheLookups > 0 ? 100.0 * double(cacheStats.hits) / double(cacheLookups) : 0.0, cacheLookups));
+
 
 
 	//ui->drawTexturedQuad({ xOffset, yOffset + 18.0f * 11.0f }, { 384.f, 384.f }, 0xFFFFFFFF, renderer->shadowTarget());
 #endif
 }
 
-
 void e2::Game::drawFinalUI()
 {
 
@@ -2183,34 +2437,26 @@ e2::Sprite* e2::Game::getUnitSprite(e2::Name name)
 
 void e2::Game::initializeSpecifications(e2::ALJDescription &alj)
 {
-	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator("data/entities/"))
-	{
-		if (!entry.is_regular_file())
-			continue;
-		if (entry.path().extension() != ".json")
-			continue;
+	// json for unchanged files comes from the specification cache, the rest is parsed and cached for next time. Both in parallel
+	e2::SpecCache specCache(e2::specCachePath);
+	std::vector<e2::SpecDocument> documents = specCache.load({ "data/entities/", "data/items/" });
+	LogNotice("loaded {} specifications, {} cached and {} parsed", documents.size(), specCache.numCached(), specCache.numParsed());
 
-		std::ifstream unitFile(entry.path());
-		nlohmann::json entity;
-		try
-		{
-			entity = nlohmann::json::parse(unitFile);
-		}
-		catch (nlohmann::json::parse_error& e)
-		{
-			LogError("failed to load specification, json parse error: {}", e.what());
+	for (e2::SpecDocument& document : documents)
+	{
+		if (document.directory != 0)
 			continue;
-		}
 
+		nlohmann::json& entity = document.json;
 		if (!entity.contains("id"))
 		{
-			LogError("entity file {} lacks id", entry.path().string());
+			LogError("entity file {} lacks id", document.path);
 			continue;
 		}
 
 		if (!entity.contains("specification"))
 		{
-			LogError("entity file {} lacks specification type", entry.path().string());
+			LogError("entity file {} lacks specification type", document.path);
 			continue;
 		}
 		e2::Name id = entity.at("id").template get<std::string>();
@@ -2218,7 +2464,7 @@ void e2::Game::initializeSpecifications(e2::ALJDescription &alj)
 		e2::Type* specificationType = e2::Type::fromName(specification);
 		if (!specificationType || !specificationType->inherits("e2::EntitySpecification"))
 		{
-			LogError("entity file {} provided invalid specification type {} (make sure it exists, and inherits e2::EntitySpecification)", entry.path().string(), specification);
+			LogError("entity file {} provided invalid specification type {} (make sure it exists, and inherits e2::EntitySpecification)", document.path, specification);
 			continue;
 		}
 
@@ -2248,30 +2494,15 @@ void e2::Game::initializeSpecifications(e2::ALJDescription &alj)
 		m_entitySpecifications[id] = newSpecification;
 	}
 
-
-
-	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator("data/items/"))
+	for (e2::SpecDocument& document : documents)
 	{
-		if (!entry.is_regular_file())
-			continue;
-		if (entry.path().extension() != ".json")
+		if (document.directory != 1)
 			continue;
 
-		std::ifstream unitFile(entry.path());
-		nlohmann::json item;
-		try
-		{
-			item = nlohmann::json::parse(unitFile);
-		}
-		catch (nlohmann::json::parse_error& e)
-		{
-			LogError("failed to load specification, json parse error: {}", e.what());
-			continue;
-		}
-
+		nlohmann::json& item = document.json;
 		if (!item.contains("id"))
 		{
-			LogError("item file {} lacks id", entry.path().string());
+			LogError("item file {} lacks id", document.path);
 			continue;
 		}
 
@@ -2302,7 +2533,7 @@ void e2::Game::finalizeSpecifications()
 
 void e2::Game::registerCollisionComponent(e2::CollisionComponent* component, glm::ivec2 const& index)
 {
-	m_collisionComponents[index].insert(component);
+	m_collisionWorld.registerComponent(component, index);
 }
 
 e2::ItemSpecification* e2::Game::getItemSpecification(e2::Name name)
@@ -2379,144 +2610,27 @@ e2::EntitySpecification* e2::Game::getEntitySpecification(e2::Name name)
 
 void e2::Game::populateCollisions(glm::ivec2 const& coordinate, CollisionType mask, std::vector<e2::Collision>& outCollisions, bool includeNeighbours)
 {
-	e2::Hex hex(coordinate);
-	e2::TileData tileData = hexGrid()->getTileData(coordinate);
-
-	auto addTrees = [&](e2::Hex& tc, e2::TileData& td) {
-		if (td.isForested() && td.forestIndex >= 0)
-		{
-			uint32_t i = 0;
-			e2::ForestState* forestState = hexGrid()->getForestState(td.forestIndex);
-
-			for (e2::TreeState& treeState : forestState->trees)
-			{
-				glm::vec2 treeOffset = tc.planarCoords() + treeState.localOffset(&td, forestState);
-
-				Collision newCollision;
-				newCollision.type = e2::CollisionType::Tree;
-				newCollision.position = treeOffset;
-				newCollision.radius = 0.25f * treeState.scale;
-				newCollision.hex = tc.offsetCoords();
-				newCollision.treeIndex = i;
-
-				outCollisions.push_back(newCollision);
-				i++;
-			}
-		}
-		else
-		{
-			e2::UnpackedForestState* forestState = hexGrid()->getUnpackedForestState(tc.offsetCoords());
-			if (!forestState)
-				return;
-
-			uint32_t i = 0;
-			for (e2::UnpackedTreeState& treeState : forestState->trees)
-			{
-				if (treeState.health <= 0.0f)
-				{
-					i++;
-					continue;
-				}
-
-				Collision newCollision;
-				newCollision.type = e2::CollisionType::Tree;
-				newCollision.position = treeState.worldOffset;
-				newCollision.radius = 0.25f * treeState.scale;
-				newCollision.hex = tc.offsetCoords();
-				newCollision.treeIndex = i;
-
-				outCollisions.push_back(newCollision);
-				i++;
-			}
-		}
-	};
-
-	auto addComponents = [&](e2::Hex& tc) {
-		auto finder = m_collisionComponents.find(tc.offsetCoords());
-		if (finder != m_collisionComponents.end())
-		{
-			for (e2::CollisionComponent* comp : finder->second)
-			{
-				e2::Collision newCollision;
-				newCollision.type = CollisionType::Component;
-				newCollision.component = comp;
-				newCollision.radius = comp->radius();
-				newCollision.hex = tc.offsetCoords();
-				newCollision.position = comp->entity()->planarCoords();
-				outCollisions.push_back(newCollision);
-			}
-		}
-	};
-
-	if((mask & e2::CollisionType::Tree) == e2::CollisionType::Tree)
-		addTrees(hex, tileData);
-
-	if ((mask & e2::CollisionType::Component) == e2::CollisionType::Component)
-		addComponents(hex);
-
-
-	e2::Collision newCollision;
-	newCollision.hex = coordinate;
-	newCollision.position = hex.planarCoords();
-	newCollision.radius = 1.0f;
-
-	if (tileData.isMountain() && (mask & e2::CollisionType::Mountain) == e2::CollisionType::Mountain)
-	{
-		newCollision.type = e2::CollisionType::Mountain;
-		outCollisions.push_back(newCollision);
-	}
-	else if ((tileData.isShallowWater() || tileData.isDeepWater()) && (mask & e2::CollisionType::Water) == e2::CollisionType::Water)
-	{
-		newCollision.type = e2::CollisionType::Water;
-		outCollisions.push_back(newCollision);
-	}
-	else if (tileData.isLand() && (mask & e2::CollisionType::Land) == e2::CollisionType::Land)
-	{
-		newCollision.type = e2::CollisionType::Land;
-		outCollisions.push_back(newCollision);
-	}
-
-	if (!includeNeighbours)
-		return;
-
-	e2::StackVector<e2::Hex, 6> neighbours = hex.neighbours();
-	for (e2::Hex& n : neighbours)
-	{
-		e2::TileData nd = hexGrid()->getTileData(n.offsetCoords());
-
-		e2::Collision newCollision;
-		newCollision.hex = n.offsetCoords();
-		newCollision.position = n.planarCoords();
-		newCollision.radius = 1.0f;
-
-		if (nd.isMountain() && (mask & e2::CollisionType::Mountain) == e2::CollisionType::Mountain)
-		{
-			newCollision.type = e2::CollisionType::Mountain;
-			outCollisions.push_back(newCollision);
-		}
-		else if ((nd.isShallowWater() || nd.isDeepWater()) && (mask & e2::CollisionType::Water) == e2::CollisionType::Water)
-		{
-			newCollision.type = e2::CollisionType::Water;
-			outCollisions.push_back(newCollision);
-		}
-		else if (nd.isLand() && (mask & e2::CollisionType::Land) == e2::CollisionType::Land)
-		{
-			newCollision.type = e2::CollisionType::Land;
-			outCollisions.push_back(newCollision);
-		}
+	m_collisionWorld.query(coordinate, mask, includeNeighbours, outCollisions);
+}
 
-		if ((mask & e2::CollisionType::Tree) == e2::CollisionType::Tree)
-			addTrees(n, nd);
+void e2::Game::populateCollisions(glm::ivec2 const& coordinate, CollisionType mask, e2::CollisionSet& outCollisions, bool includeNeighbours)
+{
+	m_collisionWorld.query(coordinate, mask, includeNeighbours, outCollisions);
+}
 
-		if ((mask & e2::CollisionType::Component) == e2::CollisionType::Component)
-			addComponents(n);
-	}
+e2::CollisionWorld* e2::Game::collisionWorld()
+{
+	return &m_collisionWorld;
+}
 
+void e2::Game::queueMove(e2::MoveRequest const& request)
+{
+	m_queuedMoves.push_back(request);
 }
 
 void e2::Game::unregisterCollisionComponent(e2::CollisionComponent* component, glm::ivec2 const &index)
 {
-	m_collisionComponents[index].erase(component);
+	m_collisionWorld.unregisterComponent(component, index);
 }
 
 
@@ -2602,17 +2716,8 @@ void e2::Game::updateAltCamera(double seconds)
 
 void e2::Game::updateAnimation(double seconds)
 {
-	// 1 / 30 = 33.333ms = 30 fps 
-	constexpr double targetFrameTime = 1.0 / 60.0;
-	m_accumulatedAnimationTime += seconds;
-
-	int32_t numTicks = 0;
-	while (m_accumulatedAnimationTime > targetFrameTime)
-	{
-		numTicks++;
-		m_accumulatedAnimationTime -= targetFrameTime;
-	}
-
+	// animation is only visual, so it runs at most at 60 fps and catches up in one go (skinning once), but never more than maxSimulationSteps at a time
+	uint32_t numTicks = m_animation.advance(seconds);
 	if (numTicks < 1)
 		return;
 
@@ -2633,12 +2738,8 @@ void e2::Game::updateAnimation(double seconds)
 			m_entitiesInView.insert(entity);
 		}
 
-		// @todo consider using this instead if things break
-		//for(int32_t i = 0; i < numTicks; i++)
-		//	unit->updateAnimation(targetFrameTime);
-
 		if(m_turnState == e2::TurnState::Realtime)
-			entity->updateAnimation(targetFrameTime * double(numTicks));
+			entity->updateAnimation(m_animation.stepSeconds() * double(numTicks));
 	}
 
 }
@@ -2746,123 +2847,6 @@ void e2::Game::updateAnimation(double seconds)
 //	}
 //}
 
-e2::PathFindingAS::PathFindingAS(e2::Game* game, e2::Hex const& start, uint64_t range, bool ignoreVisibility, e2::PassableFlags passableFlags, bool onlyWaveRelevant, e2::Hex* stopWhenFound)
-{
-	e2::HexGrid* grid = game->hexGrid();
-	glm::ivec2 tileIndex = start.offsetCoords();
-
-	e2::Hex originHex = start;
-	origin = e2::create<e2::PathFindingHex>(originHex);
-	origin->isBegin = true;
-
-	hexIndex[tileIndex] = origin;
-
-
-	std::queue<e2::PathFindingHex*> queue;
-	std::unordered_set<e2::Hex> processed;
-
-	queue.push(origin);
-
-	while (!queue.empty())
-	{
-		e2::PathFindingHex* curr = queue.front();
-		queue.pop();
-
-		for (e2::Hex n : curr->index.neighbours())
-		{
-			if (curr->stepsFromOrigin + 1 > range)
-				continue;
-
-			if (processed.contains(n))
-				continue;
-
-			glm::ivec2 coords = n.offsetCoords();
-
-			if (hexIndex.contains(coords))
-				continue;
-
-			// ignore hexes not directly visible
-			if (!ignoreVisibility && !grid->isVisible(coords))
-				continue;
-
-			// ignore hexes that are occupied by unpassable biome
-			e2::TileData tile = game->hexGrid()->calculateTileData(coords);
-			if (!tile.isPassable(passableFlags))
-				continue;
-
-
-			e2::PathFindingHex* newHex = e2::create<e2::PathFindingHex>(n);
-			newHex->towardsOrigin = curr;
-			newHex->stepsFromOrigin = curr->stepsFromOrigin + 1;
-			hexIndex[coords] = newHex;
-
-
-			queue.push(newHex);
-		}
-
-		processed.insert(curr->index);
-
-		if (stopWhenFound && *stopWhenFound == curr->index)
-			return;
-	}
-}
-
-e2::PathFindingAS::~PathFindingAS()
-{
-	std::unordered_set<e2::PathFindingHex*> hexes;
-	for (auto [coords, hex] : hexIndex)
-		hexes.insert(hex);
-	hexIndex.clear(); 
-
-	while (!hexes.empty())
-	{
-		e2::PathFindingHex* h = *hexes.begin();
-		hexes.erase(h);
-		e2::destroy(h);
-	}
-		
-}
-
-e2::PathFindingAS::PathFindingAS()
-{
-
-}
-
-std::vector<e2::Hex> e2::PathFindingAS::find(e2::Hex const& target)
-{
-
-	auto targetFinder = hexIndex.find(target.offsetCoords());
-	if (targetFinder == hexIndex.end())
-		return {};
-
-
-	std::vector<e2::Hex> returner;
-	e2::PathFindingHex* cursor = targetFinder->second;
-	while (cursor)
-	{
-		returner.push_back(cursor->index);
-		if (cursor->isBegin)
-			break;
-		cursor = cursor->towardsOrigin;
-	}
-
-	std::reverse(returner.begin(), returner.end());
-
-	return returner;
-
-}
-
-e2::PathFindingHex::PathFindingHex(e2::Hex const& _index)
-	: index(_index)
-{
-
-}
-
-e2::PathFindingHex::~PathFindingHex()
-{
-
-}
-
 std::string e2::SaveMeta::displayName()
 {
 	if (!exists)
@@ -8,11 +8,16 @@
 #include "e2/transform.hpp"
 #include "game/game.hpp"
 #include "game/entities/itementity.hpp"
+#include "game/noise.hpp"
 
 #include <glm/gtc/noise.hpp>
 
 #include <glm/gtx/easing.hpp>
 
+#include <bit>
+#include <random>
+#include <thread>
+
 
 glm::vec2 e2::TreeState::localOffset(e2::TileData *tile, ForestState* forestState)
 {
@@ -156,9 +161,9 @@ e2::HexGrid::HexGrid(e2::GameContext* gameCtx)
 	, m_cutMask(gameCtx, 1280, 10.0f)
 {
 	LogNotice("HexGrid constructor at {}", (uint64_t)this);
-	constexpr size_t prewarmSize = 16'384;
-	m_tiles.reserve(prewarmSize);
-	m_tileIndex.reserve(prewarmSize);
+	constexpr size_t prewarmSize = 16'384 / (e2::hexChunkResolution * e2::hexChunkResolution);
+	m_tilePages.reserve(prewarmSize);
+	m_tilePageIndex.reserve(prewarmSize);
 
 	// max num of threads to use for chunk streaming
 	m_numThreads = std::thread::hardware_concurrency();
@@ -195,18 +200,17 @@ e2::HexGrid::HexGrid(e2::GameContext* gameCtx)
 
 	//m_grassMaterial = am->get("M_Grass.e2a")->cast<e2::Material>();
 
-	e2::MeshProxyConfiguration meshCfg = {
-		.lods = {
-			{
-				.maxDistance = 0.0f,
-				.mesh = m_treeMeshes[0],
-				.materials = { m_treeMaterialProxy }
-			}
-		}
-	};
-	// preload this to avoid hitch when you unpack forest tiles
-	auto tmp = e2::create<e2::MeshProxy>(gameSession(), meshCfg);
-	e2::destroy(tmp);
+	// trees in unpacked forests are drawn instanced, one proxy per tree mesh. Creating them here also compiles their pipelines up front
+	for (uint32_t i = 0; i < e2::maxNumVegetationMeshes; i++)
+	{
+		e2::MeshProxyConfiguration treeCfg;
+		e2::MeshLodConfiguration lodCfg;
+		lodCfg.mesh = m_treeMeshes[i];
+		lodCfg.materials.push(m_treeMaterialProxy);
+		treeCfg.lods.push(lodCfg);
+		treeCfg.maxInstances = e2::maxNumVegetationInstances;
+		m_treeInstanceProxies[i] = e2::create<e2::MeshProxy>(gameSession(), treeCfg);
+	}
 
 
 
@@ -456,7 +460,21 @@ e2::HexGrid::~HexGrid()
 	clearAllChunks();
 	destroyFogOfWar();
 
+	m_treeInstances.clear();
+	for (e2::MeshProxy*& proxy : m_treeInstanceProxies)
+	{
+		if (proxy)
+			e2::destroy(proxy);
+		proxy = nullptr;
+	}
+
 	m_grassProxy->setTexture("cutMask", nullptr);
+
+	for (e2::TilePage* page : m_tilePages)
+		e2::destroy(page);
+	m_tilePages.clear();
+	m_tilePageIndex.clear();
+	m_lastTilePage = nullptr;
 }
 
 
@@ -471,10 +489,18 @@ e2::Game* e2::HexGrid::game()
 }
 
 
+namespace
+{
+	constexpr uint32_t tilesPerPage = e2::hexChunkResolution * e2::hexChunkResolution;
 
+	// saved size of a tile page: chunk index, discovered mask, then visibility, forest index, forest rotation and flags per tile
+	constexpr uint64_t savedTilePageSize = sizeof(glm::ivec2) + sizeof(uint64_t) + tilesPerPage * (sizeof(int32_t) + sizeof(int32_t) + sizeof(float) + sizeof(uint8_t));
+}
 
 void e2::HexGrid::saveToBuffer(e2::IStream& toBuffer)
 {
+	toBuffer << e2::hexGridSaveMagic << e2::hexGridSaveVersion;
+
 	toBuffer << uint64_t(m_discoveredChunks.size());
 	for (glm::ivec2 const& vec : m_discoveredChunks)
 	{
@@ -483,19 +509,20 @@ void e2::HexGrid::saveToBuffer(e2::IStream& toBuffer)
 
 	toBuffer << m_discoveredChunksAABB;
 
-	toBuffer << uint64_t(m_tiles.size());
-	for (uint64_t i = 0; i < m_tiles.size(); i++)
-	{
-		toBuffer << int32_t(m_tileVisibility[i]);
-		toBuffer << uint16_t(m_tiles[i].flags);
-		toBuffer << m_tiles[i].forestIndex;
-		toBuffer << m_tiles[i].forestRotation;
-	}
-
-	toBuffer << uint64_t(m_tileIndex.size());
-	for (auto& [hex, ind]: m_tileIndex)
+	toBuffer << uint64_t(m_tilePages.size());
+	for (e2::TilePage* page : m_tilePages)
 	{
-		toBuffer << uint64_t(ind) << hex;
+		toBuffer << page->chunkIndex;
+		toBuffer << page->discoveredMask;
+
+		for (uint32_t i = 0; i < ::tilesPerPage; i++)
+			toBuffer << page->visibility[i];
+		for (uint32_t i = 0; i < ::tilesPerPage; i++)
+			toBuffer << page->tiles[i].forestIndex;
+		for (uint32_t i = 0; i < ::tilesPerPage; i++)
+			toBuffer << page->tiles[i].forestRotation;
+		for (uint32_t i = 0; i < ::tilesPerPage; i++)
+			toBuffer << uint8_t(page->tiles[i].flags);
 	}
 
 	toBuffer << m_worldBounds;
@@ -517,8 +544,18 @@ void e2::HexGrid::saveToBuffer(e2::IStream& toBuffer)
 	}
 }
 
-void e2::HexGrid::loadFromBuffer(e2::IStream& fromBuffer)
+bool e2::HexGrid::loadFromBuffer(e2::IStream& fromBuffer)
 {
+	uint32_t magic{}, version{};
+	if (fromBuffer.remaining() >= sizeof(magic) + sizeof(version))
+		fromBuffer >> magic >> version;
+
+	if (magic != e2::hexGridSaveMagic || version != e2::hexGridSaveVersion)
+	{
+		LogError("save is from an older version of the game (hex grid version {}, expected {}), it can't be loaded", magic == e2::hexGridSaveMagic ? version : 0, e2::hexGridSaveVersion);
+		return false;
+	}
+
 	uint64_t numDiscoveredChunks{};
 	fromBuffer >> numDiscoveredChunks;
 	for (uint64_t i = 0; i < numDiscoveredChunks; i++)
@@ -530,36 +567,36 @@ void e2::HexGrid::loadFromBuffer(e2::IStream& fromBuffer)
 
 	fromBuffer >> m_discoveredChunksAABB;
 
-	uint64_t numTiles{};
-	fromBuffer >> numTiles;
-	for (uint64_t i = 0; i < numTiles; i++)
+	uint64_t numPages{};
+	fromBuffer >> numPages;
+	for (uint64_t i = 0; i < numPages; i++)
 	{
-		int32_t newVis{};
-		fromBuffer >> newVis;
-		m_tileVisibility.push_back(newVis);
-
-		TileData newTile;
-
-		uint16_t flags{};
-		fromBuffer >> flags;
-		newTile.flags = (e2::TileFlags)flags;
-
-		
-		fromBuffer >> newTile.forestIndex >> newTile.forestRotation;
-	
-		m_tiles.push_back(newTile);
-
-	}
-
-	uint64_t numTileIndex{};
-	fromBuffer >> numTileIndex;
+		if (fromBuffer.remaining() < ::savedTilePageSize)
+		{
+			LogError("failed to read tile page {} of {}, save is truncated", i, numPages);
+			return false;
+		}
 
-	for (uint64_t i = 0; i < numTileIndex; i++)
-	{
-		glm::ivec2 hex;
-		uint64_t ind;
-		fromBuffer >> ind >> hex;
-		m_tileIndex[hex] = ind;
+		glm::ivec2 chunkIndex;
+		uint64_t discoveredMask{};
+		fromBuffer >> chunkIndex >> discoveredMask;
+
+		e2::TilePage* page = getOrCreateTilePage(chunkIndex);
+		page->discoveredMask = discoveredMask;
+		for (uint32_t j = 0; j < ::tilesPerPage; j++)
+			fromBuffer >> page->visibility[j];
+		for (uint32_t j = 0; j < ::tilesPerPage; j++)
+			fromBuffer >> page->tiles[j].forestIndex;
+		for (uint32_t j = 0; j < ::tilesPerPage; j++)
+			fromBuffer >> page->tiles[j].forestRotation;
+		for (uint32_t j = 0; j < ::tilesPerPage; j++)
+		{
+			uint8_t flags{};
+			fromBuffer >> flags;
+			page->tiles[j].flags = e2::TileFlags(flags);
+		}
+		page->syncVisibleMask();
+		page->revision++;
 	}
 
 
@@ -589,6 +626,7 @@ void e2::HexGrid::loadFromBuffer(e2::IStream& fromBuffer)
 	}
 
 	buildForestMeshes();
+	return true;
 }
 
 e2::Aabb2D e2::HexGrid::getChunkAabb(glm::ivec2 const& chunkIndex)
@@ -668,7 +706,7 @@ namespace
 		glm::vec2 chunkOffset;
 		glm::ivec2 cacheOffset;
 
-		e2::TileData tileCache[64];
+		e2::TileData tileCache[e2::hexChunkBorderTiles];
 
 		e2::TileData& getTileData(glm::ivec2 const& offsetCoords)
 		{
@@ -1214,6 +1252,8 @@ void e2::HexGrid::updateStreaming(glm::vec2 const& streamCenter, e2::Viewpoints2
 	if(game()->isRealtime())
 		updateUnpackedForests();
 
+	syncTreeInstances();
+
 	debugDraw();
 
 }
@@ -1254,12 +1294,22 @@ e2::ChunkState* e2::HexGrid::getOrCreateChunk(glm::ivec2 const& index)
 		// prepare chunk entities 
 		glm::ivec2 chunkTileOffset = index * glm::ivec2(e2::hexChunkResolution);
 
+		constexpr uint32_t chunkTiles = e2::hexChunkResolution * e2::hexChunkResolution;
+		glm::ivec2 chunkHexes[chunkTiles];
+		e2::TileData chunkTileData[chunkTiles];
+		for (int32_t ty = 0; ty < e2::hexChunkResolution; ty++)
+			for (int32_t tx = 0; tx < e2::hexChunkResolution; tx++)
+				chunkHexes[ty * e2::hexChunkResolution + tx] = chunkTileOffset + glm::ivec2(tx, ty);
+
+		calculateTileDataBatch(chunkHexes, chunkTileData, chunkTiles);
+		m_tileCache.fill(index, chunkTileData);
+
 		for (int32_t ty = 0; ty < e2::hexChunkResolution; ty++)
 		{
 			for (int32_t tx = 0; tx < e2::hexChunkResolution; tx++)
 			{
-				glm::ivec2 worldIndex = chunkTileOffset + glm::ivec2(tx, ty);
-				e2::TileData tile = calculateTileData(worldIndex);
+				glm::ivec2 worldIndex = chunkHexes[ty * e2::hexChunkResolution + tx];
+				e2::TileData const& tile = chunkTileData[ty * e2::hexChunkResolution + tx];
 				if (!tile.isLand() || tile.isMountain())
 					continue;
 
@@ -1357,6 +1407,8 @@ void e2::HexGrid::nukeChunk(e2::ChunkState* chunk)
 	m_lookAheadChunks.erase(chunk);
 
 	m_chunkIndex.erase(chunk->chunkIndex);
+	m_tileCache.evict(chunk->chunkIndex);
+	game()->collisionWorld()->evictStatic(chunk->chunkIndex);
 	chunk->task = nullptr;
 	e2::discard(chunk);
 }
@@ -1364,62 +1416,78 @@ void e2::HexGrid::nukeChunk(e2::ChunkState* chunk)
 
 namespace
 {
+	// noise offsets and scales for the different worldgen layers, shared between the scalar and batched paths
+	glm::vec2 const biomeNoiseOffset{ 81.44f, 93.58f };
+	constexpr float biomeNoiseScale = 0.01f;
+
+	glm::vec2 const heightNoiseOffset{ 32.16f, 64.32f };
+	constexpr float heightNoiseScale = 0.0135f;
+
+	glm::vec2 const forestNoiseOffset{ 32.16f, 64.32f };
+	constexpr float forestNoiseScale = 0.135f;
+
+	void applyBiome(float biomeCoeff, e2::TileFlags& outFlags)
+	{
+		if (biomeCoeff > 0.8f)
+			outFlags |= e2::TileFlags::BiomeTundra;
+		else if (biomeCoeff > 0.4f)
+			outFlags |= e2::TileFlags::BiomeGrassland;
+		else
+			outFlags |= e2::TileFlags::BiomeDesert;
+	}
+
+	// forestSample is only meaningful when baseHeight > 0.75
+	void applyFeaturesAndWater(float baseHeight, float forestSample, e2::TileFlags& outFlags)
+	{
+		if (baseHeight > 0.75f)
+		{
+			float forestCoeff = glm::smoothstep(0.5f, 1.0f, forestSample);
+			//forestCoeff = 1.0 - forestCoeff;
+
+			//float forestCoeff = sampleSimplex((planarCoords + glm::vec2(32.16f, 64.32f)) * 0.135f);
+			//forestCoeff = glm::pow(glm::smoothstep(0.0f, 0.5f, forestCoeff), 1.2f);
+
+			if (forestCoeff > 0.05f && (baseHeight <= 0.90f) && ((outFlags & e2::TileFlags::BiomeMask) != e2::TileFlags::BiomeDesert))
+				outFlags |= e2::TileFlags::FeatureForest;
 
-	glm::vec3 my_permute(glm::vec3 x)
-	{
-		return glm::mod(((x * 34.0f) + 1.0f) * x, 289.0f);
-	}
-
-	float my_simplex(glm::vec2 v) {
-		const glm::vec4 C = glm::vec4(0.211324865405187f, 0.366025403784439f, -0.577350269189626f, 0.024390243902439f);
-		glm::vec2 i = floor(v + glm::dot(v, glm::vec2{C.y, C.y}));
-		glm::vec2 x0 = v - i + glm::dot(i, glm::vec2{C.x, C.x});
-		glm::vec2 i1;
-		i1 = (x0.x > x0.y) ? glm::vec2(1.0f, 0.0f) : glm::vec2(0.0f, 1.0f);
-		glm::vec4 x12 = glm::vec4{ x0.x,  x0.y, x0.x, x0.y } + glm::vec4{C.x, C.x, C.z, C.z};
-		x12.x -= i1.x;
-		x12.y -= i1.y;
-		i = glm::mod(i, 289.0f);
-		glm::vec3 p = my_permute(my_permute(i.y + glm::vec3(0.0f, i1.y, 1.0f))
-			+ i.x + glm::vec3(0.0f, i1.x, 1.0f));
-		glm::vec3 m = glm::max(0.5f - glm::vec3(dot(x0, x0), glm::dot(glm::vec2{ x12.x, x12.y}, glm::vec2{ x12.x, x12.y }),
-			glm::dot(glm::vec2{ x12.z, x12.w } , glm::vec2{ x12.z, x12.w })), 0.0f);
-		m = m * m;
-		m = m * m;
-		glm::vec3 x = 2.0f * glm::fract(p * glm::vec3(C.w, C.w, C.w)) - 1.0f;
-		glm::vec3 h = glm::abs(x) - 0.5f;
-		glm::vec3 ox = floor(x + 0.5f);
-		glm::vec3 a0 = x - ox;
-		m *= 1.79284291400159f - 0.85373472095314f * (a0 * a0 + h * h);
-		glm::vec3 g;
-		g.x = a0.x * x0.x + h.x * x0.y;
-		g.y = a0.y * x12.x + h.y * x12.y;
-		g.z = a0.z * x12.z + h.z * x12.w;
-		return 130.0f * glm::dot(m, g);
+			if (forestCoeff > 0.95f)
+				outFlags |= e2::TileFlags::WoodAbundance4;
+			else if (forestCoeff > 0.750f)
+				outFlags |= e2::TileFlags::WoodAbundance3;
+			else if (forestCoeff > 0.5f)
+				outFlags |= e2::TileFlags::WoodAbundance2;
+			else
+				outFlags |= e2::TileFlags::WoodAbundance1;
+
+			if (baseHeight > 0.90f)
+				outFlags |= e2::TileFlags::FeatureMountains;
+		}
+		else if (baseHeight > 0.57f)
+		{
+			outFlags |= e2::TileFlags::WaterShallow;
+		}
+		else
+		{
+			outFlags |= e2::TileFlags::WaterDeep;
+		}
 	}
 }
 
 float e2::HexGrid::sampleSimplex(glm::vec2 const& position)
 {
-	return ::my_simplex(position) * 0.5f + 0.5f;
+	return e2::simplex(position) * 0.5f + 0.5f;
 }
 
 void e2::HexGrid::calculateBiome(glm::vec2 const& planarCoords, e2::TileFlags& outFlags)
 {
-	float biomeCoeff = sampleSimplex((planarCoords + glm::vec2(81.44f, 93.58f)) * 0.01f);
-
-	if (biomeCoeff > 0.8f)
-		outFlags |= TileFlags::BiomeTundra;
-	else if (biomeCoeff > 0.4f)
-		outFlags |= TileFlags::BiomeGrassland;
-	else
-		outFlags |= TileFlags::BiomeDesert;
+	float biomeCoeff = sampleSimplex((planarCoords + ::biomeNoiseOffset) * ::biomeNoiseScale);
+	::applyBiome(biomeCoeff, outFlags);
 }
 
 
 float e2::HexGrid::calculateBaseHeight(glm::vec2 const& planarCoords)
 {
-	float baseHeight = sampleSimplex((planarCoords + glm::vec2(32.16f, 64.32f)) * 0.0135f);
+	float baseHeight = sampleSimplex((planarCoords + ::heightNoiseOffset) * ::heightNoiseScale);
 	return baseHeight;
 
 	/*float h1p = 0.42;
@@ -1441,38 +1509,11 @@ float e2::HexGrid::calculateBaseHeight(glm::vec2 const& planarCoords)
 
 void e2::HexGrid::calculateFeaturesAndWater(glm::vec2 const& planarCoords, float baseHeight, e2::TileFlags& outFlags)
 {
+	float forestSample = 0.0f;
 	if (baseHeight > 0.75f)
-	{
-		float forestCoeff = sampleSimplex((planarCoords + glm::vec2(32.16f, 64.32f)) * 0.135f);
-		forestCoeff = glm::smoothstep(0.5f, 1.0f, forestCoeff);
-		//forestCoeff = 1.0 - forestCoeff;
-
-		//float forestCoeff = sampleSimplex((planarCoords + glm::vec2(32.16f, 64.32f)) * 0.135f);
-		//forestCoeff = glm::pow(glm::smoothstep(0.0f, 0.5f, forestCoeff), 1.2f);
+		forestSample = sampleSimplex((planarCoords + ::forestNoiseOffset) * ::forestNoiseScale);
 
-		if (forestCoeff > 0.05f && (baseHeight <= 0.90f) && ((outFlags & TileFlags::BiomeMask) != TileFlags::BiomeDesert))
-			outFlags |= TileFlags::FeatureForest;
-
-		if (forestCoeff > 0.95f)
-			outFlags |= TileFlags::WoodAbundance4;
-		else if (forestCoeff > 0.750f)
-			outFlags |= TileFlags::WoodAbundance3;
-		else if (forestCoeff > 0.5f)
-			outFlags |= TileFlags::WoodAbundance2;
-		else
-			outFlags |= TileFlags::WoodAbundance1;
-
-		if (baseHeight > 0.90f)
-			outFlags |= TileFlags::FeatureMountains;
-	}
-	else if (baseHeight > 0.57f)
-	{
-		outFlags |= TileFlags::WaterShallow;
-	}
-	else
-	{
-		outFlags |= TileFlags::WaterDeep;
-	}
+	::applyFeaturesAndWater(baseHeight, forestSample, outFlags);
 }
 
 int32_t e2::HexGrid::getForestIndexForFlags(e2::TileFlags flags)
@@ -1517,8 +1558,9 @@ void e2::HexGrid::damageTree(glm::ivec2 const& hex, uint32_t treeIndex, float dm
 	if(treeIndex >= state->trees.size())
 		return;
 
+	bool wasStanding = state->trees[treeIndex].health > 0.0f;
 	state->trees[treeIndex].health -= dmg;
-	state->trees[treeIndex].shake = 0.4f;
+	m_treeInstances.shake(state->trees[treeIndex].instance, vegetationTime());
 
 	glm::vec2 to = state->trees[treeIndex].worldOffset;
 	glm::vec3 two{to.x, -0.25f ,to.y};
@@ -1526,8 +1568,12 @@ void e2::HexGrid::damageTree(glm::ivec2 const& hex, uint32_t treeIndex, float dm
 
 	if (state->trees[treeIndex].health <= 0.0f)
 	{
+		if (wasStanding)
+			m_treeInstances.fall(state->trees[treeIndex].instance, vegetationTime());
+
 		audioManager()->playOneShot(m_woodDieSound, 1.2f, 0.25f, e2::Hex(hex).localCoords());
 		audioManager()->playOneShot(m_treeFallSound, 1.0f, 1.0f, e2::Hex(hex).localCoords());
+		game()->collisionWorld()->invalidateStatic(hex);
 	}
 	
 }
@@ -1561,16 +1607,9 @@ e2::UnpackedForestState* e2::HexGrid::unpackForestState(glm::ivec2 const& hex)
 	uint32_t i = 0;
 	for (e2::TreeState& originalTree : originalForest->trees)
 	{
-		e2::MeshProxyConfiguration treeCfg;
-		e2::MeshLodConfiguration lodCfg;
-		lodCfg.mesh = m_treeMeshes[originalTree.meshIndex];
-		lodCfg.materials.push(m_treeMaterialProxy);
-		treeCfg.lods.push(lodCfg);
-
 		e2::UnpackedTreeState newTree;
 		newTree.meshIndex = originalTree.meshIndex;
 		newTree.totalLumber = (uint32_t)(e2::randomFloat(3.5f * originalTree.scale, 4.5 * originalTree.scale)/ e2::treeScale);
-		newTree.mesh = e2::create<e2::MeshProxy>(gameSession(), treeCfg);
 
 		glm::vec3 fallDirection = glm::rotate(glm::identity<glm::quat>(), glm::radians(e2::randomFloat(-45.0f, 45.0f)), e2::worldUpf()) * -e2::worldRightf();
 		newTree.fallDir = glm::vec2(fallDirection.x, fallDirection.z);
@@ -1580,15 +1619,6 @@ e2::UnpackedForestState* e2::HexGrid::unpackForestState(glm::ivec2 const& hex)
 		glm::vec2 treeOffset = e2::Hex(hex).planarCoords() + originalTree.localOffset(tile, originalForest);
 
 		newTree.worldOffset = treeOffset;
-
-		glm::mat4 treeTranslation = glm::translate(glm::identity<glm::mat4>(), glm::vec3(treeOffset.x, 0.0f, treeOffset.y));
-		glm::mat4 treeScale = glm::scale(glm::identity<glm::mat4>(), glm::vec3(newTree.scale));
-		glm::mat4 treeRotation = glm::rotate(glm::identity<glm::mat4>(), newTree.rotation, e2::worldUpf());
-
-		glm::mat4 treeRotationFix = glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f), e2::worldRightf());
-
-		newTree.mesh->modelMatrix = treeTranslation * treeRotation * treeRotationFix * treeScale;
-		newTree.mesh->modelMatrixDirty = { true };
 		newForest.trees.push_back(newTree);
 
 
@@ -1610,6 +1640,15 @@ e2::UnpackedForestState* e2::HexGrid::unpackForestState(glm::ivec2 const& hex)
 
 	m_unpackedForests[hex] = newForest;
 
+	e2::ChunkState* chunk = getChunk(chunkIndexFromPlanarCoords(e2::Hex(hex).planarCoords()));
+	if (chunk && chunk->visibilityState)
+	{
+		for (e2::UnpackedTreeState& tree : m_unpackedForests[hex].trees)
+			showTree(tree);
+	}
+
+	game()->collisionWorld()->invalidateStatic(hex);
+
 	return getUnpackedForestState(hex);
 
 }
@@ -1631,108 +1670,58 @@ void e2::HexGrid::updateUnpackedForests()
 		uint32_t deadTrees = 0;
 		for (auto& t : pair.second.trees)
 		{
+			// standing trees only change when they're hit, and the vertex stage animates shakes and falls from when they started
+			if (t.health > 0.0f)
+				continue;
 
 			glm::vec3 fallRot = glm::vec3(t.fallDir.y, 0.0f, -t.fallDir.x);
 
-			if (t.health <= 0.0f)
+			if (t.fallTime <= 0.0f)
 			{
-				if (t.fallTime <= 0.0f)
+				if (t.killTime > 0.0f)
 				{
-					if (t.killTime > 0.0f)
-					{
 
-						t.killTime -= game()->timeDelta();
+					t.killTime -= game()->timeDelta();
 
-						if (t.killTime < 0.4f && t.mesh)
-						{
-							e2::destroy(t.mesh);
-							t.mesh = nullptr;
-						}
+					if (t.killTime < 0.4f && !t.removed)
+					{
+						hideTree(t);
+						t.removed = true;
+					}
 
-						if (t.killTime < 0.3f)
+					if (t.killTime < 0.3f)
+					{
+						
+						if (t.spawnedLumber < t.totalLumber)
 						{
-							
-							if (t.spawnedLumber < t.totalLumber)
+							float nextTimeRef = (1.0f - (((float)t.spawnedLumber + 1.0f) / (float)t.totalLumber)) * 0.3f;
+							if (t.killTime < nextTimeRef)
 							{
-								float nextTimeRef = (1.0f - (((float)t.spawnedLumber + 1.0f) / (float)t.totalLumber)) * 0.3f;
-								if (t.killTime < nextTimeRef)
-								{
-									e2::ItemEntity* newLumber = game()->spawnEntity("lumber", glm::vec3(t.worldOffset.x, 0.0f, t.worldOffset.y) + fallRot * (t.spawnedLumber * 0.2f))->cast<e2::ItemEntity>();
-									newLumber->playSound("S_Wood_Spawn.e2a", 1.0f, 1.0f);
-									t.spawnedLumber++;
-								}
+								e2::ItemEntity* newLumber = game()->spawnEntity("lumber", glm::vec3(t.worldOffset.x, 0.0f, t.worldOffset.y) + fallRot * (t.spawnedLumber * 0.2f))->cast<e2::ItemEntity>();
+								newLumber->playSound("S_Wood_Spawn.e2a", 1.0f, 1.0f);
+								t.spawnedLumber++;
 							}
 						}
 					}
-					else
-					{
-						deadTrees++;
-					}
 				}
 				else
 				{
-					t.fallTime -= game()->timeDelta();
-										
-					glm::mat4 treeTranslation = glm::translate(glm::identity<glm::mat4>(), glm::vec3(t.worldOffset.x, 0.0f, t.worldOffset.y));
-					glm::mat4 treeScale = glm::scale(glm::identity<glm::mat4>(), glm::vec3(t.scale));
-					glm::mat4 treeRotation = glm::rotate(glm::identity<glm::mat4>(), t.rotation, e2::worldUpf());
-
-					glm::mat4 treeRotationFix = glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f), e2::worldRightf());
-
-
-					glm::mat4 shakeRotation = glm::identity<glm::mat4>();
-					if (t.shake >= 0.0f)
-					{
-						float shakeDelta = glm::clamp(t.shake / 0.4f, 0.0f, 1.0f);
-						glm::vec2 shakeDirection = e2::randomOnUnitCircle();
-						shakeRotation = glm::rotate(glm::identity<glm::mat4>(), glm::radians(4.0f * shakeDelta), glm::vec3(shakeDirection.x, 0.0f, shakeDirection.y));
-						t.shake -= game()->timeDelta();
-					}
-
-					float fallAlpha = (e2::maxTreeFallTime - glm::clamp(t.fallTime, 0.0f, e2::maxTreeFallTime)) / e2::maxTreeFallTime;
-					float fallDelta = glm::circularEaseIn(glm::clamp(fallAlpha, 0.0f, 1.0f));
-					glm::mat4 fallRotation = glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f * fallDelta), glm::vec3(t.fallDir.x, 0.0f, t.fallDir.y));
-
-					t.mesh->modelMatrix = treeTranslation * fallRotation * shakeRotation * treeRotation * treeRotationFix * treeScale;
-					t.mesh->modelMatrixDirty = true;
-
-					m_cutMask.push({ t.worldOffset + glm::vec2{ fallRot.x, fallRot.z } * (0.5f * fallDelta), 0.1f + 0.25f * fallDelta });
-
-					if (t.fallTime <= 0.0f)
-					{
-						game()->addScreenShake(0.05f);
-					}
+					deadTrees++;
 				}
 			}
 			else
 			{
-				if (t.shake > 0.0f)
-				{
-					glm::mat4 treeTranslation = glm::translate(glm::identity<glm::mat4>(), glm::vec3(t.worldOffset.x, 0.0f, t.worldOffset.y));
-					glm::mat4 treeScale = glm::scale(glm::identity<glm::mat4>(), glm::vec3(t.scale));
-					glm::mat4 treeRotation = glm::rotate(glm::identity<glm::mat4>(), t.rotation, e2::worldUpf());
-
-					glm::mat4 treeRotationFix = glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f), e2::worldRightf());
+				t.fallTime -= game()->timeDelta();
 
-					float shakeDelta = glm::clamp(t.shake / 0.4f, 0.0f, 1.0f);
-					glm::vec2 shakeDirection = e2::randomOnUnitCircle();
-					glm::mat4 shakeRotation = glm::rotate(glm::identity<glm::mat4>(), glm::radians(4.0f * shakeDelta), glm::vec3(shakeDirection.x, 0.0f, shakeDirection.y));
+				// same curve as forest.vertex.glsl, to cut the grass where the crown lands
+				float fallAlpha = (e2::maxTreeFallTime - glm::clamp(t.fallTime, 0.0f, e2::maxTreeFallTime)) / e2::maxTreeFallTime;
+				float fallDelta = glm::circularEaseIn(glm::clamp(fallAlpha, 0.0f, 1.0f));
 
-					t.mesh->modelMatrix = treeTranslation * shakeRotation * treeRotation * treeRotationFix * treeScale;
-					t.mesh->modelMatrixDirty = true;
+				m_cutMask.push({ t.worldOffset + glm::vec2{ fallRot.x, fallRot.z } * (0.5f * fallDelta), 0.1f + 0.25f * fallDelta });
 
-					t.shake -= game()->timeDelta();
-					if (t.shake <= 0.0f)
-					{
-						glm::mat4 treeTranslation = glm::translate(glm::identity<glm::mat4>(), glm::vec3(t.worldOffset.x, 0.0f, t.worldOffset.y));
-						glm::mat4 treeScale = glm::scale(glm::identity<glm::mat4>(), glm::vec3(t.scale));
-						glm::mat4 treeRotation = glm::rotate(glm::identity<glm::mat4>(), t.rotation, e2::worldUpf());
-
-						glm::mat4 treeRotationFix = glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f), e2::worldRightf());
-
-						t.mesh->modelMatrix = treeTranslation * treeRotation * treeRotationFix * treeScale;
-						t.mesh->modelMatrixDirty = true;
-					}
+				if (t.fallTime <= 0.0f)
+				{
+					game()->addScreenShake(0.05f);
 				}
 			}
 		}
@@ -1749,6 +1738,68 @@ void e2::HexGrid::updateUnpackedForests()
 	}
 }
 
+void e2::HexGrid::showTree(e2::UnpackedTreeState& tree)
+{
+	if (tree.removed || tree.instance != UINT32_MAX)
+		return;
+
+	float fallAngle = glm::atan(tree.fallDir.y, tree.fallDir.x);
+	tree.instance = m_treeInstances.add(uint8_t(tree.meshIndex), tree.worldOffset, tree.rotation, tree.scale, fallAngle);
+	if (tree.instance == UINT32_MAX)
+	{
+		LogWarning("out of tree instances for mesh {}", tree.meshIndex);
+		return;
+	}
+
+	// coming back into view while falling, pick up where it would be by now
+	if (tree.health <= 0.0f)
+	{
+		float fallen = e2::maxTreeFallTime - glm::clamp(tree.fallTime, 0.0f, e2::maxTreeFallTime);
+		m_treeInstances.fall(tree.instance, glm::max(vegetationTime() - fallen, 0.0f));
+	}
+}
+
+void e2::HexGrid::hideTree(e2::UnpackedTreeState& tree)
+{
+	m_treeInstances.remove(tree.instance);
+	tree.instance = UINT32_MAX;
+}
+
+void e2::HexGrid::showUnpackedTrees(glm::ivec2 const& chunkIndex, bool show)
+{
+	for (auto& [hex, forest] : m_unpackedForests)
+	{
+		if (chunkIndexFromPlanarCoords(e2::Hex(hex).planarCoords()) != chunkIndex)
+			continue;
+
+		for (e2::UnpackedTreeState& tree : forest.trees)
+		{
+			if (show)
+				showTree(tree);
+			else
+				hideTree(tree);
+		}
+	}
+}
+
+void e2::HexGrid::syncTreeInstances()
+{
+	for (uint8_t i = 0; i < e2::maxNumVegetationMeshes; i++)
+	{
+		if (!m_treeInstances.dirty(i))
+			continue;
+
+		m_treeInstanceProxies[i]->setInstances(m_treeInstances.instances(i), m_treeInstances.numInstances(i));
+		m_treeInstances.markClean(i);
+	}
+}
+
+float e2::HexGrid::vegetationTime()
+{
+	e2::Renderer* renderer = gameSession()->renderer();
+	return renderer ? renderer->time() : 0.0f;
+}
+
 e2::MeshProxy* e2::HexGrid::createGrassProxy(e2::TileData* tileData, glm::ivec2 const& hex)
 {
 	if (!tileData)
@@ -1793,155 +1844,948 @@ e2::TileData e2::HexGrid::calculateTileData(glm::ivec2 const& hex)
 	return newTileData;
 }
 
-e2::TileData e2::HexGrid::getTileData(glm::ivec2 const& hex)
+void e2::HexGrid::calculateTileDataBatch(glm::ivec2 const* hexes, e2::TileData* outTiles, uint32_t count)
 {
-	e2::TileData* src = getExistingTileData(hex);
-	if (src)
-		return *src;
+	// one bordered chunk per block, so chunk generation is a single pass
+	constexpr uint32_t blockSize = e2::hexChunkBorderTiles;
 
-	return calculateTileData(hex);
-}
+	float xs[blockSize];
+	float ys[blockSize];
+	float heights[blockSize];
+	float biomes[blockSize];
+	float forests[blockSize];
+	glm::vec2 planar[blockSize];
 
-e2::MeshProxy* e2::HexGrid::createForestProxyForTile(e2::TileData* tileData, glm::ivec2 const& hex)
-{
-	if (!tileData)
-		return nullptr;
+	for (uint32_t blockOffset = 0; blockOffset < count; blockOffset += blockSize)
+	{
+		uint32_t blockCount = glm::min(blockSize, count - blockOffset);
+		glm::ivec2 const* blockHexes = hexes + blockOffset;
+		e2::TileData* blockTiles = outTiles + blockOffset;
 
-	if (!tileData->isForested() || tileData->forestIndex < 0)
-		return nullptr;
-		
-	e2::MeshProxyConfiguration proxyConfig{
-		.lods = {
+		for (uint32_t i = 0; i < blockCount; i++)
+			planar[i] = e2::Hex(blockHexes[i]).planarCoords();
+
+		// evaluate every noise layer for the whole block, we need forest for most land anyway and it's cheaper than branching per tile
+		auto sampleLayer = [&](glm::vec2 const& offset, float scale, float* outSamples) {
+			for (uint32_t i = 0; i < blockCount; i++)
 			{
-				.maxDistance = 0.0f,
-				.mesh = m_forestStates[tileData->forestIndex].mesh,
-				.materials = {m_treeMaterialProxy}
+				glm::vec2 p = (planar[i] + offset) * scale;
+				xs[i] = p.x;
+				ys[i] = p.y;
 			}
-		}
-	};
 
-	e2::MeshProxy* newMeshProxy = e2::create<e2::MeshProxy>(gameSession(), proxyConfig);
-	newMeshProxy->modelMatrix = glm::translate(glm::mat4(1.0f), e2::Hex(hex).localCoords());
-	newMeshProxy->modelMatrix = glm::rotate(newMeshProxy->modelMatrix, tileData->forestRotation, glm::vec3(e2::worldUp()));
-	newMeshProxy->modelMatrixDirty = { true };
+			e2::simplexBatch(xs, ys, outSamples, blockCount);
 
-	return newMeshProxy;
+			for (uint32_t i = 0; i < blockCount; i++)
+				outSamples[i] = outSamples[i] * 0.5f + 0.5f;
+		};
+
+		sampleLayer(::heightNoiseOffset, ::heightNoiseScale, heights);
+		sampleLayer(::biomeNoiseOffset, ::biomeNoiseScale, biomes);
+		sampleLayer(::forestNoiseOffset, ::forestNoiseScale, forests);
+
+		for (uint32_t i = 0; i < blockCount; i++)
+		{
+			glm::ivec2 const& hex = blockHexes[i];
+			e2::TileData newTileData;
+			::applyBiome(biomes[i], newTileData.flags);
+			::applyFeaturesAndWater(heights[i], forests[i], newTileData.flags);
+			newTileData.forestIndex = getForestIndexForFlags(newTileData.flags);
+			newTileData.forestRotation = glm::radians(hex.x * hex.y * 1.12f);
+			blockTiles[i] = newTileData;
+		}
+	}
 }
 
-size_t e2::HexGrid::discover(glm::ivec2 const& hex)
+void e2::HexGrid::calculateChunkTileData(glm::ivec2 const& chunkIndex, e2::TileData* outTiles)
 {
-	// there are no checks to see if hex is already discovered, use with care!! 
-#if defined(E2_DEVELOPMENT)
-	if (m_tileIndex.contains(hex))
-	{
-		LogError("DISCOVERING ALREADY DISCOVERED TILE, EXPECT BREAKAGE");
-	}
-#endif
-	m_tiles.push_back(calculateTileData(hex));
-	m_tileVisibility.push_back(0);
-	m_tileIndex[hex] = m_tiles.size() - 1;
+	glm::ivec2 chunkTileOffset = chunkIndex * glm::ivec2(e2::hexChunkResolution);
 
-	glm::ivec2 chunkIndex = chunkIndexFromPlanarCoords(e2::Hex(hex).planarCoords());
-	auto chunkFinder = m_discoveredChunks.find(chunkIndex);
-	if (chunkFinder == m_discoveredChunks.end())
+	glm::ivec2 hexes[e2::hexChunkBorderTiles];
+	uint32_t i = 0;
+	for (int32_t y = -1; y < (int32_t)e2::hexChunkResolution + 1; y++)
 	{
-		m_discoveredChunks.insert(chunkIndex);
-		
-		e2::Aabb2D chunkAabb = getChunkAabb(chunkIndex);
-		for (glm::vec2 p : chunkAabb.points())
-			m_discoveredChunksAABB.push(p);
-
+		for (int32_t x = -1; x < (int32_t)e2::hexChunkResolution + 1; x++)
+		{
+			hexes[i++] = chunkTileOffset + glm::ivec2(x, y);
+		}
 	}
-	
-	
-	e2::TileData* tileData = &m_tiles[m_tiles.size() - 1];
 
-	flagChunkOutdated(chunkIndex);
-	//
-	//if (tileData->empireId < 255)
-	//{
-	//	game()->discoverEmpire(tileData->empireId);
-	//}
+	calculateTileDataBatch(hexes, outTiles, e2::hexChunkBorderTiles);
+}
 
+e2::TileData e2::HexGrid::getTileData(glm::ivec2 const& hex)
+{
+	e2::TileData* src = getExistingTileData(hex);
+	if (src)
+		return *src;
 
-	return m_tiles.size() - 1;
+	return getProceduralTileData(hex);
 }
 
-size_t e2::HexGrid::getTileIndexFromHex(glm::ivec2 const& hex)
+namespace
 {
-	size_t tileIndex = 0;
-
-	auto finder = m_tileIndex.find(hex);
-	if (finder == m_tileIndex.end())
+	uint32_t tileCacheSlotIndex(glm::ivec2 const& chunkIndex)
 	{
-		tileIndex = discover(hex);
+		uint32_t h = uint32_t(chunkIndex.x) * 73856093u ^ uint32_t(chunkIndex.y) * 19349663u;
+		h ^= h >> 16;
+		return h & (e2::maxNumCachedChunks - 1);
 	}
-	else
-	{
-		tileIndex = finder->second;
-	}
-
-	return tileIndex;
 }
 
-e2::TileData* e2::HexGrid::getExistingTileData(glm::ivec2 const& hex)
+e2::TileData e2::HexGrid::getProceduralTileData(glm::ivec2 const& hex)
 {
-	auto finder = m_tileIndex.find(hex);
-	if (finder == m_tileIndex.end())
-		return nullptr;
+	e2::TileData returner;
+	if (m_tileCache.get(hex, returner))
+		return returner;
 
-	return &m_tiles[finder->second];
+	return calculateTileData(hex);
 }
 
-
-e2::TileData& e2::HexGrid::getTileFromIndex(size_t index)
+bool e2::ProceduralTileCache::get(glm::ivec2 const& hex, e2::TileData& outTile)
 {
-	static TileData empty;
-	if (index > m_tiles.size())
+	uint32_t localIndex;
+	glm::ivec2 chunkIndex = e2::HexGrid::chunkIndexFromOffsetCoords(hex, localIndex);
+	e2::TileCacheSlot& slot = m_slots[::tileCacheSlotIndex(chunkIndex)];
+
+	uint32_t sequenceBefore = slot.sequence.load(std::memory_order_acquire);
+	bool hit = (sequenceBefore & 1) == 0 && slot.valid && slot.chunkIndex == chunkIndex;
+	if (hit)
 	{
-		LogError("out of range");
-		return empty;
+		outTile = slot.tiles[localIndex];
+
+		// if the mainthread touched the slot while we copied, the copy may be torn
+		std::atomic_thread_fence(std::memory_order_acquire);
+		hit = slot.sequence.load(std::memory_order_relaxed) == sequenceBefore;
 	}
-	return m_tiles[index];
+
+	if (hit)
+		m_hits.fetch_add(1, std::memory_order_relaxed);
+	else
+		m_misses.fetch_add(1, std::memory_order_relaxed);
+
+	return hit;
 }
 
-void e2::HexGrid::clearAllChunks()
+void e2::ProceduralTileCache::fill(glm::ivec2 const& chunkIndex, e2::TileData const* tiles)
 {
-	auto chunkIndexCopy = m_chunkIndex;
-	for (auto [chunkIndex, chunkState] : chunkIndexCopy)
+	e2::TileCacheSlot& slot = m_slots[::tileCacheSlotIndex(chunkIndex)];
+	if (slot.valid && slot.chunkIndex != chunkIndex)
+		m_evictions++;
+
+	slot.sequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.valid = true;
+	slot.chunkIndex = chunkIndex;
+	for (uint32_t i = 0; i < e2::hexChunkResolution * e2::hexChunkResolution; i++)
 	{
-		nukeChunk(chunkState);
+		slot.tiles[i] = tiles[i];
+		slot.tiles[i].forestProxy = nullptr;
 	}
 
-	m_chunkIndex.clear();
+	slot.sequence.fetch_add(1, std::memory_order_release);
+	m_fills++;
 }
 
-uint32_t e2::HexGrid::numChunks()
+void e2::ProceduralTileCache::evict(glm::ivec2 const& chunkIndex)
 {
-	return (uint32_t)m_chunkIndex.size();
-}
+	e2::TileCacheSlot& slot = m_slots[::tileCacheSlotIndex(chunkIndex)];
+	if (!slot.valid || slot.chunkIndex != chunkIndex)
+		return;
 
-uint32_t e2::HexGrid::numVisibleChunks()
-{
-	return (uint32_t)m_visibleChunks.size();
-}
+	slot.sequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.valid = false;
+	slot.sequence.fetch_add(1, std::memory_order_release);
 
-uint32_t e2::HexGrid::numJobsInFlight()
-{
-	return (uint32_t)m_streamingChunks.size();
+	m_evictions++;
 }
 
-uint32_t e2::HexGrid::numJobsInQueue()
+e2::TileCacheStats e2::ProceduralTileCache::stats() const
 {
-	return (uint32_t)m_queuedChunks.size();
+	e2::TileCacheStats returner;
+	returner.hits = m_hits.load(std::memory_order_relaxed);
+	returner.misses = m_misses.load(std::memory_order_relaxed);
+	returner.fills = m_fills;
+	returner.evictions = m_evictions;
+	return returner;
 }
 
-void e2::HexGrid::flagChunkOutdated(glm::ivec2 const& chunkIndex)
+void e2::ProceduralTileCache::resetStats()
 {
-	m_outdatedChunks.insert(getOrCreateChunk(chunkIndex));
+	m_hits.store(0, std::memory_order_relaxed);
+	m_misses.store(0, std::memory_order_relaxed);
+	m_fills = 0;
+	m_evictions = 0;
 }
 
-double e2::HexGrid::highLoadTime()
+bool e2::testProceduralTileCache(uint32_t numIterations)
+{
+	constexpr int32_t res = e2::hexChunkResolution;
+	constexpr uint32_t tilesPerChunk = e2::hexChunkResolution * e2::hexChunkResolution;
+
+	// fixed seed, so a failure replays exactly. minstd is fully specified by the standard, unlike the distributions
+	std::minstd_rand random(0x0027);
+	auto randomBelow = [&random](uint32_t count) {
+		return uint32_t(random() % count);
+	};
+
+	// a few chunks around the origin, each paired with a chunk further out that shares its slot, so fills evict each other
+	constexpr uint32_t numPairs = 6;
+	constexpr uint32_t numChunks = numPairs * 2;
+	glm::ivec2 chunks[numChunks];
+	uint32_t slots[numChunks];
+	for (uint32_t i = 0; i < numPairs; i++)
+	{
+		chunks[i] = glm::ivec2(int32_t(i % 3) - 1, int32_t(i / 3) - 1);
+		slots[i] = ::tileCacheSlotIndex(chunks[i]);
+
+		glm::ivec2 alias = chunks[i] + glm::ivec2(100, 0);
+		while (::tileCacheSlotIndex(alias) != slots[i])
+			alias.x++;
+
+		chunks[numPairs + i] = alias;
+		slots[numPairs + i] = slots[i];
+	}
+
+	// tiles name their chunk, index and the fill they came from, redundantly, so foreign and torn tiles both show up
+	e2::MeshProxy* const strayProxy = reinterpret_cast<e2::MeshProxy*>(uintptr_t(0x10));
+	auto makeTiles = [strayProxy](uint32_t chunk, uint32_t generation, e2::TileData* outTiles) {
+		for (uint32_t i = 0; i < tilesPerChunk; i++)
+		{
+			outTiles[i].flags = e2::TileFlags(uint8_t(generation));
+			outTiles[i].forestIndex = int32_t(chunk * tilesPerChunk + i);
+			outTiles[i].forestRotation = float(generation);
+			outTiles[i].forestProxy = strayProxy;
+		}
+	};
+	auto isIntact = [](e2::TileData const& tile, uint32_t chunk, uint32_t localIndex) {
+		return tile.forestIndex == int32_t(chunk * tilesPerChunk + localIndex)
+			&& uint8_t(tile.flags) == uint8_t(uint32_t(tile.forestRotation))
+			&& tile.forestProxy == nullptr;
+	};
+
+	e2::TileData tiles[tilesPerChunk];
+	uint32_t generation{};
+
+	// single threaded, every lookup checked against which fill each chunk should still hold
+	{
+		e2::ProceduralTileCache cache;
+		int64_t expectedGeneration[numChunks];
+		for (int64_t& g : expectedGeneration)
+			g = -1;
+
+		e2::TileCacheStats expectedStats;
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+		{
+			uint32_t chunk = randomBelow(numChunks);
+			uint32_t op = randomBelow(100);
+			if (op < 20)
+			{
+				generation++;
+				makeTiles(chunk, generation, tiles);
+				cache.fill(chunks[chunk], tiles);
+				expectedStats.fills++;
+
+				for (uint32_t other = 0; other < numChunks; other++)
+				{
+					if (other != chunk && slots[other] == slots[chunk] && expectedGeneration[other] >= 0)
+					{
+						expectedGeneration[other] = -1;
+						expectedStats.evictions++;
+					}
+				}
+				expectedGeneration[chunk] = generation;
+			}
+			else if (op < 30)
+			{
+				cache.evict(chunks[chunk]);
+				if (expectedGeneration[chunk] >= 0)
+				{
+					expectedGeneration[chunk] = -1;
+					expectedStats.evictions++;
+				}
+			}
+			else
+			{
+				uint32_t localIndex = randomBelow(tilesPerChunk);
+				glm::ivec2 hex = chunks[chunk] * res + glm::ivec2(localIndex % res, localIndex / res);
+
+				e2::TileData tile;
+				bool hit = cache.get(hex, tile);
+				bool expectHit = expectedGeneration[chunk] >= 0;
+				if (hit != expectHit)
+				{
+					LogError("tile cache: lookup for {} was a {}, expected a {} after {} iterations", hex, hit ? "hit" : "miss", expectHit ? "hit" : "miss", iteration);
+					return false;
+				}
+
+				if (hit && (!isIntact(tile, chunk, localIndex) || int64_t(tile.forestRotation) != expectedGeneration[chunk]))
+				{
+					LogError("tile cache: wrong tile for {} after {} iterations", hex, iteration);
+					return false;
+				}
+
+				if (hit)
+					expectedStats.hits++;
+				else
+					expectedStats.misses++;
+			}
+		}
+
+		e2::TileCacheStats stats = cache.stats();
+		if (stats.hits != expectedStats.hits || stats.misses != expectedStats.misses || stats.fills != expectedStats.fills || stats.evictions != expectedStats.evictions)
+		{
+			LogError("tile cache: stats {}/{}/{}/{} (hits/misses/fills/evictions), expected {}/{}/{}/{}", stats.hits, stats.misses, stats.fills, stats.evictions,
+				expectedStats.hits, expectedStats.misses, expectedStats.fills, expectedStats.evictions);
+			return false;
+		}
+	}
+
+	// mainthread keeps refilling and evicting one pair of aliasing chunks while readers look up. A hit must never be torn, nor come from the other chunk
+	{
+		e2::ProceduralTileCache cache;
+		constexpr uint32_t numReaders = 2;
+		std::atomic<bool> done{};
+		std::atomic<uint64_t> numLookups{};
+		std::atomic<uint64_t> numBadHits{};
+
+		std::vector<std::thread> readers;
+		for (uint32_t r = 0; r < numReaders; r++)
+		{
+			readers.emplace_back([&, r]() {
+				std::minstd_rand readerRandom(0x0027 + r + 1);
+				uint64_t lookups{};
+				uint64_t badHits{};
+				while (!done.load(std::memory_order_relaxed))
+				{
+					uint32_t chunk = uint32_t(readerRandom() % 2) * numPairs;
+					uint32_t localIndex = uint32_t(readerRandom() % tilesPerChunk);
+					glm::ivec2 hex = chunks[chunk] * res + glm::ivec2(localIndex % res, localIndex / res);
+
+					e2::TileData tile;
+					if (cache.get(hex, tile) && !isIntact(tile, chunk, localIndex))
+						badHits++;
+					lookups++;
+				}
+				numLookups += lookups;
+				numBadHits += badHits;
+			});
+		}
+
+		for (uint32_t iteration = 0; iteration < numIterations * 16; iteration++)
+		{
+			uint32_t chunk = randomBelow(2) * numPairs;
+			if (randomBelow(4) == 0)
+			{
+				cache.evict(chunks[chunk]);
+			}
+			else
+			{
+				generation++;
+				makeTiles(chunk, generation, tiles);
+				cache.fill(chunks[chunk], tiles);
+			}
+		}
+
+		done = true;
+		for (std::thread& reader : readers)
+			reader.join();
+
+		e2::TileCacheStats stats = cache.stats();
+		if (numBadHits > 0 || stats.hits + stats.misses != numLookups)
+		{
+			LogError("tile cache: {} torn or foreign hits in {} concurrent lookups ({} counted)", numBadHits.load(), numLookups.load(), stats.hits + stats.misses);
+			return false;
+		}
+	}
+
+	// real tiles, served from the cache must equal calculated. Also gives an idea of what a hit saves
+	{
+		e2::ProceduralTileCache cache;
+		constexpr uint32_t numLookups = 1u << 16;
+		glm::ivec2 const chunkIndex{ 3, -2 };
+		for (uint32_t i = 0; i < tilesPerChunk; i++)
+			tiles[i] = e2::HexGrid::calculateTileData(chunkIndex * res + glm::ivec2(i % res, i / res));
+		cache.fill(chunkIndex, tiles);
+
+		e2::Timer cachedTimer;
+		for (uint32_t i = 0; i < numLookups; i++)
+		{
+			uint32_t localIndex = i % tilesPerChunk;
+			glm::ivec2 hex = chunkIndex * res + glm::ivec2(localIndex % res, localIndex / res);
+
+			e2::TileData tile;
+			if (!cache.get(hex, tile) || tile.flags != tiles[localIndex].flags || tile.forestIndex != tiles[localIndex].forestIndex || tile.forestRotation != tiles[localIndex].forestRotation)
+			{
+				LogError("tile cache: cached tile for {} differs from calculateTileData", hex);
+				return false;
+			}
+		}
+		double cachedNs = cachedTimer.seconds() * 1e9 / double(numLookups);
+
+		e2::Timer calculatedTimer;
+		for (uint32_t i = 0; i < numLookups; i++)
+		{
+			uint32_t localIndex = i % tilesPerChunk;
+			glm::ivec2 hex = chunkIndex * res + glm::ivec2(localIndex % res, localIndex / res);
+
+			e2::TileData tile = e2::HexGrid::calculateTileData(hex);
+			if (tile.flags != tiles[localIndex].flags || tile.forestIndex != tiles[localIndex].forestIndex || tile.forestRotation != tiles[localIndex].forestRotation)
+			{
+				LogError("tile cache: calculateTileData for {} is not deterministic", hex);
+				return false;
+			}
+		}
+		double calculatedNs = calculatedTimer.seconds() * 1e9 / double(numLookups);
+
+		LogNotice("tile cache: {} iterations and {} fills passed, lookups take {:.1f}ns cached vs {:.1f}ns calculated", numIterations, generation, cachedNs, calculatedNs);
+	}
+
+	return true;
+}
+
+bool e2::testTileDataBatch(uint32_t numHexes)
+{
+	constexpr int32_t res = e2::hexChunkResolution;
+
+	auto sameTile = [](e2::TileData const& a, e2::TileData const& b) {
+		return a.flags == b.flags && a.forestIndex == b.forestIndex && a.forestProxy == b.forestProxy
+			&& std::bit_cast<uint32_t>(a.forestRotation) == std::bit_cast<uint32_t>(b.forestRotation);
+	};
+	auto logMismatch = [](char const* what, glm::ivec2 const& hex, e2::TileData const& got, e2::TileData const& expected) {
+		LogError("tile data: {} gave flags {:x}, forest {}, rotation {:a} for {}, calculateTileData gave {:x}, {}, {:a} ({})", what,
+			uint16_t(got.flags), got.forestIndex, got.forestRotation, hex, uint16_t(expected.flags), expected.forestIndex, expected.forestRotation, e2::simplexPath());
+	};
+
+	// origin, both sides of chunk borders, and far out. forestRotation multiplies x and y, so stay clear of overflowing that
+	int32_t const edges[] = { 0, 1, -1, res - 1, res, -res, -res - 1, 4095, -4096, 1 << 15, -(1 << 15) };
+	std::vector<glm::ivec2> hexes;
+	for (int32_t x : edges)
+	{
+		for (int32_t y : edges)
+			hexes.push_back({ x, y });
+	}
+
+	// fixed seed, so a failure replays exactly. minstd is fully specified by the standard, unlike the distributions
+	std::minstd_rand random(0x0026);
+	int32_t const ranges[] = { 64, 4096, 1 << 15 };
+	for (uint32_t i = 0; i < numHexes; i++)
+	{
+		int32_t range = ranges[i % 3];
+		int32_t x = int32_t(random() % uint32_t(range * 2)) - range;
+		int32_t y = int32_t(random() % uint32_t(range * 2)) - range;
+		hexes.push_back({ x, y });
+	}
+
+	uint32_t numTotal = uint32_t(hexes.size());
+	std::vector<e2::TileData> expected(numTotal);
+	for (uint32_t i = 0; i < numTotal; i++)
+		expected[i] = e2::HexGrid::calculateTileData(hexes[i]);
+
+	// everything at once, odd sizes for the simd tails, and sizes around one block so both sides of a block edge are covered
+	uint32_t const batchSizes[] = { 0, 1, 2, 3, 5, 7, e2::simplexLaneWidth + 1, e2::simplexLaneWidth * 2 + 3,
+		e2::hexChunkBorderTiles - 1, e2::hexChunkBorderTiles, e2::hexChunkBorderTiles + 1, e2::hexChunkBorderTiles * 2 + 3 };
+	std::vector<e2::TileData> batch(numTotal);
+	for (uint32_t batchSize : batchSizes)
+	{
+		uint32_t size = batchSize > 0 ? batchSize : numTotal;
+		for (uint32_t offset = 0; offset < numTotal; offset += size)
+			e2::HexGrid::calculateTileDataBatch(hexes.data() + offset, batch.data() + offset, glm::min(size, numTotal - offset));
+
+		for (uint32_t i = 0; i < numTotal; i++)
+		{
+			if (!sameTile(batch[i], expected[i]))
+			{
+				logMismatch("batch", hexes[i], batch[i], expected[i]);
+				return false;
+			}
+		}
+	}
+
+	// whole chunks, border included, like chunk streaming asks for them
+	constexpr uint32_t numChunks = 64;
+	e2::TileData chunkTiles[e2::hexChunkBorderTiles];
+	for (uint32_t i = 0; i < numChunks; i++)
+	{
+		glm::ivec2 chunkIndex = i < 9 ? glm::ivec2(int32_t(i % 3) - 1, int32_t(i / 3) - 1) : glm::ivec2(int32_t(random() % 2048) - 1024, int32_t(random() % 2048) - 1024);
+		e2::HexGrid::calculateChunkTileData(chunkIndex, chunkTiles);
+
+		for (uint32_t t = 0; t < e2::hexChunkBorderTiles; t++)
+		{
+			glm::ivec2 hex = chunkIndex * res + glm::ivec2(int32_t(t % e2::hexChunkBorderResolution) - 1, int32_t(t / e2::hexChunkBorderResolution) - 1);
+			e2::TileData tile = e2::HexGrid::calculateTileData(hex);
+			if (!sameTile(chunkTiles[t], tile))
+			{
+				logMismatch("chunk", hex, chunkTiles[t], tile);
+				return false;
+			}
+		}
+	}
+
+	LogNotice("tile data: {} hexes and {} chunks bit-identical to calculateTileData ({})", numTotal, numChunks, e2::simplexPath());
+	return true;
+}
+
+e2::MeshProxy* e2::HexGrid::createForestProxyForTile(e2::TileData* tileData, glm::ivec2 const& hex)
+{
+	if (!tileData)
+		return nullptr;
+
+	if (!tileData->isForested() || tileData->forestIndex < 0)
+		return nullptr;
+		
+	e2::MeshProxyConfiguration proxyConfig{
+		.lods = {
+			{
+				.maxDistance = 0.0f,
+				.mesh = m_forestStates[tileData->forestIndex].mesh,
+				.materials = {m_treeMaterialProxy}
+			}
+		}
+	};
+
+	e2::MeshProxy* newMeshProxy = e2::create<e2::MeshProxy>(gameSession(), proxyConfig);
+	newMeshProxy->modelMatrix = glm::translate(glm::mat4(1.0f), e2::Hex(hex).localCoords());
+	newMeshProxy->modelMatrix = glm::rotate(newMeshProxy->modelMatrix, tileData->forestRotation, glm::vec3(e2::worldUp()));
+	newMeshProxy->modelMatrixDirty = { true };
+
+	return newMeshProxy;
+}
+
+glm::ivec2 e2::HexGrid::chunkIndexFromOffsetCoords(glm::ivec2 const& hex, uint32_t& outLocalIndex)
+{
+	// floor division, same as chunkIndexFromPlanarCoords but straight from offset coords
+	constexpr int32_t res = e2::hexChunkResolution;
+	glm::ivec2 chunkIndex{ hex.x >= 0 ? hex.x / res : (hex.x + 1) / res - 1, hex.y >= 0 ? hex.y / res : (hex.y + 1) / res - 1 };
+	glm::ivec2 local = hex - chunkIndex * res;
+	outLocalIndex = uint32_t(local.y * res + local.x);
+	return chunkIndex;
+}
+
+e2::TilePage* e2::HexGrid::getTilePage(glm::ivec2 const& chunkIndex)
+{
+	if (m_lastTilePage && m_lastTilePage->chunkIndex == chunkIndex)
+		return m_lastTilePage;
+
+	auto finder = m_tilePageIndex.find(chunkIndex);
+	if (finder == m_tilePageIndex.end())
+		return nullptr;
+
+	m_lastTilePage = finder->second;
+	return finder->second;
+}
+
+e2::TilePage* e2::HexGrid::getOrCreateTilePage(glm::ivec2 const& chunkIndex)
+{
+	e2::TilePage* page = getTilePage(chunkIndex);
+	if (page)
+		return page;
+
+	page = e2::create<e2::TilePage>();
+	page->chunkIndex = chunkIndex;
+	m_tilePages.push_back(page);
+	m_tilePageIndex[chunkIndex] = page;
+	m_lastTilePage = page;
+	return page;
+}
+
+void e2::TilePage::discover(uint32_t localIndex, e2::TileData const& tile)
+{
+	uint64_t bit = uint64_t(1) << localIndex;
+	tiles[localIndex] = tile;
+	visibility[localIndex] = 0;
+	discoveredMask |= bit;
+	visibleMask &= ~bit;
+	revision++;
+}
+
+void e2::TilePage::clearVisibility()
+{
+	if (visibleMask)
+		revision++;
+
+	memset(visibility, 0, sizeof(visibility));
+	visibleMask = 0;
+}
+
+void e2::TilePage::syncVisibleMask()
+{
+	uint64_t newMask{};
+	for (uint32_t i = 0; i < e2::hexChunkResolution * e2::hexChunkResolution; i++)
+	{
+		if (visibility[i] > 0)
+			newMask |= uint64_t(1) << i;
+	}
+
+	if (newMask != visibleMask)
+		revision++;
+
+	visibleMask = newMask;
+}
+
+e2::FogOfWarTexels::FogOfWarTexels()
+	: m_texels(e2::fogOfWarTexelSize * e2::fogOfWarTexelSize, 0)
+{
+
+}
+
+void e2::FogOfWarTexels::updateChunk(glm::ivec2 const& chunkIndex, e2::TilePage* page)
+{
+	glm::uvec2 blockCoords = glm::uvec2(chunkIndex) & glm::uvec2(e2::fogOfWarTexelChunks - 1);
+	uint32_t blockIndex = blockCoords.y * e2::fogOfWarTexelChunks + blockCoords.x;
+	Block& block = m_blocks[blockIndex];
+
+	// a page that was just created but has nothing discovered looks the same as no page at all, they both have revision 0
+	uint32_t revision = page ? page->revision : 0;
+	if (block.valid && block.chunkIndex == chunkIndex && block.revision == revision)
+		return;
+
+	block.valid = true;
+	block.chunkIndex = chunkIndex;
+	block.revision = revision;
+
+	constexpr uint32_t res = e2::hexChunkResolution;
+	glm::uvec2 origin = blockCoords * res;
+	for (uint32_t y = 0; y < res; y++)
+	{
+		uint32_t* row = &m_texels[(origin.y + y) * e2::fogOfWarTexelSize + origin.x];
+		for (uint32_t x = 0; x < res; x++)
+			row[x] = page ? packTexel(page, y * res + x) : 0;
+	}
+
+	for (uint32_t i = 0; i < e2::fogOfWarTexelConsumers; i++)
+	{
+		if (m_dirty[i][blockIndex])
+			continue;
+
+		m_dirty[i][blockIndex] = true;
+		m_numDirty[i]++;
+	}
+
+	m_numBlockWrites++;
+}
+
+glm::uvec2 e2::FogOfWarTexels::texelCoords(glm::ivec2 const& hex)
+{
+	// the fog of war vertex shader does the same
+	uint32_t localIndex;
+	glm::ivec2 chunkIndex = e2::HexGrid::chunkIndexFromOffsetCoords(hex, localIndex);
+	glm::uvec2 blockCoords = glm::uvec2(chunkIndex) & glm::uvec2(e2::fogOfWarTexelChunks - 1);
+	return blockCoords * e2::hexChunkResolution + glm::uvec2(localIndex % e2::hexChunkResolution, localIndex / e2::hexChunkResolution);
+}
+
+uint32_t e2::FogOfWarTexels::texel(glm::ivec2 const& hex) const
+{
+	glm::uvec2 coords = texelCoords(hex);
+	return m_texels[coords.y * e2::fogOfWarTexelSize + coords.x];
+}
+
+uint32_t e2::FogOfWarTexels::packTexel(e2::TilePage* page, uint32_t localIndex)
+{
+	if (!page->isDiscovered(localIndex))
+		return 0;
+
+	e2::TileData& tile = page->tiles[localIndex];
+	uint32_t visible = page->isVisible(localIndex) ? 255 : 0;
+	uint32_t wood = uint32_t(tile.getWoodAbundanceAsFloat() / 4.0f * 255.0f);
+	uint32_t deepWater = tile.getWater() == e2::TileFlags::WaterDeep ? 255 : 0;
+	return 255 | visible << 8 | wood << 16 | deepWater << 24;
+}
+
+bool e2::FogOfWarTexels::dirtyRect(uint32_t consumer, glm::uvec2& outOffset, glm::uvec2& outSize) const
+{
+	if (m_numDirty[consumer] == 0)
+		return false;
+
+	glm::uvec2 minBlock{ UINT32_MAX };
+	glm::uvec2 maxBlock{ 0 };
+	for (uint32_t i = 0; i < numBlocks; i++)
+	{
+		if (!m_dirty[consumer][i])
+			continue;
+
+		glm::uvec2 blockCoords{ i % e2::fogOfWarTexelChunks, i / e2::fogOfWarTexelChunks };
+		minBlock = glm::min(minBlock, blockCoords);
+		maxBlock = glm::max(maxBlock, blockCoords);
+	}
+
+	outOffset = minBlock * e2::hexChunkResolution;
+	outSize = (maxBlock - minBlock + 1u) * e2::hexChunkResolution;
+	return true;
+}
+
+void e2::FogOfWarTexels::copyRect(glm::uvec2 const& offset, glm::uvec2 const& size, std::vector<uint32_t>& outTexels) const
+{
+	outTexels.resize(size.x * size.y);
+	for (uint32_t y = 0; y < size.y; y++)
+		memcpy(&outTexels[y * size.x], &m_texels[(offset.y + y) * e2::fogOfWarTexelSize + offset.x], size.x * sizeof(uint32_t));
+}
+
+void e2::FogOfWarTexels::markClean(uint32_t consumer)
+{
+	memset(m_dirty[consumer], 0, sizeof(m_dirty[consumer]));
+	m_numDirty[consumer] = 0;
+}
+
+void e2::FogOfWarTexels::markAllDirty()
+{
+	for (uint32_t i = 0; i < e2::fogOfWarTexelConsumers; i++)
+	{
+		memset(m_dirty[i], 1, sizeof(m_dirty[i]));
+		m_numDirty[i] = numBlocks;
+	}
+}
+
+bool e2::testFogOfWarTexels(uint32_t numIterations)
+{
+	constexpr int32_t res = e2::hexChunkResolution;
+	constexpr int32_t alias = e2::fogOfWarTexelChunks;
+	constexpr uint32_t tilesPerPage = e2::hexChunkResolution * e2::hexChunkResolution;
+
+	// fixed seed, so a failure replays exactly. minstd is fully specified by the standard, unlike the distributions
+	std::minstd_rand random(0x0F06);
+	auto randomBelow = [&random](uint32_t count) {
+		return uint32_t(random() % count);
+	};
+
+	// two views of 3x2 chunks, each chunk in one shares its block with a chunk in the other. Some chunks have no page
+	glm::ivec2 const viewOrigins[2] = { { -1, -1 }, { alias - 1, -1 - alias } };
+	constexpr uint32_t chunksPerView = 6;
+	constexpr uint32_t numChunks = chunksPerView * 2;
+
+	std::vector<e2::TilePage> pages(numChunks);
+	bool hasPage[numChunks]{};
+	int32_t expectedVisibility[numChunks][tilesPerPage]{};
+	bool expectedDiscovered[numChunks][tilesPerPage]{};
+
+	for (uint32_t i = 0; i < numChunks; i++)
+	{
+		glm::ivec2 origin = viewOrigins[i / chunksPerView];
+		uint32_t j = i % chunksPerView;
+		pages[i].chunkIndex = origin + glm::ivec2(j % 3, j / 3);
+		hasPage[i] = j != 4;
+	}
+
+	e2::TileFlags const tileFlags[4] = {
+		e2::TileFlags::None,
+		e2::TileFlags::WaterDeep,
+		e2::TileFlags::WoodAbundance2,
+		e2::TileFlags(uint16_t(e2::TileFlags::WoodAbundance4) | uint16_t(e2::TileFlags::WaterShallow)),
+	};
+
+	e2::FogOfWarTexels texels;
+	texels.markAllDirty();
+
+	std::vector<uint32_t> gpuCopies[e2::fogOfWarTexelConsumers];
+	for (std::vector<uint32_t>& copy : gpuCopies)
+		copy.assign(e2::fogOfWarTexelSize * e2::fogOfWarTexelSize, 0xFFFFFFFF);
+
+	std::vector<uint32_t> rect;
+	for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+	{
+		// change some visibility, all over, seen or not
+		uint32_t numChanges = randomBelow(9);
+		for (uint32_t c = 0; c < numChanges; c++)
+		{
+			uint32_t i = randomBelow(numChunks);
+			if (!hasPage[i])
+				continue;
+
+			e2::TilePage& page = pages[i];
+			uint32_t localIndex = randomBelow(tilesPerPage);
+			uint32_t op = randomBelow(100);
+			if (!expectedDiscovered[i][localIndex])
+			{
+				e2::TileData tile;
+				tile.flags = tileFlags[randomBelow(4)];
+				page.discover(localIndex, tile);
+				expectedDiscovered[i][localIndex] = true;
+				expectedVisibility[i][localIndex] = 0;
+			}
+			else if (op < 50)
+			{
+				page.flagVisible(localIndex);
+				expectedVisibility[i][localIndex]++;
+			}
+			else if (op < 98)
+			{
+				if (expectedVisibility[i][localIndex] == 0)
+					continue;
+
+				page.unflagVisible(localIndex);
+				expectedVisibility[i][localIndex]--;
+			}
+			else
+			{
+				page.clearVisibility();
+				memset(expectedVisibility[i], 0, sizeof(expectedVisibility[i]));
+			}
+		}
+
+		// sync the view, like renderFogOfWar does for the chunks around the camera
+		uint32_t view = (iteration / 16) % 2;
+		for (uint32_t j = 0; j < chunksPerView; j++)
+		{
+			uint32_t i = view * chunksPerView + j;
+			texels.updateChunk(pages[i].chunkIndex, hasPage[i] ? &pages[i] : nullptr);
+		}
+
+		for (uint32_t j = 0; j < chunksPerView; j++)
+		{
+			uint32_t i = view * chunksPerView + j;
+			for (uint32_t localIndex = 0; localIndex < tilesPerPage; localIndex++)
+			{
+				glm::ivec2 hex = pages[i].chunkIndex * res + glm::ivec2(localIndex % res, localIndex / res);
+
+				bool visible = expectedVisibility[i][localIndex] > 0;
+				if (hasPage[i] && pages[i].isVisible(localIndex) != visible)
+				{
+					LogError("fog of war: isVisible wrong for {} after {} iterations", hex, iteration);
+					return false;
+				}
+
+				uint32_t expected = 0;
+				if (hasPage[i] && expectedDiscovered[i][localIndex])
+				{
+					e2::TileData& tile = pages[i].tiles[localIndex];
+					expected = 255u | (visible ? 255u << 8 : 0u) | uint32_t(tile.getWoodAbundanceAsFloat() / 4.0f * 255.0f) << 16 | (tile.getWater() == e2::TileFlags::WaterDeep ? 255u << 24 : 0u);
+				}
+
+				if (texels.texel(hex) != expected)
+				{
+					LogError("fog of war: texel for {} is {:x}, expected {:x} after {} iterations", hex, texels.texel(hex), expected, iteration);
+					return false;
+				}
+			}
+		}
+
+		// alternate frames copy their dirty rect, after which their copy must match everything
+		uint32_t consumer = iteration % e2::fogOfWarTexelConsumers;
+		glm::uvec2 offset, size;
+		if (texels.dirtyRect(consumer, offset, size))
+		{
+			texels.copyRect(offset, size, rect);
+			for (uint32_t y = 0; y < size.y; y++)
+				memcpy(&gpuCopies[consumer][(offset.y + y) * e2::fogOfWarTexelSize + offset.x], &rect[y * size.x], size.x * sizeof(uint32_t));
+			texels.markClean(consumer);
+		}
+
+		texels.copyRect({ 0, 0 }, { e2::fogOfWarTexelSize, e2::fogOfWarTexelSize }, rect);
+		if (rect != gpuCopies[consumer])
+		{
+			LogError("fog of war: copy {} is stale after syncing its dirty rect, after {} iterations", consumer, iteration);
+			return false;
+		}
+
+		// nothing changed since, so nothing may be written or flagged
+		uint64_t writesBefore = texels.numBlockWrites();
+		for (uint32_t j = 0; j < chunksPerView; j++)
+		{
+			uint32_t i = view * chunksPerView + j;
+			texels.updateChunk(pages[i].chunkIndex, hasPage[i] ? &pages[i] : nullptr);
+		}
+
+		if (texels.numBlockWrites() != writesBefore || texels.dirtyRect(consumer, offset, size))
+		{
+			LogError("fog of war: unchanged chunks were rewritten after {} iterations", iteration);
+			return false;
+		}
+	}
+
+	LogNotice("fog of war texels verified over {} iterations, {} block writes", numIterations, texels.numBlockWrites());
+	return true;
+}
+
+e2::TileData* e2::HexGrid::discover(glm::ivec2 const& hex)
+{
+	uint32_t localIndex;
+	glm::ivec2 chunkIndex = chunkIndexFromOffsetCoords(hex, localIndex);
+	e2::TilePage* page = getOrCreateTilePage(chunkIndex);
+
+	// there are no checks to see if hex is already discovered, use with care!! 
+#if defined(E2_DEVELOPMENT)
+	if (page->isDiscovered(localIndex))
+	{
+		LogError("DISCOVERING ALREADY DISCOVERED TILE, EXPECT BREAKAGE");
+	}
+#endif
+	page->discover(localIndex, getProceduralTileData(hex));
+
+	auto chunkFinder = m_discoveredChunks.find(chunkIndex);
+	if (chunkFinder == m_discoveredChunks.end())
+	{
+		m_discoveredChunks.insert(chunkIndex);
+		
+		e2::Aabb2D chunkAabb = getChunkAabb(chunkIndex);
+		for (glm::vec2 p : chunkAabb.points())
+			m_discoveredChunksAABB.push(p);
+
+	}
+
+	flagChunkOutdated(chunkIndex);
+
+	return &page->tiles[localIndex];
+}
+
+e2::TileData* e2::HexGrid::getOrDiscoverTileData(glm::ivec2 const& hex)
+{
+	e2::TileData* existing = getExistingTileData(hex);
+	if (existing)
+		return existing;
+
+	return discover(hex);
+}
+
+e2::TileData* e2::HexGrid::getExistingTileData(glm::ivec2 const& hex)
+{
+	uint32_t localIndex;
+	e2::TilePage* page = getTilePage(chunkIndexFromOffsetCoords(hex, localIndex));
+	if (!page || !page->isDiscovered(localIndex))
+		return nullptr;
+
+	return &page->tiles[localIndex];
+}
+
+void e2::HexGrid::clearAllChunks()
+{
+	auto chunkIndexCopy = m_chunkIndex;
+	for (auto [chunkIndex, chunkState] : chunkIndexCopy)
+	{
+		nukeChunk(chunkState);
+	}
+
+	m_chunkIndex.clear();
+}
+
+uint32_t e2::HexGrid::numChunks()
+{
+	return (uint32_t)m_chunkIndex.size();
+}
+
+uint32_t e2::HexGrid::numVisibleChunks()
+{
+	return (uint32_t)m_visibleChunks.size();
+}
+
+uint32_t e2::HexGrid::numJobsInFlight()
+{
+	return (uint32_t)m_streamingChunks.size();
+}
+
+uint32_t e2::HexGrid::numJobsInQueue()
+{
+	return (uint32_t)m_queuedChunks.size();
+}
+
+void e2::HexGrid::flagChunkOutdated(glm::ivec2 const& chunkIndex)
+{
+	m_outdatedChunks.insert(getOrCreateChunk(chunkIndex));
+	game()->collisionWorld()->evictStatic(chunkIndex);
+}
+
+double e2::HexGrid::highLoadTime()
 {
 	return m_highLoadTime;
 }
@@ -1957,16 +2801,54 @@ void e2::HexGrid::initializeFogOfWar()
 	auto renderCtx = game()->renderContext();
 	auto mainThreadCtx = game()->mainThreadContext();
 
-	// fogofwar stuff 
+	// fogofwar stuff, fog and outlines both read the visibility texels and outline tiles in their vertex shaders
+	e2::DescriptorSetLayoutCreateInfo fogSetLayoutInf{};
+	fogSetLayoutInf.bindings = {
+		{e2::DescriptorBindingType::Texture},
+		{e2::DescriptorBindingType::Texture},
+	};
+	m_fogOfWarSetLayout = renderCtx->createDescriptorSetLayout(fogSetLayoutInf);
+
+	e2::DescriptorPoolCreateInfo fogPoolCreateInfo{};
+	fogPoolCreateInfo.maxSets = 2 * e2::maxNumSessions;
+	fogPoolCreateInfo.numTextures = 4 * e2::maxNumSessions;
+	m_fogOfWarPool = mainThreadCtx->createDescriptorPool(fogPoolCreateInfo);
+
 	e2::PipelineLayoutCreateInfo layInf{};
 	layInf.pushConstantSize = sizeof(e2::FogOfWarConstants);
+	layInf.sets.push(m_fogOfWarSetLayout);
 	m_fogOfWarPipelineLayout = renderCtx->createPipelineLayout(layInf);
 
 	// outline stuff
 	layInf = e2::PipelineLayoutCreateInfo();
 	layInf.pushConstantSize = sizeof(e2::OutlineConstants);
+	layInf.sets.push(m_fogOfWarSetLayout);
 	m_outlinePipelineLayout = renderCtx->createPipelineLayout(layInf);
 
+	e2::TextureCreateInfo visibilityTexInf{};
+	visibilityTexInf.initialLayout = e2::TextureLayout::ShaderRead;
+	visibilityTexInf.format = e2::TextureFormat::RGBA8;
+	visibilityTexInf.resolution = { e2::fogOfWarTexelSize, e2::fogOfWarTexelSize, 1 };
+
+	e2::TextureCreateInfo outlineTilesTexInf{};
+	outlineTilesTexInf.initialLayout = e2::TextureLayout::ShaderRead;
+	outlineTilesTexInf.format = e2::TextureFormat::RG32;
+	outlineTilesTexInf.resolution = { e2::initialNumOutlineTiles, uint32_t(e2::OutlineLayer::Count), 1 };
+
+	for (uint8_t i = 0; i < 2; i++)
+	{
+		m_frameData[i].visibilityTexture = renderCtx->createTexture(visibilityTexInf);
+		m_frameData[i].outlineTilesTexture = renderCtx->createTexture(outlineTilesTexInf);
+		m_frameData[i].outlineTilesCapacity = e2::initialNumOutlineTiles;
+		m_frameData[i].outlineTilesDirty = true;
+		m_frameData[i].fogOfWarSet = m_fogOfWarPool->createDescriptorSet(m_fogOfWarSetLayout);
+		m_frameData[i].fogOfWarSet->writeTexture(0, m_frameData[i].visibilityTexture);
+		m_frameData[i].fogOfWarSet->writeTexture(1, m_frameData[i].outlineTilesTexture);
+	}
+
+	// the new textures hold nothing yet
+	m_fogOfWarTexels.markAllDirty();
+
 	// blur stuff 
 	e2::DescriptorSetLayoutCreateInfo setLayoutInf{};
 	setLayoutInf.bindings = {
@@ -2440,6 +3322,80 @@ void e2::HexGrid::renderFogOfWar()
 
 	e2::SubmeshSpecification const& hexSpec = m_baseHex->specification(0);
 
+	// the fog is drawn for the rect of chunks in view, make sure their texel blocks are up to date
+	constexpr int32_t res = e2::hexChunkResolution;
+	glm::ivec2 minChunk{ INT32_MAX };
+	glm::ivec2 maxChunk{ INT32_MIN };
+	for (e2::ChunkState* chunk : m_chunksInView)
+	{
+		minChunk = glm::min(minChunk, chunk->chunkIndex);
+		maxChunk = glm::max(maxChunk, chunk->chunkIndex);
+	}
+
+	bool hasFogRegion = !m_chunksInView.empty();
+	if (hasFogRegion)
+	{
+		maxChunk = glm::min(maxChunk, minChunk + glm::ivec2(e2::fogOfWarTexelChunks - 1));
+		for (int32_t y = minChunk.y; y <= maxChunk.y; y++)
+		{
+			for (int32_t x = minChunk.x; x <= maxChunk.x; x++)
+				m_fogOfWarTexels.updateChunk({ x, y }, getTilePage({ x, y }));
+		}
+	}
+
+	// and upload whatever changed since this frames texture was last synced
+	glm::uvec2 dirtyOffset, dirtySize;
+	if (m_fogOfWarTexels.dirtyRect(frameIndex, dirtyOffset, dirtySize))
+	{
+		m_fogOfWarTexels.copyRect(dirtyOffset, dirtySize, m_fogOfWarUploadScratch);
+		frameData.visibilityTexture->upload(0, glm::uvec3(dirtyOffset, 0), glm::uvec3(dirtySize, 1), reinterpret_cast<uint8_t const*>(m_fogOfWarUploadScratch.data()), m_fogOfWarUploadScratch.size() * sizeof(uint32_t));
+		m_fogOfWarTexels.markClean(frameIndex);
+	}
+
+	// grow this frames outline tile texture if a layer outgrew it, the old one is kept around until the gpu is done with it
+	uint32_t maxOutlineSize{};
+	for (uint8_t i = 0; i < size_t(e2::OutlineLayer::Count); i++)
+		maxOutlineSize = glm::max(maxOutlineSize, uint32_t(m_outlineTiles[i].size()));
+
+	if (maxOutlineSize > frameData.outlineTilesCapacity && frameData.outlineTilesCapacity < e2::maxNumOutlineTiles)
+	{
+		uint32_t newCapacity = frameData.outlineTilesCapacity;
+		while (newCapacity < maxOutlineSize && newCapacity < e2::maxNumOutlineTiles)
+			newCapacity *= 2;
+		newCapacity = glm::min(newCapacity, e2::maxNumOutlineTiles);
+
+		e2::TextureCreateInfo outlineTilesTexInf{};
+		outlineTilesTexInf.initialLayout = e2::TextureLayout::ShaderRead;
+		outlineTilesTexInf.format = e2::TextureFormat::RG32;
+		outlineTilesTexInf.resolution = { newCapacity, uint32_t(e2::OutlineLayer::Count), 1 };
+
+		e2::discard(frameData.outlineTilesTexture);
+		frameData.outlineTilesTexture = game()->renderContext()->createTexture(outlineTilesTexInf);
+		frameData.outlineTilesCapacity = newCapacity;
+		frameData.outlineTilesDirty = true;
+		frameData.fogOfWarSet->writeTexture(1, frameData.outlineTilesTexture);
+	}
+
+	uint32_t numOutlineTiles[size_t(e2::OutlineLayer::Count)];
+	for (uint8_t i = 0; i < size_t(e2::OutlineLayer::Count); i++)
+		numOutlineTiles[i] = glm::min(uint32_t(m_outlineTiles[i].size()), frameData.outlineTilesCapacity);
+
+	if (frameData.outlineTilesDirty)
+	{
+		for (uint8_t i = 0; i < size_t(e2::OutlineLayer::Count); i++)
+		{
+			if (numOutlineTiles[i] == 0)
+				continue;
+
+			m_outlineUploadScratch.resize(numOutlineTiles[i]);
+			for (uint32_t j = 0; j < numOutlineTiles[i]; j++)
+				m_outlineUploadScratch[j] = glm::vec2(m_outlineTiles[i][j]);
+
+			frameData.outlineTilesTexture->upload(0, glm::uvec3(0, i, 0), glm::uvec3(numOutlineTiles[i], 1, 1), reinterpret_cast<uint8_t const*>(m_outlineUploadScratch.data()), m_outlineUploadScratch.size() * sizeof(glm::vec2));
+		}
+		frameData.outlineTilesDirty = false;
+	}
+
 	// outlines first 
 	e2::OutlineConstants outlineConstants;
 	glm::mat4 vpMatrix = m_streamingView.view.calculateProjectionMatrix(m_streamingView.resolution) * m_streamingView.view.calculateViewMatrix();
@@ -2451,59 +3407,30 @@ void e2::HexGrid::renderFogOfWar()
 	buff->useAsAttachment(frameData.outlineTexture);
 	buff->beginRender(frameData.outlineTarget);
 	buff->bindPipeline(m_outlinePipeline);
+	buff->bindDescriptorSet(m_outlinePipelineLayout, 0, frameData.fogOfWarSet);
 	buff->bindVertexLayout(hexSpec.vertexLayout);
-	buff->bindIndexBuffer(hexSpec.indexBuffer);
+	buff->bindIndexBuffer(hexSpec.indexBuffer, hexSpec.indexFormat);
 	for (uint8_t i = 0; i < hexSpec.vertexAttributes.size(); i++)
 		buff->bindVertexBuffer(i, hexSpec.vertexAttributes[i]);
 
-
-
-	const glm::vec4 layerColors[2] = {
-		{ 0.0f, 0.5f, 0.15f, 0.1f },
-		{ 0.5f, 0.0f, 0.15f, 0.1f }
-	};
-
+	// one instance per outline tile, base then subtractive
+	outlineConstants.vpMatrix = vpMatrix;
 	for (uint8_t i = 0; i < size_t(e2::OutlineLayer::Count); i++)
 	{
+		if (numOutlineTiles[i] == 0)
+			continue;
 
 		// base
-		for (glm::ivec2 const& hexIndex : m_outlineTiles[i])
-		{
-			//e2::TileData* td = getExistingTileData(hexIndex);
-			glm::vec3 worldOffset = e2::Hex(hexIndex).localCoords();
-			//if (td && td->getWater() != e2::TileFlags::WaterNone)
-			//	worldOffset.y += 0.1f;
-
-			glm::mat4 transform = glm::identity<glm::mat4>();
-			transform = glm::translate(transform, worldOffset);
-			transform = glm::scale(transform, { 1.1f, 1.1f, 1.1f });
-
+		outlineConstants.color = e2::gameAccent.toVec4();
+		outlineConstants.parameters = { 1.1f, float(i), 0.0f, 0.0f };
+		buff->pushConstants(m_outlinePipelineLayout, 0, sizeof(e2::OutlineConstants), reinterpret_cast<uint8_t*>(&outlineConstants));
+		buff->draw(hexSpec.indexCount, numOutlineTiles[i]);
 
-			outlineConstants.mvpMatrix = vpMatrix * transform;
-			outlineConstants.color = e2::gameAccent.toVec4();
-
-			buff->pushConstants(m_outlinePipelineLayout, 0, sizeof(e2::OutlineConstants), reinterpret_cast<uint8_t*>(&outlineConstants));
-			buff->draw(hexSpec.indexCount, 1);
-		}
 		// subtractive
-		for (glm::ivec2 const& hexIndex : m_outlineTiles[i])
-		{
-			//e2::TileData* td = getExistingTileData(hexIndex);
-			glm::vec3 worldOffset = e2::Hex(hexIndex).localCoords();
-
-			//if (td && td->getWater() != e2::TileFlags::WaterNone)
-			//	worldOffset.y += 0.1f;
-
-			glm::mat4 transform = glm::identity<glm::mat4>();
-			transform = glm::translate(transform, worldOffset);
-			transform = glm::scale(transform, { 1.04f, 1.04f, 1.04f });
-
-			outlineConstants.mvpMatrix = vpMatrix * transform;
-			outlineConstants.color = {};
-
-			buff->pushConstants(m_outlinePipelineLayout, 0, sizeof(e2::OutlineConstants), reinterpret_cast<uint8_t*>(&outlineConstants));
-			buff->draw(hexSpec.indexCount, 1);
-		}
+		outlineConstants.color = {};
+		outlineConstants.parameters = { 1.04f, float(i), 0.0f, 0.0f };
+		buff->pushConstants(m_outlinePipelineLayout, 0, sizeof(e2::OutlineConstants), reinterpret_cast<uint8_t*>(&outlineConstants));
+		buff->draw(hexSpec.indexCount, numOutlineTiles[i]);
 	}
 
 	buff->endRender();
@@ -2516,63 +3443,31 @@ void e2::HexGrid::renderFogOfWar()
 
 
 	//fog of war
-	e2::FogOfWarConstants fogOfWarConstants;
-
 	buff->useAsAttachment(frameData.fogOfWarMasks[0]);
 	buff->beginRender(frameData.fogOfWarTargets[0]);
-	buff->bindPipeline(m_fogOfWarPipeline);
-
-	// Bind vertex states
-	buff->bindVertexLayout(hexSpec.vertexLayout);
-	buff->bindIndexBuffer(hexSpec.indexBuffer);
-	for (uint8_t i = 0; i < hexSpec.vertexAttributes.size(); i++)
-		buff->bindVertexBuffer(i, hexSpec.vertexAttributes[i]);
 
-	for (e2::ChunkState* chunk : m_chunksInView)
+	// one instance per hex in the rect, undiscovered ones are collapsed in the vertex shader
+	if (hasFogRegion)
 	{
-		glm::ivec2 chunkIndex = chunk->chunkIndex;
-
-		glm::ivec2 chunkTileOffset = chunkIndex * glm::ivec2(e2::hexChunkResolution);
-
-		glm::mat4 vpMatrix = m_streamingView.view.calculateProjectionMatrix(m_streamingView.resolution) * m_streamingView.view.calculateViewMatrix();
-
-		for (int32_t y = 0; y < e2::hexChunkResolution; y++)
-		{
-			for (int32_t x = 0; x < e2::hexChunkResolution; x++)
-			{
-				glm::ivec2 worldIndex = chunkTileOffset + glm::ivec2(x, y);
-				auto finder = m_tileIndex.find(worldIndex);
-				if (finder == m_tileIndex.end())
-					continue;
-
-				e2::Hex currentHex(worldIndex);
-				glm::vec3 worldOffset = currentHex.localCoords();
-
-				glm::mat4 transform = glm::identity<glm::mat4>();
-				transform = glm::translate(transform, worldOffset);
-
-				float spooky = m_tiles[finder->second].getWoodAbundanceAsFloat() / 4.0f;
-				
-				fogOfWarConstants.mvpMatrix = vpMatrix * transform;
+		glm::ivec2 regionSize = (maxChunk - minChunk + 1) * res;
 
-				if (m_debugDraw)
-					fogOfWarConstants.visibility = {1.0f, 1.0f, 0.0f, 1.0f};
-				else
-				{
-					fogOfWarConstants.visibility.x = 1.0;
-					fogOfWarConstants.visibility.y = m_tileVisibility[finder->second] > 0.0f ? 1.0f : 0.0f;
-					fogOfWarConstants.visibility.z = spooky;
-					fogOfWarConstants.visibility.w = m_tiles[finder->second].getWater() == TileFlags::WaterDeep ? 1.0f : 0.0f;
-				}
+		e2::FogOfWarConstants fogOfWarConstants;
+		fogOfWarConstants.vpMatrix = vpMatrix;
+		fogOfWarConstants.region = glm::ivec4(minChunk * res, regionSize.x, m_debugDraw ? 1 : 0);
 
+		buff->bindPipeline(m_fogOfWarPipeline);
+		buff->bindDescriptorSet(m_fogOfWarPipelineLayout, 0, frameData.fogOfWarSet);
 
-				buff->pushConstants(m_fogOfWarPipelineLayout, 0, sizeof(e2::FogOfWarConstants), reinterpret_cast<uint8_t*>(&fogOfWarConstants));
-				buff->draw(hexSpec.indexCount, 1);
-			}
-		}
-
+		// Bind vertex states
+		buff->bindVertexLayout(hexSpec.vertexLayout);
+		buff->bindIndexBuffer(hexSpec.indexBuffer, hexSpec.indexFormat);
+		for (uint8_t i = 0; i < hexSpec.vertexAttributes.size(); i++)
+			buff->bindVertexBuffer(i, hexSpec.vertexAttributes[i]);
 
+		buff->pushConstants(m_fogOfWarPipelineLayout, 0, sizeof(e2::FogOfWarConstants), reinterpret_cast<uint8_t*>(&fogOfWarConstants));
+		buff->draw(hexSpec.indexCount, uint32_t(regionSize.x * regionSize.y));
 	}
+
 	buff->endRender();	
 	buff->useAsDefault(frameData.fogOfWarMasks[0]);
 
@@ -2881,6 +3776,22 @@ void e2::HexGrid::destroyFogOfWar()
 	if (m_fogOfWarPipelineLayout)
 		e2::discard(m_fogOfWarPipelineLayout);
 
+	for (uint8_t i = 0; i < 2; i++)
+	{
+		if (m_frameData[i].fogOfWarSet)
+			e2::discard(m_frameData[i].fogOfWarSet);
+		if (m_frameData[i].visibilityTexture)
+			e2::discard(m_frameData[i].visibilityTexture);
+		if (m_frameData[i].outlineTilesTexture)
+			e2::discard(m_frameData[i].outlineTilesTexture);
+	}
+
+	if (m_fogOfWarPool)
+		e2::discard(m_fogOfWarPool);
+
+	if (m_fogOfWarSetLayout)
+		e2::discard(m_fogOfWarSetLayout);
+
 	if (m_frameData[0].fogOfWarMasks[0])
 		e2::discard(m_frameData[0].fogOfWarMasks[0]);
 	if (m_frameData[0].fogOfWarMasks[1])
@@ -2932,41 +3843,43 @@ void e2::HexGrid::destroyFogOfWar()
 
 void e2::HexGrid::clearVisibility()
 {
-	for (int32_t &vis : m_tileVisibility)
-		vis = 0;
+	for (e2::TilePage* page : m_tilePages)
+		page->clearVisibility();
 }
 
 void e2::HexGrid::flagVisible(glm::ivec2 const& v, bool onlyDiscover)
 {
-	int32_t tileIndex = (int32_t)getTileIndexFromHex(v);
+	uint32_t localIndex;
+	glm::ivec2 chunkIndex = chunkIndexFromOffsetCoords(v, localIndex);
+	e2::TilePage* page = getTilePage(chunkIndex);
+	if (!page || !page->isDiscovered(localIndex))
+	{
+		discover(v);
+		page = getTilePage(chunkIndex);
+	}
 
-	if(!onlyDiscover)
-		m_tileVisibility[tileIndex] = m_tileVisibility[tileIndex]  + 1;
+	if (!onlyDiscover)
+		page->flagVisible(localIndex);
 }
 
 void e2::HexGrid::unflagVisible(glm::ivec2 const& v)
 {
-	auto finder = m_tileIndex.find(v);
-	int32_t index = 0;
-	if (finder == m_tileIndex.end())
+	uint32_t localIndex;
+	e2::TilePage* page = getTilePage(chunkIndexFromOffsetCoords(v, localIndex));
+	if (!page || !page->isDiscovered(localIndex))
 	{
 		LogError("attempted to unflag visibility in nondiscovered area, this is likely a bug!");
 		return;
 	}
-	index = (int32_t)finder->second;
 
-	m_tileVisibility[index] = m_tileVisibility[index] - 1;
+	page->unflagVisible(localIndex);
 }
 
 bool e2::HexGrid::isVisible(glm::ivec2 const& v)
 {
-	auto finder = m_tileIndex.find(v);
-	if (finder == m_tileIndex.end())
-	{
-		return false;
-	}
-	int32_t index = (int32_t)finder->second;
-	return m_tileVisibility[index];
+	uint32_t localIndex;
+	e2::TilePage* page = getTilePage(chunkIndexFromOffsetCoords(v, localIndex));
+	return page && page->isVisible(localIndex);
 }
 
 void e2::HexGrid::clearOutline()
@@ -2976,11 +3889,18 @@ void e2::HexGrid::clearOutline()
 		m_outlineTiles[i].clear();
 	}
 	
+	m_frameData[0].outlineTilesDirty = true;
+	m_frameData[1].outlineTilesDirty = true;
 }
 
 void e2::HexGrid::pushOutline(e2::OutlineLayer layer, glm::ivec2 const& tile)
 {
 	m_outlineTiles[size_t(layer)].push_back(tile);
+	if (m_outlineTiles[size_t(layer)].size() == e2::maxNumOutlineTiles + 1)
+		LogWarning("outline layer {} has more than {} tiles, the rest of it won't be drawn", uint32_t(layer), e2::maxNumOutlineTiles);
+
+	m_frameData[0].outlineTilesDirty = true;
+	m_frameData[1].outlineTilesDirty = true;
 }
 
 e2::ITexture* e2::HexGrid::outlineTexture(uint8_t frameIndex)
@@ -3018,6 +3938,7 @@ void e2::HexGrid::removeWood(glm::ivec2 const& location)
 	glm::ivec2 chunkIndex = chunkIndexFromPlanarCoords(Hex(location).planarCoords());
 	e2::ChunkState *chunkState = getOrCreateChunk(chunkIndex);
 	refreshChunkMeshes(chunkState);
+	game()->collisionWorld()->invalidateStatic(location);
 }
 
 
@@ -3183,6 +4104,8 @@ bool e2::ChunkLoadTask::execute()
 
 	{
 		//E2_TIME_SCOPE("WorldGen.Prepare");
+		shaderData.grid->calculateChunkTileData(m_chunkIndex, shaderData.tileCache);
+
 		int32_t i = 0;
 		for (int32_t y = -1; y < (int32_t)e2::hexChunkResolution+1; y++)
 		{
@@ -3192,8 +4115,7 @@ bool e2::ChunkLoadTask::execute()
 				e2::Hex localHex(localOffsetCoords);
 				glm::ivec2 worldOffsetCoords = shaderData.cacheOffset + localOffsetCoords;
 
-				e2::TileData newTile = shaderData.grid->calculateTileData(worldOffsetCoords);
-				shaderData.tileCache[i++] = newTile;
+				e2::TileData const& newTile = shaderData.tileCache[i++];
 
 				if (y < 0 || x < 0 || x >= (int32_t)e2::hexChunkResolution || y >= (int32_t)e2::hexChunkResolution)
 					continue;
@@ -3282,6 +4204,8 @@ void e2::HexGrid::popInChunk(e2::ChunkState* state)
 	m_visibleChunks.insert(state);
 	m_hiddenChunks.erase(state);
 
+	showUnpackedTrees(state->chunkIndex, true);
+
 	glm::vec3 chunkOffset = chunkOffsetFromIndex(state->chunkIndex);
 
 	// finalize
@@ -3353,6 +4277,8 @@ void e2::HexGrid::popOutChunk(e2::ChunkState* state)
 	m_visibleChunks.erase(state);
 	m_hiddenChunks.insert(state);
 
+	showUnpackedTrees(state->chunkIndex, false);
+
 
 	if (state->waterProxy)
 	{
@@ -3446,7 +4372,7 @@ void e2::HexGrid::refreshChunkMeshes(e2::ChunkState* state)
 			}
 			else
 			{
-				e2::TileData tileData = calculateTileData(tileHex);
+				e2::TileData tileData = getProceduralTileData(tileHex);
 
 				e2::MeshProxy* newForestProxy = createForestProxyForTile(&tileData, tileHex);
 				if (newForestProxy)
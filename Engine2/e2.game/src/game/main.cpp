@@ -1,13 +1,43 @@
 
 #include <e2/e2.hpp>
+#include <e2/log.hpp>
+#include <e2/compression.hpp>
 
 #include "game/game.hpp"
+#include "game/hex.hpp"
+#include "game/noise.hpp"
+#include "game/vegetation.hpp"
+#include "game/speccache.hpp"
+#include "game/shared.hpp"
 
 #include "init.inl"
 
+#include <cstring>
+
 int main(int argc, char** argv)
 {
 	::registerGeneratedTypes();
+
+	// --selftest runs the game's self tests and exits, before there is an engine, window or session. Engine tests are in e2.tests
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--selftest") == 0)
+		{
+			bool passed = true;
+			passed &= e2::testFogOfWarTexels(4096);
+			passed &= e2::testProceduralTileCache(4096);
+			passed &= e2::testSimplexBatch(65536);
+			passed &= e2::testTileDataBatch(16384);
+			passed &= e2::testVegetationInstances(4096);
+			passed &= e2::testSpecCache();
+			passed &= e2::testCollisionSweep(100000);
+			passed &= e2::testCompressionLZ();
+
+			LogNotice("{}", passed ? "ALL PASSED" : "FAILED");
+			e2::Log::shutdown();
+			return passed ? 0 : 1;
+		}
+	}
 	//_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF |  _CRTDBG_CHECK_ALWAYS_DF);
 	e2::Engine engine;
 	e2::Game game(&engine);
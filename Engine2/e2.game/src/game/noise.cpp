@@ -0,0 +1,309 @@
+
+#include "game/noise.hpp"
+
+#include <e2/log.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#if defined(E2_SIMPLEX_AVX2) || defined(E2_SIMPLEX_SSE2)
+#include <immintrin.h>
+#endif
+
+/**
+ * The kernel below is written once and instantiated for scalar, SSE2 and AVX2 lanes.
+ * Every lane type does plain IEEE single precision ops in the exact same order as the old glm implementation did,
+ * which is what makes the paths bit-identical. Keep fp contraction off (msvc default), an fma in here changes the world.
+ */
+
+namespace
+{
+	struct ScalarLanes
+	{
+		float v;
+
+		static ScalarLanes set(float f) { return { f }; }
+	};
+
+	inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return { a.v + b.v }; }
+	inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return { a.v - b.v }; }
+	inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return { a.v * b.v }; }
+	inline ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return { a.v / b.v }; }
+
+	inline ScalarLanes floorLanes(ScalarLanes a) { return { std::floor(a.v) }; }
+	inline ScalarLanes absLanes(ScalarLanes a) { return { std::fabs(a.v) }; }
+	// same semantics as glm::max(x, 0.0f), i.e. (x < 0) ? 0 : x
+	inline ScalarLanes maxZeroLanes(ScalarLanes a) { return { (a.v < 0.0f) ? 0.0f : a.v }; }
+	// 1.0 where a > b, otherwise 0.0
+	inline ScalarLanes greaterLanes(ScalarLanes a, ScalarLanes b) { return { (a.v > b.v) ? 1.0f : 0.0f }; }
+
+#if defined(E2_SIMPLEX_SSE2)
+	struct SseLanes
+	{
+		__m128 v;
+
+		static SseLanes set(float f) { return { _mm_set1_ps(f) }; }
+		static SseLanes load(float const* p) { return { _mm_loadu_ps(p) }; }
+		void store(float* p) const { _mm_storeu_ps(p, v); }
+	};
+
+	inline SseLanes operator+(SseLanes a, SseLanes b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline SseLanes operator-(SseLanes a, SseLanes b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline SseLanes operator*(SseLanes a, SseLanes b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline SseLanes operator/(SseLanes a, SseLanes b) { return { _mm_div_ps(a.v, b.v) }; }
+
+	inline SseLanes absLanes(SseLanes a)
+	{
+		return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) };
+	}
+
+	// sse2 has no floor, so truncate and step down for negatives. Values >= 2^23 (and nan/inf) are already integral and pass through untouched.
+	// floor always keeps the sign of its input, so or:ing the sign back in also gets -0.0 right
+	inline SseLanes floorLanes(SseLanes a)
+	{
+		__m128 const signMask = _mm_set1_ps(-0.0f);
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+		__m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+		__m128 inRange = _mm_cmplt_ps(_mm_andnot_ps(signMask, a.v), _mm_set1_ps(8388608.0f));
+		__m128 result = _mm_or_ps(_mm_and_ps(inRange, floored), _mm_andnot_ps(inRange, a.v));
+		return { _mm_or_ps(result, _mm_and_ps(a.v, signMask)) };
+	}
+
+	// _mm_max_ps returns the second operand unless the first is greater, so zero goes first to match glm
+	inline SseLanes maxZeroLanes(SseLanes a) { return { _mm_max_ps(_mm_setzero_ps(), a.v) }; }
+	inline SseLanes greaterLanes(SseLanes a, SseLanes b) { return { _mm_and_ps(_mm_cmpgt_ps(a.v, b.v), _mm_set1_ps(1.0f)) }; }
+#endif
+
+#if defined(E2_SIMPLEX_AVX2)
+	struct AvxLanes
+	{
+		__m256 v;
+
+		static AvxLanes set(float f) { return { _mm256_set1_ps(f) }; }
+		static AvxLanes load(float const* p) { return { _mm256_loadu_ps(p) }; }
+		void store(float* p) const { _mm256_storeu_ps(p, v); }
+	};
+
+	inline AvxLanes operator+(AvxLanes a, AvxLanes b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline AvxLanes operator-(AvxLanes a, AvxLanes b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline AvxLanes operator*(AvxLanes a, AvxLanes b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline AvxLanes operator/(AvxLanes a, AvxLanes b) { return { _mm256_div_ps(a.v, b.v) }; }
+
+	inline AvxLanes absLanes(AvxLanes a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+	inline AvxLanes floorLanes(AvxLanes a) { return { _mm256_floor_ps(a.v) }; }
+	inline AvxLanes maxZeroLanes(AvxLanes a) { return { _mm256_max_ps(_mm256_setzero_ps(), a.v) }; }
+	inline AvxLanes greaterLanes(AvxLanes a, AvxLanes b) { return { _mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ), _mm256_set1_ps(1.0f)) }; }
+#endif
+
+	// glm::mod, x - y * floor(x / y)
+	template <typename Lanes>
+	inline Lanes modLanes(Lanes x, Lanes y)
+	{
+		return x - y * floorLanes(x / y);
+	}
+
+	template <typename Lanes>
+	inline Lanes permuteLanes(Lanes x)
+	{
+		return modLanes(((x * Lanes::set(34.0f)) + Lanes::set(1.0f)) * x, Lanes::set(289.0f));
+	}
+
+	template <typename Lanes>
+	inline Lanes simplexKernel(Lanes vx, Lanes vy)
+	{
+		Lanes const Cx = Lanes::set(0.211324865405187f);
+		Lanes const Cy = Lanes::set(0.366025403784439f);
+		Lanes const Cz = Lanes::set(-0.577350269189626f);
+		Lanes const Cw = Lanes::set(0.024390243902439f);
+		Lanes const zero = Lanes::set(0.0f);
+		Lanes const half = Lanes::set(0.5f);
+		Lanes const one = Lanes::set(1.0f);
+		Lanes const two = Lanes::set(2.0f);
+		Lanes const mod = Lanes::set(289.0f);
+
+		// i = floor(v + dot(v, C.yy))
+		Lanes skew = vx * Cy + vy * Cy;
+		Lanes ix = floorLanes(vx + skew);
+		Lanes iy = floorLanes(vy + skew);
+
+		// x0 = v - i + dot(i, C.xx)
+		Lanes unskew = ix * Cx + iy * Cx;
+		Lanes x0x = (vx - ix) + unskew;
+		Lanes x0y = (vy - iy) + unskew;
+
+		// i1 = (x0.x > x0.y) ? (1, 0) : (0, 1)
+		Lanes i1x = greaterLanes(x0x, x0y);
+		Lanes i1y = one - i1x;
+
+		// x12 = x0.xyxy + C.xxzz, x12.xy -= i1
+		Lanes x12x = (x0x + Cx) - i1x;
+		Lanes x12y = (x0y + Cx) - i1y;
+		Lanes x12z = x0x + Cz;
+		Lanes x12w = x0y + Cz;
+
+		ix = modLanes(ix, mod);
+		iy = modLanes(iy, mod);
+
+		// p = permute(permute(i.y + (0, i1.y, 1)) + i.x + (0, i1.x, 1))
+		Lanes p0 = permuteLanes(permuteLanes(iy + zero) + ix + zero);
+		Lanes p1 = permuteLanes(permuteLanes(iy + i1y) + ix + i1x);
+		Lanes p2 = permuteLanes(permuteLanes(iy + one) + ix + one);
+
+		// m = max(0.5 - (dot(x0, x0), dot(x12.xy, x12.xy), dot(x12.zw, x12.zw)), 0), then m^4
+		Lanes m0 = maxZeroLanes(half - (x0x * x0x + x0y * x0y));
+		Lanes m1 = maxZeroLanes(half - (x12x * x12x + x12y * x12y));
+		Lanes m2 = maxZeroLanes(half - (x12z * x12z + x12w * x12w));
+		m0 = m0 * m0;
+		m1 = m1 * m1;
+		m2 = m2 * m2;
+		m0 = m0 * m0;
+		m1 = m1 * m1;
+		m2 = m2 * m2;
+
+		// x = 2 * fract(p * C.w) - 1
+		Lanes pw0 = p0 * Cw;
+		Lanes pw1 = p1 * Cw;
+		Lanes pw2 = p2 * Cw;
+		Lanes x0 = two * (pw0 - floorLanes(pw0)) - one;
+		Lanes x1 = two * (pw1 - floorLanes(pw1)) - one;
+		Lanes x2 = two * (pw2 - floorLanes(pw2)) - one;
+
+		// h = abs(x) - 0.5, a0 = x - floor(x + 0.5)
+		Lanes h0 = absLanes(x0) - half;
+		Lanes h1 = absLanes(x1) - half;
+		Lanes h2 = absLanes(x2) - half;
+		Lanes a0 = x0 - floorLanes(x0 + half);
+		Lanes a1 = x1 - floorLanes(x1 + half);
+		Lanes a2 = x2 - floorLanes(x2 + half);
+
+		// normalise gradients implicitly by scaling m
+		Lanes const n0 = Lanes::set(1.79284291400159f);
+		Lanes const n1 = Lanes::set(0.85373472095314f);
+		m0 = m0 * (n0 - n1 * (a0 * a0 + h0 * h0));
+		m1 = m1 * (n0 - n1 * (a1 * a1 + h1 * h1));
+		m2 = m2 * (n0 - n1 * (a2 * a2 + h2 * h2));
+
+		Lanes g0 = a0 * x0x + h0 * x0y;
+		Lanes g1 = a1 * x12x + h1 * x12y;
+		Lanes g2 = a2 * x12z + h2 * x12w;
+
+		return Lanes::set(130.0f) * ((m0 * g0 + m1 * g1) + m2 * g2);
+	}
+}
+
+float e2::simplex(glm::vec2 const& v)
+{
+	return ::simplexKernel(::ScalarLanes{ v.x }, ::ScalarLanes{ v.y }).v;
+}
+
+void e2::simplexBatch(float const* xs, float const* ys, float* outValues, uint32_t count)
+{
+	uint32_t i = 0;
+
+#if defined(E2_SIMPLEX_AVX2)
+	for (; i + 8 <= count; i += 8)
+		::simplexKernel(::AvxLanes::load(xs + i), ::AvxLanes::load(ys + i)).store(outValues + i);
+#elif defined(E2_SIMPLEX_SSE2)
+	for (; i + 4 <= count; i += 4)
+		::simplexKernel(::SseLanes::load(xs + i), ::SseLanes::load(ys + i)).store(outValues + i);
+#endif
+
+	for (; i < count; i++)
+		outValues[i] = ::simplexKernel(::ScalarLanes{ xs[i] }, ::ScalarLanes{ ys[i] }).v;
+}
+
+char const* e2::simplexPath()
+{
+#if defined(E2_SIMPLEX_AVX2)
+	return "AVX2";
+#elif defined(E2_SIMPLEX_SSE2)
+	return "SSE2";
+#else
+	return "Scalar";
+#endif
+}
+
+bool e2::testSimplexBatch(uint32_t numPoints)
+{
+	float const inf = std::numeric_limits<float>::infinity();
+	float const nan = std::numeric_limits<float>::quiet_NaN();
+
+	// every pair of these, they sit where floor, mod 289 and the skew are most likely to disagree between paths
+	float const edges[] = {
+		0.0f, -0.0f, 0.5f, -0.5f, 1.0f, -1.0f, std::nextafter(1.0f, 0.0f), std::nextafter(-1.0f, 0.0f),
+		0.211324865405187f, 0.366025403784439f, 288.0f, 289.0f, -289.0f, 289.0f * 289.0f,
+		8388607.5f, 8388608.0f, -8388608.5f, 16777216.0f, 1e30f, -1e30f,
+		std::numeric_limits<float>::min(), std::numeric_limits<float>::denorm_min(), inf, -inf, nan
+	};
+
+	std::vector<float> xs;
+	std::vector<float> ys;
+	for (float x : edges)
+	{
+		for (float y : edges)
+		{
+			xs.push_back(x);
+			ys.push_back(y);
+		}
+	}
+
+	// fixed seed, so a failure replays exactly. minstd is fully specified by the standard, unlike the distributions
+	std::minstd_rand random(0x0026);
+	float const ranges[] = { 1.0f, 64.0f, 5000.0f, 1e6f };
+	for (uint32_t i = 0; i < numPoints; i++)
+	{
+		float range = ranges[i % 4];
+		xs.push_back((float(random()) / float(std::minstd_rand::max()) * 2.0f - 1.0f) * range);
+		ys.push_back((float(random()) / float(std::minstd_rand::max()) * 2.0f - 1.0f) * range);
+	}
+
+	uint32_t numTotal = uint32_t(xs.size());
+	std::vector<float> expected(numTotal);
+	for (uint32_t i = 0; i < numTotal; i++)
+		expected[i] = e2::simplex({ xs[i], ys[i] });
+
+	// the whole lot in one go, then back to back batches of every count, so every tail length and lane alignment is covered.
+	// Each batch gets its own output with a guard behind it, nothing past count may be written
+	uint32_t const guard = 0x7FC0DEAD;
+	std::vector<float> batch(numTotal);
+	std::vector<float> output;
+	for (uint32_t count = 0; count <= e2::simplexLaneWidth * 2 + 3; count++)
+	{
+		uint32_t batchSize = count > 0 ? count : numTotal;
+		for (uint32_t offset = 0; offset < numTotal; offset += batchSize)
+		{
+			uint32_t num = glm::min(batchSize, numTotal - offset);
+			output.assign(num + e2::simplexLaneWidth, std::bit_cast<float>(guard));
+			e2::simplexBatch(xs.data() + offset, ys.data() + offset, output.data(), num);
+
+			for (uint32_t i = num; i < output.size(); i++)
+			{
+				if (std::bit_cast<uint32_t>(output[i]) != guard)
+				{
+					LogError("simplex: batch of {} wrote past its end ({})", num, e2::simplexPath());
+					return false;
+				}
+			}
+
+			std::copy(output.begin(), output.begin() + num, batch.begin() + offset);
+		}
+
+		for (uint32_t i = 0; i < numTotal; i++)
+		{
+			// no nan payload has any meaning here, all that matters is that both paths give one
+			bool bothNan = std::isnan(batch[i]) && std::isnan(expected[i]);
+			if (!bothNan && std::bit_cast<uint32_t>(batch[i]) != std::bit_cast<uint32_t>(expected[i]))
+			{
+				LogError("simplex: batch of {} gave {:a} for ({:a}, {:a}), scalar gave {:a} ({})", batchSize, batch[i], xs[i], ys[i], expected[i], e2::simplexPath());
+				return false;
+			}
+		}
+	}
+
+	LogNotice("simplex: {} points bit-identical to scalar in batches of 1 to {} ({})", numTotal, e2::simplexLaneWidth * 2 + 3, e2::simplexPath());
+	return true;
+}
@@ -0,0 +1,243 @@
+
+#include "game/pathfinding.hpp"
+#include "game/hex.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	// neighbour deltas in odd-r offset coords, same order as e2::Hex::neighbours (nw, ne, e, se, sw, w)
+	constexpr glm::ivec2 evenRowNeighbours[6] = { {-1, -1}, {0, -1}, {1, 0}, {0, 1}, {-1, 1}, {-1, 0} };
+	constexpr glm::ivec2 oddRowNeighbours[6] = { {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 0} };
+
+	inline glm::ivec2 const* neighbourDeltas(glm::ivec2 const& hex)
+	{
+		return (hex.y & 1) ? oddRowNeighbours : evenRowNeighbours;
+	}
+
+	// e2::Hex::distance without going through the Hex constructors
+	inline uint32_t hexDistance(glm::ivec2 const& a, glm::ivec2 const& b)
+	{
+		int32_t aq = a.x - (a.y - (a.y & 1)) / 2;
+		int32_t bq = b.x - (b.y - (b.y & 1)) / 2;
+		int32_t dq = aq - bq;
+		int32_t dr = a.y - b.y;
+		return uint32_t((glm::abs(dq) + glm::abs(dr) + glm::abs(dq + dr)) / 2);
+	}
+
+	// min-heap on estimate, ties pop the higher cost first (the node further along, with less left to go) so we keep pushing forward
+	inline bool heapGreater(e2::PathFindingContext::HeapNode const& lhs, e2::PathFindingContext::HeapNode const& rhs)
+	{
+		if (lhs.estimate != rhs.estimate)
+			return lhs.estimate > rhs.estimate;
+		return lhs.cost < rhs.cost;
+	}
+}
+
+e2::PathFindingContext::PathFindingContext(uint32_t maxRange)
+	: m_maxRange(maxRange)
+	, m_side(int32_t(maxRange) * 2 + 1)
+{
+	size_t numEntries = size_t(m_side) * size_t(m_side);
+	m_openGeneration.resize(numEntries, 0);
+	m_closedGeneration.resize(numEntries, 0);
+	m_cost.resize(numEntries, 0);
+	m_parent.resize(numEntries, -1);
+
+	m_queue.reserve(numEntries);
+	m_heap.reserve(1024);
+	m_visited.reserve(1024);
+}
+
+void e2::PathFindingContext::beginSearch(glm::ivec2 const& origin, uint32_t range)
+{
+	if (range > m_maxRange)
+	{
+		LogWarning("search range {} exceeds context range {}, clamping", range, m_maxRange);
+	}
+
+	m_origin = origin;
+	m_queue.clear();
+	m_heap.clear();
+	m_visited.clear();
+
+	// on wraparound, old generations would alias new ones, so reset for real
+	if (++m_generation == 0)
+	{
+		std::fill(m_openGeneration.begin(), m_openGeneration.end(), 0);
+		std::fill(m_closedGeneration.begin(), m_closedGeneration.end(), 0);
+		m_generation = 1;
+	}
+}
+
+int32_t e2::PathFindingContext::localIndex(glm::ivec2 const& hex) const
+{
+	// every step changes offset coords by at most 1 per axis, so range r always fits in the window
+	glm::ivec2 local = hex - m_origin + int32_t(m_maxRange);
+	if (local.x < 0 || local.y < 0 || local.x >= m_side || local.y >= m_side)
+		return -1;
+
+	return local.y * m_side + local.x;
+}
+
+bool e2::PathFindingContext::isPassable(e2::HexGrid* grid, glm::ivec2 const& hex, e2::PassableFlags passable, bool ignoreVisibility)
+{
+	if (!ignoreVisibility && !grid->isVisible(hex))
+		return false;
+
+	return grid->getProceduralTileData(hex).isPassable(passable);
+}
+
+uint32_t e2::PathFindingContext::floodFill(e2::HexGrid* grid, glm::ivec2 const& origin, uint32_t range, e2::PassableFlags passable, bool ignoreVisibility)
+{
+	beginSearch(origin, range);
+	range = glm::min(range, m_maxRange);
+
+	int32_t originIndex = localIndex(origin);
+	m_openGeneration[originIndex] = m_generation;
+	m_closedGeneration[originIndex] = m_generation;
+	m_cost[originIndex] = 0;
+	m_parent[originIndex] = -1;
+	m_queue.push_back(originIndex);
+	m_visited.push_back(origin);
+
+	// m_queue and m_visited are filled in lockstep, so the same cursor indexes both
+	for (size_t cursor = 0; cursor < m_queue.size(); cursor++)
+	{
+		int32_t currIndex = m_queue[cursor];
+		glm::ivec2 curr = m_visited[cursor];
+		uint32_t currCost = m_cost[currIndex];
+		if (currCost + 1 > range)
+			continue;
+
+		glm::ivec2 const* deltas = ::neighbourDeltas(curr);
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			glm::ivec2 n = curr + deltas[i];
+			int32_t nIndex = localIndex(n);
+			if (nIndex < 0 || m_openGeneration[nIndex] == m_generation)
+				continue;
+
+			// flag as seen even if it's impassable, so we only test it once
+			m_openGeneration[nIndex] = m_generation;
+
+			if (!isPassable(grid, n, passable, ignoreVisibility))
+				continue;
+
+			m_closedGeneration[nIndex] = m_generation;
+			m_cost[nIndex] = currCost + 1;
+			m_parent[nIndex] = currIndex;
+			m_queue.push_back(nIndex);
+			m_visited.push_back(n);
+		}
+	}
+
+	return uint32_t(m_visited.size());
+}
+
+bool e2::PathFindingContext::findPath(e2::HexGrid* grid, glm::ivec2 const& start, glm::ivec2 const& goal, uint32_t range, e2::PassableFlags passable, std::vector<glm::ivec2>& outPath, bool ignoreVisibility)
+{
+	outPath.clear();
+	beginSearch(start, range);
+	range = glm::min(range, m_maxRange);
+
+	int32_t goalIndex = localIndex(goal);
+	if (goalIndex < 0 || ::hexDistance(start, goal) > range)
+		return false;
+
+	int32_t startIndex = localIndex(start);
+	m_openGeneration[startIndex] = m_generation;
+	m_cost[startIndex] = 0;
+	m_parent[startIndex] = -1;
+	m_heap.push_back({ ::hexDistance(start, goal), 0, startIndex });
+
+	while (!m_heap.empty())
+	{
+		std::pop_heap(m_heap.begin(), m_heap.end(), ::heapGreater);
+		HeapNode node = m_heap.back();
+		m_heap.pop_back();
+
+		// stale entry, we already found a cheaper way here
+		if (m_closedGeneration[node.index] == m_generation)
+			continue;
+
+		m_closedGeneration[node.index] = m_generation;
+
+		glm::ivec2 curr = m_origin - int32_t(m_maxRange) + glm::ivec2(node.index % m_side, node.index / m_side);
+		m_visited.push_back(curr);
+
+		if (node.index == goalIndex)
+			return pathTo(goal, outPath);
+
+		if (node.cost + 1 > range)
+			continue;
+
+		glm::ivec2 const* deltas = ::neighbourDeltas(curr);
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			glm::ivec2 n = curr + deltas[i];
+			int32_t nIndex = localIndex(n);
+			if (nIndex < 0 || m_closedGeneration[nIndex] == m_generation)
+				continue;
+
+			uint32_t newCost = node.cost + 1;
+			bool seen = m_openGeneration[nIndex] == m_generation;
+			if (seen && m_cost[nIndex] <= newCost)
+				continue;
+
+			// impassable hexes get closed right away, so they're only tested once
+			if (!seen && !isPassable(grid, n, passable, ignoreVisibility))
+			{
+				m_openGeneration[nIndex] = m_generation;
+				m_closedGeneration[nIndex] = m_generation;
+				m_parent[nIndex] = -1;
+				continue;
+			}
+
+			m_openGeneration[nIndex] = m_generation;
+			m_cost[nIndex] = newCost;
+			m_parent[nIndex] = node.index;
+
+			m_heap.push_back({ newCost + ::hexDistance(n, goal), newCost, nIndex });
+			std::push_heap(m_heap.begin(), m_heap.end(), ::heapGreater);
+		}
+	}
+
+	return false;
+}
+
+bool e2::PathFindingContext::reached(glm::ivec2 const& hex) const
+{
+	int32_t index = localIndex(hex);
+	if (index < 0 || m_closedGeneration[index] != m_generation)
+		return false;
+
+	// impassable hexes are closed too, but never get a parent (only origin lacks one)
+	return m_parent[index] >= 0 || hex == m_origin;
+}
+
+uint32_t e2::PathFindingContext::stepsTo(glm::ivec2 const& hex) const
+{
+	if (!reached(hex))
+		return UINT32_MAX;
+
+	return m_cost[localIndex(hex)];
+}
+
+bool e2::PathFindingContext::pathTo(glm::ivec2 const& hex, std::vector<glm::ivec2>& outPath) const
+{
+	outPath.clear();
+	if (!reached(hex))
+		return false;
+
+	glm::ivec2 windowOrigin = m_origin - int32_t(m_maxRange);
+	int32_t cursor = localIndex(hex);
+	while (cursor >= 0)
+	{
+		outPath.push_back(windowOrigin + glm::ivec2(cursor % m_side, cursor / m_side));
+		cursor = m_parent[cursor];
+	}
+
+	std::reverse(outPath.begin(), outPath.end());
+	return true;
+}
@@ -561,8 +561,9 @@ void e2::HatchetHandler::onTrigger(e2::PlayerEntity* player, e2::Name actionName
 		uint32_t closestTree{};
 		bool didHitTree = false;
 		glm::ivec2 closestHex;
-		for (e2::Collision& c : player->getCollisionCache())
+		for (uint32_t i = 0; i < player->getCollisionCache().size(); i++)
 		{
+			e2::Collision c = player->getCollisionCache().get(i);
 			if (c.type != e2::CollisionType::Tree)
 				continue;
 
@@ -697,8 +698,9 @@ void e2::SwordHandler::onTrigger(e2::PlayerEntity* player, e2::Name actionName,
 		glm::vec2 const playerToMouse = glm::normalize(mouse - planarPosition);
 
 
-		for (e2::Collision& c : player->getCollisionCache())
+		for (uint32_t i = 0; i < player->getCollisionCache().size(); i++)
 		{
+			e2::Collision c = player->getCollisionCache().get(i);
 			if (c.type != e2::CollisionType::Component || (c.component && c.component->entity() == player))
 				continue;
 
@@ -76,11 +76,8 @@ void e2::RadionManager::tickWithParents(e2::RadionEntity* node)
 
 }
 
-void e2::RadionManager::update(double seconds)
+void e2::RadionManager::tick()
 {
-	m_timeAccumulator += seconds;
-	constexpr double tickRate = 1.0 / 10.0; // 10tps
-
 	m_endNodes.clear();
 
 	for (e2::RadionEntity* node : m_entities)
@@ -91,21 +88,16 @@ void e2::RadionManager::update(double seconds)
 		}
 	}
 
-	while (m_timeAccumulator >= tickRate)
+	m_tickedNodes.clear();
+	m_untickedNodes = m_entities;
+	for (e2::RadionEntity* endNode : m_endNodes)
 	{
-		m_tickedNodes.clear();
-		m_untickedNodes = m_entities;
-		for (e2::RadionEntity* endNode : m_endNodes)
-		{
-			tickWithParents(endNode);
-		}
-
-		while (!m_untickedNodes.empty())
-		{
-			tickWithParents(*m_untickedNodes.begin());
-		}
+		tickWithParents(endNode);
+	}
 
-		m_timeAccumulator -= tickRate;
+	while (!m_untickedNodes.empty())
+	{
+		tickWithParents(*m_untickedNodes.begin());
 	}
 }
 
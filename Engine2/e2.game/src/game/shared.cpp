@@ -1,8 +1,17 @@
 #include "game/shared.hpp"
 
+#include "e2/log.hpp"
 
 #include <glm/gtx/intersect.hpp>
 
+#include <algorithm>
+#include <limits>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define E2_COLLISION_SSE2
+#include <immintrin.h>
+#endif
+
 e2::SweepResult e2::circleSweepTest(
     glm::vec2 const& startLocation,
     glm::vec2 const& endLocation,
@@ -77,3 +86,273 @@ e2::OverlapResult e2::circleOverlapTest(glm::vec2 const& location1, float radius
 
     return result;
 }
+
+void e2::CollisionSet::clear()
+{
+    x.clear();
+    y.clear();
+    radius.clear();
+    types.clear();
+    hexes.clear();
+    components.clear();
+    treeIndices.clear();
+}
+
+void e2::CollisionSet::reserve(uint32_t capacity)
+{
+    x.reserve(capacity);
+    y.reserve(capacity);
+    radius.reserve(capacity);
+    types.reserve(capacity);
+    hexes.reserve(capacity);
+    components.reserve(capacity);
+    treeIndices.reserve(capacity);
+}
+
+void e2::CollisionSet::push(e2::Collision const& collision)
+{
+    x.push_back(collision.position.x);
+    y.push_back(collision.position.y);
+    radius.push_back(collision.radius);
+    types.push_back(collision.type);
+    hexes.push_back(collision.hex);
+    components.push_back(collision.component);
+    treeIndices.push_back(collision.treeIndex);
+}
+
+void e2::CollisionSet::append(e2::CollisionSet const& other, uint32_t begin, uint32_t end, e2::CollisionType mask)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        if ((other.types[i] & mask) != other.types[i])
+            continue;
+
+        x.push_back(other.x[i]);
+        y.push_back(other.y[i]);
+        radius.push_back(other.radius[i]);
+        types.push_back(other.types[i]);
+        hexes.push_back(other.hexes[i]);
+        components.push_back(other.components[i]);
+        treeIndices.push_back(other.treeIndices[i]);
+    }
+}
+
+e2::Collision e2::CollisionSet::get(uint32_t index) const
+{
+    e2::Collision returner;
+    returner.type = types[index];
+    returner.position = { x[index], y[index] };
+    returner.hex = hexes[index];
+    returner.radius = radius[index];
+    returner.component = components[index];
+    returner.treeIndex = treeIndices[index];
+    return returner;
+}
+
+void e2::sweepCandidates(e2::CollisionSet const& set, glm::vec2 const& startLocation, glm::vec2 const& endLocation, float sweepRadius, std::vector<uint32_t>& outIndices)
+{
+    outIndices.clear();
+
+    // circleSweepTest never hits on a zero length sweep
+    glm::vec2 delta = endLocation - startLocation;
+    float lengthSquared = glm::dot(delta, delta);
+    if (lengthSquared <= 0.0f)
+        return;
+
+    float invLengthSquared = 1.0f / lengthSquared;
+
+    // a hit means the circles touch somewhere on the segment, so distance from obstacle to segment is within the radii.
+    // pad it a little so float error never rejects something circleSweepTest would accept
+    constexpr float padScale = 1.001f;
+    constexpr float padBias = 0.0001f;
+
+    uint32_t count = set.size();
+    uint32_t i = 0;
+
+#if defined(E2_COLLISION_SSE2)
+    __m128 const sx = _mm_set1_ps(startLocation.x);
+    __m128 const sy = _mm_set1_ps(startLocation.y);
+    __m128 const dx = _mm_set1_ps(delta.x);
+    __m128 const dy = _mm_set1_ps(delta.y);
+    __m128 const invLen = _mm_set1_ps(invLengthSquared);
+    __m128 const sweep = _mm_set1_ps(sweepRadius);
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 ox = _mm_sub_ps(_mm_loadu_ps(set.x.data() + i), sx);
+        __m128 oy = _mm_sub_ps(_mm_loadu_ps(set.y.data() + i), sy);
+
+        // t = clamp(dot(o, d) / dot(d, d), 0, 1)
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ox, dx), _mm_mul_ps(oy, dy)), invLen);
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+        __m128 ex = _mm_sub_ps(ox, _mm_mul_ps(dx, t));
+        __m128 ey = _mm_sub_ps(oy, _mm_mul_ps(dy, t));
+        __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+
+        __m128 reach = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(set.radius.data() + i), sweep), _mm_set1_ps(padScale)), _mm_set1_ps(padBias));
+        int hits = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(reach, reach)));
+
+        while (hits)
+        {
+            uint32_t lane = 0;
+            while ((hits & (1 << lane)) == 0)
+                lane++;
+
+            outIndices.push_back(i + lane);
+            hits &= ~(1 << lane);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        glm::vec2 o = glm::vec2(set.x[i], set.y[i]) - startLocation;
+        float t = glm::clamp(glm::dot(o, delta) * invLengthSquared, 0.0f, 1.0f);
+        glm::vec2 e = o - delta * t;
+        float reach = (set.radius[i] + sweepRadius) * padScale + padBias;
+        if (glm::dot(e, e) <= reach * reach)
+            outIndices.push_back(i);
+    }
+}
+
+namespace
+{
+    /** Index and distance of the closest hit in set, testing only the given circles or all of them */
+    uint32_t closestSweepHit(e2::CollisionSet const& set, glm::vec2 const& start, glm::vec2 const& end, float radius, std::vector<uint32_t> const* indices, float& outDistance)
+    {
+        uint32_t closest = UINT32_MAX;
+        outDistance = std::numeric_limits<float>::max();
+
+        uint32_t count = indices ? uint32_t(indices->size()) : set.size();
+        for (uint32_t n = 0; n < count; n++)
+        {
+            uint32_t i = indices ? (*indices)[n] : n;
+            e2::SweepResult result = e2::circleSweepTest(start, end, radius, { set.x[i], set.y[i] }, set.radius[i]);
+            if (result.hit && result.moveDistance < outDistance)
+            {
+                outDistance = result.moveDistance;
+                closest = i;
+            }
+        }
+
+        return closest;
+    }
+}
+
+bool e2::testCollisionSweep(uint32_t numSweeps)
+{
+    // about what a query returns for a hex and its neighbours in a crowded forest: trees, a few terrain circles and a crowd of mobs.
+    // the count is not a multiple of four, so the scalar tail after the SSE2 loop is covered too
+    constexpr uint32_t numTrees = 96;
+    constexpr uint32_t numTerrain = 12;
+    constexpr uint32_t numMobs = 55;
+    constexpr float extent = 1.5f;
+
+    e2::CollisionSet set;
+    set.reserve(numTrees + numTerrain + numMobs);
+    auto pushCircles = [&set](uint32_t count, e2::CollisionType type, float minRadius, float maxRadius) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            e2::Collision collision;
+            collision.type = type;
+            collision.position = { e2::randomFloat(-extent, extent), e2::randomFloat(-extent, extent) };
+            collision.radius = e2::randomFloat(minRadius, maxRadius);
+            set.push(collision);
+        }
+    };
+    pushCircles(numTrees, e2::CollisionType::Tree, 0.05f, 0.15f);
+    pushCircles(numTerrain, e2::CollisionType::Mountain, 0.3f, 0.5f);
+    pushCircles(numMobs, e2::CollisionType::Component, 0.1f, 0.1f);
+
+    struct Sweep
+    {
+        glm::vec2 start;
+        glm::vec2 end;
+        float radius{};
+    };
+
+    // mob sized steps mostly, some long ones and some that don't move at all
+    std::vector<Sweep> sweeps(numSweeps);
+    for (Sweep& sweep : sweeps)
+    {
+        float angle = glm::radians(e2::randomFloat(0.0f, 360.0f));
+        float length = e2::randomInt(0, 9) == 0 ? 0.0f : (e2::randomBool() ? e2::randomFloat(0.0f, 0.1f) : e2::randomFloat(0.1f, 1.0f));
+        sweep.start = { e2::randomFloat(-extent, extent), e2::randomFloat(-extent, extent) };
+        sweep.end = sweep.start + glm::vec2(glm::cos(angle), glm::sin(angle)) * length;
+        sweep.radius = e2::randomFloat(0.05f, 0.2f);
+    }
+
+    // every circle circleSweepTest hits must be a candidate, and the closest hit must come out the same
+    std::vector<uint32_t> candidates;
+    uint64_t numCandidates{};
+    uint64_t numHits{};
+    for (Sweep const& sweep : sweeps)
+    {
+        e2::sweepCandidates(set, sweep.start, sweep.end, sweep.radius, candidates);
+        numCandidates += candidates.size();
+
+        for (uint32_t c = 1; c < candidates.size(); c++)
+        {
+            if (candidates[c] <= candidates[c - 1])
+            {
+                LogError("sweep candidates aren't ascending at {}", c);
+                return false;
+            }
+        }
+
+        for (uint32_t i = 0; i < set.size(); i++)
+        {
+            if (!e2::circleSweepTest(sweep.start, sweep.end, sweep.radius, { set.x[i], set.y[i] }, set.radius[i]).hit)
+                continue;
+
+            numHits++;
+            if (!std::binary_search(candidates.begin(), candidates.end(), i))
+            {
+                LogError("sweep from ({}, {}) to ({}, {}) radius {} hits circle {} but it's not a candidate", sweep.start.x, sweep.start.y, sweep.end.x, sweep.end.y, sweep.radius, i);
+                return false;
+            }
+        }
+
+        float allDistance{}, candidateDistance{};
+        uint32_t allClosest = ::closestSweepHit(set, sweep.start, sweep.end, sweep.radius, nullptr, allDistance);
+        uint32_t candidateClosest = ::closestSweepHit(set, sweep.start, sweep.end, sweep.radius, &candidates, candidateDistance);
+        if (allClosest != candidateClosest || allDistance != candidateDistance)
+        {
+            LogError("closest hit is {} over all circles but {} over candidates", allClosest, candidateClosest);
+            return false;
+        }
+    }
+
+    // what MovementComponent::move did before and does now, per sweep
+    // count hits, so the loops can't be optimized away
+    uint32_t allTimedHits{}, candidateTimedHits{};
+    e2::Timer allTimer;
+    for (Sweep const& sweep : sweeps)
+    {
+        float distance{};
+        allTimedHits += ::closestSweepHit(set, sweep.start, sweep.end, sweep.radius, nullptr, distance) != UINT32_MAX;
+    }
+    double allUs = allTimer.seconds() * 1000000.0 / numSweeps;
+
+    e2::Timer candidateTimer;
+    for (Sweep const& sweep : sweeps)
+    {
+        float distance{};
+        e2::sweepCandidates(set, sweep.start, sweep.end, sweep.radius, candidates);
+        candidateTimedHits += ::closestSweepHit(set, sweep.start, sweep.end, sweep.radius, &candidates, distance) != UINT32_MAX;
+    }
+    double candidateUs = candidateTimer.seconds() * 1000000.0 / numSweeps;
+
+    if (allTimedHits != candidateTimedHits)
+    {
+        LogError("timed runs disagree, {} sweeps hit something over all circles but {} over candidates", allTimedHits, candidateTimedHits);
+        return false;
+    }
+
+    LogNotice("collision sweep verified over {} sweeps against {} circles, {:.1f} candidates and {:.1f} hits per sweep. circleSweepTest on all {:.3f}us, sweepCandidates first {:.3f}us",
+        numSweeps, set.size(), double(numCandidates) / numSweeps, double(numHits) / numSweeps, allUs, candidateUs);
+    return true;
+}
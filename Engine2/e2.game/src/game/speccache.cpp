@@ -0,0 +1,433 @@
+
+#include "game/speccache.hpp"
+
+#include "e2/buffer.hpp"
+#include "e2/log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	constexpr uint32_t specCacheMagic = 0x43533245; // "E2SC"
+
+	uint64_t hashSource(std::string const& text)
+	{
+		// FNV-1a
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (char c : text)
+		{
+			hash ^= uint8_t(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	struct SpecSource
+	{
+		std::string path;
+		uint32_t directory{};
+
+		/** The cache entry for this path from the last boot, if any */
+		uint64_t cachedHash{};
+		std::vector<uint8_t> const* cached{};
+
+		// set on a worker
+		uint64_t hash{};
+		nlohmann::json json;
+		std::vector<uint8_t> encoded;
+		bool fromCache{};
+		std::string error;
+	};
+}
+
+e2::SpecCache::SpecCache(std::string const& cachePath)
+	: m_cachePath(cachePath)
+{
+}
+
+std::vector<e2::SpecDocument> e2::SpecCache::load(std::vector<std::string> const& directories)
+{
+	m_numCached = 0;
+	m_numParsed = 0;
+
+	// files are read and hashed on the workers
+	std::vector<::SpecSource> sources;
+	for (uint32_t i = 0; i < directories.size(); i++)
+	{
+		if (!std::filesystem::is_directory(directories[i]))
+			continue;
+
+		size_t first = sources.size();
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directories[i]))
+		{
+			if (!entry.is_regular_file())
+				continue;
+			if (entry.path().extension() != ".json")
+				continue;
+
+			::SpecSource newSource;
+			newSource.path = entry.path().string();
+			newSource.directory = i;
+			sources.push_back(newSource);
+		}
+
+		std::sort(sources.begin() + first, sources.end(), [](::SpecSource const& lhs, ::SpecSource const& rhs) {
+			return lhs.path < rhs.path;
+		});
+	}
+
+	std::vector<Entry> oldEntries;
+	read(oldEntries);
+
+	std::unordered_map<std::string, Entry*> oldByPath;
+	for (Entry& entry : oldEntries)
+		oldByPath[entry.path] = &entry;
+
+	for (::SpecSource& source : sources)
+	{
+		auto finder = oldByPath.find(source.path);
+		if (finder == oldByPath.end())
+			continue;
+
+		source.cachedHash = finder->second->sourceHash;
+		source.cached = &finder->second->encoded;
+	}
+
+	// decoding cached json costs about as much as parsing it, so hashing, decoding and parsing all happen in parallel. Everything that depends on the game happens later on the main thread
+	std::atomic<uint32_t> nextSource{};
+	auto loadWorker = [&sources, &nextSource]() {
+		for (uint32_t i = nextSource++; i < sources.size(); i = nextSource++)
+		{
+			::SpecSource& source = sources[i];
+
+			std::ifstream file(source.path, std::ios::binary);
+			std::stringstream text;
+			text << file.rdbuf();
+			std::string sourceText = text.str();
+			source.hash = ::hashSource(sourceText);
+
+			if (source.cached && source.cachedHash == source.hash)
+			{
+				try
+				{
+					source.json = nlohmann::json::from_msgpack(*source.cached);
+					source.fromCache = true;
+					continue;
+				}
+				catch (nlohmann::json::exception&)
+				{
+					// a broken entry is simply parsed again
+				}
+			}
+
+			try
+			{
+				source.json = nlohmann::json::parse(sourceText);
+				source.encoded = nlohmann::json::to_msgpack(source.json);
+			}
+			catch (nlohmann::json::exception& e)
+			{
+				source.error = e.what();
+			}
+		}
+	};
+
+	uint32_t numWorkers = std::min<uint32_t>(std::max(std::thread::hardware_concurrency(), 1u), uint32_t(sources.size()));
+	std::vector<std::thread> workers;
+	for (uint32_t i = 1; i < numWorkers; i++)
+		workers.emplace_back(loadWorker);
+	loadWorker();
+	for (std::thread& worker : workers)
+		worker.join();
+
+	std::vector<e2::SpecDocument> returner;
+	m_entries.clear();
+	for (::SpecSource& source : sources)
+	{
+		if (!source.error.empty())
+		{
+			LogError("failed to load specification {}, json parse error: {}", source.path, source.error);
+			continue;
+		}
+
+		e2::SpecDocument& newDocument = returner.emplace_back();
+		newDocument.path = source.path;
+		newDocument.directory = source.directory;
+		newDocument.json = std::move(source.json);
+
+		if (source.fromCache)
+		{
+			m_entries.push_back(std::move(*oldByPath.at(source.path)));
+			m_numCached++;
+		}
+		else
+		{
+			Entry& newEntry = m_entries.emplace_back();
+			newEntry.path = source.path;
+			newEntry.sourceHash = source.hash;
+			newEntry.encoded = std::move(source.encoded);
+			m_numParsed++;
+		}
+	}
+
+	// anything parsed, or anything that was cached but isn't anymore
+	if (m_numParsed > 0 || m_numCached != oldEntries.size())
+		write(m_entries);
+
+	return returner;
+}
+
+uint64_t e2::SpecCache::sourceHash(std::string const& path) const
+{
+	Entry const* entry = find(path);
+	return entry ? entry->sourceHash : 0;
+}
+
+std::vector<uint8_t> const* e2::SpecCache::encoded(std::string const& path) const
+{
+	Entry const* entry = find(path);
+	return entry ? &entry->encoded : nullptr;
+}
+
+e2::SpecCache::Entry const* e2::SpecCache::find(std::string const& path) const
+{
+	for (Entry const& entry : m_entries)
+	{
+		if (entry.path == path)
+			return &entry;
+	}
+
+	return nullptr;
+}
+
+bool e2::SpecCache::read(std::vector<Entry>& outEntries)
+{
+	if (!std::filesystem::exists(m_cachePath))
+		return false;
+
+	// the whole cache in one read, entries are decoded straight out of it
+	e2::FileStream file(m_cachePath, e2::FileMode::ReadOnly);
+	if (!file.valid())
+		return false;
+
+	e2::HeapStream data;
+	data << file;
+	data.seek(0);
+
+	uint32_t magic{}, version{}, numEntries{};
+	if (data.remaining() < sizeof(uint32_t) * 3)
+		return false;
+
+	data >> magic >> version >> numEntries;
+	if (magic != ::specCacheMagic || version != e2::specCacheVersion)
+	{
+		LogNotice("specification cache {} is outdated, rebuilding it", m_cachePath);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < numEntries; i++)
+	{
+		Entry newEntry;
+
+		uint64_t pathSize{};
+		if (data.remaining() < sizeof(uint64_t))
+			break;
+		data >> pathSize;
+		if (data.remaining() < pathSize + sizeof(uint64_t) * 2)
+			break;
+		uint8_t const* path = data.read(pathSize);
+		newEntry.path.assign(reinterpret_cast<char const*>(path), pathSize);
+
+		uint64_t encodedSize{};
+		data >> newEntry.sourceHash >> encodedSize;
+		if (data.remaining() < encodedSize)
+			break;
+		uint8_t const* encoded = data.read(encodedSize);
+		newEntry.encoded.assign(encoded, encoded + encodedSize);
+
+		outEntries.push_back(std::move(newEntry));
+	}
+
+	if (outEntries.size() != numEntries)
+	{
+		LogWarning("specification cache {} is truncated, rebuilding it", m_cachePath);
+		outEntries.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool e2::SpecCache::write(std::vector<Entry> const& entries)
+{
+	e2::HeapStream data;
+	data << ::specCacheMagic << e2::specCacheVersion << uint32_t(entries.size());
+	for (Entry const& entry : entries)
+	{
+		data << entry.path << entry.sourceHash << uint64_t(entry.encoded.size());
+		data.write(entry.encoded.data(), entry.encoded.size());
+	}
+	data.seek(0);
+
+	e2::FileStream file(m_cachePath, e2::FileMode::ReadWrite | e2::FileMode::Truncate);
+	file << data;
+
+	if (!file.valid())
+	{
+		LogError("failed to write specification cache {}", m_cachePath);
+		return false;
+	}
+
+	return true;
+}
+
+namespace
+{
+	void writeText(std::filesystem::path const& path, std::string const& text)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	}
+
+	/** Checks the documents are exactly the given files, in order and equal to parsing them directly */
+	bool checkDocuments(std::vector<e2::SpecDocument> const& documents, std::vector<std::filesystem::path> const& expected, std::vector<uint32_t> const& directories)
+	{
+		if (documents.size() != expected.size())
+		{
+			LogError("loaded {} specifications, expected {}", documents.size(), expected.size());
+			return false;
+		}
+
+		for (uint32_t i = 0; i < documents.size(); i++)
+		{
+			std::ifstream file(expected[i]);
+			nlohmann::json fresh = nlohmann::json::parse(file);
+			if (documents[i].path != expected[i].string() || documents[i].directory != directories[i] || documents[i].json != fresh)
+			{
+				LogError("specification {} ({}) doesn't match {}", i, documents[i].path, expected[i].string());
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool checkCounts(e2::SpecCache const& cache, char const* step, uint32_t numCached, uint32_t numParsed)
+	{
+		if (cache.numCached() != numCached || cache.numParsed() != numParsed)
+		{
+			LogError("{}: {} cached and {} parsed, expected {} and {}", step, cache.numCached(), cache.numParsed(), numCached, numParsed);
+			return false;
+		}
+
+		return true;
+	}
+}
+
+bool e2::testSpecCache()
+{
+	std::filesystem::path root = std::filesystem::temp_directory_path() / "e2_speccache_test";
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root / "entities" / "units");
+	std::filesystem::create_directories(root / "items");
+
+	std::filesystem::path a = root / "entities" / "a.json";
+	std::filesystem::path b = root / "entities" / "units" / "b.json";
+	std::filesystem::path c = root / "items" / "c.json";
+
+	::writeText(a, R"({ "id": "a", "specification": "e2::EntitySpecification", "health": 10, "nested": { "list": [1, 2.5, "x", true, null], "empty": {} } })");
+	::writeText(b, R"({ "id": "b", "specification": "e2::EntitySpecification", "scale": 0.125, "big": 18446744073709551615, "negative": -42 })");
+	::writeText(c, R"({ "id": "c", "name": "Fl\u00e5sk \"quoted\"", "cost": { "gold": 3 } })");
+	::writeText(root / "entities" / "notes.txt", "not a specification");
+
+	std::vector<std::string> directories = { (root / "entities").string(), (root / "items").string() };
+	std::string cachePath = (root / "cache" / "specifications.e2c").string();
+
+	bool success = true;
+
+	// first load parses everything and builds the cache, the second takes everything from it
+	e2::SpecCache first(cachePath);
+	success = ::checkDocuments(first.load(directories), { a, b, c }, { 0, 0, 1 }) && success;
+	success = ::checkCounts(first, "first load", 0, 3) && success;
+
+	e2::SpecCache second(cachePath);
+	success = ::checkDocuments(second.load(directories), { a, b, c }, { 0, 0, 1 }) && success;
+	success = ::checkCounts(second, "cached load", 3, 0) && success;
+
+	std::vector<uint8_t> encodedA = *second.encoded(a.string());
+	std::vector<uint8_t> encodedB = *second.encoded(b.string());
+	std::vector<uint8_t> encodedC = *second.encoded(c.string());
+
+	// changing one file only rebuilds its entry
+	::writeText(b, R"({ "id": "b", "specification": "e2::EntitySpecification", "scale": 0.25 })");
+	e2::SpecCache changed(cachePath);
+	success = ::checkDocuments(changed.load(directories), { a, b, c }, { 0, 0, 1 }) && success;
+	success = ::checkCounts(changed, "changed load", 2, 1) && success;
+
+	if (*changed.encoded(a.string()) != encodedA || *changed.encoded(c.string()) != encodedC || *changed.encoded(b.string()) == encodedB)
+	{
+		LogError("changing one specification touched the others");
+		success = false;
+	}
+
+	// same size and the same write time, only the content gives it away
+	std::filesystem::file_time_type writeTimeB = std::filesystem::last_write_time(b);
+	::writeText(b, R"({ "id": "b", "specification": "e2::EntitySpecification", "scale": 0.75 })");
+	std::filesystem::last_write_time(b, writeTimeB);
+	e2::SpecCache sameSize(cachePath);
+	success = ::checkDocuments(sameSize.load(directories), { a, b, c }, { 0, 0, 1 }) && success;
+	success = ::checkCounts(sameSize, "same size load", 2, 1) && success;
+
+	// and rewriting a file with what it already had doesn't rebuild anything
+	uint64_t hashB = sameSize.sourceHash(b.string());
+	::writeText(b, R"({ "id": "b", "specification": "e2::EntitySpecification", "scale": 0.75 })");
+	std::filesystem::last_write_time(b, writeTimeB + std::chrono::seconds(2));
+	e2::SpecCache touched(cachePath);
+	success = ::checkDocuments(touched.load(directories), { a, b, c }, { 0, 0, 1 }) && success;
+	success = ::checkCounts(touched, "touched load", 3, 0) && success;
+
+	if (hashB == 0 || touched.sourceHash(b.string()) != hashB)
+	{
+		LogError("rewriting a specification unchanged changed its hash");
+		success = false;
+	}
+
+	// removed and broken files drop out of the cache, without taking anything else with them
+	LogNotice("testing a broken specification, expect a parse error for {}", c.string());
+	std::filesystem::remove(a);
+	::writeText(c, R"({ "id": "c", )");
+	e2::SpecCache broken(cachePath);
+	success = ::checkDocuments(broken.load(directories), { b }, { 0 }) && success;
+	success = ::checkCounts(broken, "broken load", 1, 0) && success;
+
+	if (broken.encoded(a.string()) || broken.encoded(c.string()))
+	{
+		LogError("removed and broken specifications are still cached");
+		success = false;
+	}
+
+	// a truncated cache is rebuilt rather than trusted
+	std::filesystem::resize_file(cachePath, 10);
+	::writeText(c, R"({ "id": "c" })");
+	e2::SpecCache truncated(cachePath);
+	success = ::checkDocuments(truncated.load(directories), { b, c }, { 0, 1 }) && success;
+	success = ::checkCounts(truncated, "truncated cache", 0, 2) && success;
+
+	e2::SpecCache rebuilt(cachePath);
+	success = ::checkDocuments(rebuilt.load(directories), { b, c }, { 0, 1 }) && success;
+	success = ::checkCounts(rebuilt, "rebuilt cache", 2, 0) && success;
+
+	std::filesystem::remove_all(root);
+
+	if (success)
+		LogNotice("specification cache tests passed");
+
+	return success;
+}
@@ -0,0 +1,323 @@
+
+#include "game/vegetation.hpp"
+#include "e2/log.hpp"
+
+#include <algorithm>
+
+uint32_t e2::VegetationInstances::add(uint8_t meshIndex, glm::vec2 const& position, float rotation, float scale, float fallAngle)
+{
+	if (meshIndex >= e2::maxNumVegetationMeshes)
+	{
+		LogError("invalid vegetation mesh {}", uint32_t(meshIndex));
+		return UINT32_MAX;
+	}
+
+	std::vector<e2::InstanceData>& records = m_records[meshIndex];
+	if (records.size() >= e2::maxNumVegetationInstances)
+		return UINT32_MAX;
+
+	uint32_t handle{};
+	if (m_freeSlots.empty())
+	{
+		handle = (uint32_t)m_slots.size();
+		m_slots.emplace_back();
+	}
+	else
+	{
+		handle = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+
+	m_slots[handle].meshIndex = meshIndex;
+	m_slots[handle].recordIndex = (uint32_t)records.size();
+
+	e2::InstanceData& record = records.emplace_back();
+	record.transform = glm::vec4(position.x, 0.0f, position.y, rotation);
+	record.parameters = glm::vec4(scale, fallAngle, e2::vegetationNotStarted, e2::vegetationNotStarted);
+	m_recordHandles[meshIndex].push_back(handle);
+
+	m_dirty[meshIndex] = true;
+	return handle;
+}
+
+void e2::VegetationInstances::remove(uint32_t handle)
+{
+	if (!valid(handle))
+		return;
+
+	Slot& slot = m_slots[handle];
+	std::vector<e2::InstanceData>& records = m_records[slot.meshIndex];
+	std::vector<uint32_t>& recordHandles = m_recordHandles[slot.meshIndex];
+
+	// move the last record into the hole
+	uint32_t lastIndex = (uint32_t)records.size() - 1;
+	if (slot.recordIndex != lastIndex)
+	{
+		uint32_t movedHandle = recordHandles[lastIndex];
+		records[slot.recordIndex] = records[lastIndex];
+		recordHandles[slot.recordIndex] = movedHandle;
+		m_slots[movedHandle].recordIndex = slot.recordIndex;
+	}
+
+	records.pop_back();
+	recordHandles.pop_back();
+	m_dirty[slot.meshIndex] = true;
+
+	slot.recordIndex = UINT32_MAX;
+	m_freeSlots.push_back(handle);
+}
+
+void e2::VegetationInstances::shake(uint32_t handle, float time)
+{
+	if (!valid(handle))
+		return;
+
+	Slot const& slot = m_slots[handle];
+	m_records[slot.meshIndex][slot.recordIndex].parameters.z = time;
+	m_dirty[slot.meshIndex] = true;
+}
+
+void e2::VegetationInstances::fall(uint32_t handle, float time)
+{
+	if (!valid(handle))
+		return;
+
+	Slot const& slot = m_slots[handle];
+	m_records[slot.meshIndex][slot.recordIndex].parameters.w = time;
+	m_dirty[slot.meshIndex] = true;
+}
+
+void e2::VegetationInstances::clear()
+{
+	for (uint32_t i = 0; i < e2::maxNumVegetationMeshes; i++)
+	{
+		if (!m_records[i].empty())
+			m_dirty[i] = true;
+
+		m_records[i].clear();
+		m_recordHandles[i].clear();
+	}
+
+	m_slots.clear();
+	m_freeSlots.clear();
+}
+
+bool e2::VegetationInstances::valid(uint32_t handle) const
+{
+	return handle < m_slots.size() && m_slots[handle].recordIndex != UINT32_MAX;
+}
+
+e2::InstanceData const& e2::VegetationInstances::instance(uint32_t handle) const
+{
+	Slot const& slot = m_slots[handle];
+	return m_records[slot.meshIndex][slot.recordIndex];
+}
+
+uint32_t e2::VegetationInstances::numInstances() const
+{
+	uint32_t total{};
+	for (uint32_t i = 0; i < e2::maxNumVegetationMeshes; i++)
+		total += (uint32_t)m_records[i].size();
+
+	return total;
+}
+
+uint32_t e2::VegetationInstances::numInstances(uint8_t meshIndex) const
+{
+	return (uint32_t)m_records[meshIndex].size();
+}
+
+e2::InstanceData const* e2::VegetationInstances::instances(uint8_t meshIndex) const
+{
+	return m_records[meshIndex].data();
+}
+
+bool e2::VegetationInstances::dirty(uint8_t meshIndex) const
+{
+	return m_dirty[meshIndex];
+}
+
+void e2::VegetationInstances::markClean(uint8_t meshIndex)
+{
+	m_dirty[meshIndex] = false;
+}
+
+bool e2::testVegetationInstances(uint32_t numIterations)
+{
+	// trees are spread over a few chunks, and a chunk unloading removes all of its trees at once
+	constexpr uint32_t numChunks = 8;
+
+	struct ExpectedTree
+	{
+		uint32_t handle{};
+		uint8_t meshIndex{};
+		uint32_t chunk{};
+		e2::InstanceData data;
+	};
+
+	e2::VegetationInstances vegetation;
+	std::vector<ExpectedTree> expected;
+	bool expectedDirty[e2::maxNumVegetationMeshes]{};
+	std::vector<bool> seen;
+
+	uint32_t numAdded{};
+	uint32_t numCut{};
+	uint32_t numUnloads{};
+
+	auto removeTree = [&](uint32_t i) {
+		vegetation.remove(expected[i].handle);
+		expectedDirty[expected[i].meshIndex] = true;
+		expected[i] = expected.back();
+		expected.pop_back();
+	};
+
+	for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+	{
+		float time = float(iteration) / 60.0f;
+
+		uint32_t numChanges = uint32_t(e2::randomInt(0, 8));
+		for (uint32_t c = 0; c < numChanges; c++)
+		{
+			int64_t op = e2::randomInt(0, 99);
+			if (op < 40 || expected.empty())
+			{
+				// a forest unpacks a tree
+				ExpectedTree tree;
+				tree.meshIndex = uint8_t(e2::randomInt(0, e2::maxNumVegetationMeshes - 1));
+				tree.chunk = uint32_t(e2::randomInt(0, numChunks - 1));
+
+				glm::vec2 position{ e2::randomFloat(-100.0f, 100.0f), e2::randomFloat(-100.0f, 100.0f) };
+				float rotation = e2::randomFloat(0.0f, glm::two_pi<float>());
+				float scale = e2::randomFloat(0.5f, 1.5f);
+				float fallAngle = e2::randomFloat(-glm::pi<float>(), glm::pi<float>());
+
+				tree.handle = vegetation.add(tree.meshIndex, position, rotation, scale, fallAngle);
+				if (tree.handle == UINT32_MAX)
+				{
+					if (vegetation.numInstances(tree.meshIndex) < e2::maxNumVegetationInstances)
+					{
+						LogError("vegetation: add failed with room to spare after {} iterations", iteration);
+						return false;
+					}
+					continue;
+				}
+
+				for (ExpectedTree const& other : expected)
+				{
+					if (other.handle == tree.handle)
+					{
+						LogError("vegetation: handle {} given out twice after {} iterations", tree.handle, iteration);
+						return false;
+					}
+				}
+
+				tree.data.transform = glm::vec4(position.x, 0.0f, position.y, rotation);
+				tree.data.parameters = glm::vec4(scale, fallAngle, e2::vegetationNotStarted, e2::vegetationNotStarted);
+				expected.push_back(tree);
+				expectedDirty[tree.meshIndex] = true;
+				numAdded++;
+			}
+			else if (op < 65)
+			{
+				// a tree is hit
+				ExpectedTree& tree = expected[e2::randomInt(0, int64_t(expected.size()) - 1)];
+				vegetation.shake(tree.handle, time);
+				tree.data.parameters.z = time;
+				expectedDirty[tree.meshIndex] = true;
+			}
+			else if (op < 80)
+			{
+				// a tree is cut, it shakes and starts falling
+				ExpectedTree& tree = expected[e2::randomInt(0, int64_t(expected.size()) - 1)];
+				vegetation.shake(tree.handle, time);
+				vegetation.fall(tree.handle, time);
+				tree.data.parameters.z = time;
+				tree.data.parameters.w = time;
+				expectedDirty[tree.meshIndex] = true;
+				numCut++;
+			}
+			else if (op < 97)
+			{
+				// a fallen tree turns into lumber
+				removeTree(uint32_t(e2::randomInt(0, int64_t(expected.size()) - 1)));
+			}
+			else
+			{
+				// a chunk unloads
+				uint32_t chunk = uint32_t(e2::randomInt(0, numChunks - 1));
+				for (uint32_t i = 0; i < expected.size();)
+				{
+					if (expected[i].chunk == chunk)
+						removeTree(i);
+					else
+						i++;
+				}
+				numUnloads++;
+			}
+		}
+
+		if (vegetation.numInstances() != expected.size())
+		{
+			LogError("vegetation: {} instances, expected {} after {} iterations", vegetation.numInstances(), expected.size(), iteration);
+			return false;
+		}
+
+		uint32_t expectedCounts[e2::maxNumVegetationMeshes]{};
+		for (ExpectedTree const& tree : expected)
+			expectedCounts[tree.meshIndex]++;
+
+		for (uint8_t m = 0; m < e2::maxNumVegetationMeshes; m++)
+		{
+			if (vegetation.numInstances(m) != expectedCounts[m])
+			{
+				LogError("vegetation: mesh {} has {} instances, expected {} after {} iterations", uint32_t(m), vegetation.numInstances(m), expectedCounts[m], iteration);
+				return false;
+			}
+		}
+
+		// every tree has its own record with what we last gave it, and as the counts match, no record is left over
+		for (uint8_t m = 0; m < e2::maxNumVegetationMeshes; m++)
+		{
+			seen.assign(vegetation.numInstances(m), false);
+			for (ExpectedTree const& tree : expected)
+			{
+				if (tree.meshIndex != m)
+					continue;
+
+				if (!vegetation.valid(tree.handle))
+				{
+					LogError("vegetation: handle {} invalid after {} iterations", tree.handle, iteration);
+					return false;
+				}
+
+				e2::InstanceData const& record = vegetation.instance(tree.handle);
+				if (record.transform != tree.data.transform || record.parameters != tree.data.parameters)
+				{
+					LogError("vegetation: record of handle {} is wrong after {} iterations", tree.handle, iteration);
+					return false;
+				}
+
+				size_t recordIndex = size_t(&record - vegetation.instances(m));
+				if (recordIndex >= seen.size() || seen[recordIndex])
+				{
+					LogError("vegetation: handle {} points at record {} which is out of range or shared, after {} iterations", tree.handle, recordIndex, iteration);
+					return false;
+				}
+				seen[recordIndex] = true;
+			}
+
+			// only meshes that changed may be uploaded
+			if (vegetation.dirty(m) != expectedDirty[m])
+			{
+				LogError("vegetation: mesh {} dirty is {}, expected {} after {} iterations", uint32_t(m), vegetation.dirty(m), expectedDirty[m], iteration);
+				return false;
+			}
+
+			vegetation.markClean(m);
+			expectedDirty[m] = false;
+		}
+	}
+
+	LogNotice("vegetation instances verified over {} iterations, {} trees added, {} cut, {} chunk unloads, {} left", numIterations, numAdded, numCut, numUnloads, expected.size());
+	return true;
+}
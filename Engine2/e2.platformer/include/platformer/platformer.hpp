@@ -9,9 +9,11 @@
 #include <e2/rhi/window.hpp>
 #include <e2/managers/networkmanager.hpp>
 
+#include "platformer/snapshot.hpp"
+#include "platformer/simulation.hpp"
+
 namespace e2
 {
-	constexpr uint64_t maxNetPlayers = 8;
 	constexpr uint8_t packetId_ClientFetchGameInfo = 0;
 	constexpr uint8_t packetId_ClientInput = 1;
 	constexpr uint8_t packetId_ClientInfo = 2;
@@ -19,19 +21,29 @@ namespace e2
 	constexpr uint8_t packetId_ServerFrame = 129;
 	constexpr uint8_t packetId_ServerGameEnd = 130;
 	constexpr uint8_t packetId_ServerPlayerLeft = 131;
+	constexpr uint8_t packetId_ServerPlayerTable = 132;
 
 
 	struct ServerPlayerState
 	{
 		e2::Name name;
 		e2::NetPeerAddress address;
+		uint8_t id{};
 
 		uint64_t lastClientFrameIndex{};
 
-		// input states
-		bool buttonMoveLeft{};
-		bool buttonMoveRight{};
-		bool buttonJump{};
+		// newest snapshot the client told us it has, frames are deltas against it
+		bool hasAckedSnapshot{};
+		uint16_t ackedSnapshot{};
+
+		// client input waiting for a tick, one is consumed per tick
+		std::deque<e2::TickedInput> pendingInputs;
+		bool hasQueuedInput{};
+		uint64_t lastQueuedInput{};
+
+		// newest input we stepped, sent back with every frame so the client can reconcile
+		bool hasProcessedInput{};
+		uint64_t lastProcessedInput{};
 
 		// world states 
 		glm::vec2 position{};
@@ -42,7 +54,7 @@ namespace e2
 	struct ClientPlayerState
 	{
 		e2::Name name;
-		uint64_t lastServerFrameIndex{};
+		uint8_t id{};
 
 		// world states 
 		glm::vec2 position{};
@@ -51,27 +63,45 @@ namespace e2
 
 	struct ServerManager
 	{
-		uint64_t frameIndex;
-		double frameTickRate = 120.0;
-		e2::Moment lastSentFrame;
+		uint64_t frameIndex{};
+		double tickAccumulator{};
 
 		std::unordered_map<e2::Name, ServerPlayerState> players;
+
+		// player ids are what goes over the wire, names are only sent once in the player table
+		bool idInUse[e2::maxNetPlayers]{};
+		e2::Name playerIds[e2::maxNetPlayers];
+
+		e2::SnapshotHistory snapshots;
+
+		// every frame goes to this file while it's open, see Platformer::startRecording
+		e2::FileStream* recording{};
+		uint64_t numRecordedFrames{};
 	};
 
 	struct ClientManager
 	{
-		uint64_t frameIndex;
-
 		bool joinedGame{};
 		e2::Name localPlayerName;
 		bool buttonMoveLeft{};
 		bool buttonMoveRight{};
 		bool buttonJump{};
 
-		double inputTickRate = 120.0;
-		e2::Moment lastSentInput;
+		double tickAccumulator{};
+		e2::ClientPrediction prediction;
+		e2::SnapshotInterpolator interpolator;
 
 		std::unordered_map<e2::Name, ClientPlayerState> players;
+
+		// from the servers player table
+		bool hasLocalPlayerId{};
+		uint8_t localPlayerId{};
+		bool playerKnown[e2::maxNetPlayers]{};
+		e2::Name playerNames[e2::maxNetPlayers];
+
+		e2::SnapshotHistory snapshots;
+		bool hasSnapshot{};
+		uint16_t lastSnapshot{};
 	};
 
 
@@ -112,6 +142,25 @@ namespace e2
 		virtual void postDispatch(uint8_t frameIndex) override;
 
 
+		/** Server only. Gives name the first free player id, returns false if the game is full */
+		bool assignPlayerId(e2::Name name);
+
+		/** Server only. Sends every player id and name to all clients */
+		void broadcastPlayerTable();
+
+		/** Server only. Runs as many simulation ticks as seconds covers, and sends every client its frame. localInput is the hosting player, or nullptr for a dedicated server */
+		void tickServer(double seconds, e2::PlayerInput const* localInput);
+
+		/** Server only. Starts writing every frame to recordPath, if it's set, until stopRecording or maxRecordedFrames */
+		void startRecording();
+		void stopRecording();
+
+		/** Where a server records its session, set by --record. Replay it with --replay */
+		std::string recordPath;
+
+		/** Port we host on. A headless engine runs a dedicated server on it */
+		uint16_t serverPort{ 1337 };
+
 		ServerManager serverManager;
 		ClientManager clientManager;
 
@@ -0,0 +1,198 @@
+
+#pragma once
+
+#include <e2/utils.hpp>
+
+#include "platformer/snapshot.hpp"
+
+#include <deque>
+
+namespace e2
+{
+	class NetworkManager;
+
+	/** Server and client both step players at this fixed rate, with the same code, so the client can predict exactly what the server will do */
+	constexpr double simulationTickRate = 120.0;
+
+	constexpr float playerMoveSpeed = 100.0f;
+	constexpr float playerJumpSpeed = 300.0f;
+	constexpr float playerGravity = 900.0f;
+	constexpr float playerGroundHeight = 500.0f;
+
+	/** A long frame runs at most this many ticks, the rest is dropped rather than spiraling */
+	constexpr uint32_t maxTicksPerUpdate = 8;
+
+	/** Inputs the server holds per player, beyond this the oldest are dropped so a burst can't add lasting latency */
+	constexpr uint32_t maxQueuedInputs = 16;
+
+	/** Ticks of input the client remembers for replay, about a second */
+	constexpr uint32_t predictionHistorySize = 128;
+
+	/** Inputs per input packet, the newest plus the ones before it in case those were lost */
+	constexpr uint32_t redundantInputs = 4;
+
+	/** Remote players are drawn this many ticks behind the newest snapshot, so there's usually one on each side to interpolate between */
+	constexpr double interpolationDelayTicks = 6.0;
+
+	struct PlayerInput
+	{
+		bool moveLeft{};
+		bool moveRight{};
+		bool jump{};
+
+		uint8_t pack() const
+		{
+			return uint8_t(moveLeft) | uint8_t(moveRight) << 1 | uint8_t(jump) << 2;
+		}
+
+		static PlayerInput unpack(uint8_t bits)
+		{
+			return { (bits & 1) != 0, (bits & 2) != 0, (bits & 4) != 0 };
+		}
+	};
+
+	struct TickedInput
+	{
+		uint64_t tick{};
+		e2::PlayerInput input;
+	};
+
+	/**
+	 * Steps one player one tick. The result is snapped to the snapshot quantization grid,
+	 * so a client that rewinds to a state from a snapshot replays to exactly what the server has
+	 */
+	void stepPlayer(glm::vec2& position, glm::vec2& velocity, e2::PlayerInput const& input);
+
+	/**
+	 * Predicts the local player from its own input, and rewinds and replays when the server disagrees.
+	 * The server steps a player once per input it gets and nothing else, so its state for an input tick is directly comparable to ours
+	 */
+	class ClientPrediction
+	{
+	public:
+		/** Starts predicting from an authoritative state */
+		void reset(e2::SnapshotPlayer const& serverState);
+
+		/** Records input for the next tick and steps our player with it. Returns the tick */
+		uint64_t predict(e2::PlayerInput const& input);
+
+		/** Server state after it processed our input with the given (16 bit wrapped) tick. Rewinds and replays if we got it wrong */
+		void reconcile(uint16_t inputTick, e2::SnapshotPlayer const& serverState);
+
+		/** The last count inputs, oldest first. Returns how many there were */
+		uint32_t recentInputs(e2::TickedInput* outInputs, uint32_t count) const;
+
+		bool hasState() const
+		{
+			return m_hasState;
+		}
+
+		glm::vec2 const& position() const
+		{
+			return m_position;
+		}
+
+		/** Newest tick we predicted, the next predict() is one after this */
+		uint64_t tick() const
+		{
+			return m_tick;
+		}
+
+		/** How far off we were at the last reconcile, and at worst, in pixels */
+		float lastError() const
+		{
+			return m_lastError;
+		}
+
+		float maxError() const
+		{
+			return m_maxError;
+		}
+
+		uint32_t numReconciled() const
+		{
+			return m_numReconciled;
+		}
+
+		uint32_t numCorrections() const
+		{
+			return m_numCorrections;
+		}
+
+	protected:
+		struct HistoryEntry
+		{
+			uint64_t tick{ UINT64_MAX };
+			e2::PlayerInput input;
+
+			// false for ticks stepped before we had a state from the server
+			bool predicted{};
+
+			// state after input was applied
+			glm::vec2 position{};
+			glm::vec2 velocity{};
+		};
+
+		HistoryEntry m_history[e2::predictionHistorySize];
+		uint64_t m_tick{};
+		bool m_hasTicked{};
+
+		bool m_hasState{};
+		glm::vec2 m_position{};
+		glm::vec2 m_velocity{};
+
+		bool m_hasReconciled{};
+		uint64_t m_lastReconciled{};
+
+		float m_lastError{};
+		float m_maxError{};
+		uint32_t m_numReconciled{};
+		uint32_t m_numCorrections{};
+	};
+
+	/** Buffers snapshots and plays them back a little behind the newest, so remote players move smoothly between updates */
+	class SnapshotInterpolator
+	{
+	public:
+		void push(e2::Snapshot const& snapshot);
+
+		/** Moves render time forward, drifting it towards interpolationDelayTicks behind the newest snapshot */
+		void advance(double seconds);
+
+		/** Position of playerId at the current render time, false if we don't have it */
+		bool sample(uint32_t playerId, glm::vec2& outPosition) const;
+
+		double renderTick() const
+		{
+			return m_renderTick;
+		}
+
+		void clear();
+
+	protected:
+		struct Sample
+		{
+			uint64_t tick{};
+			e2::Snapshot snapshot;
+		};
+
+		std::deque<Sample> m_samples;
+		bool m_started{};
+		uint64_t m_newestTick{};
+		double m_renderTick{};
+	};
+
+	/**
+	 * testPrediction fails if interpolated remote players are further than this off on average, or (with loss) a reconcile finds us further off than this.
+	 * At worst the server never got the ticks we jumped on, and we're a whole jump plus a few ticks of running off
+	 */
+	constexpr double maxPredictionTestInterpolationError = 8.0;
+	constexpr float maxPredictionTestLossyError = e2::playerJumpSpeed * e2::playerJumpSpeed / (2.0f * e2::playerGravity) + e2::playerMoveSpeed * 0.1f;
+
+	/**
+	 * Hosts on port and runs a server and a predicting client against each other over loopback, in real time, with the given latency, jitter and loss (both ways)
+	 * set on net's shims. The local player follows a script and so does a remote player. Without loss every reconcile must agree exactly and nothing is corrected,
+	 * with loss the error must stay bounded. Logs the result and returns it, false if net isn't offline
+	 */
+	bool testPrediction(e2::NetworkManager& net, uint16_t port, double latency, double jitter, float packetLoss, uint32_t numTicks);
+}
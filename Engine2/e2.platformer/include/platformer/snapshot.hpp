@@ -0,0 +1,151 @@
+
+#pragma once
+
+#include <e2/utils.hpp>
+
+#include <vector>
+
+namespace e2
+{
+	constexpr uint64_t maxNetPlayers = 8;
+
+	/** Positions are sent in 1/8 pixels and velocities in 1/4 pixels per second, clamped to these many bits (signed) */
+	constexpr float snapshotPositionScale = 8.0f;
+	constexpr float snapshotVelocityScale = 4.0f;
+	constexpr uint32_t snapshotPositionBits = 20;
+	constexpr uint32_t snapshotVelocityBits = 16;
+
+	/** Snapshots both ends remember for delta baselines. Anything acked longer ago than this is sent in full */
+	constexpr uint32_t snapshotHistorySize = 32;
+
+	/** Quantized state of one player */
+	struct SnapshotPlayer
+	{
+		bool present{};
+		int32_t position[2]{};
+		int32_t velocity[2]{};
+
+		bool operator==(SnapshotPlayer const& other) const = default;
+	};
+
+	/** Quantized state of every player for one server frame, indexed by player id */
+	struct Snapshot
+	{
+		uint16_t sequence{};
+		e2::SnapshotPlayer players[e2::maxNetPlayers];
+	};
+
+	e2::SnapshotPlayer quantizePlayer(glm::vec2 const& position, glm::vec2 const& velocity);
+	glm::vec2 dequantizePosition(e2::SnapshotPlayer const& player);
+	glm::vec2 dequantizeVelocity(e2::SnapshotPlayer const& player);
+
+	/** Last snapshotHistorySize snapshots, by sequence */
+	class SnapshotHistory
+	{
+	public:
+		void store(e2::Snapshot const& snapshot);
+
+		/** The snapshot with the given sequence, or nullptr if we don't have it (anymore) */
+		e2::Snapshot const* find(uint16_t sequence) const;
+
+		void clear();
+
+	protected:
+		e2::Snapshot m_snapshots[e2::snapshotHistorySize];
+		bool m_valid[e2::snapshotHistorySize]{};
+	};
+
+	/** Packs values of arbitrary bit width, lsb first */
+	class BitWriter
+	{
+	public:
+		void write(uint32_t value, uint32_t numBits);
+
+		/** Pads the last byte, call before bytes() */
+		void flush();
+
+		std::vector<uint8_t> const& bytes() const
+		{
+			return m_bytes;
+		}
+
+		void clear();
+
+	protected:
+		std::vector<uint8_t> m_bytes;
+		uint64_t m_scratch{};
+		uint32_t m_scratchBits{};
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(uint8_t const* data, uint64_t size);
+
+		/** Reads numBits, returns 0 and flags overflowed() if we run out */
+		uint32_t read(uint32_t numBits);
+
+		bool overflowed() const
+		{
+			return m_overflowed;
+		}
+
+	protected:
+		uint8_t const* m_data{};
+		uint64_t m_size{};
+		uint64_t m_cursor{};
+		uint64_t m_scratch{};
+		uint32_t m_scratchBits{};
+		bool m_overflowed{};
+	};
+
+	/**
+	 * Writes snapshot, as a delta against baseline if given (it must be within snapshotHistorySize of it).
+	 * Unchanged players cost a bit, and changed values are sent as variable width deltas, so players moving at a steady pace cost a couple of bytes
+	 */
+	void encodeSnapshot(e2::Snapshot const& snapshot, e2::Snapshot const* baseline, e2::BitWriter& writer);
+
+	/** Reads a snapshot written by encodeSnapshot, looking up its baseline in history. Returns false if it's corrupt or we don't have the baseline */
+	bool decodeSnapshot(e2::BitReader& reader, e2::SnapshotHistory const& history, e2::Snapshot& outSnapshot);
+
+	/** Writes a ServerFrame packet: its id, whether the client's input was processed and the newest processed input tick, then the encoded snapshot */
+	void writeServerFrame(e2::IStream& toBuffer, bool hasProcessedInput, uint16_t lastProcessedInput, e2::BitWriter const& snapshot);
+
+	struct RecordedPlayer
+	{
+		uint8_t id{};
+		e2::Name name;
+		glm::vec2 position{};
+		glm::vec2 velocity{};
+	};
+
+	/** Server world state of one frame, as recorded by the platformer server */
+	struct RecordedFrame
+	{
+		uint64_t frameIndex{};
+		std::vector<e2::RecordedPlayer> players;
+	};
+
+	e2::Snapshot makeSnapshot(e2::RecordedFrame const& frame);
+
+	/** A made up session of numPlayers joining one by one and running back and forth, for when nothing was recorded */
+	std::vector<e2::RecordedFrame> synthesizeRecording(uint32_t numFrames, uint32_t numPlayers);
+
+	/** Starts every recording file */
+	constexpr uint32_t recordingMagic = 0x43455245; // "EREC"
+
+	/** A server stops recording after this many frames, half an hour at 120Hz (~50MB with 8 players) */
+	constexpr uint64_t maxRecordedFrames = 120 * 60 * 30;
+
+	/** Appends frame to a recording. The file starts with recordingMagic */
+	void writeRecordedFrame(e2::IStream& toBuffer, e2::RecordedFrame const& frame);
+
+	/** Reads every frame of the recording at path. Returns false if it can't be read or isn't a recording, a partial frame at the end (the server died mid write) is left out */
+	bool readRecording(std::string const& path, std::vector<e2::RecordedFrame>& outFrames);
+
+	/**
+	 * Replays frames through the old full-state frame format and through delta snapshots, with packetLoss of snapshots and acks dropped and acks arriving a few frames late.
+	 * Verifies every snapshot that arrives decodes to exactly what the server had and that deltas come out smaller, logs bytes per frame and per player for both and returns the result
+	 */
+	bool replaySnapshotRecording(std::vector<e2::RecordedFrame> const& frames, float packetLoss);
+}
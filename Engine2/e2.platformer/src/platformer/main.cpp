@@ -1,18 +1,123 @@
-
 #include <e2/e2.hpp>
+#include <e2/log.hpp>
+#include <e2/managers/networkmanager.hpp>
 
 #include "platformer/platformer.hpp"
 
 #include "init.inl"
 
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+
+namespace
+{
+	e2::Engine* s_engine{};
+
+	void onTerminate(int signal)
+	{
+		if (s_engine)
+			s_engine->shutdown();
+	}
+}
+
 int main(int argc, char** argv)
 {
 	::registerGeneratedTypes();
+
+	// --server [port] runs a dedicated server, without window, renderer, UI or audio
+	// --record <file> makes a server record its session, --replay <file> replays one through the snapshot codec and exits
+	// --selftest runs the network and netcode tests and exits, before there is an engine. They talk to themselves over loopback port 1338
+	e2::EngineCreateInfo engineCreateInfo{};
+	uint16_t serverPort = 1337;
+	std::string recordPath;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--selftest") == 0)
+		{
+			bool passed = true;
+
+			e2::NetworkManager net(nullptr);
+			net.initialize();
+			passed &= net.benchmarkLoopback(1338, 100000);
+			passed &= net.testLoopbackFragments(1338, 64 * 1024, 64, 0.0f);
+			passed &= net.testLoopbackFragments(1338, 16 * 1024, 256, 0.01f);
+			passed &= net.testLoopbackReliability(1338, 1000, 0.0f, 0.0, 0.0);
+			passed &= net.testLoopbackReliability(1338, 1000, 0.1f, 0.05, 0.02);
+			passed &= e2::testPrediction(net, 1338, 0.05, 0.0, 0.0f, 120 * 5);
+			passed &= e2::testPrediction(net, 1338, 0.1, 0.03, 0.05f, 120 * 5);
+			net.shutdown();
+
+			// the replay goes through a recording file, the same way --replay does
+			std::vector<e2::RecordedFrame> synthesized = e2::synthesizeRecording(120 * 60, 8);
+			std::string selftestRecording = (std::filesystem::temp_directory_path() / "platformer_selftest.rec").string();
+			{
+				e2::HeapStream recordingData;
+				recordingData << e2::recordingMagic;
+				for (e2::RecordedFrame const& frame : synthesized)
+					e2::writeRecordedFrame(recordingData, frame);
+
+				e2::FileStream recordingFile(selftestRecording, e2::FileMode::ReadWrite | e2::FileMode::Truncate);
+				recordingFile.write(recordingData.data(), recordingData.size());
+			}
+
+			std::vector<e2::RecordedFrame> frames;
+			if (!e2::readRecording(selftestRecording, frames) || frames.size() != synthesized.size())
+			{
+				LogError("selftest recording didn't read back, {} of {} frames", frames.size(), synthesized.size());
+				passed = false;
+			}
+			std::filesystem::remove(selftestRecording);
+
+			passed &= e2::replaySnapshotRecording(frames, 0.0f);
+			passed &= e2::replaySnapshotRecording(frames, 0.1f);
+
+			LogNotice("{}", passed ? "ALL PASSED" : "FAILED");
+			e2::Log::shutdown();
+			return passed ? 0 : 1;
+		}
+
+		if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			std::vector<e2::RecordedFrame> frames;
+			bool passed = e2::readRecording(argv[i + 1], frames);
+			if (passed)
+			{
+				LogNotice("Replaying {} frames from {}", frames.size(), argv[i + 1]);
+				passed &= e2::replaySnapshotRecording(frames, 0.0f);
+				passed &= e2::replaySnapshotRecording(frames, 0.1f);
+			}
+
+			e2::Log::shutdown();
+			return passed ? 0 : 1;
+		}
+
+		if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			recordPath = argv[++i];
+
+		if (std::strcmp(argv[i], "--server") == 0)
+		{
+			engineCreateInfo.headless = true;
+			engineCreateInfo.tickRate = e2::simulationTickRate;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				serverPort = (uint16_t)std::atoi(argv[++i]);
+		}
+	}
+
 	//_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF |  _CRTDBG_CHECK_ALWAYS_DF);
-	e2::Engine engine;
+	e2::Engine engine(engineCreateInfo);
 	e2::Platformer game(&engine);
+	game.serverPort = serverPort;
+	game.recordPath = recordPath;
+
+	s_engine = &engine;
+	std::signal(SIGINT, onTerminate);
+	std::signal(SIGTERM, onTerminate);
 
 	engine.run(&game);
 
+	s_engine = nullptr;
+
 	return 0;
-}
\ No newline at end of file
+}
@@ -28,9 +28,13 @@
 #pragma warning(disable : 4996)
 
 #include <filesystem>
-#include <Shlobj.h>
 #include <ctime>
+#if defined(_WIN64)
+#include <Shlobj.h>
 #include <Ws2tcpip.h>
+#else
+#include <netdb.h>
+#endif
 
 #include <random>
 #include <algorithm>
@@ -51,6 +55,7 @@ namespace
 
 		e2::NetPacket response;
 		response.peerAddress = packet.peerAddress;
+		response.channel = e2::NetChannel::ReliableOrdered;
 		response.data << e2::packetId_ServerGameInfo;
 		response.data << (uint8_t)game->serverManager.players.size();
 		for (auto& [id, player]: game->serverManager.players)
@@ -74,11 +79,18 @@ namespace
 		e2::Name name;
 		packet.data >> name;
 
+		if (!game->serverManager.players.contains(name) && !game->assignPlayerId(name))
+		{
+			LogWarning("Player \"{}\" can't join, game is full", name);
+			return;
+		}
+
 		LogNotice("Player \"{}\" joined", name);
 
-		game->serverManager.players[name].name = name;
 		game->serverManager.players[name].address = packet.peerAddress;
 		game->serverManager.players[name].position = { 300.0f, 500.0f };
+
+		game->broadcastPlayerTable();
 	}
 
 	// client -> server
@@ -92,22 +104,61 @@ namespace
 			return;
 		}
 
-		e2::Name name;
-		packet.data >> name;
+		uint8_t playerId{};
+		packet.data >> playerId;
 
 		uint64_t clientFrameIndex{};
 		packet.data >> clientFrameIndex;
 
+		if (playerId >= e2::maxNetPlayers || !game->serverManager.idInUse[playerId])
+			return;
+
+		e2::Name name = game->serverManager.playerIds[playerId];
 		if (!game->serverManager.players.contains(name))
 			return;
 
 		e2::ServerPlayerState &playerState = game->serverManager.players.at(name);
+
+		// ids are small and easy to guess, only take input for a player from its own client
+		if (!(playerState.address == packet.peerAddress))
+			return;
+
 		if (playerState.lastClientFrameIndex >= clientFrameIndex)
 			return;
 
-		packet.data >> playerState.buttonMoveLeft;
-		packet.data >> playerState.buttonMoveRight;
-		packet.data >> playerState.buttonJump;
+		bool hasSnapshot{};
+		uint16_t ackedSnapshot{};
+		packet.data >> hasSnapshot;
+		packet.data >> ackedSnapshot;
+
+		uint8_t numInputs{};
+		packet.data >> numInputs;
+		if (numInputs == 0 || numInputs > e2::redundantInputs || numInputs > clientFrameIndex + 1)
+			return;
+
+		// oldest first, ending with clientFrameIndex. queue the ones we haven't seen
+		for (uint8_t i = 0; i < numInputs; i++)
+		{
+			uint8_t inputBits{};
+			packet.data >> inputBits;
+
+			uint64_t inputTick = clientFrameIndex + 1 - numInputs + i;
+			if (playerState.hasQueuedInput && inputTick <= playerState.lastQueuedInput)
+				continue;
+
+			playerState.pendingInputs.push_back({ inputTick, e2::PlayerInput::unpack(inputBits) });
+			playerState.hasQueuedInput = true;
+			playerState.lastQueuedInput = inputTick;
+		}
+
+		while (playerState.pendingInputs.size() > e2::maxQueuedInputs)
+			playerState.pendingInputs.pop_front();
+
+		if (hasSnapshot)
+		{
+			playerState.hasAckedSnapshot = true;
+			playerState.ackedSnapshot = ackedSnapshot;
+		}
 
 		playerState.lastClientFrameIndex = clientFrameIndex;
 	}
@@ -138,6 +189,45 @@ namespace
 		// @todo actually do somethign with the data
 	}
 
+	// server -> client
+	void _handleServerPlayerTable(e2::Engine* engine, e2::NetPacket& packet)
+	{
+		e2::NetworkManager* net = engine->networkManager();
+		e2::Platformer* game = static_cast<e2::Platformer*>(engine->application());
+
+		if (!net->isClient())
+		{
+			return;
+		}
+
+		e2::ClientManager& client = game->clientManager;
+		for (bool& known : client.playerKnown)
+			known = false;
+		client.hasLocalPlayerId = false;
+
+		uint8_t numPlayers{};
+		packet.data >> numPlayers;
+
+		for (uint8_t i = 0; i < numPlayers; i++)
+		{
+			uint8_t playerId{};
+			e2::Name playerName;
+			packet.data >> playerId >> playerName;
+
+			if (playerId >= e2::maxNetPlayers)
+				continue;
+
+			client.playerKnown[playerId] = true;
+			client.playerNames[playerId] = playerName;
+
+			if (playerName == client.localPlayerName)
+			{
+				client.hasLocalPlayerId = true;
+				client.localPlayerId = playerId;
+			}
+		}
+	}
+
 	// server -> client
 	void _handleServerPlayerLeft(e2::Engine* engine, e2::NetPacket& packet)
 	{
@@ -182,33 +272,57 @@ namespace
 			return;
 		}
 
-		uint64_t serverFrameIndex{};
-		packet.data >> serverFrameIndex;
+		e2::ClientManager& client = game->clientManager;
 
-		uint8_t numPlayers{};
-		packet.data >> numPlayers;
+		bool hasProcessedInput{};
+		uint16_t processedInput{};
+		packet.data >> hasProcessedInput;
+		packet.data >> processedInput;
 
-		for (uint8_t i = 0; i < numPlayers; i++)
+		uint64_t snapshotSize = packet.data.remaining();
+		e2::BitReader reader(packet.data.read(snapshotSize), snapshotSize);
+
+		e2::Snapshot snapshot;
+		if (!e2::decodeSnapshot(reader, client.snapshots, snapshot))
 		{
-			e2::Name name;
-			glm::vec2 pos, vel;
-			packet.data >> name >> pos >> vel;
-			bool newPlayer = false;
-			if (!game->clientManager.players.contains(name))
-			{
-				game->clientManager.players[name].name = name;
-				newPlayer = true;
-			}
+			LogWarning("dropping server frame, corrupt or baseline missing");
+			return;
+		}
 
-			e2::ClientPlayerState& state = game->clientManager.players.at(name);
-			if (!newPlayer && state.lastServerFrameIndex >= serverFrameIndex)
-				continue;
+		if (client.hasSnapshot && !e2::netSequenceGreater(snapshot.sequence, client.lastSnapshot))
+			return;
 
-			state.position = pos;
-			state.velocity = vel;
-			state.lastServerFrameIndex = serverFrameIndex;
+		// keep it as a baseline, and tell the server we have it with our next input
+		client.snapshots.store(snapshot);
+		client.hasSnapshot = true;
+		client.lastSnapshot = snapshot.sequence;
+
+		client.interpolator.push(snapshot);
+
+		if (client.hasLocalPlayerId && snapshot.players[client.localPlayerId].present)
+		{
+			e2::SnapshotPlayer const& localPlayer = snapshot.players[client.localPlayerId];
+			if (!client.prediction.hasState())
+				client.prediction.reset(localPlayer);
+			else if (hasProcessedInput)
+				client.prediction.reconcile(processedInput, localPlayer);
 		}
 
+		for (uint32_t i = 0; i < e2::maxNetPlayers; i++)
+		{
+			e2::SnapshotPlayer const& player = snapshot.players[i];
+
+			// names arrive reliably in the player table, but may not be here yet
+			if (!player.present || !client.playerKnown[i])
+				continue;
+
+			e2::Name name = client.playerNames[i];
+			e2::ClientPlayerState& state = client.players[name];
+			state.name = name;
+			state.id = uint8_t(i);
+			state.position = e2::dequantizePosition(player);
+			state.velocity = e2::dequantizeVelocity(player);
+		}
 	}
 }
 
@@ -230,6 +344,14 @@ void e2::Platformer::onServerStarted()
 
 void e2::Platformer::onServerStopped()
 {
+	// a dedicated server has nothing left to do
+	if (engine()->headless())
+	{
+		LogNotice("Server stopped, shutting down");
+		engine()->shutdown();
+	}
+
+	stopRecording();
 	serverManager = ServerManager();
 }
 
@@ -238,6 +360,7 @@ void e2::Platformer::onConnected(e2::NetPeerAddress const& address)
 	LogNotice("Sending client info to {}.{}.{}.{}:{}", uint8_t(address.address), uint8_t(address.address >> 8), uint8_t(address.address >> 16), uint8_t(address.address>> 24), address.port);
 	e2::NetPacket clientInfoPacket;
 	clientInfoPacket.peerAddress = address;
+	clientInfoPacket.channel = e2::NetChannel::ReliableOrdered;
 	clientInfoPacket.data << e2::packetId_ClientInfo;
 	clientInfoPacket.data << clientManager.localPlayerName;
 	networkManager()->sendPacket(clientInfoPacket);
@@ -245,7 +368,10 @@ void e2::Platformer::onConnected(e2::NetPeerAddress const& address)
 
 void e2::Platformer::onDisconnected(e2::NetPeerAddress const& address)
 {
+	// the server knows us by name, keep it for next time
+	e2::Name localPlayerName = clientManager.localPlayerName;
 	clientManager = ClientManager();
+	clientManager.localPlayerName = localPlayerName;
 }
 
 void e2::Platformer::onPeerConnected(e2::NetPeerAddress const& address)
@@ -260,20 +386,176 @@ void e2::Platformer::onPeerDisconnected(e2::NetPeerAddress const& address)
 		e2::Name nameCopy = name;
 		if (state.address == address)
 		{
+			serverManager.idInUse[state.id] = false;
 			serverManager.players.erase(nameCopy);
 
 			e2::HeapStream notify;
 			notify << e2::packetId_ServerPlayerLeft;
 			notify << nameCopy;
-			networkManager()->broadcastPacket(notify);
+			networkManager()->broadcastPacket(notify, e2::NetChannel::ReliableOrdered);
+
+			broadcastPlayerTable();
 			return;
 		}
 	}
 
 }
 
+bool e2::Platformer::assignPlayerId(e2::Name name)
+{
+	for (uint8_t i = 0; i < e2::maxNetPlayers; i++)
+	{
+		if (serverManager.idInUse[i])
+			continue;
+
+		serverManager.idInUse[i] = true;
+		serverManager.playerIds[i] = name;
+
+		e2::ServerPlayerState& state = serverManager.players[name];
+		state.name = name;
+		state.id = i;
+		return true;
+	}
+
+	return false;
+}
+
+void e2::Platformer::broadcastPlayerTable()
+{
+	e2::HeapStream table;
+	table << e2::packetId_ServerPlayerTable;
+	table << uint8_t(serverManager.players.size());
+	for (auto& [name, state] : serverManager.players)
+	{
+		table << state.id << name;
+	}
+
+	networkManager()->broadcastPacket(table, e2::NetChannel::ReliableOrdered);
+}
+
+void e2::Platformer::tickServer(double seconds, e2::PlayerInput const* localInput)
+{
+	constexpr double tickSeconds = 1.0 / e2::simulationTickRate;
+
+	serverManager.tickAccumulator += seconds;
+	for (uint32_t i = 0; i < e2::maxTicksPerUpdate && serverManager.tickAccumulator >= tickSeconds; i++)
+	{
+		serverManager.tickAccumulator -= tickSeconds;
+
+		for (auto& [name, state] : serverManager.players)
+		{
+			if (localInput && clientManager.localPlayerName == name)
+			{
+				e2::stepPlayer(state.position, state.velocity, *localInput);
+				continue;
+			}
+
+			// remote players only move when their input does, so our state always matches an input tick their client can compare against
+			if (state.pendingInputs.empty())
+				continue;
+
+			e2::stepPlayer(state.position, state.velocity, state.pendingInputs.front().input);
+			state.hasProcessedInput = true;
+			state.lastProcessedInput = state.pendingInputs.front().tick;
+			state.pendingInputs.pop_front();
+		}
+
+		e2::RecordedFrame frame;
+		frame.frameIndex = serverManager.frameIndex;
+		for (auto& [name, state] : serverManager.players)
+		{
+			e2::RecordedPlayer& player = frame.players.emplace_back();
+			player.id = state.id;
+			player.name = name;
+			player.position = state.position;
+			player.velocity = state.velocity;
+		}
+
+		e2::Snapshot snapshot = e2::makeSnapshot(frame);
+		serverManager.snapshots.store(snapshot);
+
+		if (serverManager.recording)
+		{
+			// one write per frame, FileStream resizes on every write
+			e2::HeapStream recordedFrame;
+			e2::writeRecordedFrame(recordedFrame, frame);
+			serverManager.recording->write(recordedFrame.data(), recordedFrame.size());
+
+			if (++serverManager.numRecordedFrames >= e2::maxRecordedFrames)
+			{
+				LogNotice("Recorded {} frames, that's the limit", serverManager.numRecordedFrames);
+				stopRecording();
+			}
+		}
+
+		// every client gets a delta against whatever it last acked, the local player has no address
+		e2::BitWriter writer;
+		for (auto& [name, state] : serverManager.players)
+		{
+			if (state.address.port == 0)
+				continue;
+
+			writer.clear();
+			e2::encodeSnapshot(snapshot, state.hasAckedSnapshot ? serverManager.snapshots.find(state.ackedSnapshot) : nullptr, writer);
+
+			e2::NetPacket framePacket;
+			framePacket.peerAddress = state.address;
+			framePacket.channel = e2::NetChannel::UnreliableSequenced;
+			e2::writeServerFrame(framePacket.data, state.hasProcessedInput, uint16_t(state.lastProcessedInput), writer);
+			networkManager()->sendPacket(framePacket);
+		}
+
+		serverManager.frameIndex++;
+	}
+	serverManager.tickAccumulator = glm::min(serverManager.tickAccumulator, tickSeconds);
+}
+
+void e2::Platformer::startRecording()
+{
+	if (recordPath.empty() || serverManager.recording)
+		return;
+
+	serverManager.recording = e2::create<e2::FileStream>(recordPath, e2::FileMode::ReadWrite | e2::FileMode::Truncate);
+	if (!serverManager.recording->valid())
+	{
+		LogError("Failed to open {} for recording", recordPath);
+		e2::destroy(serverManager.recording);
+		serverManager.recording = nullptr;
+		return;
+	}
+
+	*serverManager.recording << e2::recordingMagic;
+	serverManager.numRecordedFrames = 0;
+	LogNotice("Recording to {}", recordPath);
+}
+
+void e2::Platformer::stopRecording()
+{
+	if (!serverManager.recording)
+		return;
+
+	e2::destroy(serverManager.recording);
+	serverManager.recording = nullptr;
+	LogNotice("Stopped recording, {} frames in {}", serverManager.numRecordedFrames, recordPath);
+}
+
 void e2::Platformer::initialize()
 {
+	networkManager()->registerHandler(e2::packetId_ClientFetchGameInfo, _handleClientFetchGameInfo);
+	networkManager()->registerHandler(e2::packetId_ClientInput, _handleClientInput);
+	networkManager()->registerHandler(e2::packetId_ClientInfo, _handleClientInfo);
+
+	networkManager()->registerNetCallbacks(this);
+
+	if (engine()->headless())
+	{
+		// dedicated server, nobody plays locally and nothing is drawn
+		LogNotice("Starting dedicated server on port {}", serverPort);
+		networkManager()->startServer(serverPort);
+		startRecording();
+		return;
+	}
+
 	e2::WindowCreateInfo winCreateInfo{};
 	winCreateInfo.title = "NetworkPlatformTest";
 	winCreateInfo.resizable = true;
@@ -290,14 +572,11 @@ void e2::Platformer::initialize()
 
 	renderManager()->registerCallbacks(this);
 
-	networkManager()->registerHandler(e2::packetId_ClientFetchGameInfo, _handleClientFetchGameInfo);
-	networkManager()->registerHandler(e2::packetId_ClientInput, _handleClientInput);
-	networkManager()->registerHandler(e2::packetId_ClientInfo, _handleClientInfo);
-
 	networkManager()->registerHandler(e2::packetId_ServerGameInfo, _handleServerGameInfo);
 	networkManager()->registerHandler(e2::packetId_ServerFrame, _handleServerFrame);
 	networkManager()->registerHandler(e2::packetId_ServerGameEnd, _handleServerGameEnd);
 	networkManager()->registerHandler(e2::packetId_ServerPlayerLeft, _handleServerPlayerLeft);
+	networkManager()->registerHandler(e2::packetId_ServerPlayerTable, _handleServerPlayerTable);
 
 	std::string randName;
 	for (uint8_t i = 0; i < 8; i++)
@@ -306,13 +585,16 @@ void e2::Platformer::initialize()
 	}
 	clientManager.localPlayerName = randName;
 	LogNotice("Local name: {}", clientManager.localPlayerName);
-
-	networkManager()->registerNetCallbacks(this);
 }
 
 void e2::Platformer::shutdown()
 {
 	networkManager()->unregisterNetCallbacks(this);
+	stopRecording();
+
+	if (engine()->headless())
+		return;
+
 	renderManager()->unregisterCallbacks(this);
 
 	m_window->unregisterInputHandler(m_uiContext);
@@ -323,6 +605,12 @@ void e2::Platformer::shutdown()
 
 void e2::Platformer::update(double seconds)
 {
+	if (engine()->headless())
+	{
+		if (networkManager()->currentState() == e2::NetworkState::Server)
+			tickServer(seconds, nullptr);
+		return;
+	}
 
 	if (m_window->wantsClose())
 	{
@@ -352,77 +640,68 @@ void e2::Platformer::update(double seconds)
 	clientManager.buttonMoveRight = kb.state(e2::Key::Right);
 	clientManager.buttonJump = kb.state(e2::Key::Space);
 	
+	constexpr double tickSeconds = 1.0 / e2::simulationTickRate;
+	e2::PlayerInput localInput{ clientManager.buttonMoveLeft, clientManager.buttonMoveRight, clientManager.buttonJump };
+
 	if (netState == e2::NetworkState::Client_Connected)
 	{
-		if (clientManager.lastSentInput.durationSince().seconds() >= 1.0 / clientManager.inputTickRate)
+		// same fixed ticks as the server. every tick is predicted right away, and sent along with the few before it
+		clientManager.tickAccumulator += seconds;
+		for (uint32_t i = 0; i < e2::maxTicksPerUpdate && clientManager.tickAccumulator >= tickSeconds; i++)
 		{
+			clientManager.tickAccumulator -= tickSeconds;
+
+			// we can't send input before the server told us our id
+			if (!clientManager.hasLocalPlayerId)
+				continue;
+
+			clientManager.prediction.predict(localInput);
+
+			e2::TickedInput inputs[e2::redundantInputs];
+			uint32_t numInputs = clientManager.prediction.recentInputs(inputs, e2::redundantInputs);
+
 			e2::NetPacket inputFrame;
 			inputFrame.peerAddress = clientServerAddress;
+			inputFrame.channel = e2::NetChannel::UnreliableSequenced;
 			inputFrame.data << e2::packetId_ClientInput;
 
-			inputFrame.data << clientManager.localPlayerName;
-			inputFrame.data << clientManager.frameIndex;
+			inputFrame.data << clientManager.localPlayerId;
+			inputFrame.data << clientManager.prediction.tick();
 
-			inputFrame.data << clientManager.buttonMoveLeft;
-			inputFrame.data << clientManager.buttonMoveRight;
-			inputFrame.data << clientManager.buttonJump;
+			inputFrame.data << clientManager.hasSnapshot;
+			inputFrame.data << clientManager.lastSnapshot;
 
-			net->sendPacket(inputFrame);
+			inputFrame.data << uint8_t(numInputs);
+			for (uint32_t j = 0; j < numInputs; j++)
+				inputFrame.data << inputs[j].input.pack();
 
-			clientManager.lastSentInput = e2::timeNow();
-			clientManager.frameIndex++;
+			net->sendPacket(inputFrame);
 		}
+		clientManager.tickAccumulator = glm::min(clientManager.tickAccumulator, tickSeconds);
 
+		clientManager.interpolator.advance(seconds);
 
 		for (auto& [name, state] : clientManager.players)
 		{
-			// render client players
+			// render client players, ourselves where we predict we are and everyone else a few ticks in the past
 			bool localPlayer = (clientManager.localPlayerName == name);
 
-			ui->drawQuad(state.position - glm::vec2{ 8.0f, 8.0f }, { 16.0f, 16.0f }, 0xFF0000FF);
+			glm::vec2 position = state.position;
+			if (localPlayer && clientManager.prediction.hasState())
+				position = clientManager.prediction.position();
+			else if (!localPlayer)
+				clientManager.interpolator.sample(state.id, position);
+
+			ui->drawQuad(position - glm::vec2{ 8.0f, 8.0f }, { 16.0f, 16.0f }, 0xFF0000FF);
 		}
 	}
 	else if (netState == e2::NetworkState::Server)
 	{
-		if (serverManager.lastSentFrame.durationSince().seconds() >= 1.0 / serverManager.frameTickRate)
-		{
-			e2::HeapStream frame;
-
-			frame << e2::packetId_ServerFrame;
-			frame << serverManager.frameIndex;
-			frame << uint8_t(serverManager.players.size());
-
-			for (auto& [id, state] : serverManager.players)
-			{
-				frame << state.name << state.position << state.velocity;
-			}
-
-			net->broadcastPacket(frame);
-
-			serverManager.lastSentFrame = e2::timeNow();
-			serverManager.frameIndex++;
-		}
+		tickServer(seconds, &localInput);
 
 		for (auto& [name, state] : serverManager.players)
 		{
-			// update and render server players
-			bool localPlayer = (clientManager.localPlayerName == name);
-
-			if (localPlayer)
-			{
-				state.buttonMoveLeft = clientManager.buttonMoveLeft;
-				state.buttonMoveRight = clientManager.buttonMoveRight;
-			}
-
-			if (state.buttonMoveLeft)
-				state.velocity.x = -100.0f;
-			else if (state.buttonMoveRight)
-				state.velocity.x = 100.0f;
-			else
-				state.velocity.x = 0.0f;
-
-			state.position += state.velocity * float(seconds);
-
+			// render server players
 			ui->drawQuad(state.position - glm::vec2{ 8.0f, 8.0f }, { 16.0f, 16.0f }, 0xFF0000FF);
 		}
 
@@ -435,6 +714,8 @@ void e2::Platformer::update(double seconds)
 
 
 	std::string netStatus;
+	std::string netStats;
+	std::string predictionStats;
 	if (netState == e2::NetworkState::Offline)
 	{
 		netStatus = "Offline";
@@ -450,19 +731,32 @@ void e2::Platformer::update(double seconds)
 	else if (netState == e2::NetworkState::Client_Connected)
 	{
 		netStatus = std::format("[Client] Connected to {}.{}.{}.{} on port {}", uint8_t(serverAddress), uint8_t(serverAddress >> 8), uint8_t(serverAddress >> 16) , uint8_t(serverAddress >> 24) , serverPort);
+
+		e2::ClientPrediction const& prediction = clientManager.prediction;
+		predictionStats = std::format("prediction: {} corrections in {} frames, {:.2f}px last error, {:.2f}px max error", prediction.numCorrections(), prediction.numReconciled(), prediction.lastError(), prediction.maxError());
+
+		e2::NetPeerStats stats;
+		if (net->peerStats(clientServerAddress, stats))
+			netStats = std::format("rtt {:.0f}ms, jitter {:.0f}ms, loss {:.1f}%, {:.1f}KB/s out, {:.1f}KB/s in", stats.roundTripTime * 1000.0, stats.jitter * 1000.0, stats.packetLoss * 100.0, stats.sentBytesPerSecond / 1024.0, stats.receivedBytesPerSecond / 1024.0);
 	}
 	e2::UIStyle& style = uiManager()->workingStyle();
-	ui->drawQuadFancy({ 4.0f, 4.0f }, { 500.f, 200.f }, style.windowBgColor, 8.0f, 1.0f, true);
-	ui->pushFixedPanel("panpan", { 4.0f, 4.0f }, { 500.f, 200.f });
+	ui->drawQuadFancy({ 4.0f, 4.0f }, { 500.f, 320.f }, style.windowBgColor, 8.0f, 1.0f, true);
+	ui->pushFixedPanel("panpan", { 4.0f, 4.0f }, { 500.f, 320.f });
 	ui->beginStackV("mainstack");
 	ui->label("status", netStatus);
+	if (!netStats.empty())
+		ui->label("stats", netStats);
+	if (!predictionStats.empty())
+		ui->label("predictionStats", predictionStats);
 	if (netState == e2::NetworkState::Offline)
 	{
 		if (ui->button("hostBtn", "Host"))
 		{
-			net->startServer(1337);
+			net->startServer(serverPort);
+			startRecording();
 			clientManager.joinedGame = true;
-			serverManager.players[clientManager.localPlayerName].name = clientManager.localPlayerName;
+			if (!serverManager.players.contains(clientManager.localPlayerName))
+				assignPlayerId(clientManager.localPlayerName);
 			serverManager.players[clientManager.localPlayerName].position = {200.0f, 500.0f};
 		}
 		if (ui->button("joinBtn", "Join"))
@@ -482,15 +776,23 @@ void e2::Platformer::update(double seconds)
 			joinAddress.port = htons(1337);
 			net->tryConnect(joinAddress);
 		}
+		if (ui->button("joinLocalBtn", "Join localhost"))
+		{
+			// for running a second instance against a local host
+			e2::NetPeerAddress joinAddress;
+			joinAddress.address = htonl(INADDR_LOOPBACK);
+			joinAddress.port = htons(1337);
+			net->tryConnect(joinAddress);
+		}
 	}
 	else if (netState == e2::NetworkState::Server)
 	{
 		if (ui->button("discBtn", "Disconnect"))
 		{
 			net->disable();
+			stopRecording();
 			clientManager.joinedGame = false;
 		}
-
 	}
 	else if (netState == e2::NetworkState::Client_Connecting)
 	{
@@ -0,0 +1,469 @@
+
+#include "platformer/simulation.hpp"
+#include "platformer/platformer.hpp"
+
+#include <e2/log.hpp>
+#include <e2/managers/networkmanager.hpp>
+
+#include <vector>
+#include <thread>
+#include <chrono>
+
+void e2::stepPlayer(glm::vec2& position, glm::vec2& velocity, e2::PlayerInput const& input)
+{
+	constexpr float tickSeconds = float(1.0 / e2::simulationTickRate);
+
+	if (input.moveLeft)
+		velocity.x = -e2::playerMoveSpeed;
+	else if (input.moveRight)
+		velocity.x = e2::playerMoveSpeed;
+	else
+		velocity.x = 0.0f;
+
+	bool grounded = position.y >= e2::playerGroundHeight;
+	if (grounded && input.jump)
+		velocity.y = -e2::playerJumpSpeed;
+
+	velocity.y += e2::playerGravity * tickSeconds;
+	position += velocity * tickSeconds;
+
+	if (position.y >= e2::playerGroundHeight)
+	{
+		position.y = e2::playerGroundHeight;
+		velocity.y = 0.0f;
+	}
+
+	e2::SnapshotPlayer snapped = e2::quantizePlayer(position, velocity);
+	position = e2::dequantizePosition(snapped);
+	velocity = e2::dequantizeVelocity(snapped);
+}
+
+void e2::ClientPrediction::reset(e2::SnapshotPlayer const& serverState)
+{
+	m_hasState = true;
+	m_position = e2::dequantizePosition(serverState);
+	m_velocity = e2::dequantizeVelocity(serverState);
+
+	// whatever we stepped before this was a guess from nothing, don't count it against us
+	for (HistoryEntry& entry : m_history)
+		entry.predicted = false;
+}
+
+uint64_t e2::ClientPrediction::predict(e2::PlayerInput const& input)
+{
+	if (m_hasTicked)
+		m_tick++;
+	m_hasTicked = true;
+
+	e2::stepPlayer(m_position, m_velocity, input);
+
+	HistoryEntry& entry = m_history[m_tick % e2::predictionHistorySize];
+	entry.tick = m_tick;
+	entry.predicted = m_hasState;
+	entry.input = input;
+	entry.position = m_position;
+	entry.velocity = m_velocity;
+
+	return m_tick;
+}
+
+void e2::ClientPrediction::reconcile(uint16_t inputTick, e2::SnapshotPlayer const& serverState)
+{
+	if (!m_hasTicked)
+		return;
+
+	// widen to the newest tick with these low bits that we predicted
+	uint64_t tick = m_tick - uint16_t(uint16_t(m_tick) - inputTick);
+
+	// snapshots arrive in order, but consecutive ones may ack the same input
+	if (m_hasReconciled && tick < m_lastReconciled)
+		return;
+
+	glm::vec2 serverPosition = e2::dequantizePosition(serverState);
+	glm::vec2 serverVelocity = e2::dequantizeVelocity(serverState);
+
+	HistoryEntry& entry = m_history[tick % e2::predictionHistorySize];
+	if (entry.tick != tick)
+	{
+		// so old we forgot what we predicted, all we can do is snap
+		m_position = serverPosition;
+		m_velocity = serverVelocity;
+		m_numCorrections++;
+		return;
+	}
+
+	m_hasReconciled = true;
+	m_lastReconciled = tick;
+
+	if (entry.predicted)
+	{
+		m_numReconciled++;
+		m_lastError = glm::distance(entry.position, serverPosition);
+		m_maxError = glm::max(m_maxError, m_lastError);
+
+		if (entry.position == serverPosition && entry.velocity == serverVelocity)
+			return;
+
+		m_numCorrections++;
+	}
+
+	// rewind to what the server says, and replay every input it hasn't seen yet
+	entry.predicted = true;
+	entry.position = serverPosition;
+	entry.velocity = serverVelocity;
+
+	glm::vec2 position = serverPosition;
+	glm::vec2 velocity = serverVelocity;
+	for (uint64_t replayTick = tick + 1; replayTick <= m_tick; replayTick++)
+	{
+		HistoryEntry& replayEntry = m_history[replayTick % e2::predictionHistorySize];
+		e2::stepPlayer(position, velocity, replayEntry.input);
+		replayEntry.predicted = true;
+		replayEntry.position = position;
+		replayEntry.velocity = velocity;
+	}
+
+	m_position = position;
+	m_velocity = velocity;
+}
+
+uint32_t e2::ClientPrediction::recentInputs(e2::TickedInput* outInputs, uint32_t count) const
+{
+	if (!m_hasTicked)
+		return 0;
+
+	count = uint32_t(glm::min<uint64_t>(count, m_tick + 1));
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint64_t tick = m_tick + 1 - count + i;
+		outInputs[i].tick = tick;
+		outInputs[i].input = m_history[tick % e2::predictionHistorySize].input;
+	}
+
+	return count;
+}
+
+void e2::SnapshotInterpolator::push(e2::Snapshot const& snapshot)
+{
+	// widen the 16 bit sequence
+	uint64_t tick = snapshot.sequence;
+	if (m_started)
+		tick = m_newestTick + int16_t(uint16_t(snapshot.sequence - uint16_t(m_newestTick)));
+
+	if (m_started && tick <= m_newestTick)
+		return;
+
+	if (!m_started)
+	{
+		m_started = true;
+		m_renderTick = double(tick) - e2::interpolationDelayTicks;
+	}
+
+	m_newestTick = tick;
+	Sample& newSample = m_samples.emplace_back();
+	newSample.tick = tick;
+	newSample.snapshot = snapshot;
+
+	while (m_samples.size() > e2::snapshotHistorySize)
+		m_samples.pop_front();
+}
+
+void e2::SnapshotInterpolator::advance(double seconds)
+{
+	if (!m_started)
+		return;
+
+	m_renderTick += seconds * e2::simulationTickRate;
+
+	// way off (a hitch, or a burst of loss), jump. otherwise drift at most 5% faster or slower so motion stays smooth
+	double target = double(m_newestTick) - e2::interpolationDelayTicks;
+	double offset = target - m_renderTick;
+	if (glm::abs(offset) > e2::interpolationDelayTicks * 2.0)
+		m_renderTick = target;
+	else
+		m_renderTick += glm::clamp(offset, -0.05, 0.05) * seconds * e2::simulationTickRate;
+
+	// keep one sample at or before render time to interpolate from
+	while (m_samples.size() > 1 && double(m_samples[1].tick) <= m_renderTick)
+		m_samples.pop_front();
+}
+
+bool e2::SnapshotInterpolator::sample(uint32_t playerId, glm::vec2& outPosition) const
+{
+	if (m_samples.empty() || playerId >= e2::maxNetPlayers)
+		return false;
+
+	Sample const& from = m_samples.front();
+	if (!from.snapshot.players[playerId].present)
+		return false;
+
+	glm::vec2 fromPosition = e2::dequantizePosition(from.snapshot.players[playerId]);
+	if (m_samples.size() < 2 || !m_samples[1].snapshot.players[playerId].present || m_renderTick <= double(from.tick))
+	{
+		outPosition = fromPosition;
+		return true;
+	}
+
+	Sample const& to = m_samples[1];
+	float alpha = float(glm::clamp((m_renderTick - double(from.tick)) / double(to.tick - from.tick), 0.0, 1.0));
+	outPosition = glm::mix(fromPosition, e2::dequantizePosition(to.snapshot.players[playerId]), alpha);
+	return true;
+}
+
+void e2::SnapshotInterpolator::clear()
+{
+	m_samples.clear();
+	m_started = false;
+	m_newestTick = 0;
+	m_renderTick = 0.0;
+}
+
+namespace
+{
+	e2::PlayerInput scriptedInput(uint64_t tick, uint64_t seed)
+	{
+		// runs one way, stops, runs back, jumping now and then
+		uint64_t phase = ((tick + seed) / 90) % 4;
+
+		e2::PlayerInput input;
+		input.moveRight = phase == 0;
+		input.moveLeft = phase == 2;
+		input.jump = ((tick + seed) % 150) < 4;
+		return input;
+	}
+
+	constexpr uint8_t predictionLocalId = 0;
+	constexpr uint8_t predictionRemoteId = 1;
+
+	/** Both ends of testPrediction, the packet handlers get to it through s_predictionTest */
+	struct PredictionTest
+	{
+		// server side
+		glm::vec2 serverPositions[2] = { { 300.0f, e2::playerGroundHeight }, { 200.0f, e2::playerGroundHeight } };
+		glm::vec2 serverVelocities[2] = {};
+		std::deque<e2::TickedInput> serverInputs;
+		bool serverHasQueued{};
+		uint64_t serverLastQueued{};
+		bool serverHasProcessed{};
+		uint64_t serverLastProcessed{};
+		bool serverHasAck{};
+		uint16_t serverAck{};
+		e2::SnapshotHistory serverSnapshots;
+
+		// client side
+		e2::ClientPrediction prediction;
+		e2::SnapshotInterpolator interpolator;
+		e2::SnapshotHistory clientSnapshots;
+		bool clientHasSnapshot{};
+		uint16_t clientLastSnapshot{};
+		glm::vec2 clientServerView{};
+		uint32_t numUndecodable{};
+	};
+
+	PredictionTest* s_predictionTest{};
+
+	// server side, reads input like _handleClientInput
+	void _handlePredictionInput(e2::Engine* engine, e2::NetPacket& packet)
+	{
+		PredictionTest& test = *s_predictionTest;
+
+		uint8_t playerId{};
+		uint64_t clientTick{};
+		bool hasSnapshot{};
+		uint16_t ackedSnapshot{};
+		uint8_t numInputs{};
+		packet.data >> playerId >> clientTick >> hasSnapshot >> ackedSnapshot >> numInputs;
+		if (playerId != predictionLocalId || numInputs == 0 || numInputs > e2::redundantInputs || numInputs > clientTick + 1)
+			return;
+
+		for (uint8_t i = 0; i < numInputs; i++)
+		{
+			uint8_t inputBits{};
+			packet.data >> inputBits;
+
+			uint64_t inputTick = clientTick + 1 - numInputs + i;
+			if (test.serverHasQueued && inputTick <= test.serverLastQueued)
+				continue;
+
+			test.serverInputs.push_back({ inputTick, e2::PlayerInput::unpack(inputBits) });
+			test.serverHasQueued = true;
+			test.serverLastQueued = inputTick;
+		}
+
+		if (hasSnapshot)
+		{
+			test.serverHasAck = true;
+			test.serverAck = ackedSnapshot;
+		}
+	}
+
+	// client side, takes in frames like _handleServerFrame
+	void _handlePredictionFrame(e2::Engine* engine, e2::NetPacket& packet)
+	{
+		PredictionTest& test = *s_predictionTest;
+
+		bool hasProcessedInput{};
+		uint16_t processedInput{};
+		packet.data >> hasProcessedInput >> processedInput;
+
+		uint64_t snapshotSize = packet.data.remaining();
+		e2::BitReader reader(packet.data.read(snapshotSize), snapshotSize);
+
+		e2::Snapshot snapshot;
+		if (!e2::decodeSnapshot(reader, test.clientSnapshots, snapshot))
+		{
+			test.numUndecodable++;
+			return;
+		}
+
+		if (test.clientHasSnapshot && !e2::netSequenceGreater(snapshot.sequence, test.clientLastSnapshot))
+			return;
+
+		test.clientSnapshots.store(snapshot);
+		test.clientHasSnapshot = true;
+		test.clientLastSnapshot = snapshot.sequence;
+
+		e2::SnapshotPlayer const& localPlayer = snapshot.players[predictionLocalId];
+		test.clientServerView = e2::dequantizePosition(localPlayer);
+
+		if (!test.prediction.hasState())
+			test.prediction.reset(localPlayer);
+		else if (hasProcessedInput)
+			test.prediction.reconcile(processedInput, localPlayer);
+
+		test.interpolator.push(snapshot);
+	}
+}
+
+bool e2::testPrediction(e2::NetworkManager& net, uint16_t port, double latency, double jitter, float packetLoss, uint32_t numTicks)
+{
+	if (net.currentState() != e2::NetworkState::Offline)
+	{
+		LogError("prediction test needs the network to be offline");
+		return false;
+	}
+
+	net.startServer(port);
+	if (net.currentState() != e2::NetworkState::Server)
+		return false;
+
+	net.setSimulatedPacketLoss(packetLoss);
+	net.setSimulatedLatency(latency, jitter);
+	net.registerHandler(e2::packetId_ClientInput, ::_handlePredictionInput);
+	net.registerHandler(e2::packetId_ServerFrame, ::_handlePredictionFrame);
+
+	PredictionTest test;
+	s_predictionTest = &test;
+
+	e2::NetPeerAddress selfAddress;
+	selfAddress.address = htonl(INADDR_LOOPBACK);
+	selfAddress.port = htons(port);
+
+	constexpr double tickSeconds = 1.0 / e2::simulationTickRate;
+
+	std::vector<glm::vec2> remoteHistory;
+	double unpredictedError{};
+	double interpolationError{};
+	uint32_t numInterpolationSamples{};
+	uint32_t numStarvedTicks{};
+
+	e2::BitWriter writer;
+	e2::Moment begin = e2::timeNow();
+	for (uint32_t tick = 0; tick < numTicks; tick++)
+	{
+		// in real time, the latency shim holds frames back by the clock
+		while (begin.durationSince().seconds() < double(tick) * tickSeconds)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		net.update(tickSeconds);
+
+		// client predicts and sends its newest inputs, like Platformer::update
+		test.prediction.predict(::scriptedInput(tick, 0));
+
+		e2::TickedInput inputs[e2::redundantInputs];
+		uint32_t numInputs = test.prediction.recentInputs(inputs, e2::redundantInputs);
+
+		e2::NetPacket inputPacket;
+		inputPacket.peerAddress = selfAddress;
+		inputPacket.channel = e2::NetChannel::UnreliableSequenced;
+		inputPacket.data << e2::packetId_ClientInput << predictionLocalId << test.prediction.tick();
+		inputPacket.data << test.clientHasSnapshot << test.clientLastSnapshot;
+		inputPacket.data << uint8_t(numInputs);
+		for (uint32_t i = 0; i < numInputs; i++)
+			inputPacket.data << inputs[i].input.pack();
+		net.sendPacket(inputPacket);
+
+		// server steps the local player once per input, like tickServer, and the remote player from its script
+		if (!test.serverInputs.empty())
+		{
+			e2::stepPlayer(test.serverPositions[predictionLocalId], test.serverVelocities[predictionLocalId], test.serverInputs.front().input);
+			test.serverHasProcessed = true;
+			test.serverLastProcessed = test.serverInputs.front().tick;
+			test.serverInputs.pop_front();
+		}
+		else if (test.serverHasProcessed)
+		{
+			numStarvedTicks++;
+		}
+
+		e2::stepPlayer(test.serverPositions[predictionRemoteId], test.serverVelocities[predictionRemoteId], ::scriptedInput(tick, 45));
+		remoteHistory.push_back(test.serverPositions[predictionRemoteId]);
+
+		e2::Snapshot snapshot;
+		snapshot.sequence = uint16_t(tick);
+		snapshot.players[predictionLocalId] = e2::quantizePlayer(test.serverPositions[predictionLocalId], test.serverVelocities[predictionLocalId]);
+		snapshot.players[predictionRemoteId] = e2::quantizePlayer(test.serverPositions[predictionRemoteId], test.serverVelocities[predictionRemoteId]);
+		test.serverSnapshots.store(snapshot);
+
+		writer.clear();
+		e2::encodeSnapshot(snapshot, test.serverHasAck ? test.serverSnapshots.find(test.serverAck) : nullptr, writer);
+
+		e2::NetPacket framePacket;
+		framePacket.peerAddress = selfAddress;
+		framePacket.channel = e2::NetChannel::UnreliableSequenced;
+		e2::writeServerFrame(framePacket.data, test.serverHasProcessed, uint16_t(test.serverLastProcessed), writer);
+		net.sendPacket(framePacket);
+
+		test.interpolator.advance(tickSeconds);
+
+		if (test.clientHasSnapshot)
+			unpredictedError += glm::distance(test.clientServerView, test.prediction.position());
+
+		// compare against where the server really had the remote player at render time
+		glm::vec2 remotePosition;
+		double renderTick = test.interpolator.renderTick();
+		if (renderTick >= 0.0 && renderTick < double(remoteHistory.size() - 1) && test.interpolator.sample(predictionRemoteId, remotePosition))
+		{
+			uint64_t fromTick = uint64_t(renderTick);
+			glm::vec2 truth = glm::mix(remoteHistory[fromTick], remoteHistory[fromTick + 1], float(renderTick - double(fromTick)));
+			interpolationError += glm::distance(truth, remotePosition);
+			numInterpolationSamples++;
+		}
+	}
+
+	double averageInterpolationError = numInterpolationSamples > 0 ? interpolationError / double(numInterpolationSamples) : 0.0;
+
+	// without loss the server processes every input we predicted, so we must agree on all of them. With loss it skips inputs that never
+	// arrived and we must correct, but mostly we still agree. Jitter makes the sequenced channel drop frames that are overtaken, so fewer get reconciled
+	e2::ClientPrediction const& prediction = test.prediction;
+	bool passed = test.numUndecodable == 0 && prediction.numReconciled() >= numTicks / 4 && numInterpolationSamples >= numTicks / 2
+		&& averageInterpolationError <= e2::maxPredictionTestInterpolationError;
+	if (packetLoss <= 0.0f)
+		passed = passed && prediction.numCorrections() == 0 && prediction.maxError() == 0.0f;
+	else
+		passed = passed && prediction.numCorrections() <= prediction.numReconciled() / 4 && prediction.maxError() <= e2::maxPredictionTestLossyError;
+
+	LogNotice("prediction test {}: {} ticks, {:.0f}ms (+{:.0f}ms) latency, {:.1f}% loss. {} reconciled, {} corrections, {:.3f}px last error, {:.3f}px max error, {} starved server ticks, {} undecodable",
+		passed ? "passed" : "FAILED", numTicks, latency * 1000.0, jitter * 1000.0, packetLoss * 100.0f, prediction.numReconciled(), prediction.numCorrections(),
+		prediction.lastError(), prediction.maxError(), numStarvedTicks, test.numUndecodable);
+	LogNotice("prediction test: without prediction the local player would be drawn {:.2f}px off on average, interpolated remote players are {:.3f}px off",
+		unpredictedError / double(glm::max(numTicks, 1u)), averageInterpolationError);
+
+	s_predictionTest = nullptr;
+	net.registerHandler(e2::packetId_ClientInput, nullptr);
+	net.registerHandler(e2::packetId_ServerFrame, nullptr);
+	net.setSimulatedPacketLoss(0.0f);
+	net.setSimulatedLatency(0.0, 0.0);
+	net.disable();
+	return passed;
+}
@@ -0,0 +1,509 @@
+
+#include "platformer/snapshot.hpp"
+#include "platformer/platformer.hpp"
+
+#include <e2/log.hpp>
+#include <e2/buffer.hpp>
+
+#include <random>
+#include <deque>
+
+namespace
+{
+	uint32_t bitMask(uint32_t numBits)
+	{
+		return numBits >= 32 ? 0xFFFFFFFF : (1u << numBits) - 1;
+	}
+
+	int32_t quantize(float value, float scale, uint32_t numBits)
+	{
+		int32_t limit = int32_t(1u << (numBits - 1)) - 1;
+		return glm::clamp(int32_t(glm::round(value * scale)), -limit, limit);
+	}
+
+	int32_t signExtend(uint32_t value, uint32_t numBits)
+	{
+		return int32_t(value << (32 - numBits)) >> (32 - numBits);
+	}
+
+	void writeFull(e2::BitWriter& writer, int32_t value, uint32_t numBits)
+	{
+		writer.write(uint32_t(value) & ::bitMask(numBits), numBits);
+	}
+
+	int32_t readFull(e2::BitReader& reader, uint32_t numBits)
+	{
+		return ::signExtend(reader.read(numBits), numBits);
+	}
+
+	// 0 costs one bit, anything else 3 bits plus 4, 8, 12 or 24 bits of zigzagged delta
+	constexpr uint32_t deltaClassBits[4] = { 4, 8, 12, 24 };
+
+	void writeDelta(e2::BitWriter& writer, int32_t delta)
+	{
+		uint32_t zigzag = (uint32_t(delta) << 1) ^ uint32_t(delta >> 31);
+		if (zigzag == 0)
+		{
+			writer.write(0, 1);
+			return;
+		}
+
+		writer.write(1, 1);
+		for (uint32_t deltaClass = 0; deltaClass < 4; deltaClass++)
+		{
+			if (deltaClass == 3 || zigzag < (1u << ::deltaClassBits[deltaClass]))
+			{
+				writer.write(deltaClass, 2);
+				writer.write(zigzag, ::deltaClassBits[deltaClass]);
+				return;
+			}
+		}
+	}
+
+	int32_t readDelta(e2::BitReader& reader)
+	{
+		if (reader.read(1) == 0)
+			return 0;
+
+		uint32_t deltaClass = reader.read(2);
+		uint32_t zigzag = reader.read(::deltaClassBits[deltaClass]);
+		return int32_t(zigzag >> 1) ^ -int32_t(zigzag & 1);
+	}
+
+	/** Wire cost of a packet of packetSize bytes, every fragment carries its own header. UDP and IP headers aren't counted */
+	uint64_t wireBytes(uint64_t packetSize)
+	{
+		uint64_t numFragments = glm::max<uint64_t>(1, (packetSize + e2::maxFragmentPayloadSize - 1) / e2::maxFragmentPayloadSize);
+		return packetSize + numFragments * e2::netFragmentHeaderSize;
+	}
+
+	/** Reads a frame written by writeRecordedFrame, returns false if stream ends before it does */
+	bool readRecordedFrame(e2::IStream& stream, e2::RecordedFrame& outFrame)
+	{
+		uint8_t numPlayers{};
+		if (stream.remaining() < sizeof(outFrame.frameIndex) + sizeof(numPlayers))
+			return false;
+		stream >> outFrame.frameIndex >> numPlayers;
+
+		outFrame.players.resize(numPlayers);
+		for (e2::RecordedPlayer& player : outFrame.players)
+		{
+			uint8_t nameLength{};
+			if (stream.remaining() < sizeof(player.id) + sizeof(nameLength))
+				return false;
+			stream >> player.id >> nameLength;
+
+			if (stream.remaining() < nameLength + 4 * sizeof(float))
+				return false;
+			uint8_t const* nameData = stream.read(nameLength);
+			player.name = std::string_view(reinterpret_cast<char const*>(nameData), nameLength);
+			stream >> player.position >> player.velocity;
+		}
+
+		return true;
+	}
+}
+
+e2::SnapshotPlayer e2::quantizePlayer(glm::vec2 const& position, glm::vec2 const& velocity)
+{
+	e2::SnapshotPlayer player;
+	player.present = true;
+	player.position[0] = ::quantize(position.x, e2::snapshotPositionScale, e2::snapshotPositionBits);
+	player.position[1] = ::quantize(position.y, e2::snapshotPositionScale, e2::snapshotPositionBits);
+	player.velocity[0] = ::quantize(velocity.x, e2::snapshotVelocityScale, e2::snapshotVelocityBits);
+	player.velocity[1] = ::quantize(velocity.y, e2::snapshotVelocityScale, e2::snapshotVelocityBits);
+	return player;
+}
+
+glm::vec2 e2::dequantizePosition(e2::SnapshotPlayer const& player)
+{
+	return glm::vec2(float(player.position[0]), float(player.position[1])) / e2::snapshotPositionScale;
+}
+
+glm::vec2 e2::dequantizeVelocity(e2::SnapshotPlayer const& player)
+{
+	return glm::vec2(float(player.velocity[0]), float(player.velocity[1])) / e2::snapshotVelocityScale;
+}
+
+void e2::SnapshotHistory::store(e2::Snapshot const& snapshot)
+{
+	uint32_t slot = snapshot.sequence % e2::snapshotHistorySize;
+	m_snapshots[slot] = snapshot;
+	m_valid[slot] = true;
+}
+
+e2::Snapshot const* e2::SnapshotHistory::find(uint16_t sequence) const
+{
+	uint32_t slot = sequence % e2::snapshotHistorySize;
+	if (!m_valid[slot] || m_snapshots[slot].sequence != sequence)
+		return nullptr;
+
+	return &m_snapshots[slot];
+}
+
+void e2::SnapshotHistory::clear()
+{
+	for (bool& valid : m_valid)
+		valid = false;
+}
+
+void e2::BitWriter::write(uint32_t value, uint32_t numBits)
+{
+	m_scratch |= uint64_t(value & ::bitMask(numBits)) << m_scratchBits;
+	m_scratchBits += numBits;
+
+	while (m_scratchBits >= 8)
+	{
+		m_bytes.push_back(uint8_t(m_scratch));
+		m_scratch >>= 8;
+		m_scratchBits -= 8;
+	}
+}
+
+void e2::BitWriter::flush()
+{
+	if (m_scratchBits > 0)
+		m_bytes.push_back(uint8_t(m_scratch));
+
+	m_scratch = 0;
+	m_scratchBits = 0;
+}
+
+void e2::BitWriter::clear()
+{
+	m_bytes.clear();
+	m_scratch = 0;
+	m_scratchBits = 0;
+}
+
+e2::BitReader::BitReader(uint8_t const* data, uint64_t size)
+	: m_data(data)
+	, m_size(size)
+{
+}
+
+uint32_t e2::BitReader::read(uint32_t numBits)
+{
+	while (m_scratchBits < numBits)
+	{
+		if (m_cursor >= m_size)
+		{
+			m_overflowed = true;
+			return 0;
+		}
+
+		m_scratch |= uint64_t(m_data[m_cursor++]) << m_scratchBits;
+		m_scratchBits += 8;
+	}
+
+	uint32_t value = uint32_t(m_scratch) & ::bitMask(numBits);
+	m_scratch >>= numBits;
+	m_scratchBits -= numBits;
+	return value;
+}
+
+void e2::encodeSnapshot(e2::Snapshot const& snapshot, e2::Snapshot const* baseline, e2::BitWriter& writer)
+{
+	writer.write(snapshot.sequence, 16);
+
+	uint16_t baselineOffset = baseline ? uint16_t(snapshot.sequence - baseline->sequence) : 0;
+	if (baselineOffset == 0 || baselineOffset >= e2::snapshotHistorySize)
+		baseline = nullptr;
+
+	writer.write(baseline ? 1 : 0, 1);
+	if (baseline)
+		writer.write(baselineOffset, 5);
+
+	for (uint32_t i = 0; i < e2::maxNetPlayers; i++)
+		writer.write(snapshot.players[i].present ? 1 : 0, 1);
+
+	for (uint32_t i = 0; i < e2::maxNetPlayers; i++)
+	{
+		e2::SnapshotPlayer const& player = snapshot.players[i];
+		if (!player.present)
+			continue;
+
+		e2::SnapshotPlayer const* basePlayer = baseline && baseline->players[i].present ? &baseline->players[i] : nullptr;
+		if (basePlayer)
+		{
+			bool changed = !(player == *basePlayer);
+			writer.write(changed ? 1 : 0, 1);
+			if (!changed)
+				continue;
+
+			for (uint32_t c = 0; c < 2; c++)
+				::writeDelta(writer, player.position[c] - basePlayer->position[c]);
+			for (uint32_t c = 0; c < 2; c++)
+				::writeDelta(writer, player.velocity[c] - basePlayer->velocity[c]);
+		}
+		else
+		{
+			for (uint32_t c = 0; c < 2; c++)
+				::writeFull(writer, player.position[c], e2::snapshotPositionBits);
+			for (uint32_t c = 0; c < 2; c++)
+				::writeFull(writer, player.velocity[c], e2::snapshotVelocityBits);
+		}
+	}
+
+	writer.flush();
+}
+
+bool e2::decodeSnapshot(e2::BitReader& reader, e2::SnapshotHistory const& history, e2::Snapshot& outSnapshot)
+{
+	outSnapshot = e2::Snapshot();
+	outSnapshot.sequence = uint16_t(reader.read(16));
+
+	e2::Snapshot const* baseline{};
+	if (reader.read(1))
+	{
+		uint16_t baselineOffset = uint16_t(reader.read(5));
+		baseline = history.find(uint16_t(outSnapshot.sequence - baselineOffset));
+		if (!baseline)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < e2::maxNetPlayers; i++)
+		outSnapshot.players[i].present = reader.read(1) != 0;
+
+	for (uint32_t i = 0; i < e2::maxNetPlayers; i++)
+	{
+		e2::SnapshotPlayer& player = outSnapshot.players[i];
+		if (!player.present)
+			continue;
+
+		e2::SnapshotPlayer const* basePlayer = baseline && baseline->players[i].present ? &baseline->players[i] : nullptr;
+		if (basePlayer)
+		{
+			player = *basePlayer;
+			if (!reader.read(1))
+				continue;
+
+			for (uint32_t c = 0; c < 2; c++)
+				player.position[c] += ::readDelta(reader);
+			for (uint32_t c = 0; c < 2; c++)
+				player.velocity[c] += ::readDelta(reader);
+		}
+		else
+		{
+			for (uint32_t c = 0; c < 2; c++)
+				player.position[c] = ::readFull(reader, e2::snapshotPositionBits);
+			for (uint32_t c = 0; c < 2; c++)
+				player.velocity[c] = ::readFull(reader, e2::snapshotVelocityBits);
+		}
+	}
+
+	return !reader.overflowed();
+}
+
+void e2::writeServerFrame(e2::IStream& toBuffer, bool hasProcessedInput, uint16_t lastProcessedInput, e2::BitWriter const& snapshot)
+{
+	toBuffer << e2::packetId_ServerFrame;
+	toBuffer << hasProcessedInput;
+	toBuffer << lastProcessedInput;
+	toBuffer.write(snapshot.bytes().data(), snapshot.bytes().size());
+}
+
+e2::Snapshot e2::makeSnapshot(e2::RecordedFrame const& frame)
+{
+	e2::Snapshot snapshot;
+	snapshot.sequence = uint16_t(frame.frameIndex);
+	for (e2::RecordedPlayer const& player : frame.players)
+	{
+		if (player.id < e2::maxNetPlayers)
+			snapshot.players[player.id] = e2::quantizePlayer(player.position, player.velocity);
+	}
+
+	return snapshot;
+}
+
+std::vector<e2::RecordedFrame> e2::synthesizeRecording(uint32_t numFrames, uint32_t numPlayers)
+{
+	std::mt19937 random(1337);
+	std::vector<e2::RecordedPlayer> players;
+	std::vector<e2::RecordedFrame> frames(numFrames);
+
+	constexpr float frameSeconds = 1.0f / 120.0f;
+	for (uint32_t f = 0; f < numFrames; f++)
+	{
+		// one joins every half second
+		if (players.size() < numPlayers && f % 60 == 0)
+		{
+			e2::RecordedPlayer& newPlayer = players.emplace_back();
+			newPlayer.id = uint8_t(players.size() - 1);
+			newPlayer.name = std::format("PLAYER{:02}", newPlayer.id);
+			newPlayer.position = { 200.0f + 50.0f * newPlayer.id, 500.0f };
+		}
+
+		for (e2::RecordedPlayer& player : players)
+		{
+			// same movement as the server, buttons change every now and then
+			if (std::uniform_int_distribution<uint32_t>(0, 59)(random) == 0)
+				player.velocity.x = float(std::uniform_int_distribution<int32_t>(-1, 1)(random)) * 100.0f;
+
+			player.position += player.velocity * frameSeconds;
+		}
+
+		frames[f].frameIndex = f;
+		frames[f].players = players;
+	}
+
+	return frames;
+}
+
+bool e2::replaySnapshotRecording(std::vector<e2::RecordedFrame> const& frames, float packetLoss)
+{
+	std::mt19937 random(1337);
+	auto dropped = [&random, packetLoss]() {
+		return std::uniform_real_distribution<float>(0.0f, 1.0f)(random) < packetLoss;
+	};
+
+	e2::SnapshotHistory serverHistory;
+	e2::SnapshotHistory clientHistory;
+
+	bool serverHasAck{};
+	uint16_t serverAck{};
+
+	// acks arrive this many frames late, ~50ms at 120Hz
+	constexpr uint32_t ackLag = 6;
+	std::deque<uint16_t> acksInFlight;
+
+	uint64_t legacyBytes{};
+	uint64_t deltaBytes{};
+	uint64_t numPlayerFrames{};
+	uint32_t numDropped{};
+	uint32_t numUndecodable{};
+	uint32_t numMismatched{};
+
+	e2::BitWriter writer;
+	for (e2::RecordedFrame const& frame : frames)
+	{
+		// the old full-state frame, as _handleServerFrame used to read it
+		e2::HeapStream legacy;
+		legacy << e2::packetId_ServerFrame;
+		legacy << frame.frameIndex;
+		legacy << uint8_t(frame.players.size());
+		for (e2::RecordedPlayer const& player : frame.players)
+			legacy << player.name << player.position << player.velocity;
+		legacyBytes += ::wireBytes(legacy.size());
+
+		e2::Snapshot snapshot = e2::makeSnapshot(frame);
+		serverHistory.store(snapshot);
+
+		writer.clear();
+		e2::encodeSnapshot(snapshot, serverHasAck ? serverHistory.find(serverAck) : nullptr, writer);
+
+		// the packet tickServer sends, counted the same way
+		e2::HeapStream framePacket;
+		e2::writeServerFrame(framePacket, true, uint16_t(frame.frameIndex), writer);
+		deltaBytes += ::wireBytes(framePacket.size());
+		numPlayerFrames += frame.players.size();
+
+		if (dropped())
+		{
+			numDropped++;
+		}
+		else
+		{
+			e2::BitReader reader(writer.bytes().data(), writer.bytes().size());
+			e2::Snapshot received;
+			if (!e2::decodeSnapshot(reader, clientHistory, received))
+			{
+				numUndecodable++;
+			}
+			else
+			{
+				for (uint32_t i = 0; i < e2::maxNetPlayers; i++)
+				{
+					if (!(received.players[i] == snapshot.players[i]))
+					{
+						numMismatched++;
+						break;
+					}
+				}
+
+				clientHistory.store(received);
+				acksInFlight.push_back(received.sequence);
+			}
+		}
+
+		while (acksInFlight.size() > ackLag)
+		{
+			uint16_t ack = acksInFlight.front();
+			acksInFlight.pop_front();
+			if (!dropped())
+			{
+				serverHasAck = true;
+				serverAck = ack;
+			}
+		}
+	}
+
+	double numFrames = double(glm::max<uint64_t>(frames.size(), 1));
+	double playerFrames = double(glm::max<uint64_t>(numPlayerFrames, 1));
+	bool passed = numUndecodable == 0 && numMismatched == 0 && deltaBytes < legacyBytes;
+
+	LogNotice("snapshot replay {}: {} frames, {:.1f} players on average, {:.1f}% loss. {} dropped, {} undecodable, {} mismatched",
+		passed ? "passed" : "FAILED", frames.size(), playerFrames / numFrames, packetLoss * 100.0f, numDropped, numUndecodable, numMismatched);
+	LogNotice("snapshot replay bandwidth with fragment headers: full frames {:.1f} B/frame ({:.2f} B/player), delta snapshots {:.1f} B/frame ({:.2f} B/player), {:.1f}x smaller",
+		double(legacyBytes) / numFrames, double(legacyBytes) / playerFrames, double(deltaBytes) / numFrames, double(deltaBytes) / playerFrames, double(legacyBytes) / double(glm::max<uint64_t>(deltaBytes, 1)));
+
+	return passed;
+}
+
+void e2::writeRecordedFrame(e2::IStream& toBuffer, e2::RecordedFrame const& frame)
+{
+	toBuffer << frame.frameIndex;
+	toBuffer << uint8_t(frame.players.size());
+	for (e2::RecordedPlayer const& player : frame.players)
+	{
+		std::string_view name = player.name.view();
+		uint8_t nameLength = uint8_t(glm::min<uint64_t>(name.size(), 255));
+		toBuffer << player.id << nameLength;
+		toBuffer.write(reinterpret_cast<uint8_t const*>(name.data()), nameLength);
+		toBuffer << player.position << player.velocity;
+	}
+}
+
+bool e2::readRecording(std::string const& path, std::vector<e2::RecordedFrame>& outFrames)
+{
+	outFrames.clear();
+
+	std::vector<uint8_t> bytes;
+	{
+		e2::FileStream file(path, e2::FileMode::ReadOnly);
+		uint64_t fileSize = file.size();
+		uint8_t const* fileData = file.valid() && fileSize > 0 ? file.read(fileSize) : nullptr;
+		if (!fileData)
+		{
+			LogError("failed to read recording {}", path);
+			return false;
+		}
+
+		bytes.assign(fileData, fileData + fileSize);
+	}
+
+	e2::RawMemoryStream stream(bytes.data(), bytes.size());
+	uint32_t magic{};
+	if (stream.remaining() >= sizeof(magic))
+		stream >> magic;
+
+	if (magic != e2::recordingMagic)
+	{
+		LogError("{} isn't a recording", path);
+		return false;
+	}
+
+	while (stream.remaining() > 0)
+	{
+		e2::RecordedFrame frame;
+		if (!::readRecordedFrame(stream, frame))
+		{
+			LogWarning("recording {} ends in a partial frame, keeping the {} before it", path, outFrames.size());
+			break;
+		}
+
+		outFrames.push_back(std::move(frame));
+	}
+
+	return true;
+}
@@ -5,6 +5,12 @@
 #include "bar.hpp"
 
 #include <e2/log.hpp>
+#include <e2/profiler.hpp>
+#include <e2/ui/uitextlayout.hpp>
+#include <e2/ui/uiwidgettable.hpp>
+#include <e2/assets/texturecompression.hpp>
+#include <e2/assets/meshquantization.hpp>
+#include <e2/assets/meshlod.hpp>
 
 #include "init.inl"
 
@@ -76,5 +82,19 @@ int main(int argc, char** argv)
 
 	LogNotice("PodCCC");
 
-	return 0;
+	// self tests of the engine, none of them need a window, renderer or running game. Every test runs even if one before it failed
+	bool passed = true;
+	passed &= e2::testUIWidgetTable(4096);
+	passed &= e2::testTextLayoutCache(4096);
+	passed &= e2::testBlockCompression();
+	passed &= e2::testMeshQuantization();
+	passed &= e2::testMeshLods();
+	passed &= e2::testLog();
+#if defined(E2_PROFILER)
+	passed &= e2::testProfiler();
+#endif
+
+	LogNotice("{}", passed ? "ALL PASSED" : "FAILED");
+	e2::Log::shutdown();
+	return passed ? 0 : 1;
 }
\ No newline at end of file
@@ -71,8 +71,17 @@ layout(set = MeshSetIndex, binding = 0) uniform MeshData
 
 layout(set = MeshSetIndex, binding = 1) uniform SkinData 
 {
-    mat4 skinMatrices[128]; // @todo make define
+    // 3 rows per bone, bound at the offset of the skin proxy palette
+    vec4 skinRows[128 * 3]; // @todo make define
 } skin;
+
+mat4 getSkinMatrix(uint boneId)
+{
+	vec4 row0 = skin.skinRows[boneId * 3 + 0];
+	vec4 row1 = skin.skinRows[boneId * 3 + 1];
+	vec4 row2 = skin.skinRows[boneId * 3 + 2];
+	return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
 // End Set1
 
 
@@ -2,6 +2,13 @@
 
 #define EPSILON 1e-5
 
+// normal maps are BC5, two channels, so z is rebuilt from x and y
+vec3 decodeNormalTexel(vec4 texel)
+{
+    vec2 xy = texel.xy * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(0.0, 1.0 - dot(xy, xy))));
+}
+
 const vec2 invAtan = vec2(0.1591, 0.3183);
 vec2 equirectangularUv(vec3 direction)
 {
@@ -218,4 +225,27 @@ vec4 getHex(vec2 p)
     return dot(h.xy, h.xy) < dot(h.zw, h.zw) 
         ? vec4(h.xy, hC.xy) 
         : vec4(h.zw, hC.zw + .5);
+}
+
+// local coords of the center of a hex given in offset coords, same as e2::Hex(offset).localCoords()
+vec3 hexLocalCoords(ivec2 offset)
+{
+	int x = offset.x - (offset.y - (offset.y & 1)) / 2;
+	int y = offset.y;
+	return vec3(sqrt(3.0) * float(x) + sqrt(3.0) / 2.0 * float(y), 0.0, 1.5 * float(y));
+}
+
+// rotation of angle radians around axis, same as glm::rotate(identity, angle, axis)
+mat4 axisAngleMatrix(vec3 axis, float angle)
+{
+	vec3 a = normalize(axis);
+	float c = cos(angle);
+	float s = sin(angle);
+	vec3 t = (1.0 - c) * a;
+
+	return mat4(
+		vec4(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y, 0.0),
+		vec4(t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x, 0.0),
+		vec4(t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z, 0.0),
+		vec4(0.0, 0.0, 0.0, 1.0));
 }
\ No newline at end of file
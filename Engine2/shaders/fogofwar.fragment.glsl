@@ -1,15 +1,10 @@
 #include <shaders/header.glsl>
 
-out vec4 outColor;
+flat in vec4 fragmentVisibility;
 
-// Push constants
-layout(push_constant) uniform ConstantData
-{
-    mat4 mvpMatrix;
-	vec4 visibility;
-};
+out vec4 outColor;
 
 void main()
 {
-	outColor = visibility;
+	outColor = fragmentVisibility;
 }
\ No newline at end of file
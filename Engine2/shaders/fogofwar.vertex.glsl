@@ -28,11 +28,42 @@ in uvec4 vertexIds;
 // Push constants
 layout(push_constant) uniform ConstantData
 {
-    mat4 mvpMatrix;
-	vec4 visibility;
+    mat4 vpMatrix;
+	// xy: first hex of the rect drawn, z: its width in hexes, w: 1 to show everything as visible
+	ivec4 region;
 };
 
+layout(set = 0, binding = 0) uniform texture2D visibilityTexture;
+
+flat out vec4 fragmentVisibility;
+
+#include <shaders/common/utils.glsl>
+
+// must match e2::hexChunkResolution and e2::fogOfWarTexelChunks
+const int hexChunkResolution = 6;
+const int fogOfWarTexelChunks = 32;
+
+// same as e2::FogOfWarTexels::texelCoords
+ivec2 visibilityTexelCoords(ivec2 hex)
+{
+	ivec2 chunkIndex = ivec2(floor(vec2(hex) / float(hexChunkResolution)));
+	ivec2 local = hex - chunkIndex * hexChunkResolution;
+	return (chunkIndex & ivec2(fogOfWarTexelChunks - 1)) * hexChunkResolution + local;
+}
+
 void main()
 {
-	gl_Position = mvpMatrix * vertexPosition;
+	ivec2 hex = region.xy + ivec2(gl_InstanceIndex % region.z, gl_InstanceIndex / region.z);
+	vec4 texel = texelFetch(visibilityTexture, visibilityTexelCoords(hex), 0);
+
+	// undiscovered hexes aren't drawn, collapse them to a point
+	if (texel.x < 0.5)
+	{
+		fragmentVisibility = vec4(0.0);
+		gl_Position = vec4(0.0, 0.0, -1.0, 1.0);
+		return;
+	}
+
+	fragmentVisibility = region.w != 0 ? vec4(1.0, 1.0, 0.0, 1.0) : texel;
+	gl_Position = vpMatrix * vec4(hexLocalCoords(hex) + vertexPosition.xyz, 1.0);
 }
\ No newline at end of file
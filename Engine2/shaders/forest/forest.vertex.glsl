@@ -25,6 +25,12 @@ in vec4 vertexWeights;
 in uvec4 vertexIds;
 #endif
 
+// Instance attributes, see e2::VegetationInstances
+#if defined(Renderer_Instanced)
+in vec4 instanceTransform; // position, rotation around up
+in vec4 instanceParameters; // scale, fall direction as an angle, shake start time, fall start time (negative if not started)
+#endif
+
 // Fragment attributes
 
 #if !defined(Renderer_Shadow)
@@ -52,8 +58,57 @@ out vec4 fragmentColor;
 
 %CustomDescriptorSets%
 
+#if defined(Renderer_Instanced)
+// same as e2::maxTreeFallTime, and how long a hit tree shakes
+const float treeFallTime = 4.0;
+const float treeShakeTime = 0.4;
+
+mat4 instanceMatrix(float time)
+{
+	mat4 translation = mat4(1.0);
+	translation[3] = vec4(instanceTransform.xyz, 1.0);
+
+	mat4 rotation = axisAngleMatrix(vec3(0.0, -1.0, 0.0), instanceTransform.w);
+	mat4 rotationFix = axisAngleMatrix(vec3(1.0, 0.0, 0.0), radians(90.0));
+	mat4 scale = mat4(instanceParameters.x);
+	scale[3][3] = 1.0;
+
+	// shakes in a new direction every frame, less and less
+	mat4 shake = mat4(1.0);
+	float shakeAge = time - instanceParameters.z;
+	if (instanceParameters.z >= 0.0 && shakeAge < treeShakeTime)
+	{
+		float shakeDelta = clamp(1.0 - shakeAge / treeShakeTime, 0.0, 1.0);
+		float shakeAngle = fract(sin(time * 91.7 + float(gl_InstanceIndex) * 12.9898) * 43758.5453) * 6.2831853;
+		shake = axisAngleMatrix(vec3(cos(shakeAngle), 0.0, sin(shakeAngle)), radians(4.0 * shakeDelta));
+	}
+
+	// circular ease in, like glm::circularEaseIn
+	mat4 fall = mat4(1.0);
+	if (instanceParameters.w >= 0.0)
+	{
+		float fallAlpha = clamp((time - instanceParameters.w) / treeFallTime, 0.0, 1.0);
+		float fallDelta = 1.0 - sqrt(1.0 - fallAlpha * fallAlpha);
+		fall = axisAngleMatrix(vec3(cos(instanceParameters.y), 0.0, sin(instanceParameters.y)), radians(90.0 * fallDelta));
+	}
+
+	return translation * fall * shake * rotation * rotationFix * scale;
+}
+#endif
+
 void main()
 {
+#if !defined(Renderer_Shadow)
+	vec4 time = renderer.time;
+#else 
+	vec4 time = shadowTime;
+#endif
+
+#if defined(Renderer_Instanced)
+	mat4 modelMatrix = mesh.modelMatrix * instanceMatrix(time.x);
+#else
+	mat4 modelMatrix = mesh.modelMatrix;
+#endif
 
 	vec4 meshVertex = vec4(vertexPosition.xyz, 1.0);
 #if defined(Vertex_TexCoords23)
@@ -61,7 +116,7 @@ void main()
 #else 
 	vec4 meshRoot = vec4(0.0, 0.0, 0.0, 1.0);
 #endif
-	vec4 worldRoot = mesh.modelMatrix * meshRoot;
+	vec4 worldRoot = modelMatrix * meshRoot;
 
 #if !defined(Renderer_Shadow)
 	vec4 animatedVertexNormal = vec4(vertexNormal.xyz, 0.0);
@@ -69,13 +124,7 @@ void main()
 	float tangentSign = vertexTangent.w;
 #endif
 
-	vec4 worldVertex = mesh.modelMatrix * meshVertex;
-
-#if !defined(Renderer_Shadow)
-	vec4 time = renderer.time;
-#else 
-	vec4 time = shadowTime;
-#endif
+	vec4 worldVertex = modelMatrix * meshVertex;
 
 
 	float ss = sampleSimplex(worldRoot.xz * 0.5) * 0.5 + 0.5;
@@ -94,8 +143,8 @@ void main()
 	fragmentPosition = worldVertex;
 #if defined(Vertex_Normals)
 
-	fragmentNormal = normalize(mesh.modelMatrix * normalize(animatedVertexNormal)).xyz;
-	fragmentTangent.xyz =  normalize(mesh.modelMatrix * normalize(animatedVertexTangent)).xyz;
+	fragmentNormal = normalize(modelMatrix * normalize(animatedVertexNormal)).xyz;
+	fragmentTangent.xyz =  normalize(modelMatrix * normalize(animatedVertexTangent)).xyz;
     fragmentTangent.w = tangentSign;
 	//fragmentBitangent = normalize(cross(fragmentNormal.xyz, fragmentTangent.xyz));
 #endif
@@ -90,7 +90,7 @@ void main()
 	vec3 n = normalize(fragmentNormal.xyz);
 	vec3 t = normalize(fragmentTangent.xyz);
 	vec3 b = fragmentTangent.w * cross(n, t);
-	vec3 texelNormal = normalize(texture(sampler2D(normalTexture, repeatSampler), uv).xyz * 2.0 - 1.0);
+	vec3 texelNormal = normalize(decodeNormalTexel(texture(sampler2D(normalTexture, repeatSampler), uv)));
 	//texelNormal.y = -texelNormal.y;
 	vec3 worldNormal = normalize(texelNormal.x * t + texelNormal.y * b + texelNormal.z * fragmentNormal);
 #else 
@@ -62,10 +62,10 @@ void main()
 
 #if defined(Renderer_Skin) && defined(Vertex_Bones)
 
-	mat4 animationTransform = skin.skinMatrices[vertexIds.x] * vertexWeights.x; 
-	animationTransform += skin.skinMatrices[vertexIds.y] * vertexWeights.y; 
-	animationTransform += skin.skinMatrices[vertexIds.z] * vertexWeights.z; 
-	animationTransform += skin.skinMatrices[vertexIds.w] * vertexWeights.w; 
+	mat4 animationTransform = getSkinMatrix(vertexIds.x) * vertexWeights.x; 
+	animationTransform += getSkinMatrix(vertexIds.y) * vertexWeights.y; 
+	animationTransform += getSkinMatrix(vertexIds.z) * vertexWeights.z; 
+	animationTransform += getSkinMatrix(vertexIds.w) * vertexWeights.w; 
 
 	animatedVertexPosition =  animationTransform * animatedVertexPosition;
 
@@ -5,8 +5,9 @@ out vec4 outColor;
 // Push constants
 layout(push_constant) uniform ConstantData
 {
-    mat4 mvpMatrix;
+    mat4 vpMatrix;
 	vec4 color;
+	vec4 parameters;
 };
 
 void main()
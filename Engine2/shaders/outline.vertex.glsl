@@ -28,11 +28,19 @@ in uvec4 vertexIds;
 // Push constants
 layout(push_constant) uniform ConstantData
 {
-    mat4 mvpMatrix;
-	vec3 visibility;
+    mat4 vpMatrix;
+	vec4 color;
+	// x: hex scale, y: outline layer
+	vec4 parameters;
 };
 
+layout(set = 0, binding = 1) uniform texture2D outlineTilesTexture;
+
+#include <shaders/common/utils.glsl>
+
 void main()
 {
-	gl_Position = mvpMatrix * vertexPosition;
+	// one instance per outline tile, their offset coords are in a row per layer
+	ivec2 hex = ivec2(texelFetch(outlineTilesTexture, ivec2(gl_InstanceIndex, int(parameters.y)), 0).xy);
+	gl_Position = vpMatrix * vec4(hexLocalCoords(hex) + vertexPosition.xyz * parameters.x, 1.0);
 }
\ No newline at end of file
@@ -135,9 +135,9 @@ void main()
 	
 
 
-	vec3 nmMountains = normalize(texture(sampler2D(mountainNormal, repeatSampler), texUv * texScaleMountains).xyz * 2.0 - 1.0);
+	vec3 nmMountains = normalize(decodeNormalTexel(texture(sampler2D(mountainNormal, repeatSampler), texUv * texScaleMountains)));
     //vec3 nmGreen = normalize(texture(sampler2D(greenNormal, repeatSampler), texUv * texScaleGreen).xyz * 2.0 - 1.0);
-	vec3 nmSand = normalize(texture(sampler2D(sandNormal, repeatSampler), texUv * texScaleSand).xyz * 2.0 - 1.0);
+	vec3 nmSand = normalize(decodeNormalTexel(texture(sampler2D(sandNormal, repeatSampler), texUv * texScaleSand)));
 
     nmSand.y = -nmSand.y;
     //nmGreen.y = -nmGreen.y;